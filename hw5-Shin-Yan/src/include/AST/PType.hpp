@@ -1,6 +1,8 @@
 #ifndef AST_P_TYPE_H
 #define AST_P_TYPE_H
 
+#include "driver/MemoryStats.hpp"
+
 #include <memory>
 #include <string>
 #include <vector>
@@ -9,7 +11,7 @@ class PType;
 
 using PTypeSharedPtr = std::shared_ptr<PType>;
 
-class PType {
+class PType : private CountedObject<PType, MemoryCategory::kPType> {
   public:
     enum class PrimitiveTypeEnum : uint8_t {
         kVoidType,
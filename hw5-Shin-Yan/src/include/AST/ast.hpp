@@ -1,6 +1,7 @@
 #ifndef AST_AST_NODE_H
 #define AST_AST_NODE_H
 
+#include <cstddef>
 #include <cstdint>
 
 class AstNodeVisitor;
@@ -28,6 +29,10 @@ class AstNode {
 
     const Location &getLocation() const;
 
+    // counted by --mem-report
+    static void *operator new(std::size_t p_size);
+    static void operator delete(void *p_ptr, std::size_t p_size);
+
     virtual void accept(AstNodeVisitor &p_visitor) = 0;
     virtual void visitChildNodes(AstNodeVisitor &p_visitor){};
 };
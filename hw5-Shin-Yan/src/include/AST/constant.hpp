@@ -36,6 +36,8 @@ class Constant {
     const char *getConstantValueCString() const;
 
     decltype(m_value.integer) integer() const { return m_value.integer; }
+    decltype(m_value.real) real() const { return m_value.real; }
+    decltype(m_value.boolean) boolean() const { return m_value.boolean; }
 };
 
 #endif
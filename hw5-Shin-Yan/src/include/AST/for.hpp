@@ -30,6 +30,8 @@ class ForNode final : public AstNode {
     const ConstantValueNode &getLowerBound() const;
     const ConstantValueNode &getUpperBound() const;
     const AssignmentNode *getInitialStatement() const;
+    DeclNode &getLoopVarDecl() const { return *m_loop_var_decl.get(); }
+    CompoundStatementNode &getBody() const { return *m_body.get(); }
 
     const SymbolTable *getSymbolTable() const { return m_symbol_table_ptr; }
     void setSymbolTable(const SymbolTable *p_symbol_table) {
@@ -45,6 +45,8 @@ class FunctionNode final : public AstNode {
     const DeclNodes &getParameters() const { return m_parameters; }
 
     const PType *getTypePtr() const { return m_ret_type.get(); }
+    // nullptr for a declaration without a definition
+    CompoundStatementNode *getBody() const { return m_body.get(); }
 
     const SymbolTable *getSymbolTable() const { return m_symbol_table_ptr; }
     void setSymbolTable(const SymbolTable *p_symbol_table) {
@@ -22,6 +22,9 @@ class IfNode final : public AstNode {
           m_else_body(p_else_body){}
 
     const ExpressionNode &getCondition() const { return *m_condition.get(); }
+    CompoundStatementNode &getBody() const { return *m_body.get(); }
+    // nullptr if there is no else branch
+    CompoundStatementNode *getElseBody() const { return m_else_body.get(); }
 
     void accept(AstNodeVisitor &p_visitor) override { p_visitor.visit(*this); }
     void visitChildNodes(AstNodeVisitor &p_visitor) override;
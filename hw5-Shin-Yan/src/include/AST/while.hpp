@@ -19,6 +19,7 @@ class WhileNode final : public AstNode {
         : AstNode{line, col}, m_condition(p_condition), m_body(p_body){}
 
     const ExpressionNode &getCondition() const { return *m_condition.get(); }
+    CompoundStatementNode &getBody() const { return *m_body.get(); }
 
     void accept(AstNodeVisitor &p_visitor) override { p_visitor.visit(*this); }
     void visitChildNodes(AstNodeVisitor &p_visitor) override;
@@ -0,0 +1,62 @@
+#ifndef CODEGEN_ASSEMBLY_BUFFER_H
+#define CODEGEN_ASSEMBLY_BUFFER_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// One line of the generated assembly, parsed just enough for the passes
+// that run after code generation to inspect and rewrite instructions.
+struct AsmLine {
+    enum class KindEnum : uint8_t {
+        kEmpty, // blank or comment-only line
+        kLabel,
+        kDirective,
+        kInstruction
+    };
+
+    KindEnum kind = KindEnum::kEmpty;
+    std::string label;
+    // mnemonic of an instruction or name of a directive
+    std::string op;
+    // instruction operands; a directive keeps its arguments verbatim in [0]
+    std::vector<std::string> operands;
+    std::string comment;
+
+    // the line as emitted, used for rendering until the line is rewritten
+    std::string text;
+    bool modified = false;
+
+    static AsmLine parse(const std::string &p_text);
+
+    bool isInstruction() const { return kind == KindEnum::kInstruction; }
+    bool isLabel() const { return kind == KindEnum::kLabel; }
+    bool isDirective() const { return kind == KindEnum::kDirective; }
+
+    void setInstruction(const std::string &p_op,
+                        const std::vector<std::string> &p_operands);
+    std::string render() const;
+};
+
+class AssemblyBuffer {
+  public:
+    using Lines = std::vector<AsmLine>;
+
+  private:
+    Lines m_lines;
+    // text that has not been terminated by a newline yet
+    std::string m_pending;
+
+  public:
+    ~AssemblyBuffer() = default;
+    AssemblyBuffer() = default;
+
+    void append(const std::string &p_text);
+
+    Lines &getLines() { return m_lines; }
+    const Lines &getLines() const { return m_lines; }
+
+    void write(FILE *p_out_file) const;
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef CODEGEN_C_CODE_GENERATOR_H
+#define CODEGEN_C_CODE_GENERATOR_H
+
+#include "sema/SymbolTable.hpp"
+#include "visitor/AstNodeVisitor.hpp"
+
+#include <memory>
+#include <string>
+
+class Constant;
+class ExpressionNode;
+
+// Translates a checked AST into C99 that calls the io.c functions, so that
+// a host compiler's optimizer can be used as a reference for how fast a P
+// program can run. P identifiers are prefixed with "p_" to keep them apart
+// from C keywords and the runtime.
+class CCodeGenerator final : public AstNodeVisitor {
+  private:
+    const SymbolManager *m_symbol_manager_ptr;
+    std::string m_source_file_path;
+    std::unique_ptr<FILE, decltype(&fclose)> m_output_file{nullptr, &fclose};
+    std::string m_code;
+
+    int m_indent = 0;
+    const PType *m_return_type_ptr = nullptr;
+    // C text of the last expression visited
+    std::string m_expression;
+    // nesting of expressions being translated, 0 while visiting statements
+    int m_expression_depth = 0;
+
+  public:
+    ~CCodeGenerator() = default;
+    CCodeGenerator(const std::string &p_source_file_name,
+                   const std::string &p_save_path,
+                   const SymbolManager *const p_symbol_manager);
+
+    void visit(ProgramNode &p_program) override;
+    void visit(DeclNode &p_decl) override;
+    void visit(VariableNode &p_variable) override;
+    void visit(ConstantValueNode &p_constant_value) override;
+    void visit(FunctionNode &p_function) override;
+    void visit(CompoundStatementNode &p_compound_statement) override;
+    void visit(PrintNode &p_print) override;
+    void visit(BinaryOperatorNode &p_bin_op) override;
+    void visit(UnaryOperatorNode &p_un_op) override;
+    void visit(FunctionInvocationNode &p_func_invocation) override;
+    void visit(VariableReferenceNode &p_variable_ref) override;
+    void visit(AssignmentNode &p_assignment) override;
+    void visit(ReadNode &p_read) override;
+    void visit(IfNode &p_if) override;
+    void visit(WhileNode &p_while) override;
+    void visit(ForNode &p_for) override;
+    void visit(ReturnNode &p_return) override;
+
+  private:
+    void emitLine(const std::string &p_line);
+
+    static std::string getScalarType(const PType &p_type);
+    // "int32_t p_a[3][4]"; p_suffix is appended to the name
+    static std::string declare(const std::string &p_name, const PType &p_type,
+                               const char *p_suffix = "");
+    static std::string translateConstant(const Constant &p_constant);
+
+    // C text of p_expr, converted to float if p_as_real is set
+    std::string translate(const ExpressionNode &p_expr,
+                          const bool p_as_real = false);
+};
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef CODEGEN_CODE_GEN_OPTIONS_H
+#define CODEGEN_CODE_GEN_OPTIONS_H
+
+#include "codegen/CoreModel.hpp"
+#include "codegen/PassManager.hpp"
+#include "codegen/Remarks.hpp"
+
+#include <cstdint>
+#include <string>
+
+// How values of type `real` are represented in the generated code
+enum class RealLowering : uint8_t {
+    kNative,     // leave real to the hardware (not lowered)
+    kSoftFloat,  // IEEE-754 single in integer registers, libgcc __*sf3 calls
+    kFixedPoint  // Q16.16 fixed-point in integer registers
+};
+
+struct CodeGenOptions {
+    RealLowering real_lowering = RealLowering::kNative;
+    // -march=rv32imac: emit RV32C compressed instructions
+    bool compressed = false;
+    bool size_report = false;
+    // --emit=asm|obj|asm,obj: write the .S file and/or a relocatable .o
+    bool emit_assembly = true;
+    bool emit_object = false;
+    // -mabi=ilp32d or -mabi=ilp32, recorded in the ELF header of the .o
+    bool double_float_abi = true;
+    // --profile-generate=file: count function entries, if arms and loop
+    // iterations, written to the file at exit by io.c's profileInit()
+    std::string profile_generate_path;
+    // --profile-use=file: lay out, unroll and inline by those counts
+    std::string profile_use_path;
+    // -mtune=<model>: the core the schedule pass targets
+    bool schedule = false;
+    CoreModel tune;
+    // --bounds-check: trap on array indices outside [1, size], except where
+    // the range of the index is known at compile time
+    bool bounds_check = false;
+    // -g: .loc directives that map the code of each statement back to its
+    // source line
+    bool line_table = false;
+    // --cost-report[=<model>]: the static cost of each function on a core
+    bool cost_report = false;
+    CoreModel cost_core;
+    // -O<level>, -f<pass> and -fno-<pass>
+    PassManager passes;
+    // -Rpass=, -Rpass-missed= and --remarks-output=
+    RemarkOptions remarks;
+};
+
+#endif
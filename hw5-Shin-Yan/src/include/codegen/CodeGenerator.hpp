@@ -1,16 +1,39 @@
 #ifndef CODEGEN_CODE_GENERATOR_H
 #define CODEGEN_CODE_GENERATOR_H
 
+#include "codegen/AssemblyBuffer.hpp"
+#include "codegen/CodeGenOptions.hpp"
+#include "codegen/CostReport.hpp"
+#include "codegen/PassManager.hpp"
+#include "codegen/Profile.hpp"
+#include "codegen/Remarks.hpp"
+#include "codegen/PurityAnalysis.hpp"
+#include "codegen/RangeAnalysis.hpp"
 #include "sema/SymbolTable.hpp"
 #include "visitor/AstNodeVisitor.hpp"
 
 #include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+class ExpressionNode;
+class FunctionNode;
 
 class CodeGenerator final : public AstNodeVisitor {
   private:
     const SymbolManager *m_symbol_manager_ptr;
+    const CodeGenOptions m_options;
+    const PType *m_return_type_ptr = nullptr;
     std::string m_source_file_path;
-    std::unique_ptr<FILE> m_output_file;
+    std::unique_ptr<FILE, decltype(&fclose)> m_output_file{nullptr, &fclose};
+    std::unique_ptr<FILE, decltype(&fclose)> m_object_file{nullptr, &fclose};
+    std::string m_object_file_path;
+    bool m_has_error = false;
+    AssemblyBuffer m_asm;
+    PassManager m_passes;
+    RemarkEmitter m_remarks;
     std::map<std::string, std::stack<int>> addr_stack;
     std::stack<int> label_base;
     int local_addr;
@@ -26,14 +49,96 @@ class CodeGenerator final : public AstNodeVisitor {
     bool flag_for;
     bool flag_branch;
     bool flag_for_assign;
+    bool flag_fixdiv_used = false;
+    bool flag_str_section = false;
+    // real values left to the hardware, which needs the F extension
+    bool m_needs_float = false;
+    // string literals used as values, each a .rodata label
+    int m_string_literals = 0;
+    // the condition of the current if jumps to the then arm instead of the
+    // else arm, which is laid out first
+    bool flag_branch_invert = false;
+
+    ProfileCounterMap m_profile_counters;
+    ProfileData m_profile;
+    // counter to bump at the start of the next compound statement
+    uint32_t m_pending_counter = ProfileCounterMap::kNone;
+    std::map<std::string, FunctionNode *> m_functions;
+
+    RangeAnalysis m_ranges;
+    int bounds_check_id = 0;
+
+    // a clone of a function for the known values of some of its parameters
+    struct Specialization {
+        FunctionNode *function;
+        std::vector<std::pair<size_t, int64_t>> values;
+        std::string label;
+    };
+    std::vector<Specialization> m_specializations;
+    std::map<std::string, std::string> m_specialization_labels;
+    int m_specialized_nodes = 0;
+    int m_specialize_budget = 0;
+    // the clone the next visit of a FunctionNode generates
+    const Specialization *m_specialization = nullptr;
+    // the function being generated, nullptr in main
+    const FunctionNode *m_function = nullptr;
+
+    PurityAnalysis m_purity;
+    // the loops of the code and their trip counts, for --cost-report
+    CostReport m_cost_report;
+
+    std::set<const SymbolEntry *> m_padded_arrays;
+    int m_array_bytes = 0;
+    int m_padding_bytes = 0;
 
   public:
     ~CodeGenerator() = default;
     CodeGenerator(const std::string source_file_name,
                   const std::string save_path,
-                  const SymbolManager *const p_symbol_manager);
+                  const SymbolManager *const p_symbol_manager,
+                  const CodeGenOptions &p_options = CodeGenOptions());
     void addrStackPush(const std::string p_name);
     void addrStackPop(const std::string p_name);
+    // the integrated assembler rejected the generated code
+    bool hasError() const { return m_has_error; }
+    bool needsFloatExtension() const { return m_needs_float; }
+    const AssemblyBuffer &getAssembly() const { return m_asm; }
+
+    bool isRealLowered() const {
+        return m_options.real_lowering != RealLowering::kNative;
+    }
+    int32_t encodeReal(const double p_value) const;
+    void visitAsReal(ExpressionNode &p_expr, const bool p_as_real);
+    void emitIntToReal();
+    void emitRealArithmetic(const char *p_op);
+    void emitRealComparison(const char *p_op);
+
+    bool isInstrumented() const { return !m_options.profile_generate_path.empty(); }
+    void emitProfileCounter(const uint32_t p_counter);
+    // -g: attribute the code that follows to p_location
+    void emitLocation(const Location &p_location);
+    void emitIfBranch(const char *p_mnemonic);
+    void emitZeroBranch();
+    void visitArguments(FunctionInvocationNode &p_func_invocation);
+    // copies of the body a hot for loop runs per iteration, 1 if not unrolled
+    int getUnrollFactor(ForNode &p_for);
+    bool tryInline(FunctionInvocationNode &p_func_invocation);
+    bool getConstantImmediate(const SymbolEntry &p_entry, int32_t &p_value) const;
+    bool declareConstantImmediate(const VariableNode &p_variable, const SymbolEntry &p_entry);
+    std::vector<uint64_t> getLayout(const SymbolEntry &p_entry) const;
+    int padArray(const SymbolEntry &p_entry, const int p_element_num, const Location &p_location);
+    void emitElementAddress(const VariableReferenceNode &p_variable_ref,
+                            const SymbolEntry &p_entry, const int p_addr);
+    bool getScalarElement(const VariableReferenceNode &p_variable_ref,
+                          const SymbolEntry &p_entry, int &p_element) const;
+    bool tryFullUnroll(ForNode &p_for, const SymbolEntry *p_loop_var);
+    bool tryFold(ExpressionNode &p_expr);
+    std::string getSpecialization(FunctionInvocationNode &p_func_invocation);
+    bool isMemoized(const FunctionNode &p_function) const;
+    void emitMemoWrapper(const FunctionNode &p_function);
+    // checks the index on top of the stack against [1, p_size]
+    void emitBoundsCheck(const VariableReferenceNode &p_variable_ref,
+                         const size_t p_index, const int p_size);
 
     void visit(ProgramNode &p_program) override;
     void visit(DeclNode &p_decl) override;
@@ -0,0 +1,27 @@
+#ifndef CODEGEN_CORE_MODEL_H
+#define CODEGEN_CORE_MODEL_H
+
+#include <cstdint>
+#include <string>
+
+// Timing of a single-issue in-order RV32IM core, coarse enough to be
+// written down from a datasheet. Latencies count cycles from issue until
+// the result can be used by the next instruction.
+struct CoreModel {
+    std::string name = "ideal";
+    uint32_t alu_latency = 1;
+    uint32_t load_latency = 1;
+    uint32_t mul_latency = 1;
+    uint32_t div_latency = 1;
+    // an iterative multiplier/divider holds up issue until it is done
+    bool muldiv_blocking = false;
+    // cycles lost when a branch is taken or on any jump
+    uint32_t branch_taken_penalty = 0;
+    uint32_t jump_penalty = 0;
+
+    // "ideal", "bumblebee" (GD32VF103) or "inorder" (generic 5-stage),
+    // optionally followed by ":key=value,..." overrides
+    static bool parse(const std::string &p_spec, CoreModel &p_model);
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef CODEGEN_COST_REPORT_H
+#define CODEGEN_COST_REPORT_H
+
+#include "codegen/AssemblyBuffer.hpp"
+#include "codegen/CoreModel.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+// A static estimate of what each function of the generated code costs on a
+// CoreModel, for --cost-report: the instruction mix, the frame, and the
+// cycles of each basic block when it issues in order with its inputs ready.
+// A block runs once per entry of its function, times the trip counts of
+// the loops around it. Calls are charged their jump only.
+class CostReport {
+  public:
+    struct Block {
+        std::string name;
+        uint32_t instructions = 0;
+        uint64_t cycles = 0;
+        // times the block runs per entry of the function
+        double weight = 1.0;
+        // inside a while loop, whose trips are not known
+        bool unbounded = false;
+    };
+
+    struct FunctionCost {
+        std::string name;
+        uint32_t instructions = 0;
+        uint32_t loads = 0;
+        uint32_t stores = 0;
+        uint32_t muldiv = 0;
+        uint32_t branches = 0;
+        uint32_t jumps = 0;
+        int64_t frame = 0;
+        // the deepest sp gets below its value at the entry
+        int64_t stack = 0;
+        double cycles = 0.0;
+        // some block is in a while loop, counted once per entry
+        bool unbounded = false;
+        std::vector<Block> blocks;
+    };
+
+  private:
+    struct Loop {
+        std::string exit;
+        // iterations of the loop's code per entry, -1 if unknown
+        int64_t trips;
+    };
+
+    // keyed by the label the loop's condition starts at
+    std::map<std::string, Loop> m_loops;
+    std::vector<FunctionCost> m_costs;
+
+  public:
+    ~CostReport() = default;
+    CostReport() = default;
+
+    void addLoop(const std::string &p_head, const std::string &p_exit,
+                 const int64_t p_trips);
+
+    void run(const AssemblyBuffer &p_asm, const CoreModel &p_core);
+
+    const std::vector<FunctionCost> &getCosts() const { return m_costs; }
+    void dumpCostReport(FILE *p_out_file, const std::string &p_source,
+                        const CoreModel &p_core) const;
+};
+
+#endif
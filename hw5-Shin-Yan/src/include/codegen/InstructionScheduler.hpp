@@ -0,0 +1,31 @@
+#ifndef CODEGEN_INSTRUCTION_SCHEDULER_H
+#define CODEGEN_INSTRUCTION_SCHEDULER_H
+
+#include "codegen/AssemblyBuffer.hpp"
+#include "codegen/CoreModel.hpp"
+
+#include <cstddef>
+
+// List scheduler over the basic blocks of the generated code, driven by the
+// latencies of a CoreModel. It fills the load-use and mul/div shadows of the
+// stack-machine code with independent instructions. Pushes and pops are
+// decoupled from the sp adjustments between them by rewriting the offsets
+// of the accesses that move across an "addi sp, sp, imm".
+class InstructionScheduler {
+  private:
+    struct Node;
+
+    const CoreModel m_core;
+
+  public:
+    ~InstructionScheduler() = default;
+    explicit InstructionScheduler(const CoreModel &p_core) : m_core(p_core) {}
+
+    void run(AssemblyBuffer &p_asm);
+
+  private:
+    void scheduleBlock(AssemblyBuffer::Lines &p_lines, const std::size_t p_begin,
+                       const std::size_t p_end);
+};
+
+#endif
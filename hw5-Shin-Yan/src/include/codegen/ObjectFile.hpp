@@ -0,0 +1,86 @@
+#ifndef CODEGEN_OBJECT_FILE_H
+#define CODEGEN_OBJECT_FILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// psABI relocation types used by the generated code
+enum RiscvRelocationType : uint32_t {
+    kRelocNone = 0,
+    kReloc32 = 1,
+    kRelocBranch = 16,
+    kRelocJal = 17,
+    kRelocCall = 18,
+    kRelocPcrelHi20 = 23,
+    kRelocPcrelLo12I = 24,
+    kRelocPcrelLo12S = 25,
+    kRelocHi20 = 26,
+    kRelocLo12I = 27,
+    kRelocLo12S = 28,
+    kRelocAlign = 43,
+    kRelocRvcBranch = 44,
+    kRelocRvcJump = 45,
+    kRelocRelax = 51
+};
+
+// A relocatable object held in memory: what the assembler produces and
+// what the ELF writer and the simulator consume.
+struct ObjectFile {
+    enum class SectionKind : uint8_t { kText, kData, kReadOnly, kBss };
+
+    struct Relocation {
+        uint32_t offset = 0;
+        uint32_t type = kRelocNone;
+        // index into symbols, 0 for relocations without a symbol
+        uint32_t symbol = 0;
+        int32_t addend = 0;
+    };
+
+    struct Section {
+        std::string name;
+        SectionKind kind = SectionKind::kText;
+        uint32_t align = 1;
+        // contents, left empty for kBss
+        std::vector<uint8_t> data;
+        uint32_t size = 0;
+        std::vector<Relocation> relocations;
+    };
+
+    struct Symbol {
+        enum class TypeEnum : uint8_t { kNoType, kObject, kFunction, kFile };
+
+        std::string name;
+        TypeEnum type = TypeEnum::kNoType;
+        // index into sections, -1 if the symbol is undefined
+        int section = -1;
+        uint32_t value = 0;
+        uint32_t size = 0;
+        bool global = false;
+    };
+
+    // from .loc: the source line of the instruction at an offset of a
+    // section, in the order the instructions were emitted
+    struct LineEntry {
+        int section = -1;
+        uint32_t offset = 0;
+        uint32_t line = 0;
+        uint32_t column = 0;
+    };
+
+    std::vector<Section> sections;
+    // symbols[0] is the null symbol
+    std::vector<Symbol> symbols{Symbol()};
+    std::vector<LineEntry> lines;
+    bool rvc = false;
+    bool double_float_abi = true;
+
+    int findSection(const std::string &p_name) const;
+    int findSymbol(const std::string &p_name) const;
+
+    // ELF32 relocatable object for EM_RISCV
+    void writeElf(FILE *p_out_file) const;
+};
+
+#endif
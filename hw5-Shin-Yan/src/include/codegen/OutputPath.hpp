@@ -0,0 +1,13 @@
+#ifndef CODEGEN_OUTPUT_PATH_H
+#define CODEGEN_OUTPUT_PATH_H
+
+#include <string>
+
+// The file a code generator writes for p_source_file: its name in
+// p_save_path, or in the working directory if that is empty, with the
+// extension replaced by p_extension (".S", ".o", ".s" or ".c").
+std::string getOutputFilePath(const std::string &p_source_file,
+                              const std::string &p_save_path,
+                              const std::string &p_extension);
+
+#endif
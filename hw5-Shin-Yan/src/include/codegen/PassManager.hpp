@@ -0,0 +1,110 @@
+#ifndef CODEGEN_PASS_MANAGER_H
+#define CODEGEN_PASS_MANAGER_H
+
+#include "codegen/AssemblyBuffer.hpp"
+#include "codegen/RvcCompressor.hpp"
+
+#include <bitset>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+struct CodeGenOptions;
+
+enum class OptLevel : uint8_t { kO0, kO1, kO2, kOs };
+
+// The passes of the riscv32 pipeline: the analyses, then the transformations
+// made while generating code from the AST, then those of the generated code
+// in the order they run.
+enum class PassId : uint8_t {
+    kRanges,
+    kPurity,
+    kProfile,
+    kCodeSize,
+
+    kFold,
+    kConstantImmediates,
+    kCheckElimination,
+    kLayout,
+    kScalarReplacement,
+    kSpecialize,
+    kInline,
+    kUnroll,
+    kMemoize,
+    kPadArrays,
+
+    kSchedule,
+    kCompress,
+
+    kNumPasses
+};
+
+struct PassInfo {
+    PassId id;
+    const char *name;
+    bool is_analysis;
+    // bit i is set if OptLevel i runs the pass
+    uint8_t levels;
+    // analyses the pass reads
+    std::vector<PassId> required;
+    // analyses whose results no longer describe the code once it has run
+    std::vector<PassId> invalidated;
+    const char *description;
+};
+
+// Picks the passes of an optimization level, adjusted by -f<pass> and
+// -fno-<pass> in either order. A transformation runs with the analyses it
+// requires; disabling an analysis disables the transformations that need
+// it. Analyses are computed on demand and stay valid until a pass that
+// invalidates them runs.
+class PassManager {
+  private:
+    static constexpr std::size_t kNumPasses = static_cast<std::size_t>(PassId::kNumPasses);
+
+    OptLevel m_level = OptLevel::kO2;
+    std::bitset<kNumPasses> m_forced_on;
+    std::bitset<kNumPasses> m_forced_off;
+    std::bitset<kNumPasses> m_enabled;
+    std::bitset<kNumPasses> m_valid;
+    // the code-size analysis: the generated code in rv32im and rv32imac form
+    RvcCompressor m_code_size;
+
+  public:
+    ~PassManager() = default;
+    PassManager() { resolve(); }
+
+    static const PassInfo &getInfo(const PassId p_pass);
+    // false if there is no pass of that name
+    static bool findPass(const std::string &p_name, PassId &p_pass);
+    // "0", "1", "2" or "s", as in -O<level>
+    static bool parseLevel(const char *p_text, OptLevel &p_level);
+
+    void setLevel(const OptLevel p_level);
+    OptLevel getLevel() const { return m_level; }
+    // false if there is no pass of that name
+    bool setEnabled(const std::string &p_name, const bool p_enabled);
+    bool isEnabled(const PassId p_pass) const {
+        return m_enabled[static_cast<std::size_t>(p_pass)];
+    }
+
+    bool isValid(const PassId p_analysis) const {
+        return m_valid[static_cast<std::size_t>(p_analysis)];
+    }
+    void markValid(const PassId p_analysis);
+    // p_transform has changed the code
+    void invalidate(const PassId p_transform);
+
+    const RvcCompressor &getCodeSize(const AssemblyBuffer &p_asm);
+
+    // the passes over the generated code, and --size-report between them
+    void runAssemblyPasses(AssemblyBuffer &p_asm, const CodeGenOptions &p_options,
+                           const std::string &p_source);
+
+    void dumpPasses(FILE *p_out_file) const;
+
+  private:
+    void resolve();
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef CODEGEN_PROFILE_H
+#define CODEGEN_PROFILE_H
+
+#include "visitor/AstNodeVisitor.hpp"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+class AstNode;
+
+// Numbers the profile counters of a program in AST order, so that an
+// instrumented build and a --profile-use build of the same source agree on
+// them: one at the entry of each function (the ProgramNode stands for
+// main), one for each arm of an if and one for the body of each loop.
+class ProfileCounterMap final : public AstNodeVisitor {
+  public:
+    static constexpr uint32_t kNone = UINT32_MAX;
+    // counted at the entry of main, numbered first
+    static constexpr uint32_t kMainCounter = 0;
+
+  private:
+    std::map<const AstNode *, uint32_t> m_counters;
+    uint32_t m_count = 0;
+
+  public:
+    // the first counter of p_node; an if has two, then and else
+    uint32_t getCounter(const AstNode *p_node) const;
+    uint32_t getCount() const { return m_count; }
+
+    void visit(ProgramNode &p_program) override;
+    void visit(FunctionNode &p_function) override;
+    void visit(CompoundStatementNode &p_compound_statement) override;
+    void visit(IfNode &p_if) override;
+    void visit(WhileNode &p_while) override;
+    void visit(ForNode &p_for) override;
+
+  private:
+    void allocate(const AstNode *p_node, const uint32_t p_count);
+};
+
+// Counter values written at exit by an instrumented program, see
+// profileInit() in io.c. The file is "p-profile <n>" followed by n counts,
+// one per line.
+class ProfileData {
+  private:
+    std::vector<uint64_t> m_counts;
+    uint64_t m_max = 0;
+
+  public:
+    bool load(const std::string &p_path, const uint32_t p_expected_count,
+              std::string &p_error);
+
+    bool empty() const { return m_counts.empty(); }
+    uint64_t getCount(const uint32_t p_counter) const;
+    // at least 1% of the hottest counter
+    bool isHot(const uint32_t p_counter) const;
+    // never reached in the training run
+    bool isCold(const uint32_t p_counter) const;
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef CODEGEN_PURITY_ANALYSIS_H
+#define CODEGEN_PURITY_ANALYSIS_H
+
+#include "visitor/AstNodeVisitor.hpp"
+
+#include <map>
+#include <set>
+#include <string>
+
+class SymbolManager;
+
+// Finds the functions whose result depends on their arguments alone: they
+// neither read nor write global variables, do no print or read, and call
+// only functions of the same kind. Recursion is pure unless something in
+// the cycle is not. The main program is not analyzed.
+class PurityAnalysis final : public AstNodeVisitor {
+  private:
+    struct FunctionInfo {
+        bool has_side_effects = false;
+        std::set<std::string> callees;
+    };
+
+    const SymbolManager *m_symbol_manager_ptr;
+    std::map<std::string, FunctionInfo> m_functions;
+    FunctionInfo *m_current = nullptr;
+    std::set<std::string> m_pure_functions;
+
+  public:
+    ~PurityAnalysis() = default;
+    explicit PurityAnalysis(const SymbolManager *p_symbol_manager)
+        : m_symbol_manager_ptr(p_symbol_manager) {}
+
+    bool isPure(const std::string &p_name) const {
+        return m_pure_functions.count(p_name) != 0;
+    }
+
+    void visit(ProgramNode &p_program) override;
+    void visit(FunctionNode &p_function) override;
+    void visit(CompoundStatementNode &p_compound_statement) override;
+    void visit(PrintNode &p_print) override;
+    void visit(BinaryOperatorNode &p_bin_op) override;
+    void visit(UnaryOperatorNode &p_un_op) override;
+    void visit(FunctionInvocationNode &p_func_invocation) override;
+    void visit(VariableReferenceNode &p_variable_ref) override;
+    void visit(AssignmentNode &p_assignment) override;
+    void visit(ReadNode &p_read) override;
+    void visit(IfNode &p_if) override;
+    void visit(WhileNode &p_while) override;
+    void visit(ForNode &p_for) override;
+    void visit(ReturnNode &p_return) override;
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef CODEGEN_RANGE_ANALYSIS_H
+#define CODEGEN_RANGE_ANALYSIS_H
+
+#include <cstdint>
+#include <map>
+
+class ExpressionNode;
+class SymbolEntry;
+class SymbolManager;
+
+struct ValueRange {
+    int64_t min = 0;
+    int64_t max = 0;
+
+    bool within(const int64_t p_min, const int64_t p_max) const {
+        return min >= p_min && max <= p_max;
+    }
+};
+
+// Integer ranges of expressions, from constants, the bounds of the
+// enclosing for loops, whose variables cannot be assigned in P, and the
+// parameters a specialized function is generated for. Expressions built
+// from those with +, -, *, unary minus and mod by a positive constant are
+// bounded; anything else is not. Booleans are 0 and 1, so a relation or
+// logical operator is known when its range is a single value.
+class RangeAnalysis {
+  private:
+    const SymbolManager *m_symbol_manager_ptr;
+    std::map<const SymbolEntry *, ValueRange> m_variable_ranges;
+
+  public:
+    ~RangeAnalysis() = default;
+    explicit RangeAnalysis(const SymbolManager *p_symbol_manager)
+        : m_symbol_manager_ptr(p_symbol_manager) {}
+
+    // the loop variable takes [p_lower, p_upper) in the body
+    void enterLoop(const SymbolEntry *p_var, const int64_t p_lower,
+                   const int64_t p_upper);
+    void leaveLoop(const SymbolEntry *p_var);
+    // a parameter that is never assigned holds the argument throughout
+    void bindParameter(const SymbolEntry *p_var, const int64_t p_value);
+    void unbindParameter(const SymbolEntry *p_var);
+
+    bool getRange(const ExpressionNode &p_expr, ValueRange &p_range) const;
+    bool getValue(const ExpressionNode &p_expr, int64_t &p_value) const;
+};
+
+#endif
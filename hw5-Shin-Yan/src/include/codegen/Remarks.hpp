@@ -0,0 +1,76 @@
+#ifndef CODEGEN_REMARKS_H
+#define CODEGEN_REMARKS_H
+
+#include "AST/ast.hpp"
+#include "codegen/PassManager.hpp"
+
+#include <bitset>
+#include <cstdarg>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using RemarkPasses = std::bitset<static_cast<std::size_t>(PassId::kNumPasses)>;
+
+struct RemarkOptions {
+    // -Rpass=<passes> and -Rpass-missed=<passes>
+    RemarkPasses passed;
+    RemarkPasses missed;
+    // --remarks-output=file: every remark, as JSON for a .json file and
+    // as YAML otherwise
+    std::string output_path;
+
+    // "all" or pass names separated by commas
+    static bool parsePasses(const std::string &p_list, RemarkPasses &p_passes);
+};
+
+// What a pass did or did not do to the code of a source location, and why.
+// The code generator reports each decision of a transformation here; the
+// remarks asked for are printed on stderr as they are made, like
+// diagnostics, and all of them are kept for the record file.
+class RemarkEmitter {
+  public:
+    enum class KindEnum : uint8_t { kPassed, kMissed };
+
+    struct Remark {
+        KindEnum kind;
+        PassId pass;
+        // a short identifier of the decision, stable for tools
+        std::string name;
+        Location location;
+        std::string function;
+        std::string message;
+    };
+
+  private:
+    const RemarkOptions m_options;
+    std::string m_source;
+    std::string m_function = "main";
+    std::vector<Remark> m_remarks;
+
+  public:
+    ~RemarkEmitter() = default;
+    RemarkEmitter(const RemarkOptions &p_options, const std::string &p_source)
+        : m_options(p_options), m_source(p_source) {}
+
+    // whether remarks of p_pass are printed or recorded
+    bool isEnabled(const PassId p_pass) const;
+    // the function the code being generated belongs to
+    void setFunction(const std::string &p_function) { m_function = p_function; }
+    const std::string &getFunction() const { return m_function; }
+
+    void passed(const PassId p_pass, const char *p_name, const Location &p_location,
+                const char *p_format, ...);
+    void missed(const PassId p_pass, const char *p_name, const Location &p_location,
+                const char *p_format, ...);
+
+    const std::vector<Remark> &getRemarks() const { return m_remarks; }
+    // to --remarks-output, if given
+    bool write(std::string &p_error) const;
+
+  private:
+    void emit(const KindEnum p_kind, const PassId p_pass, const char *p_name,
+              const Location &p_location, const char *p_format, va_list p_args);
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef CODEGEN_RISCV_ASSEMBLER_H
+#define CODEGEN_RISCV_ASSEMBLER_H
+
+#include "codegen/AssemblyBuffer.hpp"
+#include "codegen/ObjectFile.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Encodes the generated code straight into a relocatable object, so that
+// no external assembler is needed. It understands the RV32IMC
+// instructions, pseudo-instructions and directives the code generator
+// and the RV32C pass produce, and relocates the way GNU as does with
+// relaxation enabled.
+class RiscvAssembler {
+  private:
+    struct Operand;
+    struct OptionState {
+        bool rvc;
+        bool relax;
+    };
+
+    ObjectFile *m_object = nullptr;
+    // 1: lay out sections and define labels, 2: encode
+    int m_pass = 1;
+    int m_section = -1;
+    std::vector<int> m_section_stack;
+    std::vector<uint32_t> m_offsets;
+    OptionState m_state{false, true};
+    std::vector<OptionState> m_state_stack;
+    uint32_t m_pcrel_id = 0;
+    std::size_t m_line_number = 0;
+    // a .loc not yet attached to an instruction
+    ObjectFile::LineEntry m_pending_location;
+    std::string m_error;
+
+  public:
+    ~RiscvAssembler() = default;
+    RiscvAssembler() = default;
+
+    bool assemble(const AssemblyBuffer &p_asm, ObjectFile &p_object);
+    const std::string &getError() const { return m_error; }
+
+  private:
+    bool runPass(const AssemblyBuffer &p_asm);
+    bool error(const std::string &p_message);
+
+    bool defineLabel(const std::string &p_name);
+    uint32_t getSymbol(const std::string &p_name);
+    bool switchSection(const std::string &p_name, const std::string &p_flags,
+                       const std::string &p_type);
+    ObjectFile::Section &currentSection();
+    uint32_t currentOffset() const { return m_offsets[m_section]; }
+
+    bool directive(const AsmLine &p_line);
+    bool align(const uint32_t p_bytes);
+    bool instruction(const AsmLine &p_line);
+    bool compressedInstruction(const AsmLine &p_line);
+
+    bool parseOperand(const std::string &p_text, Operand &p_operand);
+    bool parseRegister(const std::string &p_text, uint32_t &p_reg);
+    bool parseCompressedRegister(const std::string &p_text, uint32_t &p_reg);
+    bool parseMemory(const std::string &p_text, Operand &p_offset,
+                     uint32_t &p_base);
+    bool resolveOffset(const Operand &p_target, int64_t &p_offset);
+    bool immediate(const Operand &p_operand, const unsigned p_bits,
+                   const uint32_t p_reloc, int64_t &p_value);
+
+    void emit8(const uint8_t p_byte);
+    void emit16(const uint16_t p_half);
+    void emit32(const uint32_t p_word);
+    void addRelocation(const uint32_t p_type, const uint32_t p_symbol,
+                       const int32_t p_addend, const bool p_relax);
+};
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef CODEGEN_RISCV_ISA_H
+#define CODEGEN_RISCV_ISA_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct AsmLine;
+
+// x0-x31 for an ABI or numeric register name, -1 if it is not a register
+int getRegisterNumber(const std::string &p_name);
+
+// registers reachable from the 3-bit fields of RV32C (x8-x15)
+inline bool isCompressedRegister(const int p_reg) {
+    return p_reg >= 8 && p_reg <= 15;
+}
+
+// decimal, hexadecimal or negative immediate; symbols are rejected
+bool parseImmediate(const std::string &p_str, int64_t &p_value);
+
+// split "offset(base)" into its two parts
+bool parseMemoryOperand(const std::string &p_operand, std::string &p_offset,
+                        std::string &p_base);
+
+inline bool fitsSigned(const int64_t p_value, const unsigned p_bits) {
+    return p_value >= -(int64_t{1} << (p_bits - 1)) &&
+           p_value < (int64_t{1} << (p_bits - 1));
+}
+
+// immediates scattered into the bit positions of each instruction format;
+// for U the argument is the 20-bit upper immediate
+uint32_t scatterIImmediate(const int64_t p_imm);
+uint32_t scatterSImmediate(const int64_t p_imm);
+uint32_t scatterBImmediate(const int64_t p_imm);
+uint32_t scatterUImmediate(const int64_t p_imm20);
+uint32_t scatterJImmediate(const int64_t p_imm);
+uint16_t scatterCJImmediate(const int64_t p_imm);
+uint16_t scatterCBImmediate(const int64_t p_imm);
+
+// encoded size in bytes, pseudo-instructions counted after expansion
+uint32_t getInstructionSize(const AsmLine &p_line);
+
+// follows the section directives; p_in_text.back() tells whether the
+// current section is .text, the rest are the .pushsection levels below it
+void followSection(const AsmLine &p_line, std::vector<bool> &p_in_text);
+
+#endif
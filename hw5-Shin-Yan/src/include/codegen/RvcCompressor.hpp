@@ -0,0 +1,42 @@
+#ifndef CODEGEN_RVC_COMPRESSOR_H
+#define CODEGEN_RVC_COMPRESSOR_H
+
+#include "codegen/AssemblyBuffer.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Rewrites the generated code for -march=rv32imac: the scratch registers
+// are moved into x8-x15 so that more instructions qualify, and every
+// instruction whose operands fit is replaced by its RV32C form.
+class RvcCompressor {
+  public:
+    struct FunctionSize {
+        std::string name;
+        uint32_t instructions = 0;
+        uint32_t uncompressed_bytes = 0;
+        uint32_t compressed_bytes = 0;
+    };
+
+  private:
+    std::vector<FunctionSize> m_sizes;
+
+  public:
+    ~RvcCompressor() = default;
+    RvcCompressor() = default;
+
+    void run(AssemblyBuffer &p_asm);
+    // only move the scratch registers, for passes that reorder code before
+    // run() and must see which registers end up shared
+    static void remapRegisters(AssemblyBuffer &p_asm);
+
+    const std::vector<FunctionSize> &getSizes() const { return m_sizes; }
+    void dumpSizeReport(FILE *p_out_file, const std::string &p_source) const;
+
+  private:
+    void measure(const AssemblyBuffer &p_asm, const bool p_compressed);
+};
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef CODEGEN_X86_CODE_GENERATOR_H
+#define CODEGEN_X86_CODE_GENERATOR_H
+
+#include "codegen/AssemblyBuffer.hpp"
+#include "sema/SymbolTable.hpp"
+#include "visitor/AstNodeVisitor.hpp"
+
+#include <map>
+#include <memory>
+#include <stack>
+#include <string>
+#include <vector>
+
+class Constant;
+class ExpressionNode;
+class VariableReferenceNode;
+
+// Emits x86-64 assembly (AT&T syntax, System V ABI) to be linked with a
+// host build of io.c, so that P programs can run natively. Like
+// CodeGenerator it evaluates expressions on the machine stack, one 8-byte
+// slot per value; integers and booleans live in the low 32 bits, reals
+// are IEEE-754 single precision and strings are pointers.
+class X86CodeGenerator final : public AstNodeVisitor {
+  private:
+    // where the ABI places an argument
+    struct ArgumentLocation {
+        bool sse;
+        // register number within its class, or -1 if passed on the stack
+        int reg;
+        // byte offset within the outgoing argument area
+        int stack_offset;
+    };
+
+    const SymbolManager *m_symbol_manager_ptr;
+    std::string m_source_file_path;
+    std::unique_ptr<FILE, decltype(&fclose)> m_output_file{nullptr, &fclose};
+    AssemblyBuffer m_asm;
+
+    // offsets below %rbp of the visible locals, innermost last
+    std::map<std::string, std::stack<int>> m_local_offsets;
+    std::map<std::string, int> m_string_labels;
+    int m_frame_size = 0;
+    int m_function_id = 0;
+    int m_label = 0;
+    int m_return_label = 0;
+    const PType *m_return_type_ptr = nullptr;
+    std::vector<ArgumentLocation> m_parameter_locations;
+    std::size_t m_parameter_index = 0;
+    // nesting of expressions being evaluated, 0 while visiting statements
+    int m_expression_depth = 0;
+
+  public:
+    ~X86CodeGenerator() = default;
+    X86CodeGenerator(const std::string &p_source_file_name,
+                     const std::string &p_save_path,
+                     const SymbolManager *const p_symbol_manager);
+
+    void visit(ProgramNode &p_program) override;
+    void visit(DeclNode &p_decl) override;
+    void visit(VariableNode &p_variable) override;
+    void visit(ConstantValueNode &p_constant_value) override;
+    void visit(FunctionNode &p_function) override;
+    void visit(CompoundStatementNode &p_compound_statement) override;
+    void visit(PrintNode &p_print) override;
+    void visit(BinaryOperatorNode &p_bin_op) override;
+    void visit(UnaryOperatorNode &p_un_op) override;
+    void visit(FunctionInvocationNode &p_func_invocation) override;
+    void visit(VariableReferenceNode &p_variable_ref) override;
+    void visit(AssignmentNode &p_assignment) override;
+    void visit(ReadNode &p_read) override;
+    void visit(IfNode &p_if) override;
+    void visit(WhileNode &p_while) override;
+    void visit(ForNode &p_for) override;
+    void visit(ReturnNode &p_return) override;
+
+  private:
+    static std::vector<ArgumentLocation>
+    classifyArguments(const std::vector<const PType *> &p_types,
+                      int &p_stack_size);
+
+    int allocateLocal(const std::string &p_name, const PType &p_type);
+    void popScope(const SymbolTable *p_table);
+    int getStringLabel(const std::string &p_string);
+
+    void pushConstant(const Constant &p_constant);
+
+    // push the value of p_expr, converted to real if p_as_real is set
+    void evaluate(const ExpressionNode &p_expr, const bool p_as_real = false);
+    // push the address of a variable or of an array element
+    void evaluateAddress(const VariableReferenceNode &p_variable_ref);
+    void emitCall(const char *p_name);
+    void emitFunctionPrologue(const char *p_name);
+    void emitFunctionEpilogue(const char *p_name);
+};
+
+#endif
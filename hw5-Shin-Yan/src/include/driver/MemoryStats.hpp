@@ -0,0 +1,50 @@
+#ifndef DRIVER_MEMORY_STATS_H
+#define DRIVER_MEMORY_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+
+enum class MemoryCategory : uint8_t { kAstNode, kPType, kSymbol, kNumCategories };
+
+struct MemoryCounters {
+    uint64_t created = 0;
+    uint64_t live = 0;
+    uint64_t peak_live = 0;
+    uint64_t bytes = 0;
+    uint64_t live_bytes = 0;
+};
+
+struct MemorySnapshot {
+    // every operator new and delete of the process
+    uint64_t allocations = 0;
+    uint64_t allocated_bytes = 0;
+    uint64_t frees = 0;
+    uint64_t rss_kb = 0;
+    uint64_t peak_rss_kb = 0;
+};
+
+// Counts heap allocations by replacing the global operator new, and the
+// objects of the classes that dominate the compiler's memory: AST nodes
+// through their class operator new, which sees the size of each node
+// type, and PType and symbol entries and tables through CountedObject,
+// which also sees the PTypes made by std::make_shared.
+class MemoryStats {
+  public:
+    static void add(const MemoryCategory p_category, const std::size_t p_bytes);
+    static void remove(const MemoryCategory p_category, const std::size_t p_bytes);
+    static const MemoryCounters &getCounters(const MemoryCategory p_category);
+    static const char *getCategoryName(const MemoryCategory p_category);
+
+    // the heap counters so far and the resident set size
+    static MemorySnapshot snapshot();
+};
+
+template <typename T, MemoryCategory kCategory> class CountedObject {
+  protected:
+    CountedObject() { MemoryStats::add(kCategory, sizeof(T)); }
+    CountedObject(const CountedObject &) { MemoryStats::add(kCategory, sizeof(T)); }
+    CountedObject &operator=(const CountedObject &) = default;
+    ~CountedObject() { MemoryStats::remove(kCategory, sizeof(T)); }
+};
+
+#endif
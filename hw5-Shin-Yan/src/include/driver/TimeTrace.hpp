@@ -0,0 +1,85 @@
+#ifndef DRIVER_TIME_TRACE_H
+#define DRIVER_TIME_TRACE_H
+
+#include "driver/MemoryStats.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <vector>
+
+// Wall and CPU time of the phases of a compilation, as nested spans, and
+// for --mem-report their heap allocations and resident set size. The
+// phases open a TimeScope; it costs a branch while the tracer is disabled.
+class TimeTracer {
+  public:
+    struct Span {
+        std::string name;
+        // what the span works on, e.g. the function a codegen span emits
+        std::string detail;
+        uint32_t depth = 0;
+        // microseconds from the start of the trace
+        uint64_t start = 0;
+        uint64_t wall = 0;
+        uint64_t cpu = 0;
+        // with --mem-report: the heap allocations within the span and the
+        // resident set size at its end
+        uint64_t allocations = 0;
+        uint64_t allocated_bytes = 0;
+        uint64_t rss_kb = 0;
+        uint64_t peak_rss_kb = 0;
+    };
+
+  private:
+    bool m_enabled = false;
+    bool m_memory = false;
+    std::chrono::steady_clock::time_point m_origin;
+    std::vector<Span> m_spans;
+    // indices of the spans begun and not ended, innermost last
+    std::vector<std::size_t> m_open;
+    std::vector<std::clock_t> m_open_cpu;
+    std::vector<MemorySnapshot> m_open_memory;
+
+  public:
+    static TimeTracer &get();
+
+    void enable();
+    void enableMemory();
+    bool isEnabled() const { return m_enabled; }
+
+    void begin(const char *p_name, const std::string &p_detail);
+    void end();
+
+    const std::vector<Span> &getSpans() const { return m_spans; }
+    void dumpReport(FILE *p_out_file, const std::string &p_source) const;
+    void dumpMemoryReport(FILE *p_out_file, const std::string &p_source) const;
+    // Chrome trace-event JSON, for chrome://tracing or Perfetto
+    bool writeChromeTrace(const std::string &p_path, std::string &p_error) const;
+
+  private:
+    uint64_t now() const;
+};
+
+class TimeScope {
+  private:
+    bool m_active;
+
+  public:
+    explicit TimeScope(const char *p_name, const std::string &p_detail = std::string())
+        : m_active(TimeTracer::get().isEnabled()) {
+        if (m_active) {
+            TimeTracer::get().begin(p_name, p_detail);
+        }
+    }
+    ~TimeScope() {
+        if (m_active) {
+            TimeTracer::get().end();
+        }
+    }
+    TimeScope(const TimeScope &) = delete;
+    TimeScope &operator=(const TimeScope &) = delete;
+};
+
+#endif
@@ -3,6 +3,7 @@
 
 #include "AST/PType.hpp"
 #include "AST/function.hpp"
+#include "driver/MemoryStats.hpp"
 
 #include <cstdint>
 #include <map>
@@ -38,7 +39,7 @@ class Attribute {
     const FunctionNode::DeclNodes *parameters() const;
 };
 
-class SymbolEntry {
+class SymbolEntry : private CountedObject<SymbolEntry, MemoryCategory::kSymbol> {
   public:
     enum class KindEnum : uint8_t {
         kProgramKind,
@@ -83,7 +84,7 @@ class SymbolEntry {
     const Attribute &getAttribute() const { return m_attribute; };
 };
 
-class SymbolTable {
+class SymbolTable : private CountedObject<SymbolTable, MemoryCategory::kSymbol> {
   public:
     using Entries = std::vector<std::unique_ptr<SymbolEntry>>;
 
@@ -0,0 +1,100 @@
+#ifndef SIMULATOR_SIMULATOR_H
+#define SIMULATOR_SIMULATOR_H
+
+#include "codegen/CoreModel.hpp"
+#include "codegen/ObjectFile.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+// RV32IMC instruction-set simulator. It links an ObjectFile at fixed
+// addresses, binds the undefined symbols to built-in versions of the io.c
+// runtime and the soft-float helpers, and interprets the result with a
+// pre-decoded, threaded dispatch loop. Besides executing the program it
+// counts retired instructions and estimates cycles on a CoreModel.
+class Simulator {
+  public:
+    enum class ClassEnum : uint8_t {
+        kAlu,
+        kMul,
+        kDiv,
+        kLoad,
+        kStore,
+        kBranch,
+        kJump,
+        kSystem,
+        kRuntime, // call into the built-in runtime, not an instruction
+        kCount
+    };
+
+    struct Statistics {
+        uint64_t counts[static_cast<int>(ClassEnum::kCount)] = {};
+        uint64_t branches_taken = 0;
+        uint64_t cycles = 0;
+
+        uint64_t getInstructions() const;
+    };
+
+  private:
+    struct Instruction;
+    struct RuntimeFunction;
+
+    static constexpr uint32_t kTextBase = 0x10000;
+    static constexpr uint32_t kMemorySize = 8 * 1024 * 1024;
+
+    const CoreModel m_core;
+    std::vector<uint8_t> m_memory;
+    // [kTextBase, m_text_end) is executable, including the runtime stubs
+    uint32_t m_text_end = kTextBase;
+    uint32_t m_entry = 0;
+    uint32_t m_exit_stub = 0;
+    std::vector<const RuntimeFunction *> m_stubs;
+    std::vector<Instruction> m_code;
+    Statistics m_stats;
+    std::string m_error;
+    // registered by profileInit() in an instrumented program
+    uint32_t m_profile_counters = 0;
+    uint32_t m_profile_count = 0;
+    std::string m_profile_path;
+    // --pc-profile: executions per halfword of the text, and what to
+    // attribute them to
+    bool m_count_pcs = false;
+    std::vector<uint64_t> m_pc_counts;
+    std::vector<std::pair<uint32_t, std::string>> m_functions;
+    std::vector<std::pair<uint32_t, uint32_t>> m_line_table;
+
+  public:
+    ~Simulator();
+    explicit Simulator(const CoreModel &p_core);
+
+    // place the sections, bind the runtime and apply the relocations
+    bool load(const ObjectFile &p_object, const std::string &p_entry = "main");
+    bool run();
+    // count the executions of each instruction, for writePcProfile()
+    void countPcs() { m_count_pcs = true; }
+    // the counts of the executed instructions with the functions and the
+    // source lines of the object, for lineprof.py
+    bool writePcProfile(const std::string &p_path, const std::string &p_source) const;
+
+    const Statistics &getStatistics() const { return m_stats; }
+    const std::string &getError() const { return m_error; }
+    void dumpStatistics(FILE *p_out_file, const std::string &p_source) const;
+
+  private:
+    static const RuntimeFunction *findRuntimeFunction(const std::string &p_name);
+
+    bool error(const std::string &p_message);
+    bool relocate(const ObjectFile &p_object,
+                  const std::vector<uint32_t> &p_section_addresses,
+                  const std::vector<uint32_t> &p_symbol_addresses);
+    bool decode(const uint32_t p_pc, Instruction &p_inst) const;
+    bool callRuntime(const RuntimeFunction &p_function, uint32_t *p_regs);
+    bool readString(const uint32_t p_addr, std::string &p_str) const;
+    // what io.c's profileInit() does at exit
+    bool writeProfile();
+};
+
+#endif
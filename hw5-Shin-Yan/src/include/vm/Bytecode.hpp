@@ -0,0 +1,121 @@
+#ifndef VM_BYTECODE_H
+#define VM_BYTECODE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+// A 32-bit integer (booleans are 0/1), an IEEE-754 single or a string
+union Value {
+    int32_t i;
+    float f;
+    const char *s;
+};
+
+// Operands are register numbers relative to the frame (r), global slots
+// (g), instruction indices (pc) or immediates (imm). A call's arguments
+// are placed in consecutive registers starting at `base`, which become
+// registers 0.. of the callee; the result comes back in the caller's
+// r[base].
+#define BYTECODE_OPCODES(X)                                                    \
+    X(kMov, "mov")         /* r[a] = r[b] */                                   \
+    X(kLoadImm, "li")      /* r[a] = imm b */                                  \
+    X(kLoadString, "ls")   /* r[a] = strings[b] */                             \
+    X(kGload, "gld")       /* r[a] = g[b] */                                   \
+    X(kGstore, "gst")      /* g[a] = r[b] */                                   \
+    X(kGloadIdx, "gldx")   /* r[a] = g[b + r[c]] */                            \
+    X(kGstoreIdx, "gstx")  /* g[a + r[b]] = r[c] */                            \
+    X(kLoadIdx, "ldx")     /* r[a] = r[b + r[c]] */                            \
+    X(kStoreIdx, "stx")    /* r[a + r[b]] = r[c] */                            \
+    X(kCopy, "copy")       /* r[a..a+c) = r[b..b+c) */                         \
+    X(kGcopy, "gcopy")     /* r[a..a+c) = g[b..b+c) */                         \
+    X(kAdd, "add")                                                             \
+    X(kSub, "sub")                                                             \
+    X(kMul, "mul")                                                             \
+    X(kDiv, "div")                                                             \
+    X(kMod, "mod")                                                             \
+    X(kAnd, "and")                                                             \
+    X(kOr, "or")                                                               \
+    X(kAddImm, "addi")     /* r[a] = r[b] + imm c */                           \
+    X(kMulImm, "muli")     /* r[a] = r[b] * imm c */                           \
+    X(kNeg, "neg")                                                             \
+    X(kNot, "not")                                                             \
+    X(kLt, "lt")                                                               \
+    X(kLe, "le")                                                               \
+    X(kGt, "gt")                                                               \
+    X(kGe, "ge")                                                               \
+    X(kEq, "eq")                                                               \
+    X(kNe, "ne")                                                               \
+    X(kFadd, "fadd")                                                           \
+    X(kFsub, "fsub")                                                           \
+    X(kFmul, "fmul")                                                           \
+    X(kFdiv, "fdiv")                                                           \
+    X(kFneg, "fneg")                                                           \
+    X(kFlt, "flt")                                                             \
+    X(kFle, "fle")                                                             \
+    X(kFgt, "fgt")                                                             \
+    X(kFge, "fge")                                                             \
+    X(kFeq, "feq")                                                             \
+    X(kFne, "fne")                                                             \
+    X(kIntToReal, "i2f")                                                       \
+    X(kJump, "j")          /* pc = a */                                        \
+    X(kJumpIfZero, "jz")   /* if r[a] == 0: pc = b */                          \
+    X(kJumpIfNotZero, "jnz")                                                   \
+    /* superinstructions */                                                    \
+    X(kGaddStore, "gadd")  /* g[a] += r[b], load-add-store */                  \
+    X(kBlt, "blt")         /* if r[a] < r[b]: pc = c */                        \
+    X(kBle, "ble")                                                             \
+    X(kBgt, "bgt")                                                             \
+    X(kBge, "bge")                                                             \
+    X(kBeq, "beq")                                                             \
+    X(kBne, "bne")                                                             \
+    X(kBgeImm, "bgei")     /* if r[a] >= imm b: pc = c */                      \
+    X(kForLoop, "forloop") /* if ++r[a] < imm b: pc = c */                     \
+    /* calls and the runtime */                                                \
+    X(kCall, "call")       /* call functions[a] with frame at r[b] */          \
+    X(kReturn, "ret")      /* return r[a] */                                   \
+    X(kReturnVoid, "retv")                                                     \
+    X(kPrintInt, "printi")                                                     \
+    X(kPrintReal, "printf")                                                    \
+    X(kPrintString, "prints")                                                  \
+    X(kReadInt, "readi")                                                       \
+    X(kReadReal, "readf")                                                      \
+    X(kHalt, "halt")
+
+enum class Opcode : uint8_t {
+#define BYTECODE_ENUM(name, mnemonic) name,
+    BYTECODE_OPCODES(BYTECODE_ENUM)
+#undef BYTECODE_ENUM
+    kCount
+};
+
+struct BytecodeInstruction {
+    Opcode op;
+    int32_t a = 0;
+    int32_t b = 0;
+    int32_t c = 0;
+};
+
+struct BytecodeFunction {
+    std::string name;
+    // index of the first instruction in BytecodeProgram::code
+    uint32_t entry = 0;
+    // registers used by a frame: parameters, locals, then temporaries
+    uint32_t frame_size = 0;
+};
+
+struct BytecodeProgram {
+    std::vector<BytecodeInstruction> code;
+    std::vector<BytecodeFunction> functions;
+    uint32_t main_function = 0;
+    uint32_t global_size = 0;
+    // owned storage for string constants, referenced by kLoadString
+    std::vector<std::unique_ptr<std::string>> strings;
+
+    static const char *getMnemonic(const Opcode p_op);
+    void dump(FILE *p_out_file) const;
+};
+
+#endif
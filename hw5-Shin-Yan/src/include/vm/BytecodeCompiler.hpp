@@ -0,0 +1,95 @@
+#ifndef VM_BYTECODE_COMPILER_H
+#define VM_BYTECODE_COMPILER_H
+
+#include "sema/SymbolTable.hpp"
+#include "visitor/AstNodeVisitor.hpp"
+#include "vm/Bytecode.hpp"
+
+#include <map>
+#include <stack>
+#include <string>
+#include <vector>
+
+class Constant;
+class ExpressionNode;
+class VariableReferenceNode;
+
+// Lowers a checked AST to register bytecode for the VirtualMachine. Each
+// frame owns a window of registers: parameters first, then locals (an
+// array takes one register per element), then the temporaries of the
+// statement being compiled, which are released when it ends.
+class BytecodeCompiler final : public AstNodeVisitor {
+  private:
+    struct Location {
+        bool global;
+        // global slot or frame register of the first element
+        int32_t index;
+    };
+
+    const SymbolManager *m_symbol_manager_ptr;
+    BytecodeProgram &m_program;
+    std::string m_error;
+
+    std::map<std::string, std::stack<Location>> m_locations;
+    std::map<std::string, uint32_t> m_function_ids;
+    std::map<std::string, int32_t> m_string_ids;
+    const PType *m_return_type_ptr = nullptr;
+    uint32_t m_next_register = 0;
+    uint32_t m_frame_size = 0;
+    // register holding the value of the last expression compiled
+    int32_t m_result = 0;
+    // nesting of expressions being compiled, 0 while visiting statements
+    int m_expression_depth = 0;
+
+  public:
+    ~BytecodeCompiler() = default;
+    BytecodeCompiler(const SymbolManager *const p_symbol_manager,
+                     BytecodeProgram &p_program);
+
+    bool hasError() const { return !m_error.empty(); }
+    const std::string &getError() const { return m_error; }
+
+    void visit(ProgramNode &p_program) override;
+    void visit(DeclNode &p_decl) override;
+    void visit(VariableNode &p_variable) override;
+    void visit(ConstantValueNode &p_constant_value) override;
+    void visit(FunctionNode &p_function) override;
+    void visit(CompoundStatementNode &p_compound_statement) override;
+    void visit(PrintNode &p_print) override;
+    void visit(BinaryOperatorNode &p_bin_op) override;
+    void visit(UnaryOperatorNode &p_un_op) override;
+    void visit(FunctionInvocationNode &p_func_invocation) override;
+    void visit(VariableReferenceNode &p_variable_ref) override;
+    void visit(AssignmentNode &p_assignment) override;
+    void visit(ReadNode &p_read) override;
+    void visit(IfNode &p_if) override;
+    void visit(WhileNode &p_while) override;
+    void visit(ForNode &p_for) override;
+    void visit(ReturnNode &p_return) override;
+
+  private:
+    void reportError(const std::string &p_message);
+
+    uint32_t emit(const Opcode p_op, const int32_t p_a = 0,
+                  const int32_t p_b = 0, const int32_t p_c = 0);
+    // point the jump emitted at p_index to p_target
+    void patch(const uint32_t p_index, const uint32_t p_target);
+    // make the last instruction write p_register instead of a temporary
+    bool retarget(const int32_t p_temporary, const int32_t p_register);
+
+    int32_t allocateRegisters(const uint32_t p_count = 1);
+    void popScope(const SymbolTable *p_table);
+    const Location *findLocation(const std::string &p_name) const;
+
+    void loadConstant(const int32_t p_register, const Constant &p_constant);
+    // compile p_expr, converted to real if p_as_real is set, and return the
+    // register holding its value
+    int32_t compile(const ExpressionNode &p_expr, const bool p_as_real = false);
+    // register holding the linear index of p_variable_ref's element
+    int32_t compileIndex(const VariableReferenceNode &p_variable_ref);
+    // emit a jump taken when p_condition is p_when and return its index
+    uint32_t compileBranch(const ExpressionNode &p_condition, const bool p_when);
+    void store(const VariableReferenceNode &p_lvalue, const int32_t p_value);
+};
+
+#endif
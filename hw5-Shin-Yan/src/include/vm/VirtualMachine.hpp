@@ -0,0 +1,35 @@
+#ifndef VM_VIRTUAL_MACHINE_H
+#define VM_VIRTUAL_MACHINE_H
+
+#include "vm/Bytecode.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Executes a BytecodeProgram. The code is translated into a threaded form
+// whose instructions carry the address of their handler, so that dispatch
+// is a single indirect jump (GCC's labels-as-values).
+class VirtualMachine {
+  public:
+    static constexpr uint32_t kRegisterFileSize = 1u << 20;
+    static constexpr uint32_t kMaxCallDepth = 1u << 16;
+
+  private:
+    const BytecodeProgram &m_program;
+    std::vector<Value> m_registers;
+    std::vector<Value> m_globals;
+    std::string m_error;
+    uint64_t m_executed = 0;
+
+  public:
+    explicit VirtualMachine(const BytecodeProgram &p_program);
+
+    // returns false on a runtime error
+    bool run();
+    const std::string &getError() const { return m_error; }
+    // dispatched instructions, superinstructions counting once
+    uint64_t getExecutedCount() const { return m_executed; }
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include <AST/ast.hpp>
+#include "driver/MemoryStats.hpp"
 
 // prevent the linker from complaining
 AstNode::~AstNode() {}
@@ -7,3 +8,13 @@ AstNode::AstNode(const uint32_t line, const uint32_t col)
     : location(line, col) {}
 
 const Location &AstNode::getLocation() const { return location; }
+
+void *AstNode::operator new(std::size_t p_size) {
+    MemoryStats::add(MemoryCategory::kAstNode, p_size);
+    return ::operator new(p_size);
+}
+
+void AstNode::operator delete(void *p_ptr, std::size_t p_size) {
+    MemoryStats::remove(MemoryCategory::kAstNode, p_size);
+    ::operator delete(p_ptr);
+}
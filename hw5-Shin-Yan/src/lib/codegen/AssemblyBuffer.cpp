@@ -0,0 +1,135 @@
+#include "codegen/AssemblyBuffer.hpp"
+
+#include <cctype>
+
+static std::string trim(const std::string &p_str) {
+    std::string::size_type begin = 0;
+    std::string::size_type end = p_str.size();
+    while (begin < end && std::isspace(static_cast<unsigned char>(p_str[begin]))) {
+        ++begin;
+    }
+    while (end > begin && std::isspace(static_cast<unsigned char>(p_str[end - 1]))) {
+        --end;
+    }
+    return p_str.substr(begin, end - begin);
+}
+
+AsmLine AsmLine::parse(const std::string &p_text) {
+    AsmLine line;
+    line.text = p_text;
+
+    // split off the comment, ignoring '#' inside string literals
+    std::string body = p_text;
+    bool in_string = false;
+    for (std::string::size_type i = 0; i < p_text.size(); ++i) {
+        if (p_text[i] == '"' && (i == 0 || p_text[i - 1] != '\\')) {
+            in_string = !in_string;
+        } else if (p_text[i] == '#' && !in_string) {
+            body = p_text.substr(0, i);
+            line.comment = trim(p_text.substr(i + 1));
+            break;
+        }
+    }
+    body = trim(body);
+
+    if (body.empty()) {
+        return line;
+    }
+
+    if (body.back() == ':' && body.find_first_of(" \t") == std::string::npos) {
+        line.kind = KindEnum::kLabel;
+        line.label = body.substr(0, body.size() - 1);
+        return line;
+    }
+
+    const auto op_end = body.find_first_of(" \t");
+    line.op = body.substr(0, op_end);
+    const std::string rest =
+        (op_end == std::string::npos) ? "" : trim(body.substr(op_end));
+
+    if (body[0] == '.') {
+        line.kind = KindEnum::kDirective;
+        if (!rest.empty()) {
+            line.operands.emplace_back(rest);
+        }
+        return line;
+    }
+
+    line.kind = KindEnum::kInstruction;
+    std::string::size_type begin = 0;
+    while (!rest.empty() && begin <= rest.size()) {
+        auto comma = rest.find(',', begin);
+        if (comma == std::string::npos) {
+            comma = rest.size();
+        }
+        line.operands.emplace_back(trim(rest.substr(begin, comma - begin)));
+        begin = comma + 1;
+    }
+    return line;
+}
+
+void AsmLine::setInstruction(const std::string &p_op,
+                             const std::vector<std::string> &p_operands) {
+    kind = KindEnum::kInstruction;
+    op = p_op;
+    operands = p_operands;
+    modified = true;
+}
+
+std::string AsmLine::render() const {
+    if (!modified) {
+        return text;
+    }
+
+    std::string rendered;
+    switch (kind) {
+    case KindEnum::kLabel:
+        rendered = label + ":";
+        break;
+    case KindEnum::kDirective:
+    case KindEnum::kInstruction:
+        rendered = "   " + op;
+        for (std::vector<std::string>::size_type i = 0; i < operands.size(); ++i) {
+            rendered += (i == 0) ? " " : ", ";
+            rendered += operands[i];
+        }
+        break;
+    case KindEnum::kEmpty:
+    default:
+        break;
+    }
+
+    if (!comment.empty()) {
+        constexpr std::string::size_type kCommentColumn = 24;
+        if (rendered.size() < kCommentColumn) {
+            rendered.append(kCommentColumn - rendered.size(), ' ');
+        } else {
+            rendered += " ";
+        }
+        rendered += "# " + comment;
+    }
+    return rendered;
+}
+
+void AssemblyBuffer::append(const std::string &p_text) {
+    m_pending += p_text;
+
+    std::string::size_type begin = 0;
+    auto newline = m_pending.find('\n');
+    while (newline != std::string::npos) {
+        m_lines.emplace_back(
+            AsmLine::parse(m_pending.substr(begin, newline - begin)));
+        begin = newline + 1;
+        newline = m_pending.find('\n', begin);
+    }
+    m_pending.erase(0, begin);
+}
+
+void AssemblyBuffer::write(FILE *p_out_file) const {
+    for (const auto &line : m_lines) {
+        std::fprintf(p_out_file, "%s\n", line.render().c_str());
+    }
+    if (!m_pending.empty()) {
+        std::fprintf(p_out_file, "%s", m_pending.c_str());
+    }
+}
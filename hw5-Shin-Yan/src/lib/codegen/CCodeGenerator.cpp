@@ -0,0 +1,417 @@
+#include "codegen/CCodeGenerator.hpp"
+#include "codegen/OutputPath.hpp"
+#include "visitor/AstNodeInclude.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+static std::string mangle(const std::string &p_name) {
+    return "p_" + p_name;
+}
+
+static std::string quote(const std::string &p_string) {
+    std::string quoted = "\"";
+    for (const char c : p_string) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        } else if (c < ' ' || c == 127) {
+            char escape[8];
+            snprintf(escape, sizeof(escape), "\\%03o", static_cast<unsigned char>(c));
+            quoted += escape;
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+CCodeGenerator::CCodeGenerator(const std::string &p_source_file_name,
+                               const std::string &p_save_path,
+                               const SymbolManager *const p_symbol_manager)
+    : m_symbol_manager_ptr(p_symbol_manager),
+      m_source_file_path(p_source_file_name) {
+    m_output_file.reset(
+        fopen(getOutputFilePath(p_source_file_name, p_save_path, ".c").c_str(), "w"));
+    assert(m_output_file.get() && "Failed to open output file");
+}
+
+void CCodeGenerator::emitLine(const std::string &p_line) {
+    m_code.append(4 * m_indent, ' ');
+    m_code += p_line;
+    m_code += '\n';
+}
+
+std::string CCodeGenerator::getScalarType(const PType &p_type) {
+    if (p_type.isPrimitiveReal()) {
+        return "float";
+    }
+    if (p_type.isPrimitiveBool()) {
+        return "bool";
+    }
+    if (p_type.isPrimitiveString()) {
+        return "const char *";
+    }
+    if (p_type.isPrimitiveInteger()) {
+        return "int32_t";
+    }
+    return "void";
+}
+
+std::string CCodeGenerator::declare(const std::string &p_name,
+                                    const PType &p_type, const char *p_suffix) {
+    std::string declaration = getScalarType(p_type);
+    if (declaration.back() != '*') {
+        declaration += ' ';
+    }
+    declaration += mangle(p_name) + p_suffix;
+    for (auto dimension : p_type.getDimensions()) {
+        declaration += "[" + std::to_string(dimension) + "]";
+    }
+    return declaration;
+}
+
+std::string CCodeGenerator::translateConstant(const Constant &p_constant) {
+    const PType *type = p_constant.getTypePtr();
+    if (type->isString()) {
+        return quote(p_constant.getConstantValueCString());
+    }
+    if (type->isBool()) {
+        return std::strcmp(p_constant.getConstantValueCString(), "true") == 0
+                   ? "true"
+                   : "false";
+    }
+
+    char text[32];
+    if (type->isReal()) {
+        // enough digits to round-trip a float, and always a float literal
+        snprintf(text, sizeof(text), "%.9g", static_cast<float>(p_constant.real()));
+        std::string literal = text;
+        if (literal.find_first_of(".e") == std::string::npos) {
+            literal += ".0";
+        }
+        literal += 'f';
+        return literal[0] == '-' ? "(" + literal + ")" : literal;
+    }
+    const int32_t value = static_cast<int32_t>(p_constant.integer());
+    snprintf(text, sizeof(text), value < 0 ? "(%d)" : "%d", value);
+    return text;
+}
+
+std::string CCodeGenerator::translate(const ExpressionNode &p_expr,
+                                      const bool p_as_real) {
+    ++m_expression_depth;
+    const_cast<ExpressionNode &>(p_expr).accept(*this);
+    --m_expression_depth;
+
+    if (p_as_real && p_expr.getInferredType()->isInteger()) {
+        return "(float)" + m_expression;
+    }
+    return m_expression;
+}
+
+void CCodeGenerator::visit(ProgramNode &p_program) {
+    m_code += "/* generated from " + m_source_file_path + " */\n"
+              "#include <stdbool.h>\n"
+              "#include <stdint.h>\n"
+              "#include <string.h>\n"
+              "\n"
+              "/* io.c */\n"
+              "void printInt(int value);\n"
+              "int readInt(void);\n"
+              "void printReal(float value);\n"
+              "float readReal(void);\n"
+              "void printString(char *value);\n"
+              "\n";
+
+    m_symbol_manager_ptr->reconstructHashTableFromSymbolTable(
+        p_program.getSymbolTable());
+
+    for (const auto &decl : p_program.getDeclNodes()) {
+        decl->accept(*this);
+    }
+    if (!p_program.getDeclNodes().empty()) {
+        m_code += '\n';
+    }
+    for (const auto &func : p_program.getFuncNodes()) {
+        func->accept(*this);
+    }
+
+    m_return_type_ptr = nullptr;
+    emitLine("int main(void)");
+    emitLine("{");
+    ++m_indent;
+    const_cast<CompoundStatementNode &>(p_program.getBody()).accept(*this);
+    emitLine("return 0;");
+    --m_indent;
+    emitLine("}");
+
+    m_symbol_manager_ptr->removeSymbolsFromHashTable(p_program.getSymbolTable());
+
+    fputs(m_code.c_str(), m_output_file.get());
+}
+
+void CCodeGenerator::visit(DeclNode &p_decl) {
+    p_decl.visitChildNodes(*this);
+}
+
+void CCodeGenerator::visit(VariableNode &p_variable) {
+    const SymbolEntry *entry = m_symbol_manager_ptr->lookup(p_variable.getName());
+    if (entry == nullptr) {
+        return;
+    }
+
+    // constants are folded into their references, and FunctionNode
+    // declares the parameters
+    if (entry->getKind() == SymbolEntry::KindEnum::kConstantKind ||
+        entry->getKind() == SymbolEntry::KindEnum::kParameterKind) {
+        return;
+    }
+
+    const std::string declaration =
+        declare(p_variable.getName(), *p_variable.getTypePtr()) + ";";
+    emitLine(entry->getLevel() == 0 ? "static " + declaration : declaration);
+}
+
+void CCodeGenerator::visit(ConstantValueNode &p_constant_value) {
+    m_expression = translateConstant(*p_constant_value.getConstantPtr());
+}
+
+void CCodeGenerator::visit(FunctionNode &p_function) {
+    m_symbol_manager_ptr->reconstructHashTableFromSymbolTable(
+        p_function.getSymbolTable());
+
+    // arrays are passed by value: the callee copies the caller's array
+    std::string parameters;
+    std::vector<const VariableNode *> arrays;
+    for (const auto &decl : p_function.getParameters()) {
+        for (const auto &var : decl->getVariables()) {
+            if (!parameters.empty()) {
+                parameters += ", ";
+            }
+            const PType &type = *var->getTypePtr();
+            if (type.isScalar()) {
+                parameters += declare(var->getName(), type);
+            } else {
+                parameters += declare(var->getName(), type, "_arg");
+                arrays.push_back(var.get());
+            }
+        }
+    }
+
+    m_return_type_ptr = p_function.getTypePtr();
+    std::string return_type = getScalarType(*m_return_type_ptr);
+    if (return_type.back() != '*') {
+        return_type += ' ';
+    }
+    emitLine("static " + return_type + mangle(p_function.getName()) + "(" +
+             (parameters.empty() ? "void" : parameters) + ")");
+    emitLine("{");
+    ++m_indent;
+    for (const VariableNode *array : arrays) {
+        const std::string name = mangle(array->getName());
+        emitLine(declare(array->getName(), *array->getTypePtr()) + ";");
+        emitLine("memcpy(" + name + ", " + name + "_arg, sizeof(" + name + "));");
+    }
+    if (p_function.getBody() != nullptr) {
+        p_function.getBody()->accept(*this);
+    }
+    --m_indent;
+    emitLine("}");
+    m_code += '\n';
+
+    m_return_type_ptr = nullptr;
+    m_symbol_manager_ptr->removeSymbolsFromHashTable(p_function.getSymbolTable());
+}
+
+void CCodeGenerator::visit(CompoundStatementNode &p_compound_statement) {
+    m_symbol_manager_ptr->reconstructHashTableFromSymbolTable(
+        p_compound_statement.getSymbolTable());
+
+    emitLine("{");
+    ++m_indent;
+    p_compound_statement.visitChildNodes(*this);
+    --m_indent;
+    emitLine("}");
+
+    m_symbol_manager_ptr->removeSymbolsFromHashTable(
+        p_compound_statement.getSymbolTable());
+}
+
+void CCodeGenerator::visit(PrintNode &p_print) {
+    const std::string target = translate(p_print.getTarget());
+
+    const PType *type = p_print.getTarget().getInferredType();
+    if (type->isString()) {
+        emitLine("printString((char *)" + target + ");");
+    } else if (type->isReal()) {
+        emitLine("printReal(" + target + ");");
+    } else {
+        emitLine("printInt(" + target + ");");
+    }
+}
+
+void CCodeGenerator::visit(BinaryOperatorNode &p_bin_op) {
+    const bool real = p_bin_op.getLeftOperand().getInferredType()->isReal() ||
+                      p_bin_op.getRightOperand().getInferredType()->isReal();
+    const std::string left = translate(p_bin_op.getLeftOperand(), real);
+    const std::string right = translate(p_bin_op.getRightOperand(), real);
+
+    const char *op;
+    switch (p_bin_op.getOp()) {
+    case Operator::kMultiplyOp:
+        op = "*";
+        break;
+    case Operator::kDivideOp:
+        op = "/";
+        break;
+    case Operator::kModOp:
+        op = "%";
+        break;
+    case Operator::kPlusOp:
+        op = "+";
+        break;
+    case Operator::kMinusOp:
+        op = "-";
+        break;
+    case Operator::kLessOp:
+        op = "<";
+        break;
+    case Operator::kLessOrEqualOp:
+        op = "<=";
+        break;
+    case Operator::kGreaterOp:
+        op = ">";
+        break;
+    case Operator::kGreaterOrEqualOp:
+        op = ">=";
+        break;
+    case Operator::kEqualOp:
+        op = "==";
+        break;
+    case Operator::kNotEqualOp:
+        op = "!=";
+        break;
+    // both operands are evaluated, as in the other backends
+    case Operator::kAndOp:
+        op = "&";
+        break;
+    case Operator::kOrOp:
+        op = "|";
+        break;
+    default:
+        assert(false && "unsupported binary operator");
+        op = "?";
+        break;
+    }
+    m_expression = "(" + left + " " + op + " " + right + ")";
+}
+
+void CCodeGenerator::visit(UnaryOperatorNode &p_un_op) {
+    const std::string operand = translate(p_un_op.getOperand());
+    m_expression = (p_un_op.getOp() == Operator::kNotOp ? "(!" : "(-") +
+                   operand + ")";
+}
+
+void CCodeGenerator::visit(FunctionInvocationNode &p_func_invocation) {
+    const bool statement = (m_expression_depth == 0);
+
+    std::vector<const PType *> parameter_types;
+    const SymbolEntry *entry = m_symbol_manager_ptr->lookup(p_func_invocation.getName());
+    if (entry != nullptr && entry->getKind() == SymbolEntry::KindEnum::kFunctionKind) {
+        for (const auto &decl : *entry->getAttribute().parameters()) {
+            for (const auto &var : decl->getVariables()) {
+                parameter_types.push_back(var->getTypePtr());
+            }
+        }
+    }
+
+    const auto &arguments = p_func_invocation.getArguments();
+    std::string call = mangle(p_func_invocation.getName()) + "(";
+    for (std::size_t i = 0; i < arguments.size(); ++i) {
+        if (i != 0) {
+            call += ", ";
+        }
+        const bool real = i < parameter_types.size() && parameter_types[i]->isReal();
+        call += translate(*arguments[i], real);
+    }
+    call += ")";
+
+    if (statement) {
+        emitLine(call + ";");
+    } else {
+        m_expression = call;
+    }
+}
+
+void CCodeGenerator::visit(VariableReferenceNode &p_variable_ref) {
+    const SymbolEntry *entry = m_symbol_manager_ptr->lookup(p_variable_ref.getName());
+    if (entry != nullptr && entry->getKind() == SymbolEntry::KindEnum::kConstantKind) {
+        m_expression = translateConstant(*entry->getAttribute().constant());
+        return;
+    }
+
+    // P indices start from 1
+    std::string reference = mangle(p_variable_ref.getName());
+    for (const auto &index : p_variable_ref.getIndices()) {
+        reference += "[(" + translate(*index) + ")-1]";
+    }
+    m_expression = reference;
+}
+
+void CCodeGenerator::visit(AssignmentNode &p_assignment) {
+    const VariableReferenceNode &lvalue = p_assignment.getLvalue();
+    const std::string target = translate(lvalue);
+    emitLine(target + " = " +
+             translate(p_assignment.getExpr(), lvalue.getInferredType()->isReal()) +
+             ";");
+}
+
+void CCodeGenerator::visit(ReadNode &p_read) {
+    const VariableReferenceNode &target = p_read.getTarget();
+    emitLine(translate(target) + " = " +
+             (target.getInferredType()->isReal() ? "readReal();" : "readInt();"));
+}
+
+void CCodeGenerator::visit(IfNode &p_if) {
+    emitLine("if (" + translate(p_if.getCondition()) + ")");
+    p_if.getBody().accept(*this);
+    if (p_if.getElseBody() != nullptr) {
+        emitLine("else");
+        p_if.getElseBody()->accept(*this);
+    }
+}
+
+void CCodeGenerator::visit(WhileNode &p_while) {
+    emitLine("while (" + translate(p_while.getCondition()) + ")");
+    p_while.getBody().accept(*this);
+}
+
+void CCodeGenerator::visit(ForNode &p_for) {
+    m_symbol_manager_ptr->reconstructHashTableFromSymbolTable(
+        p_for.getSymbolTable());
+
+    emitLine("{");
+    ++m_indent;
+    p_for.getLoopVarDecl().accept(*this);
+
+    // the upper bound is exclusive, as in CodeGenerator
+    const std::string counter =
+        mangle(p_for.getInitialStatement()->getLvalue().getName());
+    emitLine("for (" + counter + " = " +
+             translateConstant(*p_for.getLowerBound().getConstantPtr()) + "; " +
+             counter + " < " +
+             translateConstant(*p_for.getUpperBound().getConstantPtr()) + "; " +
+             "++" + counter + ")");
+    p_for.getBody().accept(*this);
+    --m_indent;
+    emitLine("}");
+
+    m_symbol_manager_ptr->removeSymbolsFromHashTable(p_for.getSymbolTable());
+}
+
+void CCodeGenerator::visit(ReturnNode &p_return) {
+    const bool real = m_return_type_ptr != nullptr && m_return_type_ptr->isReal();
+    emitLine("return " + translate(p_return.getReturnValue(), real) + ";");
+}
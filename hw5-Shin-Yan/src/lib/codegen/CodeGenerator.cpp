@@ -1,12 +1,17 @@
 #include "codegen/CodeGenerator.hpp"
+#include "codegen/OutputPath.hpp"
+#include "codegen/RiscvAssembler.hpp"
+#include "driver/TimeTrace.hpp"
 #include "visitor/AstNodeInclude.hpp"
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstdarg>
 #include <cstdio>
 #include <cstring>
 #include <iostream>
+#include <set>
 void CodeGenerator::addrStackPush(const std::string p_name){
     if(addr_stack.find(p_name) != addr_stack.end()){
         addr_stack[p_name].push(local_addr);
@@ -31,27 +36,22 @@ void CodeGenerator::addrStackPop(const std::string p_name){
 
 CodeGenerator::CodeGenerator(const std::string source_file_name,
                              const std::string save_path,
-                             const SymbolManager *const p_symbol_manager)
-    : m_symbol_manager_ptr(p_symbol_manager),
-      m_source_file_path(source_file_name) {
-    // FIXME: assume that the source file is always xxxx.p
-    const std::string &real_path =
-        (save_path == "") ? std::string{"."} : save_path;
-    auto slash_pos = source_file_name.rfind("/");
-    auto dot_pos = source_file_name.rfind(".");
-
-    assert(dot_pos != std::string::npos && source_file_name[dot_pos+1]=='p' && "file not recognized");
-
-    if (slash_pos != std::string::npos) {
-        ++slash_pos;
-    } else {
-        slash_pos = 0;
-    }
-    std::string output_file_path(
-        real_path + "/" +
-        source_file_name.substr(slash_pos, dot_pos - slash_pos) + ".S");
-    m_output_file.reset(fopen(output_file_path.c_str(), "w"));
-    assert(m_output_file.get() && "Failed to open output file");
+                             const SymbolManager *const p_symbol_manager,
+                             const CodeGenOptions &p_options)
+    : m_symbol_manager_ptr(p_symbol_manager), m_options(p_options),
+      m_source_file_path(source_file_name), m_passes(p_options.passes),
+      m_remarks(p_options.remarks, source_file_name),
+      m_ranges(p_symbol_manager),
+      m_purity(p_symbol_manager) {
+    if (m_options.emit_assembly) {
+        m_output_file.reset(fopen(getOutputFilePath(source_file_name, save_path, ".S").c_str(), "w"));
+        assert(m_output_file.get() && "Failed to open output file");
+    }
+    if (m_options.emit_object) {
+        m_object_file_path = getOutputFilePath(source_file_name, save_path, ".o");
+        m_object_file.reset(fopen(m_object_file_path.c_str(), "wb"));
+        assert(m_object_file.get() && "Failed to open output file");
+    }
     local_addr = 8;
     parameter_id = 0;
     label = 1;
@@ -66,11 +66,940 @@ CodeGenerator::CodeGenerator(const std::string source_file_name,
     flag_for_assign = false;
 }
 
-static void dumpInstructions(FILE *p_out_file, const char *format, ...) {
+// same threshold as the default -G of the GNU toolchain
+static constexpr int kSmallDataLimit = 8;
+
+static void dumpInstructions(AssemblyBuffer &p_asm, const char *format, ...) {
     va_list args;
+    va_list args_copy;
     va_start(args, format);
-    vfprintf(p_out_file, format, args);
+    va_copy(args_copy, args);
+    const int length = vsnprintf(nullptr, 0, format, args);
     va_end(args);
+
+    std::string text(length, '\0');
+    vsnprintf(&text[0], length + 1, format, args_copy);
+    va_end(args_copy);
+    p_asm.append(text);
+}
+
+// loop bodies are unrolled up to this many AST nodes in total
+static constexpr int kUnrollBudget = 64;
+// frame bytes the inliner may use below the 120(s0) register save area
+static constexpr int kFrameLimit = 112;
+// for loops of up to this many iterations are expanded so that the
+// elements of arrays up to kScalarReplaceLimit elements become scalars
+static constexpr int kFullUnrollTrips = 8;
+static constexpr int kScalarReplaceLimit = 16;
+// clones for constant arguments may add up to this percentage to the AST
+// nodes of the program
+static constexpr int kSpecializeGrowth = 50;
+// arguments in [0, kMemoEntries) of a memoized function have a table entry
+static constexpr int kMemoEntries = 1024;
+
+namespace {
+
+// What the profile-guided transformations need to know about a subtree
+class SubtreeInfo final : public AstNodeVisitor {
+  public:
+    std::vector<const VariableReferenceNode *> references;
+    std::set<std::string> assigned;
+    // of the if and while statements
+    std::vector<const ExpressionNode *> conditions;
+    const ReturnNode *return_node = nullptr;
+    int nodes = 0;
+    int statements = 0;
+    bool has_declaration = false;
+    bool has_control_flow = false;
+    bool has_call = false;
+
+    void visit(DeclNode &p_decl) override { has_declaration = true; }
+    void visit(FunctionNode &p_function) override { p_function.visitChildNodes(*this); }
+    void visit(CompoundStatementNode &p_compound_statement) override {
+        ++nodes;
+        p_compound_statement.visitChildNodes(*this);
+    }
+    void visit(PrintNode &p_print) override { visitStatement(p_print); }
+    void visit(AssignmentNode &p_assignment) override {
+        assigned.insert(p_assignment.getLvalue().getName());
+        visitStatement(p_assignment);
+    }
+    void visit(ReadNode &p_read) override {
+        assigned.insert(p_read.getTarget().getName());
+        visitStatement(p_read);
+    }
+    void visit(IfNode &p_if) override {
+        has_control_flow = true;
+        conditions.push_back(&p_if.getCondition());
+        visitStatement(p_if);
+    }
+    void visit(WhileNode &p_while) override {
+        has_control_flow = true;
+        conditions.push_back(&p_while.getCondition());
+        visitStatement(p_while);
+    }
+    void visit(ForNode &p_for) override {
+        has_control_flow = true;
+        visitStatement(p_for);
+    }
+    void visit(ReturnNode &p_return) override {
+        has_control_flow = true;
+        return_node = &p_return;
+        visitStatement(p_return);
+    }
+    void visit(ConstantValueNode &p_constant_value) override { ++nodes; }
+    void visit(BinaryOperatorNode &p_bin_op) override {
+        ++nodes;
+        p_bin_op.visitChildNodes(*this);
+    }
+    void visit(UnaryOperatorNode &p_un_op) override {
+        ++nodes;
+        p_un_op.visitChildNodes(*this);
+    }
+    void visit(FunctionInvocationNode &p_func_invocation) override {
+        has_call = true;
+        ++nodes;
+        p_func_invocation.visitChildNodes(*this);
+    }
+    void visit(VariableReferenceNode &p_variable_ref) override {
+        references.push_back(&p_variable_ref);
+        ++nodes;
+        p_variable_ref.visitChildNodes(*this);
+    }
+
+  private:
+    void visitStatement(AstNode &p_statement) {
+        ++statements;
+        ++nodes;
+        p_statement.visitChildNodes(*this);
+    }
+};
+
+bool isBranchingCondition(const ExpressionNode &p_condition) {
+    if (const auto *bin_op = dynamic_cast<const BinaryOperatorNode *>(&p_condition)) {
+        switch (bin_op->getOp()) {
+        case Operator::kLessOp:
+        case Operator::kLessOrEqualOp:
+        case Operator::kGreaterOp:
+        case Operator::kGreaterOrEqualOp:
+        case Operator::kEqualOp:
+        case Operator::kNotEqualOp:
+        case Operator::kAndOp:
+        case Operator::kOrOp:
+            return true;
+        default:
+            return false;
+        }
+    }
+    if (const auto *un_op = dynamic_cast<const UnaryOperatorNode *>(&p_condition))
+        return un_op->getOp() == Operator::kNotOp;
+    return dynamic_cast<const VariableReferenceNode *>(&p_condition) != nullptr;
+}
+
+// whether a condition reads nothing but the scalar parameters in p_bound,
+// so that it folds in a clone binding them
+bool isKnownWith(const ExpressionNode &p_condition, const std::set<std::string> &p_bound) {
+    SubtreeInfo condition;
+    const_cast<ExpressionNode &>(p_condition).accept(condition);
+    return !condition.has_call && !condition.references.empty() &&
+           std::all_of(condition.references.begin(), condition.references.end(),
+                       [&](const VariableReferenceNode *p_ref) {
+                           return p_ref->getIndices().empty() && p_bound.count(p_ref->getName()) != 0;
+                       });
+}
+
+} // namespace
+
+int32_t CodeGenerator::encodeReal(const double p_value) const {
+    if(m_options.real_lowering == RealLowering::kFixedPoint)
+        return static_cast<int32_t>(std::lround(p_value * 65536.0));
+
+    // IEEE-754 single precision bit pattern
+    const float value = static_cast<float>(p_value);
+    int32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+void CodeGenerator::visitAsReal(ExpressionNode &p_expr, const bool p_as_real){
+    p_expr.accept(*this);
+    if(p_as_real && isRealLowered() && p_expr.getInferredType()->isInteger())
+        emitIntToReal();
+}
+
+void CodeGenerator::emitIntToReal(){
+    if(m_options.real_lowering == RealLowering::kFixedPoint){
+        constexpr const char*const riscv_assembly_int_to_fixed =
+        "   lw t0, 0(sp)        # load the integer on the top of the stack\n"
+        "   slli t0, t0, 16     # convert it to Q16.16\n"
+        "   sw t0, 0(sp)        # replace it with the real value\n";
+        dumpInstructions(m_asm, riscv_assembly_int_to_fixed);
+    }
+    else{
+        constexpr const char*const riscv_assembly_int_to_float =
+        "   lw a0, 0(sp)        # load the integer on the top of the stack\n"
+        "   jal ra, __floatsisf # convert it to single precision\n"
+        "   sw a0, 0(sp)        # replace it with the real value\n";
+        dumpInstructions(m_asm, riscv_assembly_int_to_float);
+    }
+}
+
+// operands are in t1 (left) and t0 (right), the result is left in t0
+void CodeGenerator::emitRealArithmetic(const char *p_op){
+    constexpr const char*const riscv_assembly_real_call =
+    "   mv a0, t1\n"
+    "   mv a1, t0\n"
+    "   jal ra, %s     # call real routine '%s'\n"
+    "   mv t0, a0\n";
+
+    if(m_options.real_lowering == RealLowering::kFixedPoint){
+        if(std::strcmp(p_op, "+")==0){
+            dumpInstructions(m_asm, "   add t0, t1, t0\n");
+        }
+        else if(std::strcmp(p_op, "-")==0){
+            dumpInstructions(m_asm, "   sub t0, t1, t0\n");
+        }
+        else if(std::strcmp(p_op, "*")==0){
+            constexpr const char*const riscv_assembly_fixed_mul =
+            "   mul t2, t1, t0      # low word of the 64-bit product\n"
+            "   mulh t0, t1, t0     # high word of the 64-bit product\n"
+            "   srli t2, t2, 16\n"
+            "   slli t0, t0, 16\n"
+            "   or t0, t0, t2       # keep the middle 32 bits\n";
+            dumpInstructions(m_asm, riscv_assembly_fixed_mul);
+        }
+        else{
+            dumpInstructions(m_asm, riscv_assembly_real_call, "__pfixdiv", "__pfixdiv");
+            flag_fixdiv_used = true;
+        }
+        return;
+    }
+
+    const char *routine = "__addsf3";
+    if(std::strcmp(p_op, "-")==0)
+        routine = "__subsf3";
+    else if(std::strcmp(p_op, "*")==0)
+        routine = "__mulsf3";
+    else if(std::strcmp(p_op, "/")==0)
+        routine = "__divsf3";
+    dumpInstructions(m_asm, riscv_assembly_real_call, routine, routine);
+}
+
+// reduce a real comparison to an integer comparison of t1 against t0
+void CodeGenerator::emitRealComparison(const char *p_op){
+    // Q16.16 values are ordered like integers
+    if(m_options.real_lowering == RealLowering::kFixedPoint)
+        return;
+
+    const char *routine = "__eqsf2";
+    if(std::strcmp(p_op, "<")==0)
+        routine = "__ltsf2";
+    else if(std::strcmp(p_op, "<=")==0)
+        routine = "__lesf2";
+    else if(std::strcmp(p_op, ">")==0)
+        routine = "__gtsf2";
+    else if(std::strcmp(p_op, ">=")==0)
+        routine = "__gesf2";
+    else if(std::strcmp(p_op, "<>")==0)
+        routine = "__nesf2";
+
+    constexpr const char*const riscv_assembly_real_cmp =
+    "   mv a0, t1\n"
+    "   mv a1, t0\n"
+    "   jal ra, %s      # compare reals, the sign of a0 holds the result\n"
+    "   mv t1, a0\n"
+    "   li t0, 0\n";
+    dumpInstructions(m_asm, riscv_assembly_real_cmp, routine);
+}
+
+void CodeGenerator::emitProfileCounter(const uint32_t p_counter){
+    constexpr const char*const riscv_assembly_profile_counter =
+    "   lui t0, %%hi(__pprof_counters+%u)\n"
+    "   lw t1, %%lo(__pprof_counters+%u)(t0) # profile counter %u\n"
+    "   addi t1, t1, 1\n"
+    "   sw t1, %%lo(__pprof_counters+%u)(t0)\n";
+    const uint32_t offset = p_counter * 4;
+    dumpInstructions(m_asm, riscv_assembly_profile_counter, offset, offset, p_counter, offset);
+}
+
+// branch of an if condition comparing t1 with t0 to the else arm, or to the
+// then arm when the arms are swapped
+void CodeGenerator::emitIfBranch(const char *p_mnemonic){
+    static const struct {
+        const char *mnemonic;
+        const char *relation;
+        const char *inverse;
+    } kBranches[] = {
+        {"bgt", ">", "ble"}, {"ble", "<=", "bgt"},
+        {"bge", ">=", "blt"}, {"blt", "<", "bge"},
+        {"bne", "!=", "beq"}, {"beq", "=", "bne"},
+    };
+    const char *mnemonic = p_mnemonic;
+    if(flag_branch_invert){
+        for(const auto &branch : kBranches){
+            if(std::strcmp(branch.mnemonic, p_mnemonic) == 0)
+                mnemonic = branch.inverse;
+        }
+    }
+    for(const auto &branch : kBranches){
+        if(std::strcmp(branch.mnemonic, mnemonic) == 0){
+            dumpInstructions(m_asm, "   %s t1, t0, L%d      # if t1 %s t0, jump to L%d\n",
+                             mnemonic, label_id+1, branch.relation, label_id+1);
+            return;
+        }
+    }
+    assert(false && "unknown branch");
+}
+
+// branches if the boolean in t1 is false (true when inverted), to the else
+// arm of an if or out of a while
+void CodeGenerator::emitZeroBranch(){
+    constexpr const char*const riscv_assembly_zero_branch =
+    "   %s t1, zero, L%d      # if t1 %s 0, jump to L%d\n";
+    const int target = flag_if ? label_id+1 : label_id+2;
+    dumpInstructions(m_asm, riscv_assembly_zero_branch, flag_branch_invert ? "bne" : "beq",
+                     target, flag_branch_invert ? "!=" : "==", target);
+}
+
+void CodeGenerator::visitArguments(FunctionInvocationNode &p_func_invocation){
+    flag_funcInvocation = true;
+    if(isRealLowered()){
+        // integer arguments passed to real parameters are converted first
+        std::vector<const PType *> parameter_types;
+        const SymbolEntry *entry = m_symbol_manager_ptr->lookup(p_func_invocation.getName());
+        if(entry != nullptr && entry->getKind() == SymbolEntry::KindEnum::kFunctionKind){
+            for(const auto &decl : *entry->getAttribute().parameters()){
+                for(const auto &var : decl->getVariables())
+                    parameter_types.push_back(var->getTypePtr());
+            }
+        }
+        const auto &arguments = p_func_invocation.getArguments();
+        for(size_t i = 0; i < arguments.size(); ++i){
+            const bool as_real = i < parameter_types.size() && parameter_types[i]->isReal();
+            visitAsReal(*arguments[i], as_real);
+        }
+    }
+    else
+        p_func_invocation.visitChildNodes(*this);
+    flag_funcInvocation = false;
+}
+
+int CodeGenerator::getUnrollFactor(ForNode &p_for) {
+    if(!m_passes.isEnabled(PassId::kUnroll) || m_profile.empty())
+        return 1;
+    const uint32_t counter = m_profile_counters.getCounter(&p_for);
+    if(!m_profile.isHot(counter)){
+        m_remarks.missed(PassId::kUnroll, "NotHot", p_for.getLocation(),
+                         "loop not unrolled: its body ran %llu times in the training run, under 1%% of the hottest count",
+                         static_cast<unsigned long long>(m_profile.getCount(counter)));
+        return 1;
+    }
+    // straight-line bodies only: nested compounds carry the loop's labels
+    SubtreeInfo body;
+    p_for.getBody().accept(body);
+    if(body.has_declaration || body.has_control_flow){
+        m_remarks.missed(PassId::kUnroll, "ControlFlow", p_for.getLocation(),
+                         "loop not unrolled: its body has declarations or control flow");
+        return 1;
+    }
+    const int64_t trip_count = p_for.getUpperBound().getConstantPtr()->integer() -
+                               p_for.getLowerBound().getConstantPtr()->integer();
+    for(const int factor : {4, 2}){
+        if(trip_count >= factor && trip_count % factor == 0 &&
+           body.nodes * factor <= kUnrollBudget){
+            m_remarks.passed(PassId::kUnroll, "Unrolled", p_for.getLocation(),
+                             "loop unrolled by a factor of %d (%lld iterations)", factor,
+                             static_cast<long long>(trip_count));
+            return factor;
+        }
+    }
+    if(trip_count < 2 || trip_count % 2 != 0)
+        m_remarks.missed(PassId::kUnroll, "TripCount", p_for.getLocation(),
+                         "loop not unrolled: %lld iterations are not a multiple of 2 or 4",
+                         static_cast<long long>(trip_count));
+    else
+        m_remarks.missed(PassId::kUnroll, "TooLarge", p_for.getLocation(),
+                         "loop not unrolled: 2 copies of its body of %d AST nodes exceed the budget of %d",
+                         body.nodes, kUnrollBudget);
+    return 1;
+}
+
+// Expands a call to a hot function whose body is a single return of an
+// expression over its scalar parameters and globals, with the arguments
+// stored to fresh slots of the caller's frame.
+bool CodeGenerator::tryInline(FunctionInvocationNode &p_func_invocation){
+    if(!m_passes.isEnabled(PassId::kInline) || m_profile.empty() || flag_glb_const)
+        return false;
+    auto it = m_functions.find(p_func_invocation.getName());
+    if(it == m_functions.end() || it->second->getBody() == nullptr)
+        return false;
+    const Location &location = p_func_invocation.getLocation();
+    const char *name = p_func_invocation.getNameCString();
+    if(flag_branch){
+        m_remarks.missed(PassId::kInline, "InCondition", location,
+                         "'%s' not inlined: the call is the condition of a branch", name);
+        return false;
+    }
+    FunctionNode &callee = *it->second;
+    if(!m_profile.isHot(m_profile_counters.getCounter(&callee))){
+        m_remarks.missed(PassId::kInline, "NotHot", location,
+                         "'%s' not inlined: it is not hot in the training run", name);
+        return false;
+    }
+    if(!callee.getTypePtr()->isScalar() || callee.getTypePtr()->isString() ||
+       callee.getSymbolTable() == nullptr){
+        m_remarks.missed(PassId::kInline, "Signature", location,
+                         "'%s' not inlined: it does not return a scalar", name);
+        return false;
+    }
+
+    std::vector<const SymbolEntry *> parameters;
+    for(const auto &entry : callee.getSymbolTable()->getEntries()){
+        if(entry->getKind() != SymbolEntry::KindEnum::kParameterKind)
+            continue;
+        if(!entry->getTypePtr()->isScalar() || entry->getTypePtr()->isString()){
+            m_remarks.missed(PassId::kInline, "Signature", location,
+                             "'%s' not inlined: parameter '%s' is not a scalar", name,
+                             entry->getNameCString());
+            return false;
+        }
+        parameters.push_back(entry.get());
+    }
+    if(parameters.size() != p_func_invocation.getArguments().size())
+        return false;
+    const int slots_addr = local_addr;
+    if(slots_addr + 4 * static_cast<int>(parameters.size()) > kFrameLimit){
+        m_remarks.missed(PassId::kInline, "FrameFull", location,
+                         "'%s' not inlined: the frame of '%s' has no room for its parameters",
+                         name, m_remarks.getFunction().c_str());
+        return false;
+    }
+
+    SubtreeInfo body;
+    callee.getBody()->accept(body);
+    if(body.has_declaration || body.has_call || body.statements != 1 ||
+       body.return_node == nullptr){
+        m_remarks.missed(PassId::kInline, "NotLeaf", location,
+                         "'%s' not inlined: its body is not a single return without calls", name);
+        return false;
+    }
+    for(const auto *reference : body.references){
+        const bool is_parameter = std::any_of(parameters.begin(), parameters.end(),
+            [&](const SymbolEntry *p_entry){ return p_entry->getName() == reference->getName(); });
+        if(is_parameter)
+            continue;
+        // anything else has to mean the same global here as in the callee
+        const SymbolEntry *entry = m_symbol_manager_ptr->lookup(reference->getName());
+        if(entry == nullptr || entry->getLevel() != 0){
+            m_remarks.missed(PassId::kInline, "Shadowed", location,
+                             "'%s' not inlined: '%s' is not the same global at the call",
+                             name, reference->getNameCString());
+            return false;
+        }
+    }
+    m_remarks.passed(PassId::kInline, "Inlined", location, "'%s' inlined into '%s'", name,
+                     m_remarks.getFunction().c_str());
+
+    dumpInstructions(m_asm, "\n# inlined function invocation: %s\n", p_func_invocation.getNameCString());
+    visitArguments(p_func_invocation);
+    constexpr const char*const riscv_assembly_inline_arg =
+    "   lw t0, 0(sp)        # pop the value from the stack\n"
+    "   addi sp, sp, 4\n"
+    "   sw t0, -%d(s0)      # save the value to %s\n";
+    for(int i = parameters.size() - 1; i >= 0; --i)
+        dumpInstructions(m_asm, riscv_assembly_inline_arg, slots_addr + 4 * i + 4, parameters[i]->getNameCString());
+
+    m_symbol_manager_ptr->reconstructHashTableFromSymbolTable(callee.getSymbolTable());
+    for(size_t i = 0; i < parameters.size(); ++i){
+        local_addr = slots_addr + 4 * i;
+        addrStackPush(parameters[i]->getName());
+    }
+    local_addr = slots_addr + 4 * parameters.size();
+    visitAsReal(const_cast<ExpressionNode &>(body.return_node->getReturnValue()),
+                callee.getTypePtr()->isReal());
+    for(const auto *parameter : parameters)
+        addrStackPop(parameter->getName());
+    m_symbol_manager_ptr->removeSymbolsFromHashTable(callee.getSymbolTable());
+    local_addr = slots_addr;
+    dumpInstructions(m_asm, "\n");
+    return true;
+}
+
+// Uses of a named integer or boolean constant, or of a real one in integer
+// registers, load it as an immediate; such a constant needs no storage.
+bool CodeGenerator::getConstantImmediate(const SymbolEntry &p_entry, int32_t &p_value) const {
+    const Constant *constant = p_entry.getKind() == SymbolEntry::KindEnum::kConstantKind
+                                   ? p_entry.getAttribute().constant() : nullptr;
+    if(constant == nullptr || !m_passes.isEnabled(PassId::kConstantImmediates))
+        return false;
+    if(constant->getTypePtr()->isInteger())
+        p_value = static_cast<int32_t>(constant->integer());
+    else if(constant->getTypePtr()->isBool())
+        p_value = constant->boolean() ? 1 : 0;
+    else if(constant->getTypePtr()->isReal() && isRealLowered())
+        p_value = encodeReal(constant->real());
+    else
+        return false;
+    return true;
+}
+
+// A constant being declared that getConstantImmediate() serves needs no
+// storage; says which constants stay in memory.
+bool CodeGenerator::declareConstantImmediate(const VariableNode &p_variable,
+                                             const SymbolEntry &p_entry){
+    int32_t immediate;
+    if(getConstantImmediate(p_entry, immediate)){
+        m_remarks.passed(PassId::kConstantImmediates, "Immediate", p_variable.getLocation(),
+                         "constant '%s' needs no storage: its uses load the immediate %d",
+                         p_entry.getNameCString(), immediate);
+        return true;
+    }
+    if(m_passes.isEnabled(PassId::kConstantImmediates))
+        m_remarks.missed(PassId::kConstantImmediates, "InMemory", p_variable.getLocation(),
+                         "constant '%s' kept in memory: only integer, boolean and lowered real constants become immediates",
+                         p_entry.getNameCString());
+    return false;
+}
+
+static bool isPowerOfTwo(const uint64_t p_value) {
+    return p_value != 0 && (p_value & (p_value - 1)) == 0;
+}
+
+// p_reg += p_value, through t1 when p_value does not fit in an I-type
+// immediate
+static void emitAddImmediate(AssemblyBuffer &p_asm, const char *p_reg, const int p_value) {
+    if(p_value >= -2048 && p_value <= 2047)
+        dumpInstructions(p_asm, "   addi %s, %s, %d\n", p_reg, p_reg, p_value);
+    else if(p_value < 0)
+        dumpInstructions(p_asm, "   li t1, %d\n   sub %s, %s, t1\n", -p_value, p_reg, p_reg);
+    else
+        dumpInstructions(p_asm, "   li t1, %d\n   add %s, %s, t1\n", p_value, p_reg, p_reg);
+}
+
+static int log2Of(uint64_t p_value) {
+    int shift = 0;
+    while(p_value > 1){
+        p_value >>= 1;
+        ++shift;
+    }
+    return shift;
+}
+
+// The dimensions an array is laid out with: its own, or with the inner
+// ones rounded up to powers of two under --pad-arrays.
+std::vector<uint64_t> CodeGenerator::getLayout(const SymbolEntry &p_entry) const {
+    std::vector<uint64_t> layout = p_entry.getTypePtr()->getDimensions();
+    if(m_padded_arrays.count(&p_entry) != 0){
+        for(size_t i = 1; i < layout.size(); ++i){
+            while(!isPowerOfTwo(layout[i]))
+                ++layout[i];
+        }
+    }
+    return layout;
+}
+
+// Pads a local array being declared if its frame has room for that, and
+// reports the cost. Returns the number of elements it takes up.
+int CodeGenerator::padArray(const SymbolEntry &p_entry, const int p_element_num,
+                            const Location &p_location){
+    m_padded_arrays.insert(&p_entry);
+    int element_num = 1;
+    for(auto dimension : getLayout(p_entry))
+        element_num *= dimension;
+    if(element_num == p_element_num){
+        m_padded_arrays.erase(&p_entry);
+        return p_element_num;
+    }
+    if(local_addr + 4 * element_num > kFrameLimit){
+        m_padded_arrays.erase(&p_entry);
+        fprintf(stderr, "%s:%u: note: array '%s' is not padded, the frame has no room for it\n",
+                m_source_file_path.c_str(), p_location.line, p_entry.getNameCString());
+        m_remarks.missed(PassId::kPadArrays, "FrameFull", p_location,
+                         "array '%s' not padded: the frame has no room for %d bytes",
+                         p_entry.getNameCString(), 4 * element_num);
+        return p_element_num;
+    }
+    fprintf(stderr, "%s:%u: note: array '%s' padded from %d to %d bytes\n",
+            m_source_file_path.c_str(), p_location.line, p_entry.getNameCString(),
+            4 * p_element_num, 4 * element_num);
+    m_remarks.passed(PassId::kPadArrays, "Padded", p_location,
+                     "array '%s' padded from %d to %d bytes", p_entry.getNameCString(),
+                     4 * p_element_num, 4 * element_num);
+    m_array_bytes += 4 * p_element_num;
+    m_padding_bytes += 4 * (element_num - p_element_num);
+    return element_num;
+}
+
+// Leaves the address of an element in t0, with the indices on the stack.
+// The byte stride of each index is an immediate, a shift when it is a power
+// of two, and the -1 of the 1-based indices is folded into the base.
+void CodeGenerator::emitElementAddress(const VariableReferenceNode &p_variable_ref,
+                                       const SymbolEntry &p_entry, const int p_addr){
+    const auto &dimensions = p_entry.getTypePtr()->getDimensions();
+    const auto layout = getLayout(p_entry);
+    constexpr const char*const riscv_assembly_pop_index =
+    "   lw t0, 0(sp)        # pop the value from the stack\n"
+    "   addi sp, sp, 4\n";
+    dumpInstructions(m_asm, "\n# count offset----------------\n");
+    int stride = 4;
+    int strides = 0;
+    for(int i = p_variable_ref.getIndices().size()-1; i>=0 ; --i){
+        if(i != static_cast<int>(p_variable_ref.getIndices().size())-1)
+            stride *= layout[i+1];
+        if(m_options.bounds_check)
+            emitBoundsCheck(p_variable_ref, i, dimensions[i]);
+        dumpInstructions(m_asm, riscv_assembly_pop_index);
+        const char *offset = strides == 0 ? "t2" : "t1";
+        if(isPowerOfTwo(stride))
+            dumpInstructions(m_asm, "   slli %s, t0, %d      # index * %d bytes\n", offset, log2Of(stride), stride);
+        else
+            dumpInstructions(m_asm, "   li t1, %d\n   mul %s, t0, t1\n", stride, offset);
+        if(strides != 0)
+            dumpInstructions(m_asm, "   add t2, t1, t2\n");
+        strides += stride;
+    }
+    // global arrays ascend from their symbol, frame arrays descend from s0
+    if(p_entry.getLevel() == 0){
+        constexpr const char*const riscv_assembly_global_element_address =
+        "# count offset end-----------\n\n"
+        "   lui t0, %%hi(%s)\n"
+        "   addi t0, t0, %%lo(%s)\n"
+        "   add t0, t0, t2\n";
+        dumpInstructions(m_asm, riscv_assembly_global_element_address, p_entry.getNameCString(),
+                         p_entry.getNameCString());
+        emitAddImmediate(m_asm, "t0", -strides);
+        return;
+    }
+    constexpr const char*const riscv_assembly_element_address =
+    "# count offset end-----------\n\n"
+    "   sub t0, s0, t2\n";
+    dumpInstructions(m_asm, riscv_assembly_element_address);
+    emitAddImmediate(m_asm, "t0", strides - p_addr - 4);
+}
+
+// The frame slot of an element of a local or parameter array, relative to
+// the slot of the array, when all of its indices are known and in range.
+// Such an element is loaded and stored like a scalar variable.
+bool CodeGenerator::getScalarElement(const VariableReferenceNode &p_variable_ref,
+                                     const SymbolEntry &p_entry, int &p_element) const {
+    const auto &dimensions = p_entry.getTypePtr()->getDimensions();
+    if(!m_passes.isEnabled(PassId::kScalarReplacement) || p_variable_ref.getIndices().size() != dimensions.size())
+        return false;
+    const auto layout = getLayout(p_entry);
+    int element = 0;
+    for(size_t i = 0; i < dimensions.size(); ++i){
+        ValueRange range;
+        if(!m_ranges.getRange(*p_variable_ref.getIndices()[i], range) ||
+           range.min != range.max || !range.within(1, dimensions[i]))
+            return false;
+        element = element * layout[i] + (range.min - 1);
+    }
+    p_element = element;
+    return true;
+}
+
+// Expands a for loop with a few iterations into a copy of its body per
+// value of the loop variable when that makes an index into a small array
+// known, so that getScalarElement() applies to it.
+bool CodeGenerator::tryFullUnroll(ForNode &p_for, const SymbolEntry *p_loop_var){
+    if(!m_passes.isEnabled(PassId::kScalarReplacement) || isInstrumented())
+        return false;
+    const int64_t lower = p_for.getLowerBound().getConstantPtr()->integer();
+    const int64_t upper = p_for.getUpperBound().getConstantPtr()->integer();
+    if(upper <= lower)
+        return false;
+    if(upper - lower > kFullUnrollTrips){
+        m_remarks.missed(PassId::kScalarReplacement, "TooManyTrips", p_for.getLocation(),
+                         "loop not fully unrolled: %lld iterations, over the limit of %d",
+                         static_cast<long long>(upper - lower), kFullUnrollTrips);
+        return false;
+    }
+    SubtreeInfo body;
+    p_for.getBody().accept(body);
+    if(body.has_declaration || body.has_control_flow ||
+       body.nodes * (upper - lower) > kUnrollBudget){
+        m_remarks.missed(PassId::kScalarReplacement, "TooLarge", p_for.getLocation(),
+                         "loop not fully unrolled: its body has control flow or is over the budget of %d AST nodes",
+                         kUnrollBudget);
+        return false;
+    }
+
+    bool replaces = false;
+    m_ranges.enterLoop(p_loop_var, lower, lower + 1);
+    for(const auto *reference : body.references){
+        const SymbolEntry *entry = m_symbol_manager_ptr->lookup(reference->getName());
+        int element_num = 1;
+        if(entry == nullptr || entry->getLevel() == 0 || entry->getTypePtr()->isScalar())
+            continue;
+        for(auto dimension : entry->getTypePtr()->getDimensions())
+            element_num *= dimension;
+        int element;
+        if(element_num <= kScalarReplaceLimit && getScalarElement(*reference, *entry, element)){
+            replaces = true;
+            break;
+        }
+    }
+    m_ranges.enterLoop(p_loop_var, lower, upper);
+    if(!replaces){
+        m_remarks.missed(PassId::kScalarReplacement, "NoKnownIndex", p_for.getLocation(),
+                         "loop not fully unrolled: no element of a local array of up to %d elements gets a known index",
+                         kScalarReplaceLimit);
+        return false;
+    }
+    m_remarks.passed(PassId::kScalarReplacement, "FullyUnrolled", p_for.getLocation(),
+                     "loop fully unrolled (%lld iterations): array elements at known indices become scalar slots",
+                     static_cast<long long>(upper - lower));
+
+    p_for.getLoopVarDecl().accept(*this);
+    const int addr = addr_stack[p_loop_var->getName()].top();
+    constexpr const char*const riscv_assembly_unrolled_step =
+    "# fully unrolled loop body, %s = %d\n"
+    "   li t0, %d\n"
+    "   sw t0, -%d(s0)      # save the value to loop variable\n";
+    for(int64_t value = lower; value < upper; ++value){
+        dumpInstructions(m_asm, riscv_assembly_unrolled_step, p_loop_var->getNameCString(),
+                         static_cast<int>(value), static_cast<int>(value), addr+4);
+        m_ranges.enterLoop(p_loop_var, value, value + 1);
+        p_for.getBody().accept(*this);
+    }
+    return true;
+}
+
+// Pushes the value of an integer or boolean expression the range analysis
+// knows, in place of the code computing it.
+bool CodeGenerator::tryFold(ExpressionNode &p_expr){
+    int64_t value;
+    if(!m_passes.isEnabled(PassId::kFold) || flag_lvalue || !(p_expr.getInferredType()->isInteger() || p_expr.getInferredType()->isBool()) ||
+       !m_ranges.getValue(p_expr, value))
+        return false;
+    // a negative literal such as -3 was never anything to fold
+    const auto *un_op = dynamic_cast<const UnaryOperatorNode *>(&p_expr);
+    const bool is_literal = un_op != nullptr && un_op->getOp() == Operator::kNegOp &&
+                            dynamic_cast<const ConstantValueNode *>(&un_op->getOperand()) != nullptr;
+    if(!is_literal)
+        m_remarks.passed(PassId::kFold, "Folded", p_expr.getLocation(),
+                         "expression folded to %lld", static_cast<long long>(value));
+    constexpr const char*const riscv_assembly_folded_expr =
+    "   li t0, %d            # folded value\n"
+    "   addi sp, sp, -4\n"
+    "   sw t0, 0(sp)        # push the value to the stack\n";
+    dumpInstructions(m_asm, riscv_assembly_folded_expr, static_cast<int>(value));
+    if(flag_branch){
+        flag_branch = false;
+        dumpInstructions(m_asm, "   lw t1, 0(sp)        # pop the value from the stack\n"
+                                "   addi sp, sp, 4\n");
+        emitZeroBranch();
+    }
+    return true;
+}
+
+// The label of a clone of the callee for the integer and boolean arguments
+// of this call that are known, or the callee's own name. A clone binds the
+// parameters that its body reads but never assigns, so that tryFold() and
+// the known conditions of if and while remove code that depends on them.
+// Without a profile to show the callee is hot, only a clone in which some
+// condition becomes known is worth its code.
+std::string CodeGenerator::getSpecialization(FunctionInvocationNode &p_func_invocation){
+    const std::string &name = p_func_invocation.getName();
+    if(!m_passes.isEnabled(PassId::kSpecialize) || isInstrumented())
+        return name;
+    auto it = m_functions.find(name);
+    if(it == m_functions.end() || it->second->getBody() == nullptr)
+        return name;
+    FunctionNode &callee = *it->second;
+    const Location &location = p_func_invocation.getLocation();
+    // a clone calling itself would be cloned again for each new argument
+    if(&callee == m_function){
+        m_remarks.missed(PassId::kSpecialize, "Recursive", location,
+                         "'%s' not specialized: the call is recursive", name.c_str());
+        return name;
+    }
+    if(!m_profile.empty() && !m_profile.isHot(m_profile_counters.getCounter(&callee))){
+        m_remarks.missed(PassId::kSpecialize, "NotHot", location,
+                         "'%s' not specialized: it is not hot in the training run", name.c_str());
+        return name;
+    }
+    // the memo table already serves repeated arguments
+    if(isMemoized(callee)){
+        m_remarks.missed(PassId::kSpecialize, "Memoized", location,
+                         "'%s' not specialized: it is memoized", name.c_str());
+        return name;
+    }
+
+    SubtreeInfo body;
+    callee.getBody()->accept(body);
+    std::vector<const SymbolEntry *> parameters;
+    for(const auto &entry : callee.getSymbolTable()->getEntries()){
+        if(entry->getKind() == SymbolEntry::KindEnum::kParameterKind)
+            parameters.push_back(entry.get());
+    }
+    const auto &arguments = p_func_invocation.getArguments();
+    if(parameters.size() != arguments.size())
+        return name;
+
+    Specialization specialization{&callee, {}, ""};
+    std::string key = name;
+    std::set<std::string> bound;
+    for(size_t i = 0; i < parameters.size(); ++i){
+        const SymbolEntry *parameter = parameters[i];
+        int64_t value;
+        if(!(parameter->getTypePtr()->isInteger() || parameter->getTypePtr()->isBool()) ||
+           body.assigned.count(parameter->getName()) != 0 ||
+           !m_ranges.getValue(*arguments[i], value))
+            continue;
+        const bool is_read = std::any_of(body.references.begin(), body.references.end(),
+            [&](const VariableReferenceNode *p_ref){ return p_ref->getName() == parameter->getName(); });
+        if(!is_read)
+            continue;
+        specialization.values.emplace_back(i, value);
+        key += " " + std::to_string(i) + "=" + std::to_string(value);
+        bound.insert(parameter->getName());
+    }
+    if(specialization.values.empty()){
+        m_remarks.missed(PassId::kSpecialize, "NoKnownArgument", location,
+                         "'%s' not specialized: no argument it reads is a known integer or boolean",
+                         name.c_str());
+        return name;
+    }
+    if(m_profile.empty() &&
+       std::none_of(body.conditions.begin(), body.conditions.end(),
+                    [&](const ExpressionNode *p_condition){ return isKnownWith(*p_condition, bound); })){
+        m_remarks.missed(PassId::kSpecialize, "NoKnownCondition", location,
+                         "'%s' not specialized: no condition of it is known for these arguments",
+                         name.c_str());
+        return name;
+    }
+    auto existing = m_specialization_labels.find(key);
+    if(existing != m_specialization_labels.end()){
+        m_remarks.passed(PassId::kSpecialize, "Specialized", location,
+                         "call to '%s' uses its clone '%s' for %zu known argument%s", name.c_str(),
+                         existing->second.c_str(), specialization.values.size(),
+                         specialization.values.size() == 1 ? "" : "s");
+        return existing->second;
+    }
+    if(m_specialized_nodes + body.nodes > m_specialize_budget){
+        m_remarks.missed(PassId::kSpecialize, "Budget", location,
+                         "'%s' not specialized: its %d more AST nodes on top of the %d already cloned exceed the budget of %d",
+                         name.c_str(), body.nodes, m_specialized_nodes, m_specialize_budget);
+        return name;
+    }
+
+    m_specialized_nodes += body.nodes;
+    specialization.label = "__pspec" + std::to_string(m_specializations.size()) + "_" + name;
+    m_specialization_labels[key] = specialization.label;
+    m_specializations.push_back(specialization);
+    m_remarks.passed(PassId::kSpecialize, "Specialized", location,
+                     "call to '%s' uses its clone '%s' for %zu known argument%s", name.c_str(),
+                     specialization.label.c_str(), specialization.values.size(),
+                     specialization.values.size() == 1 ? "" : "s");
+    return specialization.label;
+}
+
+bool CodeGenerator::isMemoized(const FunctionNode &p_function) const {
+    if(!m_passes.isEnabled(PassId::kMemoize) || !m_purity.isPure(p_function.getName()) || !p_function.getTypePtr()->isInteger() ||
+       p_function.getParameters().size() != 1)
+        return false;
+    const auto &variables = p_function.getParameters()[0]->getVariables();
+    return variables.size() == 1 && variables[0]->getTypePtr()->isInteger();
+}
+
+// The entry point of a memoized function: a table in .bss holds a valid
+// flag and the result for each argument in [0, kMemoEntries), filled on the
+// first call with that argument. Other arguments go straight to the body.
+void CodeGenerator::emitMemoWrapper(const FunctionNode &p_function){
+    const char *name = p_function.getNameCString();
+    constexpr const char*const riscv_assembly_memo_table =
+    "# memo table of %s\n"
+    ".section    .bss,\"aw\",@nobits\n"
+    "   .align 2\n"
+    "   .type __pmemo_%s, @object\n"
+    "   .size __pmemo_%s, %d\n"
+    "__pmemo_%s:\n"
+    "   .zero %d\n\n";
+    dumpInstructions(m_asm, riscv_assembly_memo_table, name, name, name,
+                     8 * kMemoEntries, name, 8 * kMemoEntries);
+    constexpr const char*const riscv_assembly_memo_wrapper =
+    ".section    .text\n"
+    "   .align 2\n"
+    "   .globl %s\n"
+    "   .type %s, @function\n\n"
+    "%s:\n"
+    "# look up the result of a pure function\n"
+    "   li t0, %d\n"
+    "   bgeu a0, t0, .Lpmemo_%s_call # no entry for the argument\n"
+    "   lui t1, %%hi(__pmemo_%s)\n"
+    "   addi t1, t1, %%lo(__pmemo_%s)\n"
+    "   slli t0, a0, 3\n"
+    "   add t1, t1, t0      # the entry of the argument\n"
+    "   lw t0, 0(t1)\n"
+    "   beq t0, zero, .Lpmemo_%s_miss\n"
+    "   lw a0, 4(t1)        # the result of an earlier call\n"
+    "   jr ra\n"
+    ".Lpmemo_%s_miss:\n"
+    "   addi sp, sp, -16\n"
+    "   sw ra, 12(sp)\n"
+    "   sw t1, 8(sp)\n"
+    "   jal ra, __pmemo_body_%s\n"
+    "   lw t1, 8(sp)\n"
+    "   lw ra, 12(sp)\n"
+    "   addi sp, sp, 16\n"
+    "   li t0, 1\n"
+    "   sw a0, 4(t1)        # save the result\n"
+    "   sw t0, 0(t1)        # mark the entry valid\n"
+    "   jr ra\n"
+    ".Lpmemo_%s_call:\n"
+    "   j __pmemo_body_%s\n"
+    "   .size %s, .-%s\n\n";
+    dumpInstructions(m_asm, riscv_assembly_memo_wrapper, name, name, name, kMemoEntries,
+                     name, name, name, name, name, name, name, name, name, name);
+}
+
+void CodeGenerator::emitBoundsCheck(const VariableReferenceNode &p_variable_ref,
+                                    const size_t p_index, const int p_size) {
+    const ExpressionNode &index = *p_variable_ref.getIndices()[p_index];
+    const uint32_t line = index.getLocation().line;
+    ValueRange range;
+    if(m_passes.isEnabled(PassId::kCheckElimination) && m_ranges.getRange(index, range)){
+        if(range.within(1, p_size)){
+            m_remarks.passed(PassId::kCheckElimination, "Elided", index.getLocation(),
+                             "bounds check of '%s' removed: index in [%lld, %lld]",
+                             p_variable_ref.getNameCString(), static_cast<long long>(range.min),
+                             static_cast<long long>(range.max));
+            dumpInstructions(m_asm, "# bounds check elided: index in [%lld, %lld]\n",
+                             static_cast<long long>(range.min), static_cast<long long>(range.max));
+            return;
+        }
+        m_remarks.missed(PassId::kCheckElimination, "OutOfRange", index.getLocation(),
+                         "bounds check of '%s' kept: index in [%lld, %lld], not within [1, %d]",
+                         p_variable_ref.getNameCString(), static_cast<long long>(range.min),
+                         static_cast<long long>(range.max), p_size);
+        if(range.min == range.max)
+            fprintf(stderr, "%s:%u: warning: index %lld of '%s' is out of bounds [1, %d]\n",
+                    m_source_file_path.c_str(), line, static_cast<long long>(range.min),
+                    p_variable_ref.getNameCString(), p_size);
+    }
+    else if(m_passes.isEnabled(PassId::kCheckElimination))
+        m_remarks.missed(PassId::kCheckElimination, "UnknownRange", index.getLocation(),
+                         "bounds check of '%s' kept: the range of the index is not known",
+                         p_variable_ref.getNameCString());
+    // the unsigned compare also catches indices below 1
+    constexpr const char*const riscv_assembly_bounds_check =
+    "   lw t0, 0(sp)        # bounds check of the index on the stack\n"
+    "   addi t0, t0, -1\n"
+    "   li t1, %d\n"
+    "   bltu t0, t1, .Lpbc%d\n"
+    "   li a0, %u\n"
+    "   addi a1, t0, 1\n"
+    "   mv a2, t1\n"
+    "   jal ra, boundsCheckFailed\n"
+    ".Lpbc%d:\n";
+    dumpInstructions(m_asm, riscv_assembly_bounds_check, p_size, bounds_check_id, line, bounds_check_id);
+    ++bounds_check_id;
+}
+
+void CodeGenerator::emitLocation(const Location &p_location){
+    if(m_options.line_table)
+        dumpInstructions(m_asm, "   .loc 1 %u %u\n", p_location.line, p_location.col);
 }
 
 void CodeGenerator::visit(ProgramNode &p_program) {
@@ -80,14 +1009,41 @@ void CodeGenerator::visit(ProgramNode &p_program) {
         "    .file \"%s\"\n"
         "    .option nopic\n\n";
     // clang-format on
-    dumpInstructions(m_output_file.get(), riscv_assembly_file_prologue,
+    dumpInstructions(m_asm, riscv_assembly_file_prologue,
                      m_source_file_path.c_str());
+    if(m_options.line_table)
+        dumpInstructions(m_asm, "    .file 1 \"%s\"\n\n", m_source_file_path.c_str());
+    if(m_options.compressed)
+        dumpInstructions(m_asm, "    .option rvc\n\n");
+
+    {
+        TimeScope scope("profile counters");
+        p_program.accept(m_profile_counters);
+    }
+    if(m_passes.isEnabled(PassId::kPurity)){
+        TimeScope scope("purity");
+        p_program.accept(m_purity);
+        m_passes.markValid(PassId::kPurity);
+    }
+    if(m_passes.isEnabled(PassId::kProfile) && !m_options.profile_use_path.empty()){
+        TimeScope scope("profile");
+        std::string error;
+        if(m_profile.load(m_options.profile_use_path, m_profile_counters.getCount(), error))
+            m_passes.markValid(PassId::kProfile);
+        else
+            fprintf(stderr, "%s: warning: ignoring the profile: %s\n",
+                    m_source_file_path.c_str(), error.c_str());
+    }
 
     // Reconstruct the hash table for looking up the symbol entry
     // Hint: Use symbol_manager->lookup(symbol_name) to get the symbol entry.
     m_symbol_manager_ptr->reconstructHashTableFromSymbolTable(
         p_program.getSymbolTable());
 
+    SubtreeInfo program;
+    p_program.visitChildNodes(program);
+    m_specialize_budget = program.nodes * kSpecializeGrowth / 100;
+
     p_program.visitChildNodes(*this);
 
     constexpr const char*const riscv_assembly_function_epilogue =
@@ -98,7 +1054,77 @@ void CodeGenerator::visit(ProgramNode &p_program) {
         "   jr ra               # jump back to the caller function\n"
         "   .size main, .-main\n\n";
 
-    dumpInstructions(m_output_file.get(), riscv_assembly_function_epilogue);
+    dumpInstructions(m_asm, riscv_assembly_function_epilogue);
+
+    if(m_array_bytes != 0)
+        fprintf(stderr, "%s: array padding: %d bytes over %d bytes of padded arrays (%.1f%%)\n",
+                m_source_file_path.c_str(), m_padding_bytes, m_array_bytes,
+                100.0 * m_padding_bytes / m_array_bytes);
+
+    // the clones may call for more of them
+    for(size_t i = 0; i < m_specializations.size(); ++i){
+        const Specialization specialization = m_specializations[i];
+        m_specialization = &specialization;
+        visit(*specialization.function);
+    }
+
+    if(flag_fixdiv_used){
+        // a0 = (a0 << 16) / a1 on Q16.16 values, built from divu/remu and
+        // 16 steps of restoring division for the fraction bits
+        constexpr const char*const riscv_assembly_fixdiv_routine =
+        ".section    .text\n"
+        "   .align 2\n"
+        "   .type __pfixdiv, @function\n"
+        "__pfixdiv:\n"
+        "   xor t2, a0, a1      # sign of the quotient\n"
+        "   bge a0, zero, .Lpfixdiv_a\n"
+        "   neg a0, a0\n"
+        ".Lpfixdiv_a:\n"
+        "   bge a1, zero, .Lpfixdiv_b\n"
+        "   neg a1, a1\n"
+        ".Lpfixdiv_b:\n"
+        "   divu t0, a0, a1     # integer bits\n"
+        "   remu t1, a0, a1\n"
+        "   li t3, 16\n"
+        ".Lpfixdiv_loop:\n"
+        "   slli t0, t0, 1\n"
+        "   slli t1, t1, 1\n"
+        "   bltu t1, a1, .Lpfixdiv_next\n"
+        "   sub t1, t1, a1\n"
+        "   ori t0, t0, 1\n"
+        ".Lpfixdiv_next:\n"
+        "   addi t3, t3, -1\n"
+        "   bne t3, zero, .Lpfixdiv_loop\n"
+        "   bge t2, zero, .Lpfixdiv_done\n"
+        "   neg t0, t0\n"
+        ".Lpfixdiv_done:\n"
+        "   mv a0, t0\n"
+        "   jr ra\n"
+        "   .size __pfixdiv, .-__pfixdiv\n\n";
+        dumpInstructions(m_asm, riscv_assembly_fixdiv_routine);
+    }
+
+    if(isInstrumented()){
+        constexpr const char*const riscv_assembly_profile_data =
+        ".section    .bss,\"aw\",@nobits\n"
+        "   .align 2\n"
+        "   .type __pprof_counters, @object\n"
+        "   .size __pprof_counters, %u\n"
+        "__pprof_counters:\n"
+        "   .zero %u\n"
+        ".section    .rodata\n"
+        "   .align 2\n"
+        "__pprof_path:\n"
+        "   .string \"%s\"\n\n";
+        std::string path;
+        for(const char c : m_options.profile_generate_path){
+            if(c == '"' || c == '\\')
+                path += '\\';
+            path += c;
+        }
+        const uint32_t size = m_profile_counters.getCount() * 4;
+        dumpInstructions(m_asm, riscv_assembly_profile_data, size, size, path.c_str());
+    }
 
     // const_cast<CompoundStatementNode &>(p_program.getBody()).accept(*this);
     if(p_program.getSymbolTable() != nullptr){
@@ -110,6 +1136,38 @@ void CodeGenerator::visit(ProgramNode &p_program) {
 
     // Remove the entries in the hash table
     m_symbol_manager_ptr->removeSymbolsFromHashTable(p_program.getSymbolTable());
+
+    {
+        TimeScope scope("assembly passes");
+        m_passes.runAssemblyPasses(m_asm, m_options, m_source_file_path);
+    }
+    std::string remarks_error;
+    if (!m_remarks.write(remarks_error))
+        fprintf(stderr, "%s: warning: %s\n", m_source_file_path.c_str(), remarks_error.c_str());
+    if (m_options.cost_report){
+        TimeScope scope("cost report");
+        m_cost_report.run(m_asm, m_options.cost_core);
+        m_cost_report.dumpCostReport(stdout, m_source_file_path, m_options.cost_core);
+    }
+    if (m_output_file){
+        TimeScope scope("write assembly");
+        m_asm.write(m_output_file.get());
+    }
+    if (m_object_file){
+        TimeScope scope("assemble");
+        ObjectFile object;
+        object.double_float_abi = m_options.double_float_abi;
+        RiscvAssembler assembler;
+        if (assembler.assemble(m_asm, object))
+            object.writeElf(m_object_file.get());
+        else{
+            fprintf(stderr, "%s: assembler error: %s\n",
+                    m_source_file_path.c_str(), assembler.getError().c_str());
+            m_has_error = true;
+            m_object_file.reset();
+            std::remove(m_object_file_path.c_str());
+        }
+    }
 }
 
 void CodeGenerator::visit(DeclNode &p_decl) {
@@ -123,27 +1181,45 @@ void CodeGenerator::visit(VariableNode &p_variable) {
 
     // global variable
     if(entry->getLevel() == 0 && entry->getKind() == SymbolEntry::KindEnum::kVariableKind){
+        const char* v_name = p_variable.getNameCString();
+        int size = 4;
+        for(auto dimension : p_variable.getTypePtr()->getDimensions())
+            size *= dimension;
+
+        // objects up to the linker's -G 8 threshold go to .sbss, so that
+        // the %hi/%lo pairs below are relaxed into one gp-relative access
         constexpr const char*const riscv_assembly_global_variable_expr =
-        "# global variable declaration: %s\n" 
-        ".comm %s, 4, 4\n\n";
-        dumpInstructions(m_output_file.get(), riscv_assembly_global_variable_expr, p_variable.getNameCString(), p_variable.getNameCString());
+        "# global variable declaration: %s\n"
+        ".section    %s,\"aw\",@nobits\n"
+        "   .align 2\n"
+        "   .globl %s\n"
+        "   .type %s, @object\n"
+        "   .size %s, %d\n"
+        "%s:\n"
+        "   .zero %d\n\n";
+        dumpInstructions(m_asm, riscv_assembly_global_variable_expr, v_name,
+                         size <= kSmallDataLimit ? ".sbss" : ".bss",
+                         v_name, v_name, v_name, size, v_name, size);
     }
 
-    // global constant
+    // global constant kept in memory
     else if(entry->getLevel() == 0 && entry->getKind() == SymbolEntry::KindEnum::kConstantKind){
+        if(declareConstantImmediate(p_variable, *entry))
+            return;
         const char* v_name = p_variable.getNameCString();
         constexpr const char*const riscv_assembly_global_const_expr =
         "# global constant declaration: %s\n"
-        ".section    .rodata\n"
+        ".section    .srodata,\"a\"\n"
         "   .align 2\n"
         "   .globl %s\n"
         "   .type %s, @object\n"
+        "   .size %s, 4\n"
         "%s:\n"
         "    .word ";
-        dumpInstructions(m_output_file.get(), riscv_assembly_global_const_expr, v_name, v_name, v_name, v_name);
+        dumpInstructions(m_asm, riscv_assembly_global_const_expr, v_name, v_name, v_name, v_name, v_name);
         flag_glb_const = true;
         p_variable.visitChildNodes(*this);
-        dumpInstructions(m_output_file.get(), "\n\n");
+        dumpInstructions(m_asm, "\n\n");
     }
 
     // local variable, loop variable
@@ -158,6 +1234,8 @@ void CodeGenerator::visit(VariableNode &p_variable) {
             int element_num = 1;
             for(auto dimension : p_variable.getTypePtr()->getDimensions())
                 element_num *= dimension;
+            if(m_passes.isEnabled(PassId::kPadArrays) && entry->getKind() == SymbolEntry::KindEnum::kVariableKind)
+                element_num = padArray(*entry, element_num, p_variable.getLocation());
 
             local_addr += 4 * element_num;
         }
@@ -166,18 +1244,20 @@ void CodeGenerator::visit(VariableNode &p_variable) {
     // local constant
     else if(entry->getKind() == SymbolEntry::KindEnum::kConstantKind){
         addrStackPush(entry->getName());
+        if(declareConstantImmediate(p_variable, *entry))
+            return;
         constexpr const char*const riscv_assembly_local_const_expr=
         "# local constant declaration: %s\n"
         "   addi t0, s0, -%d\n"
         "   addi sp, sp, -4\n"
         "   sw t0, 0(sp)        # push the address to the stack\n";
         local_addr += 4;
-        dumpInstructions(m_output_file.get(), riscv_assembly_local_const_expr, p_variable.getNameCString(), local_addr);
+        dumpInstructions(m_asm, riscv_assembly_local_const_expr, p_variable.getNameCString(), local_addr);
         
 
         p_variable.visitChildNodes(*this);
 
-        dumpInstructions(m_output_file.get(), 
+        dumpInstructions(m_asm, 
                 "   lw t0, 0(sp)        # pop the value from the stack\n"
                 "   addi sp, sp, 4\n"
                 "   lw t1, 0(sp)        # pop the address from the stack\n"
@@ -195,7 +1275,7 @@ void CodeGenerator::visit(VariableNode &p_variable) {
         if(parameter_id <= 7){
             if(p_variable.getTypePtr()->isScalar()){
                 local_addr+=4;
-                dumpInstructions(m_output_file.get(), riscv_assembly_func_para_expr,parameter_id,local_addr,p_variable.getNameCString());
+                dumpInstructions(m_asm, riscv_assembly_func_para_expr,parameter_id,local_addr,p_variable.getNameCString());
             }
             else{
                 int element_num = 1;
@@ -204,17 +1284,17 @@ void CodeGenerator::visit(VariableNode &p_variable) {
                 int addr = addr_stack[entry->getName()].top();
                 for(int i = 0 ; i < element_num; ++i){
                     if(i <= 7){
-                        dumpInstructions(m_output_file.get(), riscv_assembly_func_para_expr, i, addr+4, p_variable.getNameCString());
+                        dumpInstructions(m_asm, riscv_assembly_func_para_expr, i, addr+4, p_variable.getNameCString());
                     }
                     else{
-                        dumpInstructions(m_output_file.get(), riscv_assembly_func_paras_expr, i-7, addr+4, p_variable.getNameCString());
+                        dumpInstructions(m_asm, riscv_assembly_func_paras_expr, i-7, addr+4, p_variable.getNameCString());
                     }
                     addr+=4;
                 }
             }
         }
         else{
-            dumpInstructions(m_output_file.get(), riscv_assembly_func_paras_expr, parameter_id-7, local_addr+4, p_variable.getNameCString());
+            dumpInstructions(m_asm, riscv_assembly_func_paras_expr, parameter_id-7, local_addr+4, p_variable.getNameCString());
         }
         parameter_id++;
         if(!p_variable.getTypePtr()->isScalar()){
@@ -229,9 +1309,14 @@ void CodeGenerator::visit(VariableNode &p_variable) {
 }
 
 void CodeGenerator::visit(ConstantValueNode &p_constant_value) {
+    if(!isRealLowered() && p_constant_value.getTypePtr()->isReal())
+        m_needs_float = true;
     if(flag_glb_const){
         flag_glb_const = false;
-        dumpInstructions(m_output_file.get(), "%s", p_constant_value.getConstantValueCString());
+        if(isRealLowered() && p_constant_value.getTypePtr()->isReal())
+            dumpInstructions(m_asm, "%d", encodeReal(p_constant_value.getConstantPtr()->real()));
+        else
+            dumpInstructions(m_asm, "%s", p_constant_value.getConstantValueCString());
     }
     else{
         const char* value = p_constant_value.getConstantValueCString();
@@ -246,10 +1331,32 @@ void CodeGenerator::visit(ConstantValueNode &p_constant_value) {
             "   li t0, %s            # load value to register 't0'\n"
             "   addi sp, sp, -4\n"
             "   sw t0, 0(sp)        # push the value to the stack\n";
-            dumpInstructions(m_output_file.get(), riscv_assembly_const_expr, value);
+            dumpInstructions(m_asm, riscv_assembly_const_expr, value);
+        }
+        else if(isRealLowered() && p_constant_value.getTypePtr()->isReal()){
+            constexpr const char*const riscv_assembly_real_const_expr =
+            "   li t0, %d            # load real %s to register 't0'\n"
+            "   addi sp, sp, -4\n"
+            "   sw t0, 0(sp)        # push the value to the stack\n";
+            dumpInstructions(m_asm, riscv_assembly_real_const_expr,
+                             encodeReal(p_constant_value.getConstantPtr()->real()), value);
+        }
+        else if(p_constant_value.getTypePtr()->isString() && flag_str_section){
+            dumpInstructions(m_asm, "\"%s\"\n\n", p_constant_value.getConstantValueCString());
         }
         else if(p_constant_value.getTypePtr()->isString()){
-            dumpInstructions(m_output_file.get(), "\"%s\"\n\n", p_constant_value.getConstantValueCString());
+            constexpr const char*const riscv_assembly_str_literal_expr =
+            "    .pushsection    .rodata\n"
+            "    .align 2\n"
+            "__pstr%d:\n"
+            "    .string \"%s\"\n"
+            "    .popsection\n"
+            "   lui t0, %%hi(__pstr%d)\n"
+            "   addi t0, t0, %%lo(__pstr%d)\n"
+            "   addi sp, sp, -4\n"
+            "   sw t0, 0(sp)        # push the address to the stack\n";
+            const int id = m_string_literals++;
+            dumpInstructions(m_asm, riscv_assembly_str_literal_expr, id, value, id, id);
         }
     }
 
@@ -257,17 +1364,59 @@ void CodeGenerator::visit(ConstantValueNode &p_constant_value) {
 }
 
 void CodeGenerator::visit(FunctionNode &p_function) {
+    TimeScope scope("function", m_specialization != nullptr ? m_specialization->label
+                                                            : p_function.getName());
     // Reconstruct the hash table for looking up the symbol entry
     m_symbol_manager_ptr->reconstructHashTableFromSymbolTable(
         p_function.getSymbolTable());
     
     local_addr = 8;
     flag_main = false;
-    const char *func_name = p_function.getNameCString();
+    m_return_type_ptr = p_function.getTypePtr();
+    m_functions[p_function.getName()] = &p_function;
+    const Specialization *specialization = m_specialization;
+    m_specialization = nullptr;
+    m_function = &p_function;
+    std::vector<const SymbolEntry *> parameters;
+    for(const auto &entry : p_function.getSymbolTable()->getEntries()){
+        if(entry->getKind() == SymbolEntry::KindEnum::kParameterKind)
+            parameters.push_back(entry.get());
+    }
+    // the function's own name goes to a wrapper that looks the argument up
+    const bool memoized = specialization == nullptr && isMemoized(p_function);
+    const std::string memo_body = "__pmemo_body_" + p_function.getName();
+    const char *func_name = specialization != nullptr ? specialization->label.c_str()
+                          : memoized ? memo_body.c_str() : p_function.getNameCString();
+    if(specialization != nullptr){
+        for(const auto &value : specialization->values)
+            m_ranges.bindParameter(parameters[value.first], value.second);
+    }
+    m_remarks.setFunction(func_name);
+    if(specialization == nullptr && m_passes.isEnabled(PassId::kMemoize)){
+        if(memoized)
+            m_remarks.passed(PassId::kMemoize, "Memoized", p_function.getLocation(),
+                             "'%s' memoized for arguments in [0, %d)", p_function.getNameCString(),
+                             kMemoEntries);
+        else if(!m_purity.isPure(p_function.getName()))
+            m_remarks.missed(PassId::kMemoize, "NotPure", p_function.getLocation(),
+                             "'%s' not memoized: it has side effects or reads globals",
+                             p_function.getNameCString());
+        else
+            m_remarks.missed(PassId::kMemoize, "Signature", p_function.getLocation(),
+                             "'%s' not memoized: it is not a function of one integer returning an integer",
+                             p_function.getNameCString());
+    }
+    const uint32_t counter = m_profile_counters.getCounter(&p_function);
+    // functions the training run never entered are kept away from hot code
+    const bool cold = m_passes.isEnabled(PassId::kLayout) && m_profile.isCold(counter);
+    const char *section = cold ? ".text.unlikely" : ".text";
+    if(cold)
+        m_remarks.passed(PassId::kLayout, "Cold", p_function.getLocation(),
+                         "'%s' never ran in the training run, placed in .text.unlikely", func_name);
     constexpr const char*const riscv_assembly_func_expr =
-    ".section    .text\n"
+    ".section    %s\n"
     "   .align 2\n"
-    "   .globl %s\n"
+    "   %s %s\n"
     "   .type %s, @function\n\n"
     "%s:\n"
     "# in the function prologue\n"
@@ -275,12 +1424,20 @@ void CodeGenerator::visit(FunctionNode &p_function) {
     "   sw ra, 124(sp)      # save return address of the caller function in the current stack\n"
     "   sw s0, 120(sp)      # save frame pointer of the last stack in the current stack\n"
     "   addi s0, sp, 128    # move frame pointer to the bottom of the current stack\n\n";
-    dumpInstructions(m_output_file.get(), riscv_assembly_func_expr, func_name, func_name, func_name);
+    emitLocation(p_function.getLocation());
+    // clones are called from this file only
+    dumpInstructions(m_asm, riscv_assembly_func_expr, section,
+                     specialization != nullptr ? ".local" : ".globl", func_name, func_name, func_name);
+    if(isInstrumented())
+        emitProfileCounter(counter);
 
     p_function.visitChildNodes(*this);
     parameter_id = 0;
     flag_main = true;
     local_addr = 8;
+    m_return_type_ptr = nullptr;
+    m_function = nullptr;
+    m_remarks.setFunction("main");
 
     constexpr const char*const riscv_assembly_func_epilogue=
     "# in the function epilogue\n"
@@ -290,7 +1447,11 @@ void CodeGenerator::visit(FunctionNode &p_function) {
     "   jr ra               # jump back to the caller function\n"
     "   .size %s, .-%s\n\n";
 
-    dumpInstructions(m_output_file.get(), riscv_assembly_func_epilogue, func_name, func_name);
+    dumpInstructions(m_asm, riscv_assembly_func_epilogue, func_name, func_name);
+    for(const auto *parameter : parameters)
+        m_ranges.unbindParameter(parameter);
+    if(memoized)
+        emitMemoWrapper(p_function);
 
     if(p_function.getSymbolTable() != nullptr){
         const auto &entries = p_function.getSymbolTable()->getEntries();
@@ -322,16 +1483,36 @@ void CodeGenerator::visit(CompoundStatementNode &p_compound_statement) {
         "   sw s0, 120(sp)      # save frame pointer of the last stack in the current stack\n"
         "   addi s0, sp, 128    # move frame pointer to the bottom of the current stack\n\n";
 
-        dumpInstructions(m_output_file.get(), riscv_assembly_main_func_expr);
+        emitLocation(p_compound_statement.getLocation());
+        dumpInstructions(m_asm, riscv_assembly_main_func_expr);
         flag_main = false;
+        if(isInstrumented()){
+            constexpr const char*const riscv_assembly_profile_init =
+            "   lui a0, %%hi(__pprof_counters)\n"
+            "   addi a0, a0, %%lo(__pprof_counters)\n"
+            "   li a1, %u\n"
+            "   lui a2, %%hi(__pprof_path)\n"
+            "   addi a2, a2, %%lo(__pprof_path)\n"
+            "   jal ra, profileInit # write the counters to the profile at exit\n";
+            dumpInstructions(m_asm, riscv_assembly_profile_init, m_profile_counters.getCount());
+            m_pending_counter = ProfileCounterMap::kMainCounter;
+        }
     }
-    if(flag_if)
-        dumpInstructions(m_output_file.get(), "L%d:\n", label_id);
+    // the flags belong to this block only, not to the blocks nested in it
+    const bool if_arm = flag_if;
+    const bool while_body = flag_while;
+    const bool for_body = flag_for;
+    flag_if = false;
+    flag_while = false;
+    flag_for = false;
+
+    if(if_arm)
+        dumpInstructions(m_asm, "L%d:\n", label_id);
     
-    if(flag_while)
-        dumpInstructions(m_output_file.get(), "L%d:\n", label_id+1);
+    if(while_body)
+        dumpInstructions(m_asm, "L%d:\n", label_id+1);
 
-    if(flag_for){
+    if(for_body){
         constexpr const char*const riscv_assembly_for_prologue_expr =
         "   lw t0, 0(sp)        # pop the value from the stack\n"
         "   addi sp, sp, 4\n"
@@ -339,20 +1520,27 @@ void CodeGenerator::visit(CompoundStatementNode &p_compound_statement) {
         "   addi sp, sp, 4\n"
         "   bge t1, t0, L%d        # if i >= condition value, exit the loop\n"
         "L%d:\n";
-        dumpInstructions(m_output_file.get(), riscv_assembly_for_prologue_expr, label_id+2 , label_id+1);
+        dumpInstructions(m_asm, riscv_assembly_for_prologue_expr, label_id+2 , label_id+1);
     }
-
-    p_compound_statement.visitChildNodes(*this);
-
-    if(flag_if){
-        dumpInstructions(m_output_file.get(), "   j L%d                # jump to L%d\nL%d:\n", label_id +2 , label_id +2, label_id+1);
-        flag_if = false;
+    if(m_pending_counter != ProfileCounterMap::kNone){
+        emitProfileCounter(m_pending_counter);
+        m_pending_counter = ProfileCounterMap::kNone;
     }
-    if(flag_while){
-        dumpInstructions(m_output_file.get(), "   j L%d                # jump to L%d\n", label_id, label_id);
-        flag_while = false;
+
+    for(const auto &decl : p_compound_statement.getDeclNodes())
+        decl->accept(*this);
+    for(const auto &statement : p_compound_statement.getStmtNodes()){
+        statement->accept(*this);
+        // a call used as a statement pushed a value nothing pops
+        if(dynamic_cast<const FunctionInvocationNode *>(statement.get()) != nullptr)
+            dumpInstructions(m_asm, "   addi sp, sp, 4      # drop the unused return value\n");
     }
 
+    if(if_arm)
+        dumpInstructions(m_asm, "   j L%d                # jump to L%d\nL%d:\n", label_id +2 , label_id +2, label_id+1);
+    if(while_body)
+        dumpInstructions(m_asm, "   j L%d                # jump to L%d\n", label_id, label_id);
+
     if(p_compound_statement.getSymbolTable() != nullptr){
         const auto &entries = p_compound_statement.getSymbolTable()->getEntries();
         for(const auto &entry:entries){
@@ -366,30 +1554,50 @@ void CodeGenerator::visit(CompoundStatementNode &p_compound_statement) {
 }
 
 void CodeGenerator::visit(PrintNode &p_print) {
-    dumpInstructions(m_output_file.get(), "\n# print\n");
+    emitLocation(p_print.getLocation());
+    dumpInstructions(m_asm, "\n# print\n");
     p_print.visitChildNodes(*this);
+    if(!isRealLowered() && p_print.getTarget().getInferredType()->isReal())
+        m_needs_float = true;
     if(p_print.getTarget().getInferredType()->isInteger()){
         constexpr const char*const riscv_assembly_print_expr = 
         "   lw a0, 0(sp)        # pop the value from the stack to the first argument register 'a0'\n"
         "   addi sp, sp, 4\n"
         "   jal ra, printInt    # call function 'printInt'\n\n";
-        dumpInstructions(m_output_file.get(), riscv_assembly_print_expr);
+        dumpInstructions(m_asm, riscv_assembly_print_expr);
     }
     else if(p_print.getTarget().getInferredType()->isString()){
         constexpr const char*const riscv_assembly_print_expr = 
         "   lw a0, 0(sp)        # pop the value from the stack to the first argument register 'a0'\n"
         "   addi sp, sp, 4\n"
         "   jal ra, printString    # call function 'printString'\n\n";
-        dumpInstructions(m_output_file.get(), riscv_assembly_print_expr);
+        dumpInstructions(m_asm, riscv_assembly_print_expr);
+    }
+    else if(isRealLowered() && p_print.getTarget().getInferredType()->isReal()){
+        constexpr const char*const riscv_assembly_print_expr = 
+        "   lw a0, 0(sp)        # pop the value from the stack to the first argument register 'a0'\n"
+        "   addi sp, sp, 4\n"
+        "   jal ra, %s    # call function '%s'\n\n";
+        const char *routine =
+            (m_options.real_lowering == RealLowering::kFixedPoint) ? "printFixed" : "printReal";
+        dumpInstructions(m_asm, riscv_assembly_print_expr, routine, routine);
     }
     
 }
 
 void CodeGenerator::visit(BinaryOperatorNode &p_bin_op) {
-    dumpInstructions(m_output_file.get(), "\n# binary operator: %s\n", p_bin_op.getOpCString());
+    dumpInstructions(m_asm, "\n# binary operator: %s\n", p_bin_op.getOpCString());
+    if(tryFold(p_bin_op))
+        return;
     bool branch = flag_branch;
     flag_branch = false;
-    p_bin_op.visitChildNodes(*this);
+
+    // integer operands of a lowered real operation are converted once pushed
+    const bool real_operands = isRealLowered() &&
+        (p_bin_op.getLeftOperand().getInferredType()->isReal() ||
+         p_bin_op.getRightOperand().getInferredType()->isReal());
+    visitAsReal(const_cast<ExpressionNode &>(p_bin_op.getLeftOperand()), real_operands);
+    visitAsReal(const_cast<ExpressionNode &>(p_bin_op.getRightOperand()), real_operands);
     constexpr const char*const riscv_assembly_pop2 = 
     "   lw t0, 0(sp)        # pop the value from the stack\n"
     "   addi sp, sp, 4\n"
@@ -399,146 +1607,175 @@ void CodeGenerator::visit(BinaryOperatorNode &p_bin_op) {
     constexpr const char*const riscv_assembly_push1=
     "   addi sp, sp, -4\n"
     "   sw t0, 0(sp)        # push the value to the stack\n";
-    dumpInstructions(m_output_file.get(), riscv_assembly_pop2);
+    dumpInstructions(m_asm, riscv_assembly_pop2);
     const char *ops = p_bin_op.getOpCString();
-    if(std::strcmp(ops, "+")==0){
-        dumpInstructions(m_output_file.get(), "   add t0, t1, t0      # always save the value in a certain register you choose\n");
-        dumpInstructions(m_output_file.get(), riscv_assembly_push1);
+    if(real_operands && (std::strcmp(ops, "+")==0 || std::strcmp(ops, "-")==0 ||
+                         std::strcmp(ops, "*")==0 || std::strcmp(ops, "/")==0)){
+        emitRealArithmetic(ops);
+        dumpInstructions(m_asm, riscv_assembly_push1);
+    }
+
+    else if(std::strcmp(ops, "+")==0){
+        dumpInstructions(m_asm, "   add t0, t1, t0      # always save the value in a certain register you choose\n");
+        dumpInstructions(m_asm, riscv_assembly_push1);
     }
 
     else if(std::strcmp(ops, "-")==0){
-        dumpInstructions(m_output_file.get(), "   sub t0, t1, t0      # always save the value in a certain register you choose\n");
-        dumpInstructions(m_output_file.get(), riscv_assembly_push1);
+        dumpInstructions(m_asm, "   sub t0, t1, t0      # always save the value in a certain register you choose\n");
+        dumpInstructions(m_asm, riscv_assembly_push1);
     }
 
     else if(std::strcmp(ops, "*")==0){
-        dumpInstructions(m_output_file.get(), "   mul t0, t1, t0      # always save the value in a certain register you choose\n");
-        dumpInstructions(m_output_file.get(), riscv_assembly_push1);
+        dumpInstructions(m_asm, "   mul t0, t1, t0      # always save the value in a certain register you choose\n");
+        dumpInstructions(m_asm, riscv_assembly_push1);
     }
 
     else if(std::strcmp(ops, "/")==0){
-        dumpInstructions(m_output_file.get(), "   div t0, t1, t0      # always save the value in a certain register you choose\n");
-        dumpInstructions(m_output_file.get(), riscv_assembly_push1);
+        dumpInstructions(m_asm, "   div t0, t1, t0      # always save the value in a certain register you choose\n");
+        dumpInstructions(m_asm, riscv_assembly_push1);
     }
 
     else if(std::strcmp(ops, "mod")==0){
-        dumpInstructions(m_output_file.get(), "   rem t0, t1, t0      # always save the value in a certain register you choose\n");
-        dumpInstructions(m_output_file.get(), riscv_assembly_push1);
+        dumpInstructions(m_asm, "   rem t0, t1, t0      # always save the value in a certain register you choose\n");
+        dumpInstructions(m_asm, riscv_assembly_push1);
     }
 
     else if(std::strcmp(ops, "and")==0){
-        dumpInstructions(m_output_file.get(), "   and t0, t1, t0      # always save the value in a certain register you choose\n");
-        dumpInstructions(m_output_file.get(), riscv_assembly_push1);
+        dumpInstructions(m_asm, "   and t0, t1, t0      # always save the value in a certain register you choose\n");
+        if(branch){
+            dumpInstructions(m_asm, "   mv t1, t0\n");
+            emitZeroBranch();
+        }
+        else
+            dumpInstructions(m_asm, riscv_assembly_push1);
     }
 
     else if(std::strcmp(ops, "or")==0){
-        dumpInstructions(m_output_file.get(), "   or t0, t1, t0      # always save the value in a certain register you choose\n");
-        dumpInstructions(m_output_file.get(), riscv_assembly_push1);
+        dumpInstructions(m_asm, "   or t0, t1, t0      # always save the value in a certain register you choose\n");
+        if(branch){
+            dumpInstructions(m_asm, "   mv t1, t0\n");
+            emitZeroBranch();
+        }
+        else
+            dumpInstructions(m_asm, riscv_assembly_push1);
     }
 
     else{
+        if(real_operands)
+            emitRealComparison(ops);
+
         constexpr const char*const riscv_assembly_branch = 
         "   %s t1, t0, L%d      # if t1 %s t0, jump to L%d\n";
         if(std::strcmp(p_bin_op.getOpCString(), "<=") == 0){
             if(flag_if && branch){
-                dumpInstructions(m_output_file.get(), riscv_assembly_branch, "bgt", label_id+1, ">", label_id+1);
+                emitIfBranch("bgt");
             }
             else if(flag_while && branch){
-                dumpInstructions(m_output_file.get(), riscv_assembly_branch, "bgt", label_id+2, ">", label_id+2);
+                dumpInstructions(m_asm, riscv_assembly_branch, "bgt", label_id+2, ">", label_id+2);
             }
             else{
                 constexpr const char*const riscv_assembly_bool_res =
-                "   sub t0, t1, t0      # always save the value in a certain register you choose\n"
-                "   slti t0, t0, 1\n";
-                dumpInstructions(m_output_file.get(), riscv_assembly_bool_res);
-                dumpInstructions(m_output_file.get(), riscv_assembly_push1);
+                "   slt t0, t0, t1      # t1 > t0\n"
+                "   xori t0, t0, 1\n";
+                dumpInstructions(m_asm, riscv_assembly_bool_res);
+                dumpInstructions(m_asm, riscv_assembly_push1);
             }
         }
         if(std::strcmp(p_bin_op.getOpCString(), "<") == 0){
             if(flag_if && branch){
-                dumpInstructions(m_output_file.get(), riscv_assembly_branch, "bge", label_id+1, ">=", label_id+1);
+                emitIfBranch("bge");
             }
             else if(flag_while && branch){
-                dumpInstructions(m_output_file.get(), riscv_assembly_branch, "bge", label_id+2, ">=", label_id+2);
+                dumpInstructions(m_asm, riscv_assembly_branch, "bge", label_id+2, ">=", label_id+2);
             }
             else{
                 constexpr const char*const riscv_assembly_bool_res =
-                "   sub t0, t1, t0      # always save the value in a certain register you choose\n"
-                "   slti t0, t0, 0\n";
-                dumpInstructions(m_output_file.get(), riscv_assembly_bool_res);
-                dumpInstructions(m_output_file.get(), riscv_assembly_push1);
+                "   slt t0, t1, t0      # always save the value in a certain register you choose\n";
+                dumpInstructions(m_asm, riscv_assembly_bool_res);
+                dumpInstructions(m_asm, riscv_assembly_push1);
             }
         }
         if(std::strcmp(p_bin_op.getOpCString(), ">=") == 0){
             if(flag_if && branch){
-                dumpInstructions(m_output_file.get(), riscv_assembly_branch, "blt", label_id+1, "<", label_id+1);
+                emitIfBranch("blt");
             }
             else if(flag_while && branch){
-                dumpInstructions(m_output_file.get(), riscv_assembly_branch, "blt", label_id+2, "<", label_id+2);
+                dumpInstructions(m_asm, riscv_assembly_branch, "blt", label_id+2, "<", label_id+2);
             }
             else{
                 constexpr const char*const riscv_assembly_bool_res =
-                "   sub t0, t1, t0      # always save the value in a certain register you choose\n"
-                "   slti t0, t0, 0\n"
-                "   slti t0, t0, 1\n";
-                dumpInstructions(m_output_file.get(), riscv_assembly_bool_res);
-                dumpInstructions(m_output_file.get(), riscv_assembly_push1);
+                "   slt t0, t1, t0      # t1 < t0\n"
+                "   xori t0, t0, 1\n";
+                dumpInstructions(m_asm, riscv_assembly_bool_res);
+                dumpInstructions(m_asm, riscv_assembly_push1);
             }
         }
         if(std::strcmp(p_bin_op.getOpCString(), ">") == 0){
             if(flag_if && branch){
-                dumpInstructions(m_output_file.get(), riscv_assembly_branch, "ble", label_id+1, "<=", label_id+1);
+                emitIfBranch("ble");
             }
             else if(flag_while && branch){
-                dumpInstructions(m_output_file.get(), riscv_assembly_branch, "ble", label_id+2, "<=", label_id+2);
+                dumpInstructions(m_asm, riscv_assembly_branch, "ble", label_id+2, "<=", label_id+2);
             }
             else{
                 constexpr const char*const riscv_assembly_bool_res =
-                "   sub t0, t1, t0      # always save the value in a certain register you choose\n"
-                "   slti t0, t0, 1\n"
-                "   slti t0, t0, 1\n";
-                dumpInstructions(m_output_file.get(), riscv_assembly_bool_res);
-                dumpInstructions(m_output_file.get(), riscv_assembly_push1);
+                "   slt t0, t0, t1      # always save the value in a certain register you choose\n";
+                dumpInstructions(m_asm, riscv_assembly_bool_res);
+                dumpInstructions(m_asm, riscv_assembly_push1);
             }
         }
         if(std::strcmp(p_bin_op.getOpCString(), "=") == 0){
             if(flag_if && branch){
-                dumpInstructions(m_output_file.get(), riscv_assembly_branch, "bne", label_id+1, "!=", label_id+1);
+                emitIfBranch("bne");
             }
             else if(flag_while && branch){
-                dumpInstructions(m_output_file.get(), riscv_assembly_branch, "bne", label_id+2, "!=", label_id+2);
+                dumpInstructions(m_asm, riscv_assembly_branch, "bne", label_id+2, "!=", label_id+2);
             }
             else{
                 constexpr const char*const riscv_assembly_bool_res =
-                "   sub t0, t1, t0      # always save the value in a certain register you choose\n"
+                "   xor t0, t1, t0      # always save the value in a certain register you choose\n"
                 "   seqz t0, t0\n";
-                dumpInstructions(m_output_file.get(), riscv_assembly_bool_res);
-                dumpInstructions(m_output_file.get(), riscv_assembly_push1);
+                dumpInstructions(m_asm, riscv_assembly_bool_res);
+                dumpInstructions(m_asm, riscv_assembly_push1);
             }
         }
         if(std::strcmp(p_bin_op.getOpCString(), "<>") == 0){
             if(flag_if && branch){
-                dumpInstructions(m_output_file.get(), riscv_assembly_branch, "beq", label_id+1, "=", label_id+1);
+                emitIfBranch("beq");
             }
             else if(flag_while && branch){
-                dumpInstructions(m_output_file.get(), riscv_assembly_branch, "beq", label_id+2, "=", label_id+2);
+                dumpInstructions(m_asm, riscv_assembly_branch, "beq", label_id+2, "=", label_id+2);
             }
             else{
                 constexpr const char*const riscv_assembly_bool_res =
-                "   sub t0, t1, t0      # always save the value in a certain register you choose\n"
-                "   snez t0, t0, 1\n";
-                dumpInstructions(m_output_file.get(), riscv_assembly_bool_res);
-                dumpInstructions(m_output_file.get(), riscv_assembly_push1);
+                "   xor t0, t1, t0      # always save the value in a certain register you choose\n"
+                "   snez t0, t0\n";
+                dumpInstructions(m_asm, riscv_assembly_bool_res);
+                dumpInstructions(m_asm, riscv_assembly_push1);
             }
         }
     }
-    dumpInstructions(m_output_file.get(), "\n");
+    dumpInstructions(m_asm, "\n");
 }
 
 void CodeGenerator::visit(UnaryOperatorNode &p_un_op) {
     const char* ops = p_un_op.getOpCString();
-    dumpInstructions(m_output_file.get(),"\n# unary operator: %s\n",ops);
-    if(std::strcmp(ops, "neg") == 0){
+    dumpInstructions(m_asm,"\n# unary operator: %s\n",ops);
+    if(tryFold(p_un_op))
+        return;
+    if(std::strcmp(ops, "neg") == 0 && m_options.real_lowering == RealLowering::kSoftFloat &&
+       p_un_op.getInferredType()->isReal()){
+        p_un_op.visitChildNodes(*this);
+        constexpr const char*const riscv_assembly_float_neg_expr=
+        "   lw t0, 0(sp)        # pop the value from the stack\n"
+        "   addi sp, sp, 4\n"
+        "   lui t1, 0x80000\n"
+        "   xor t0, t0, t1      # flip the sign bit\n"
+        "   addi sp, sp, -4\n"
+        "   sw t0, 0(sp)        # push the value to the stack\n\n";
+        dumpInstructions(m_asm, riscv_assembly_float_neg_expr);
+    }
+    else if(std::strcmp(ops, "neg") == 0){
         p_un_op.visitChildNodes(*this);
         constexpr const char*const riscv_assembly_unary_expr=
         "   lw t0, 0(sp)        # pop the value from the stack\n"
@@ -546,7 +1783,7 @@ void CodeGenerator::visit(UnaryOperatorNode &p_un_op) {
         "   neg t0, t0\n        # always save the value in a certain register you choose\n"
         "   addi sp, sp, -4\n"
         "   sw t0, 0(sp)        # push the value to the stack\n\n";
-        dumpInstructions(m_output_file.get(), riscv_assembly_unary_expr);
+        dumpInstructions(m_asm, riscv_assembly_unary_expr);
     }
     if(std::strcmp(ops, "not") == 0){
         bool branch = flag_branch;
@@ -556,28 +1793,26 @@ void CodeGenerator::visit(UnaryOperatorNode &p_un_op) {
         constexpr const char*const riscv_assembly_not_expr=
         "   lw t0, 0(sp)        # pop the value from the stack\n"
         "   addi sp, sp, 4\n"
-        "   slti t0, t0, 1\n"
+        "   xori t0, t0, 1\n"
         "   addi sp, sp, -4\n"
         "   sw t0, 0(sp)        # push the value to the stack\n\n";
-        dumpInstructions(m_output_file.get(), riscv_assembly_not_expr);
+        dumpInstructions(m_asm, riscv_assembly_not_expr);
 
         if(branch){
-            constexpr const char*const riscv_assembly_not_branch_expr=
-            "   lw t1, 0(sp)         # pop the value from the stack\n"
-            "   addi sp, sp, 4\n"
-            "   li t0, 0\n"
-            "   beq t1, t0, L%d      # if t1 == 0, jump to L%d\n";
-            dumpInstructions(m_output_file.get(), riscv_assembly_not_branch_expr,label_id+1,label_id+1);
+            dumpInstructions(m_asm, "   lw t1, 0(sp)         # pop the value from the stack\n"
+                                    "   addi sp, sp, 4\n");
+            emitZeroBranch();
         }
     }
     
 }
 
 void CodeGenerator::visit(FunctionInvocationNode &p_func_invocation) {
-    dumpInstructions(m_output_file.get(), "\n# function invocation: %s\n", p_func_invocation.getNameCString());
-    flag_funcInvocation = true;
-    p_func_invocation.visitChildNodes(*this);
-    flag_funcInvocation = false;
+    if(tryInline(p_func_invocation))
+        return;
+    emitLocation(p_func_invocation.getLocation());
+    dumpInstructions(m_asm, "\n# function invocation: %s\n", p_func_invocation.getNameCString());
+    visitArguments(p_func_invocation);
     constexpr const char*const riscv_assembly_popa = 
     "   lw a%d, 0(sp)        # pop the value from the stack to the argument register a%d\n"
     "   addi sp, sp, 4\n";
@@ -588,7 +1823,7 @@ void CodeGenerator::visit(FunctionInvocationNode &p_func_invocation) {
     for(int i = p_func_invocation.getArguments().size()-1 ; i>=0 ; --i){
         if(i <= 7){
             if(p_func_invocation.getArguments()[i]->getInferredType()->isScalar()){
-                dumpInstructions(m_output_file.get(), riscv_assembly_popa, i, i);
+                dumpInstructions(m_asm, riscv_assembly_popa, i, i);
             }
             // array
             else{
@@ -604,10 +1839,10 @@ void CodeGenerator::visit(FunctionInvocationNode &p_func_invocation) {
 
                 for(int j = 0; j < element_num ;j++){
                     if(j<element_num-8){
-                        dumpInstructions(m_output_file.get(), riscv_assembly_pops, element_num-8-j, element_num-8-j);
+                        dumpInstructions(m_asm, riscv_assembly_pops, element_num-8-j, element_num-8-j);
                     }
                     else{
-                        dumpInstructions(m_output_file.get(), riscv_assembly_popa, register_id, register_id);
+                        dumpInstructions(m_asm, riscv_assembly_popa, register_id, register_id);
                         register_id --;
                     }
                 }
@@ -615,7 +1850,7 @@ void CodeGenerator::visit(FunctionInvocationNode &p_func_invocation) {
         }
         // i>=8
         else{
-            dumpInstructions(m_output_file.get(), riscv_assembly_pops, i-7, i-7);
+            dumpInstructions(m_asm, riscv_assembly_pops, i-7, i-7);
         }
     }
     constexpr const char*const riscv_assembly_function_call=
@@ -624,44 +1859,78 @@ void CodeGenerator::visit(FunctionInvocationNode &p_func_invocation) {
     "   addi sp, sp, -4\n"
     "   sw t0, 0(sp)       # push the value to the stack\n\n\n";
 
-    dumpInstructions(m_output_file.get(), riscv_assembly_function_call, p_func_invocation.getNameCString(), p_func_invocation.getNameCString());
+    const std::string callee = getSpecialization(p_func_invocation);
+    dumpInstructions(m_asm, riscv_assembly_function_call, callee.c_str(), p_func_invocation.getNameCString());
 }
 
 void CodeGenerator::visit(VariableReferenceNode &p_variable_ref) {
     const SymbolEntry *entry = m_symbol_manager_ptr->lookup(p_variable_ref.getName());
     if(entry == nullptr)
         return;
+    // parameters of a specialized function and loop variables of a fully
+    // unrolled loop
+    if((entry->getKind() == SymbolEntry::KindEnum::kParameterKind ||
+        entry->getKind() == SymbolEntry::KindEnum::kLoopVarKind) && tryFold(p_variable_ref))
+        return;
     const char *var_name = p_variable_ref.getNameCString();
+    int32_t immediate;
+    // constant with a value that fits a register
+    if(getConstantImmediate(*entry, immediate)){
+        constexpr const char*const riscv_assembly_const_ref_expr =
+        "   li t0, %d            # constant %s\n"
+        "   addi sp, sp, -4\n"
+        "   sw t0, 0(sp)        # push the value to the stack\n";
+        dumpInstructions(m_asm, riscv_assembly_const_ref_expr, immediate, var_name);
+    }
+
+    // global array element
+    else if(entry->getLevel() == 0 && entry->getKind() == SymbolEntry::KindEnum::kVariableKind &&
+            !entry->getTypePtr()->isScalar() && !p_variable_ref.getIndices().empty()){
+        const bool lvalue = flag_lvalue;
+        flag_lvalue = false;
+        dumpInstructions(m_asm, "# global array reference %s\n", lvalue ? "lvalue" : "rvalue");
+        // a condition branches on the element, not on its indices
+        const bool branch = flag_branch;
+        flag_branch = false;
+        p_variable_ref.visitChildNodes(*this);
+        flag_branch = branch;
+        emitElementAddress(p_variable_ref, *entry, 0);
+        if(!lvalue)
+            dumpInstructions(m_asm, "   lw t0, 0(t0)\n");
+        dumpInstructions(m_asm, "   addi sp, sp, -4\n"
+                                "   sw t0, 0(sp)        # push the %s to the stack\n",
+                         lvalue ? "address" : "value");
+    }
+
     // global variable
-    if(entry->getLevel() == 0 && entry->getKind() == SymbolEntry::KindEnum::kVariableKind){
+    else if(entry->getLevel() == 0 && entry->getKind() == SymbolEntry::KindEnum::kVariableKind){
         if(flag_lvalue){
             flag_lvalue = false;
             constexpr const char*const riscv_assembly_glval_ref_expr =
-            "   la t0, %s           # load the address of variable %s\n"
+            "   lui t0, %%hi(%s)\n"
+            "   addi t0, t0, %%lo(%s) # load the address of variable %s\n"
             "   addi sp, sp, -4\n"
             "   sw t0, 0(sp)     # push the address to the stack\n";
-            dumpInstructions(m_output_file.get(), riscv_assembly_glval_ref_expr, var_name, var_name);
+            dumpInstructions(m_asm, riscv_assembly_glval_ref_expr, var_name, var_name, var_name);
         }
         else{
             constexpr const char*const riscv_assembly_grval_ref_expr =
-            "   la t0, %s\n"
-            "   lw t1, 0(t0)        # load the value of %s\n"
-            "   mv t0, t1\n"
+            "   lui t0, %%hi(%s)\n"
+            "   lw t0, %%lo(%s)(t0) # load the value of %s\n"
             "   addi sp, sp, -4\n"
-            "   sw t0, 0(sp)     # push the address to the stack\n";
-            dumpInstructions(m_output_file.get(), riscv_assembly_grval_ref_expr, var_name, var_name);
+            "   sw t0, 0(sp)     # push the value to the stack\n";
+            dumpInstructions(m_asm, riscv_assembly_grval_ref_expr, var_name, var_name, var_name);
         }
     }
 
     // global constant
     else if(entry->getLevel() == 0 && entry->getKind() == SymbolEntry::KindEnum::kConstantKind){
         constexpr const char*const riscv_assembly_gconst_ref_expr =
-        "   la t0, %s\n"
-        "   lw t1, 0(t0)        # load the value of %s\n"
-        "   mv t0, t1\n"
+        "   lui t0, %%hi(%s)\n"
+        "   lw t0, %%lo(%s)(t0) # load the value of %s\n"
         "   addi sp, sp, -4\n"
         "   sw t0, 0(sp)     # push the value to the stack\n";
-        dumpInstructions(m_output_file.get(), riscv_assembly_gconst_ref_expr, var_name, var_name);
+        dumpInstructions(m_asm, riscv_assembly_gconst_ref_expr, var_name, var_name, var_name);
     }
 
     // local variable, function parameter, loop variable
@@ -670,6 +1939,7 @@ void CodeGenerator::visit(VariableReferenceNode &p_variable_ref) {
         || entry->getKind() == SymbolEntry::KindEnum::kLoopVarKind)){
         
         int addr = addr_stack[entry->getName()].top();
+        int element;
 
         if(flag_lvalue){
             flag_lvalue = false;
@@ -680,47 +1950,36 @@ void CodeGenerator::visit(VariableReferenceNode &p_variable_ref) {
                     "   addi t0, s0, -%d\n"
                     "   addi sp, sp, -4\n"
                     "   sw t0, 0(sp)        # push the address to the stack\n";
-                    dumpInstructions(m_output_file.get(), riscv_assembly_llvalue_ref_expr, addr+4);
+                    dumpInstructions(m_asm, riscv_assembly_llvalue_ref_expr, addr+4);
                 }
                 else{
                     constexpr const char*const riscv_assembly_const_str_expr = 
-                    "    .section    .rodata\n"
+                    "    .pushsection    .rodata\n"
                     "    .align 2\n"
                     "%s:\n"
                     "    .string ";
-                    dumpInstructions(m_output_file.get(), riscv_assembly_const_str_expr, entry->getNameCString());
+                    dumpInstructions(m_asm, riscv_assembly_const_str_expr, entry->getNameCString());
+                    flag_str_section = true;
                 }
             }
 
+            // array element replaced by a scalar
+            else if(getScalarElement(p_variable_ref, *entry, element)){
+                dumpInstructions(m_asm, "# array element %s[%d] as a scalar\n", var_name, element);
+                constexpr const char*const riscv_assembly_llvalue_ref_expr =
+                "   addi t0, s0, -%d\n"
+                "   addi sp, sp, -4\n"
+                "   sw t0, 0(sp)        # push the address to the stack\n";
+                dumpInstructions(m_asm, riscv_assembly_llvalue_ref_expr, addr+4+4*element);
+            }
+
             // array reference lvalue
             else{
-                dumpInstructions(m_output_file.get(), "# array reference lvalue\n");
+                dumpInstructions(m_asm, "# array reference lvalue\n");
                 p_variable_ref.visitChildNodes(*this);
-                int times = 1;
-
-                dumpInstructions(m_output_file.get(), "\n# count offset----------------\n   li t2, 0\n");
-                constexpr const char*const riscv_assembly_count_off_expr =
-                "   lw t0, 0(sp)        # pop the value from the stack\n"
-                "   addi t0, t0, -1     # index starts from 1\n"
-                "   addi sp, sp, 4\n"
-                "   li t1, %d\n"
-                "   mul t1, t0, t1\n"
-                "   add t2, t1, t2\n";
-                for(int i = p_variable_ref.getIndices().size()-1; i>=0 ; --i){
-                    if(i != p_variable_ref.getIndices().size()-1)
-                        times *= entry->getTypePtr()->getDimensions()[i+1];
-                    dumpInstructions(m_output_file.get(), riscv_assembly_count_off_expr, times);
-                }
-                constexpr const char*const riscv_assembly_count_off_end_expr =
-                "   li t1, 4\n"
-                "   mul t2, t2, t1\n"
-                "   addi t2, t2, %d\n"
-                "   addi t2, t2, 4\n"
-                "# count offset end-----------\n\n"
-                "   sub t0, s0, t2\n"
-                "   addi sp, sp, -4\n"
-                "   sw t0, 0(sp)        # push the address to the stack\n";
-                dumpInstructions(m_output_file.get(), riscv_assembly_count_off_end_expr, addr);
+                emitElementAddress(p_variable_ref, *entry, addr);
+                dumpInstructions(m_asm, "   addi sp, sp, -4\n"
+                                        "   sw t0, 0(sp)        # push the address to the stack\n");
             }
         }
         else{
@@ -733,21 +1992,21 @@ void CodeGenerator::visit(VariableReferenceNode &p_variable_ref) {
                     "   addi t0, t0, %%lo(%s)\n"
                     "   addi sp, sp, -4\n"
                     "   sw t0, 0(sp)        # push the value to the stack\n";
-                    dumpInstructions(m_output_file.get(), riscv_assembly_rvalue_ref_str_expr, entry->getNameCString(), entry->getNameCString());
+                    dumpInstructions(m_asm, riscv_assembly_rvalue_ref_str_expr, entry->getNameCString(), entry->getNameCString());
                 }
                 else{
                     constexpr const char*const riscv_assembly_lrvalue_ref_expr =
                     "   lw t0, -%d(s0)      # load the value of %s\n"
                     "   addi sp, sp, -4\n"
                     "   sw t0, 0(sp)        # push the value to the stack\n";
-                    dumpInstructions(m_output_file.get(), riscv_assembly_lrvalue_ref_expr, addr+4, p_variable_ref.getNameCString());
+                    dumpInstructions(m_asm, riscv_assembly_lrvalue_ref_expr, addr+4, p_variable_ref.getNameCString());
                 }
             }
             // array reference or funcInvocation rvalue
             else{
                 // function invocation rvalue, pass the whole array value as parameter
                 if(flag_funcInvocation){
-                    dumpInstructions(m_output_file.get(), "# array reference rvalue\n");
+                    dumpInstructions(m_asm, "# array reference rvalue\n");
                     int element_num = 1;
                     for(auto dimension : p_variable_ref.getInferredType()->getDimensions()){
                         element_num *= dimension;
@@ -757,40 +2016,36 @@ void CodeGenerator::visit(VariableReferenceNode &p_variable_ref) {
                     "   lw t0, -%d(s0)      # load the value of %s\n"
                     "   addi sp, sp, -4\n"
                     "   sw t0, 0(sp)        # push the value to the stack\n";
+                    // the callee gets the elements without the padding
+                    const auto &dimensions = entry->getTypePtr()->getDimensions();
+                    const auto layout = getLayout(*entry);
                     for(int i = 0 ; i < element_num ; ++i){
-                        dumpInstructions(m_output_file.get(), riscv_assembly_larvalue_ref_expr, addr+4);
-                        addr += 4;
+                        int element = 0;
+                        for(size_t d = 0, rest = i, size = element_num; d < dimensions.size(); ++d){
+                            size /= dimensions[d];
+                            element = element * layout[d] + rest / size;
+                            rest %= size;
+                        }
+                        dumpInstructions(m_asm, riscv_assembly_larvalue_ref_expr, addr+4+4*element, p_variable_ref.getNameCString());
                     }
                 }
+                // array element replaced by a scalar
+                else if(getScalarElement(p_variable_ref, *entry, element)){
+                    dumpInstructions(m_asm, "# array element %s[%d] as a scalar\n", var_name, element);
+                    constexpr const char*const riscv_assembly_lrvalue_ref_expr =
+                    "   lw t0, -%d(s0)      # load the value of %s\n"
+                    "   addi sp, sp, -4\n"
+                    "   sw t0, 0(sp)        # push the value to the stack\n";
+                    dumpInstructions(m_asm, riscv_assembly_lrvalue_ref_expr, addr+4+4*element, var_name);
+                }
                 // array reference rvalue
                 else{
-                    dumpInstructions(m_output_file.get(), "# array reference rvalue\n");
+                    dumpInstructions(m_asm, "# array reference rvalue\n");
                     p_variable_ref.visitChildNodes(*this);
-                    int times = 1;
-                    dumpInstructions(m_output_file.get(), "\n# count offset----------------\n   li t2, 0\n");
-                    constexpr const char*const riscv_assembly_count_off_expr =
-                    "   lw t0, 0(sp)        # pop the value from the stack\n"
-                    "   addi t0, t0, -1     # index starts from 1\n"
-                    "   addi sp, sp, 4\n"
-                    "   li t1, %d\n"
-                    "   mul t1, t0, t1\n"
-                    "   add t2, t1, t2\n";
-                    for(int i = p_variable_ref.getIndices().size()-1; i>=0 ; --i){
-                        if(i != p_variable_ref.getIndices().size()-1)
-                            times *= entry->getTypePtr()->getDimensions()[i+1];
-                        dumpInstructions(m_output_file.get(), riscv_assembly_count_off_expr, times);
-                    }
-                    constexpr const char*const riscv_assembly_count_off_end_expr =
-                    "   li t1, 4\n"
-                    "   mul t2, t2, t1\n"
-                    "   addi t2, t2, %d\n"
-                    "   addi t2, t2, 4\n"
-                    "# count offset end-----------\n\n"
-                    "   sub t0, s0, t2\n"
-                    "   lw t0, 0(t0)\n"
-                    "   addi sp, sp, -4\n"
-                    "   sw t0, 0(sp)        # push the address to the stack\n";
-                    dumpInstructions(m_output_file.get(), riscv_assembly_count_off_end_expr, addr);
+                    emitElementAddress(p_variable_ref, *entry, addr);
+                    dumpInstructions(m_asm, "   lw t0, 0(t0)\n"
+                                            "   addi sp, sp, -4\n"
+                                            "   sw t0, 0(sp)        # push the address to the stack\n");
                 }
             }
         }
@@ -803,26 +2058,26 @@ void CodeGenerator::visit(VariableReferenceNode &p_variable_ref) {
         "   lw t0, -%d(s0)       # load the value of %s\n"
         "   addi sp, sp, -4\n"
         "   sw t0, 0(sp)        # push the value to the stack\n";
-        dumpInstructions(m_output_file.get(), riscv_assembly_lrvalue_const_expr, addr + 4, p_variable_ref.getNameCString());
+        dumpInstructions(m_asm, riscv_assembly_lrvalue_const_expr, addr + 4, p_variable_ref.getNameCString());
     }
 
     // TODO: consider branch
     if(flag_branch){
         flag_branch = false;
-        constexpr const char*const riscv_assembly_var_refb_expr=
-        "   lw t1, 0(sp)        # pop the value from the stack\n"
-        "   addi sp, sp, 4\n"
-        "   li t0, 0\n"
-        "   beq t1, t0, L%d      # if t1 == 0, jump to L%d\n";
-        dumpInstructions(m_output_file.get(), riscv_assembly_var_refb_expr ,label_id+1, label_id+1);
+        dumpInstructions(m_asm, "   lw t1, 0(sp)        # pop the value from the stack\n"
+                                "   addi sp, sp, 4\n");
+        emitZeroBranch();
     }
 }
 
 void CodeGenerator::visit(AssignmentNode &p_assignment) {
+    emitLocation(p_assignment.getLocation());
     flag_lvalue = true;
 
-    dumpInstructions(m_output_file.get(), "\n# variable assignment: %s\n", p_assignment.getLvalue().getNameCString());
-    p_assignment.visitChildNodes(*this);
+    dumpInstructions(m_asm, "\n# variable assignment: %s\n", p_assignment.getLvalue().getNameCString());
+    const_cast<VariableReferenceNode &>(p_assignment.getLvalue()).accept(*this);
+    visitAsReal(const_cast<ExpressionNode &>(p_assignment.getExpr()),
+                p_assignment.getLvalue().getInferredType()->isReal());
 
     if(!p_assignment.getLvalue().getInferredType()->isString()){
         constexpr const char*const riscv_assembly_assign_expr =
@@ -832,7 +2087,12 @@ void CodeGenerator::visit(AssignmentNode &p_assignment) {
         "   addi sp, sp, 4\n"
         "   sw t0, 0(t1)        # save the value to %s\n\n";
 
-        dumpInstructions(m_output_file.get(), riscv_assembly_assign_expr, p_assignment.getLvalue().getNameCString());
+        dumpInstructions(m_asm, riscv_assembly_assign_expr, p_assignment.getLvalue().getNameCString());
+    }
+    else if(flag_str_section){
+        // the string went to .rodata, continue the function in .text
+        flag_str_section = false;
+        dumpInstructions(m_asm, "    .popsection\n\n");
     }
     if(flag_for_assign){
         flag_for_assign = false;
@@ -842,33 +2102,74 @@ void CodeGenerator::visit(AssignmentNode &p_assignment) {
         "   lw t0, -%d(s0)      # load the value of %s\n"
         "   addi sp, sp, -4\n"
         "   sw t0, 0(sp)        # push the value to the stack\n";
-        dumpInstructions(m_output_file.get(), riscv_assembly_for_assign_expr, label_id ,addr+4, p_assignment.getLvalue().getNameCString());
+        dumpInstructions(m_asm, riscv_assembly_for_assign_expr, label_id ,addr+4, p_assignment.getLvalue().getNameCString());
     }
 }
 
 void CodeGenerator::visit(ReadNode &p_read) {
-    dumpInstructions(m_output_file.get(), "\n# read\n");
+    emitLocation(p_read.getLocation());
+    dumpInstructions(m_asm, "\n# read\n");
     flag_lvalue = true;
     p_read.visitChildNodes(*this);
+    const char *routine = "readInt";
+    if(!isRealLowered() && p_read.getTarget().getInferredType()->isReal())
+        m_needs_float = true;
+    if(isRealLowered() && p_read.getTarget().getInferredType()->isReal())
+        routine = (m_options.real_lowering == RealLowering::kFixedPoint) ? "readFixed" : "readReal";
     constexpr const char*const riscv_assembly_read=
-    "   jal ra, readInt     # call function 'readInt'\n"
+    "   jal ra, %s     # call function '%s'\n"
     "   lw t0, 0(sp)        # pop the address from the stack\n"
     "   addi sp, sp, 4\n"
     "   sw a0, 0(t0)        # save the return value to %s\n\n";
-    dumpInstructions(m_output_file.get(), riscv_assembly_read, p_read.getTarget().getNameCString());
+    dumpInstructions(m_asm, riscv_assembly_read, routine, routine, p_read.getTarget().getNameCString());
 }
 
 void CodeGenerator::visit(IfNode &p_if) {
+    int64_t condition;
+    if(m_passes.isEnabled(PassId::kFold) && !isInstrumented() && m_ranges.getValue(p_if.getCondition(), condition)){
+        m_remarks.passed(PassId::kFold, "KnownCondition", p_if.getLocation(),
+                         "if condition is always %s, the other arm is removed", condition ? "true" : "false");
+        dumpInstructions(m_asm, "# if condition is always %s\n", condition ? "true" : "false");
+        CompoundStatementNode *arm = condition ? &p_if.getBody() : p_if.getElseBody();
+        if(arm != nullptr)
+            arm->accept(*this);
+        return;
+    }
+    emitLocation(p_if.getLocation());
     flag_if = true;
     flag_branch = true;
     label_base.push(label);
     label += 3;
     label_id = label_base.top();
 
-    p_if.visitChildNodes(*this);
+    // the arm the training run took more often falls through
+    const uint32_t counter = m_profile_counters.getCounter(&p_if);
+    CompoundStatementNode *arms[2] = {&p_if.getBody(), p_if.getElseBody()};
+    uint32_t arm_counters[2] = {counter, counter + 1};
+    const bool swap_arms = arms[1] != nullptr && m_passes.isEnabled(PassId::kLayout) &&
+                           !m_profile.empty() &&
+                           isBranchingCondition(p_if.getCondition()) &&
+                           m_profile.getCount(counter + 1) > m_profile.getCount(counter);
+    if(swap_arms){
+        m_remarks.passed(PassId::kLayout, "ElseFirst", p_if.getLocation(),
+                         "else arm laid out first: it ran %llu times, the then arm %llu",
+                         static_cast<unsigned long long>(m_profile.getCount(counter + 1)),
+                         static_cast<unsigned long long>(m_profile.getCount(counter)));
+        std::swap(arms[0], arms[1]);
+        std::swap(arm_counters[0], arm_counters[1]);
+    }
+
+    flag_branch_invert = swap_arms;
+    const_cast<ExpressionNode &>(p_if.getCondition()).accept(*this);
+    flag_branch_invert = false;
+    for(int i = 0; i < 2 && arms[i] != nullptr; ++i){
+        if(isInstrumented())
+            m_pending_counter = arm_counters[i];
+        arms[i]->accept(*this);
+    }
 
     flag_if = false;
-    dumpInstructions(m_output_file.get(), "L%d:\n", label_id + 2);
+    dumpInstructions(m_asm, "L%d:\n", label_id + 2);
     label_base.pop();
     if(!label_base.empty())
         label_id = label_base.top();
@@ -877,16 +2178,28 @@ void CodeGenerator::visit(IfNode &p_if) {
 }
 
 void CodeGenerator::visit(WhileNode &p_while) {
+    int64_t condition;
+    if(m_passes.isEnabled(PassId::kFold) && !isInstrumented() &&
+       m_ranges.getValue(p_while.getCondition(), condition) && !condition){
+        m_remarks.passed(PassId::kFold, "KnownCondition", p_while.getLocation(),
+                         "while condition is always false, the loop is removed");
+        dumpInstructions(m_asm, "# while condition is always false\n");
+        return;
+    }
     label_base.push(label);
     label += 3;
     label_id = label_base.top();
-    dumpInstructions(m_output_file.get() , "L%d:\n", label_id);
+    emitLocation(p_while.getLocation());
+    m_cost_report.addLoop("L" + std::to_string(label_id), "L" + std::to_string(label_id + 2), -1);
+    dumpInstructions(m_asm , "L%d:\n", label_id);
     flag_while = true;
     flag_branch = true;
+    if(isInstrumented())
+        m_pending_counter = m_profile_counters.getCounter(&p_while);
     p_while.visitChildNodes(*this);
 
     flag_while = false;
-    dumpInstructions(m_output_file.get(), "L%d:\n", label_id + 2);
+    dumpInstructions(m_asm, "L%d:\n", label_id + 2);
     label_base.pop();
     if(!label_base.empty())
         label_id = label_base.top();
@@ -898,6 +2211,21 @@ void CodeGenerator::visit(ForNode &p_for) {
     // Reconstruct the hash table for looking up the symbol entry
     m_symbol_manager_ptr->reconstructHashTableFromSymbolTable(
         p_for.getSymbolTable());
+    const SymbolEntry *loop_var = m_symbol_manager_ptr->lookup(p_for.getInitialStatement()->getLvalue().getName());
+    m_ranges.enterLoop(loop_var, p_for.getLowerBound().getConstantPtr()->integer(),
+                       p_for.getUpperBound().getConstantPtr()->integer());
+
+    if(tryFullUnroll(p_for, loop_var)){
+        m_ranges.leaveLoop(loop_var);
+        if(p_for.getSymbolTable() != nullptr){
+            const auto &entries = p_for.getSymbolTable()->getEntries();
+            for(const auto &entry:entries){
+                addrStackPop(entry->getName());
+            }
+        }
+        m_symbol_manager_ptr->removeSymbolsFromHashTable(p_for.getSymbolTable());
+        return;
+    }
 
     label_base.push(label);
     label += 3;
@@ -906,11 +2234,13 @@ void CodeGenerator::visit(ForNode &p_for) {
     flag_for = true;
     flag_for_assign = true;
     // flag_branch = true;
+    if(isInstrumented())
+        m_pending_counter = m_profile_counters.getCounter(&p_for);
     p_for.visitChildNodes(*this);
 
     flag_for = false;
     int addr = addr_stack[p_for.getInitialStatement()->getLvalue().getName()].top();
-    constexpr const char*const riscv_assembly_for_expr=
+    constexpr const char*const riscv_assembly_for_step_expr=
     "   addi t0, s0, -%d      # load the address of loop variable\n"
     "   addi sp, sp, -4\n"
     "   sw t0, 0(sp)        # push the address to the stack\n"
@@ -936,10 +2266,23 @@ void CodeGenerator::visit(ForNode &p_for) {
     "   addi sp, sp, 4\n"
     "   lw t1, 0(sp)        # pop the address from the stack\n"
     "   addi sp, sp, 4\n"
-    "   sw t0, 0(t1)        # save the value to loop variable\n"
-    "   j L%d                # jump back to loop condition\n"
-    "L%d:\n";
-    dumpInstructions(m_output_file.get(), riscv_assembly_for_expr, addr+4, addr+4, label_id, label_id+2);
+    "   sw t0, 0(t1)        # save the value to loop variable\n";
+    // a hot loop with a trip count divisible by the factor runs that many
+    // copies of its body per test of the loop condition
+    const int unroll_factor = getUnrollFactor(p_for);
+    const int64_t trip_count = p_for.getUpperBound().getConstantPtr()->integer() -
+                               p_for.getLowerBound().getConstantPtr()->integer();
+    m_cost_report.addLoop("L" + std::to_string(label_id), "L" + std::to_string(label_id + 2),
+                          std::max<int64_t>(trip_count, 0) / unroll_factor);
+    for(int copy = 1; copy < unroll_factor; ++copy){
+        emitLocation(p_for.getLocation());
+        dumpInstructions(m_asm, riscv_assembly_for_step_expr, addr+4, addr+4);
+        dumpInstructions(m_asm, "# unrolled loop body, copy %d of %d\n", copy + 1, unroll_factor);
+        p_for.getBody().accept(*this);
+    }
+    emitLocation(p_for.getLocation());
+    dumpInstructions(m_asm, riscv_assembly_for_step_expr, addr+4, addr+4);
+    dumpInstructions(m_asm, "   j L%d                # jump back to loop condition\nL%d:\n", label_id, label_id+2);
     label_base.pop();
     if(!label_base.empty())
         label_id = label_base.top();
@@ -952,16 +2295,19 @@ void CodeGenerator::visit(ForNode &p_for) {
             addrStackPop(entry->getName());
         }
     }
+    m_ranges.leaveLoop(loop_var);
     // Remove the entries in the hash table
     m_symbol_manager_ptr->removeSymbolsFromHashTable(p_for.getSymbolTable());
 }
 
 void CodeGenerator::visit(ReturnNode &p_return) {
-    p_return.visitChildNodes(*this);
+    emitLocation(p_return.getLocation());
+    visitAsReal(const_cast<ExpressionNode &>(p_return.getReturnValue()),
+                m_return_type_ptr != nullptr && m_return_type_ptr->isReal());
 
     constexpr const char*const riscv_assembly_return_expr=
     "   lw t0, 0(sp)        # pop the value from the stack\n"
     "   addi sp, sp, 4\n"
     "   mv a0, t0           # load the value to the return value register 'a0'\n\n";
-    dumpInstructions(m_output_file.get(), riscv_assembly_return_expr);
+    dumpInstructions(m_asm, riscv_assembly_return_expr);
 }
@@ -0,0 +1,78 @@
+#include "codegen/CoreModel.hpp"
+
+#include <cstdlib>
+
+static bool setParameter(CoreModel &p_model, const std::string &p_key,
+                         const std::string &p_value) {
+    char *end = nullptr;
+    const unsigned long value = std::strtoul(p_value.c_str(), &end, 10);
+    if (p_value.empty() || *end != '\0') {
+        return false;
+    }
+    const auto cycles = static_cast<uint32_t>(value);
+    if (p_key == "alu") {
+        p_model.alu_latency = cycles;
+    } else if (p_key == "load") {
+        p_model.load_latency = cycles;
+    } else if (p_key == "mul") {
+        p_model.mul_latency = cycles;
+    } else if (p_key == "div") {
+        p_model.div_latency = cycles;
+    } else if (p_key == "muldiv-blocking") {
+        p_model.muldiv_blocking = (cycles != 0);
+    } else if (p_key == "branch") {
+        p_model.branch_taken_penalty = cycles;
+    } else if (p_key == "jump") {
+        p_model.jump_penalty = cycles;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool CoreModel::parse(const std::string &p_spec, CoreModel &p_model) {
+    const auto colon = p_spec.find(':');
+    const std::string name = p_spec.substr(0, colon);
+
+    p_model = CoreModel();
+    if (name == "bumblebee") {
+        // Nuclei Bumblebee: 2-stage pipeline, iterative mul/div unit
+        p_model.name = name;
+        p_model.load_latency = 2;
+        p_model.mul_latency = 17;
+        p_model.div_latency = 33;
+        p_model.muldiv_blocking = true;
+        p_model.branch_taken_penalty = 1;
+        p_model.jump_penalty = 1;
+    } else if (name == "inorder") {
+        // classic 5-stage pipeline, branches resolved in EX
+        p_model.name = name;
+        p_model.load_latency = 3;
+        p_model.mul_latency = 3;
+        p_model.div_latency = 20;
+        p_model.muldiv_blocking = false;
+        p_model.branch_taken_penalty = 2;
+        p_model.jump_penalty = 2;
+    } else if (name != "ideal") {
+        return false;
+    }
+
+    if (colon == std::string::npos) {
+        return true;
+    }
+    std::string::size_type begin = colon + 1;
+    while (begin <= p_spec.size()) {
+        auto comma = p_spec.find(',', begin);
+        if (comma == std::string::npos) {
+            comma = p_spec.size();
+        }
+        const std::string item = p_spec.substr(begin, comma - begin);
+        const auto equal = item.find('=');
+        if (equal == std::string::npos ||
+            !setParameter(p_model, item.substr(0, equal), item.substr(equal + 1))) {
+            return false;
+        }
+        begin = comma + 1;
+    }
+    return true;
+}
@@ -0,0 +1,320 @@
+#include "codegen/CostReport.hpp"
+#include "codegen/RiscvIsa.hpp"
+
+#include <algorithm>
+#include <set>
+
+namespace {
+
+constexpr int kRa = 1;
+constexpr int kSp = 2;
+
+enum class ClassEnum : uint8_t { kAlu, kLoad, kStore, kMul, kDiv, kBranch, kJump };
+
+const std::set<std::string> kMulOps = {"mul", "mulh", "mulhsu", "mulhu"};
+const std::set<std::string> kDivOps = {"div", "divu", "rem", "remu"};
+const std::set<std::string> kLoadOps = {"lw", "lh", "lhu", "lb", "lbu"};
+const std::set<std::string> kStoreOps = {"sw", "sh", "sb"};
+const std::set<std::string> kBranchOps = {"beq", "bne", "blt", "bge", "bltu", "bgeu",
+                                          "bgt", "ble", "bgtu", "bleu", "beqz",
+                                          "bnez", "blez", "bgez", "bltz", "bgtz"};
+const std::set<std::string> kJumpOps = {"j", "jal", "jalr", "jr", "ret", "call", "tail"};
+// RV32C forms whose first operand is both read and written
+const std::set<std::string> kTwoAddressOps = {"c.add", "c.addi", "c.sub", "c.and",
+                                              "c.andi", "c.or", "c.xor", "c.slli",
+                                              "c.srli", "c.srai", "c.addi16sp"};
+
+// the RV32I operation of an RV32C instruction
+std::string getBaseOp(const std::string &p_op) {
+    if (p_op.compare(0, 2, "c.") != 0) {
+        return p_op;
+    }
+    const std::string op = p_op.substr(2);
+    if (op == "lwsp") {
+        return "lw";
+    }
+    if (op == "swsp") {
+        return "sw";
+    }
+    if (op == "addi16sp" || op == "addi4spn") {
+        return "addi";
+    }
+    return op;
+}
+
+struct Decoded {
+    ClassEnum klass = ClassEnum::kAlu;
+    int def = -1;
+    std::vector<int> uses;
+    // instructions after the expansion of a pseudo-instruction
+    uint32_t count = 1;
+    std::string target;
+    // the sp adjustment of an "addi sp, sp, imm"
+    int64_t sp_imm = 0;
+};
+
+Decoded decode(const AsmLine &p_line) {
+    Decoded inst;
+    const std::string op = getBaseOp(p_line.op);
+    const auto &ops = p_line.operands;
+    inst.count = getInstructionSize(p_line) == 8 ? 2 : 1;
+
+    auto addUse = [&](const std::string &p_operand) {
+        std::string offset, base;
+        int reg = getRegisterNumber(p_operand);
+        if (reg < 0 && parseMemoryOperand(p_operand, offset, base)) {
+            reg = getRegisterNumber(base);
+        }
+        if (reg > 0) {
+            inst.uses.push_back(reg);
+        }
+    };
+
+    if (kLoadOps.count(op) || kStoreOps.count(op)) {
+        const bool is_load = kLoadOps.count(op) != 0;
+        inst.klass = is_load ? ClassEnum::kLoad : ClassEnum::kStore;
+        for (std::size_t k = is_load ? 1 : 0; k < ops.size(); ++k) {
+            addUse(ops[k]);
+        }
+        if (is_load && !ops.empty()) {
+            inst.def = getRegisterNumber(ops[0]);
+        }
+    } else if (kBranchOps.count(op)) {
+        inst.klass = ClassEnum::kBranch;
+        for (std::size_t k = 0; k + 1 < ops.size(); ++k) {
+            addUse(ops[k]);
+        }
+        if (!ops.empty()) {
+            inst.target = ops.back();
+        }
+    } else if (kJumpOps.count(op)) {
+        inst.klass = ClassEnum::kJump;
+        if (op == "jal" || op == "call") {
+            inst.def = (ops.size() == 2) ? getRegisterNumber(ops[0]) : kRa;
+        } else if (op == "jalr" || op == "jr") {
+            for (const auto &operand : ops) {
+                addUse(operand);
+            }
+        } else if (op == "ret") {
+            inst.uses.push_back(kRa);
+        }
+        if ((op == "j" || op == "jal") && !ops.empty()) {
+            inst.target = ops.back();
+        }
+    } else {
+        inst.klass = kMulOps.count(op) ? ClassEnum::kMul
+                     : kDivOps.count(op) ? ClassEnum::kDiv
+                                         : ClassEnum::kAlu;
+        if (!ops.empty()) {
+            inst.def = getRegisterNumber(ops[0]);
+        }
+        for (std::size_t k = kTwoAddressOps.count(p_line.op) ? 0 : 1; k < ops.size(); ++k) {
+            addUse(ops[k]);
+        }
+        if (op == "addi" && inst.def == kSp && !ops.empty()) {
+            // addi sp, sp, imm or c.addi16sp sp, imm
+            parseImmediate(ops.back(), inst.sp_imm);
+        }
+    }
+    if (inst.def == 0) {
+        inst.def = -1;
+    }
+    return inst;
+}
+
+} // namespace
+
+void CostReport::addLoop(const std::string &p_head, const std::string &p_exit,
+                         const int64_t p_trips) {
+    m_loops[p_head] = Loop{p_exit, p_trips};
+}
+
+void CostReport::run(const AssemblyBuffer &p_asm, const CoreModel &p_core) {
+    m_costs.clear();
+
+    const auto &lines = p_asm.getLines();
+    std::set<std::string> functions;
+    for (const auto &line : lines) {
+        if (line.isDirective() && line.op == ".type" && !line.operands.empty() &&
+            line.operands[0].find("@function") != std::string::npos) {
+            functions.insert(line.operands[0].substr(0, line.operands[0].find(',')));
+        }
+    }
+
+    FunctionCost *current = nullptr;
+    // the loops the code is in, innermost last
+    struct ActiveLoop {
+        std::string exit;
+        double weight;
+        bool unbounded;
+    };
+    std::vector<ActiveLoop> loops;
+    std::set<std::string> seen_labels;
+    std::string block_label;
+    uint32_t block_offset = 0;
+    Block block;
+    uint64_t cycle = 0;
+    uint64_t ready[32] = {};
+    int64_t sp_delta = 0;
+
+    auto weight = [&]() { return loops.empty() ? 1.0 : loops.back().weight; };
+    auto endBlock = [&](const uint64_t p_penalty) {
+        if (current == nullptr || block.instructions == 0) {
+            return;
+        }
+        block.cycles = cycle + p_penalty;
+        current->cycles += block.cycles * block.weight;
+        current->unbounded = current->unbounded || block.unbounded;
+        current->blocks.push_back(block);
+        block_offset += block.instructions;
+    };
+    auto startBlock = [&]() {
+        block = Block();
+        block.name = block_offset == 0 ? block_label
+                                       : block_label + "+" + std::to_string(block_offset);
+        block.weight = weight();
+        block.unbounded = !loops.empty() && loops.back().unbounded;
+        cycle = 0;
+        std::fill(std::begin(ready), std::end(ready), 0);
+    };
+
+    std::vector<bool> in_text{true};
+    for (const auto &line : lines) {
+        followSection(line, in_text);
+        if (line.isDirective() && line.op == ".size" && current != nullptr) {
+            endBlock(0);
+            current = nullptr;
+            continue;
+        }
+        if (!in_text.back()) {
+            continue;
+        }
+        if (line.isLabel()) {
+            if (functions.count(line.label)) {
+                m_costs.emplace_back();
+                current = &m_costs.back();
+                current->name = line.label;
+                loops.clear();
+                seen_labels.clear();
+                sp_delta = 0;
+            } else {
+                endBlock(0);
+            }
+            if (current == nullptr) {
+                continue;
+            }
+            seen_labels.insert(line.label);
+            if (!loops.empty() && loops.back().exit == line.label) {
+                loops.pop_back();
+            }
+            const auto loop = m_loops.find(line.label);
+            if (loop != m_loops.end()) {
+                const int64_t trips = loop->second.trips;
+                const bool unbounded = trips < 0 || (!loops.empty() && loops.back().unbounded);
+                loops.push_back({loop->second.exit, weight() * (trips < 0 ? 1 : trips),
+                                 unbounded});
+            }
+            block_label = line.label;
+            block_offset = 0;
+            startBlock();
+            continue;
+        }
+        if (!line.isInstruction() || current == nullptr) {
+            continue;
+        }
+
+        const Decoded inst = decode(line);
+        uint32_t latency = p_core.alu_latency;
+        uint32_t occupancy = 1;
+        switch (inst.klass) {
+        case ClassEnum::kLoad:
+            ++current->loads;
+            latency = p_core.load_latency;
+            break;
+        case ClassEnum::kStore:
+            ++current->stores;
+            break;
+        case ClassEnum::kMul:
+        case ClassEnum::kDiv:
+            ++current->muldiv;
+            latency = inst.klass == ClassEnum::kMul ? p_core.mul_latency : p_core.div_latency;
+            occupancy = p_core.muldiv_blocking ? latency : 1;
+            break;
+        case ClassEnum::kBranch:
+            ++current->branches;
+            break;
+        case ClassEnum::kJump:
+            ++current->jumps;
+            break;
+        default:
+            break;
+        }
+        current->instructions += inst.count;
+        if (inst.sp_imm != 0) {
+            sp_delta += inst.sp_imm;
+            current->stack = std::max(current->stack, -sp_delta);
+            if (current->frame == 0 && inst.sp_imm < 0) {
+                current->frame = -inst.sp_imm;
+            }
+        }
+
+        // the first half of a pseudo-instruction feeds the second
+        const uint32_t extra = inst.count - 1;
+        uint64_t issue = cycle;
+        for (const int use : inst.uses) {
+            issue = std::max(issue, ready[use]);
+        }
+        if (inst.def > 0) {
+            ready[inst.def] = issue + extra + latency;
+        }
+        cycle = issue + extra + occupancy;
+        block.instructions += inst.count;
+
+        if (inst.klass == ClassEnum::kJump) {
+            endBlock(p_core.jump_penalty);
+            startBlock();
+        } else if (inst.klass == ClassEnum::kBranch) {
+            // backward branches are taken, forward ones fall through
+            endBlock(seen_labels.count(inst.target) ? p_core.branch_taken_penalty : 0);
+            startBlock();
+        }
+    }
+    endBlock(0);
+}
+
+void CostReport::dumpCostReport(FILE *p_out_file, const std::string &p_source,
+                                const CoreModel &p_core) const {
+    const std::string title = "Static cost on the " + p_core.name + " core";
+    std::fprintf(p_out_file,
+                 "\n"
+                 "|---------------------------------------------------|\n"
+                 "|  %-49s|\n"
+                 "|---------------------------------------------------|\n"
+                 "  %s\n"
+                 "  %-20s %7s %6s %6s %6s %6s %6s %6s %6s %12s\n",
+                 title.c_str(), p_source.c_str(), "function", "instrs", "loads",
+                 "stores", "muldiv", "branch", "jumps", "frame", "stack", "cycles");
+
+    bool unbounded = false;
+    for (const auto &cost : m_costs) {
+        std::fprintf(p_out_file, "  %-20s %7u %6u %6u %6u %6u %6u %6lld %6lld %12.0f%s\n",
+                     cost.name.c_str(), cost.instructions, cost.loads, cost.stores,
+                     cost.muldiv, cost.branches, cost.jumps,
+                     static_cast<long long>(cost.frame), static_cast<long long>(cost.stack),
+                     cost.cycles, cost.unbounded ? "+" : "");
+        unbounded = unbounded || cost.unbounded;
+    }
+    std::fprintf(p_out_file, "  cycles per call, callees not included%s\n",
+                 unbounded ? "; + while loops counted once" : "");
+
+    for (const auto &cost : m_costs) {
+        std::fprintf(p_out_file, "\n  %s\n  %-28s %7s %8s %12s %12s\n", cost.name.c_str(),
+                     "block", "instrs", "cycles", "runs", "total");
+        for (const auto &block : cost.blocks) {
+            std::fprintf(p_out_file, "  %-28s %7u %8llu %12.0f %12.0f%s\n",
+                         block.name.c_str(), block.instructions,
+                         static_cast<unsigned long long>(block.cycles), block.weight,
+                         block.cycles * block.weight, block.unbounded ? "+" : "");
+        }
+    }
+}
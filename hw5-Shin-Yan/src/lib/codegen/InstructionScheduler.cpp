@@ -0,0 +1,470 @@
+#include "codegen/InstructionScheduler.hpp"
+#include "codegen/RiscvIsa.hpp"
+
+#include <algorithm>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr int kSp = 2;
+constexpr int kS0 = 8;
+// the code generator's frame: sp sits at least this far below s0 inside a
+// function body, and no s0-relative slot reaches below it
+constexpr int64_t kFrameSize = 128;
+
+enum class UnitEnum : uint8_t { kAlu, kLoad, kStore, kMul, kDiv };
+
+const std::set<std::string> kRegisterOps = {"add", "sub", "and", "or", "xor",
+                                            "sll", "srl", "sra", "slt", "sltu"};
+const std::set<std::string> kMulOps = {"mul", "mulh", "mulhsu", "mulhu"};
+const std::set<std::string> kDivOps = {"div", "divu", "rem", "remu"};
+const std::set<std::string> kImmediateOps = {"addi", "andi", "ori", "xori", "slti",
+                                             "sltiu", "slli", "srli", "srai"};
+const std::set<std::string> kUnaryOps = {"mv", "neg", "not", "seqz", "snez",
+                                         "sltz", "sgtz"};
+const std::set<std::string> kBranchOps = {"beq", "bne", "blt", "bge", "bltu", "bgeu",
+                                          "bgt", "ble", "bgtu", "bleu", "beqz",
+                                          "bnez", "blez", "bgez", "bltz", "bgtz"};
+const std::set<std::string> kJumpOps = {"j", "jal", "jalr", "jr", "ret", "call",
+                                        "tail", "ecall", "ebreak"};
+
+// where a load or store goes, as far as it can be told inside a block
+struct Address {
+    enum class BaseEnum : uint8_t {
+        kUnknown,
+        kStack,    // sp at the entry of the block + offset
+        kRegister, // one value of a register + offset; s0 at entry is the frame
+        kSymbol    // %lo(symbol+offset) off a lui %hi
+    };
+
+    BaseEnum base = BaseEnum::kUnknown;
+    int reg = -1;
+    // the node defining reg, -1 for its value at the entry of the block
+    int version = -1;
+    std::string symbol;
+    int64_t offset = 0;
+    int64_t size = 4;
+};
+
+bool overlaps(const Address &p_a, const Address &p_b) {
+    return p_a.offset < p_b.offset + p_b.size && p_b.offset < p_a.offset + p_a.size;
+}
+
+bool isFrameSlot(const Address &p_address) {
+    return p_address.base == Address::BaseEnum::kRegister && p_address.reg == kS0 &&
+           p_address.version == -1;
+}
+
+bool mayAlias(const Address &p_a, const Address &p_b) {
+    using BaseEnum = Address::BaseEnum;
+    if (p_a.base == BaseEnum::kUnknown || p_b.base == BaseEnum::kUnknown) {
+        return true;
+    }
+    if ((p_a.base == BaseEnum::kSymbol) != (p_b.base == BaseEnum::kSymbol)) {
+        // globals are never on the stack
+        return false;
+    }
+    if (p_a.base == BaseEnum::kSymbol) {
+        return p_a.symbol == p_b.symbol && overlaps(p_a, p_b);
+    }
+    if (p_a.base == BaseEnum::kStack && p_b.base == BaseEnum::kStack) {
+        return overlaps(p_a, p_b);
+    }
+    if (p_a.base == BaseEnum::kRegister && p_b.base == BaseEnum::kRegister) {
+        return p_a.reg != p_b.reg || p_a.version != p_b.version || overlaps(p_a, p_b);
+    }
+    // the evaluation stack grows below the frame, so a stack access stays
+    // under the s0-relative slots unless it reaches up into the frame
+    const Address &stack = (p_a.base == BaseEnum::kStack) ? p_a : p_b;
+    const Address &other = (p_a.base == BaseEnum::kStack) ? p_b : p_a;
+    return !isFrameSlot(other) || stack.offset + stack.size > other.offset + kFrameSize;
+}
+
+bool parseSymbolOffset(const std::string &p_offset, std::string &p_symbol,
+                       int64_t &p_value) {
+    if (p_offset.compare(0, 4, "%lo(") != 0 || p_offset.back() != ')') {
+        return false;
+    }
+    const std::string inner = p_offset.substr(4, p_offset.size() - 5);
+    const auto plus = inner.find('+');
+    p_symbol = inner.substr(0, plus);
+    p_value = 0;
+    return plus == std::string::npos || parseImmediate(inner.substr(plus + 1), p_value);
+}
+
+} // namespace
+
+struct InstructionScheduler::Node {
+    std::size_t line = 0;
+    // comment and blank lines that travel with the instruction
+    std::vector<std::size_t> trivia;
+    UnitEnum unit = UnitEnum::kAlu;
+    int def = -1;
+    std::vector<int> uses;
+    bool terminator = false;
+    // "addi sp, sp, imm"
+    bool sp_adjust = false;
+    int64_t sp_imm = 0;
+    // an sp-relative access whose offset is rewritten when it moves
+    bool sp_access = false;
+    Address address;
+
+    std::vector<std::pair<int, uint32_t>> successors;
+    int predecessors = 0;
+    uint64_t height = 0;
+    uint64_t earliest = 0;
+};
+
+void InstructionScheduler::run(AssemblyBuffer &p_asm) {
+    auto &lines = p_asm.getLines();
+    std::vector<bool> in_text{true};
+    std::size_t begin = 0;
+    for (std::size_t i = 0; i < lines.size(); ++i) {
+        const AsmLine &line = lines[i];
+        followSection(line, in_text);
+        if (line.kind == AsmLine::KindEnum::kEmpty) {
+            continue;
+        }
+        // a .loc moves with the instruction after it, like a comment
+        if (line.isDirective() && line.op == ".loc") {
+            continue;
+        }
+        if (!line.isInstruction() || !in_text.back()) {
+            scheduleBlock(lines, begin, i);
+            begin = i + 1;
+        } else if (kBranchOps.count(line.op) || kJumpOps.count(line.op)) {
+            scheduleBlock(lines, begin, i + 1);
+            begin = i + 1;
+        }
+    }
+    scheduleBlock(lines, begin, lines.size());
+}
+
+void InstructionScheduler::scheduleBlock(AssemblyBuffer::Lines &p_lines,
+                                         const std::size_t p_begin,
+                                         const std::size_t p_end) {
+    std::vector<Node> nodes;
+    std::vector<std::size_t> trivia;
+    bool fold_sp = true;
+
+    // decode, splitting the block further at anything not understood
+    for (std::size_t i = p_begin; i < p_end; ++i) {
+        const AsmLine &line = p_lines[i];
+        if (!line.isInstruction()) {
+            trivia.push_back(i);
+            continue;
+        }
+        const auto &op = line.op;
+        const auto &ops = line.operands;
+        Node node;
+        node.line = i;
+        node.trivia = trivia;
+
+        auto reg = [&](const std::size_t p_index) {
+            return p_index < ops.size() ? getRegisterNumber(ops[p_index]) : -1;
+        };
+        auto allRegisters = [&](const std::size_t p_from, const std::size_t p_count) {
+            if (ops.size() != p_from + p_count) {
+                return false;
+            }
+            for (std::size_t k = p_from; k < ops.size(); ++k) {
+                if (reg(k) < 0) {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        bool known = true;
+        int64_t imm = 0;
+        if ((kRegisterOps.count(op) || kMulOps.count(op) || kDivOps.count(op)) &&
+            allRegisters(0, 3)) {
+            node.unit = kMulOps.count(op) ? UnitEnum::kMul
+                        : kDivOps.count(op) ? UnitEnum::kDiv
+                                            : UnitEnum::kAlu;
+            node.def = reg(0);
+            node.uses = {reg(1), reg(2)};
+        } else if (kImmediateOps.count(op) && ops.size() == 3 && reg(0) >= 0 &&
+                   reg(1) >= 0) {
+            node.def = reg(0);
+            node.uses = {reg(1)};
+            node.sp_adjust = op == "addi" && reg(0) == kSp && reg(1) == kSp &&
+                             parseImmediate(ops[2], node.sp_imm);
+        } else if (kUnaryOps.count(op) && allRegisters(0, 2)) {
+            node.def = reg(0);
+            node.uses = {reg(1)};
+        } else if ((op == "li" || op == "lui") && ops.size() == 2 && reg(0) >= 0) {
+            node.def = reg(0);
+        } else if ((op == "lw" || op == "lh" || op == "lhu" || op == "lb" || op == "lbu" ||
+                    op == "sw" || op == "sh" || op == "sb") &&
+                   ops.size() == 2 && reg(0) >= 0) {
+            std::string offset, base;
+            if (!parseMemoryOperand(ops[1], offset, base) || getRegisterNumber(base) < 0) {
+                known = false;
+            } else {
+                const bool is_load = op[0] == 'l';
+                node.unit = is_load ? UnitEnum::kLoad : UnitEnum::kStore;
+                if (is_load) {
+                    node.def = reg(0);
+                } else {
+                    node.uses.push_back(reg(0));
+                }
+                node.uses.push_back(getRegisterNumber(base));
+                node.address.size = (op[1] == 'w') ? 4 : (op[1] == 'h') ? 2 : 1;
+                node.address.reg = getRegisterNumber(base);
+                if (parseImmediate(offset, imm)) {
+                    node.address.offset = imm;
+                    node.address.base = Address::BaseEnum::kRegister;
+                } else if (parseSymbolOffset(offset, node.address.symbol, imm)) {
+                    node.address.offset = imm;
+                    node.address.base = Address::BaseEnum::kSymbol;
+                }
+            }
+        } else if (kBranchOps.count(op) || kJumpOps.count(op)) {
+            node.terminator = true;
+            if (kBranchOps.count(op)) {
+                for (std::size_t k = 0; k + 1 < ops.size(); ++k) {
+                    if (reg(k) >= 0) {
+                        node.uses.push_back(reg(k));
+                    }
+                }
+            }
+        } else {
+            known = false;
+        }
+
+        if (!known) {
+            // leave it where it is and schedule both sides on their own
+            scheduleBlock(p_lines, p_begin, node.trivia.empty() ? i : node.trivia.front());
+            scheduleBlock(p_lines, i + 1, p_end);
+            return;
+        }
+        // x0 is neither a result nor a dependence
+        if (node.def == 0) {
+            node.def = -1;
+        }
+        node.uses.erase(std::remove(node.uses.begin(), node.uses.end(), 0), node.uses.end());
+        if (node.def == kSp && !node.sp_adjust) {
+            fold_sp = false;
+        }
+        trivia.clear();
+        nodes.push_back(std::move(node));
+    }
+    if (nodes.size() < 2) {
+        return;
+    }
+
+    auto latencyOf = [&](const Node &p_node) -> uint32_t {
+        switch (p_node.unit) {
+        case UnitEnum::kLoad:
+            return m_core.load_latency;
+        case UnitEnum::kMul:
+            return m_core.muldiv_blocking ? 1 : m_core.mul_latency;
+        case UnitEnum::kDiv:
+            return m_core.muldiv_blocking ? 1 : m_core.div_latency;
+        default:
+            return m_core.alu_latency;
+        }
+    };
+    auto occupancyOf = [&](const Node &p_node) -> uint32_t {
+        if (!m_core.muldiv_blocking) {
+            return 1;
+        }
+        return p_node.unit == UnitEnum::kMul   ? m_core.mul_latency
+               : p_node.unit == UnitEnum::kDiv ? m_core.div_latency
+                                               : 1;
+    };
+    auto addEdge = [&](const int p_from, const int p_to, const uint32_t p_latency) {
+        if (p_from >= 0 && p_from != p_to) {
+            nodes[p_from].successors.emplace_back(p_to, p_latency);
+            ++nodes[p_to].predecessors;
+        }
+    };
+
+    // dependences in program order
+    int last_def[32];
+    std::fill(std::begin(last_def), std::end(last_def), -1);
+    std::vector<int> readers[32];
+    std::vector<int> loads, stores;
+    // the sp adjustments and sp relative to the block entry before each
+    std::vector<std::pair<int, int64_t>> adjusts;
+    int64_t sp_delta = 0;
+    for (int n = 0; n < static_cast<int>(nodes.size()); ++n) {
+        Node &node = nodes[n];
+        const bool is_memory = node.unit == UnitEnum::kLoad || node.unit == UnitEnum::kStore;
+        if (is_memory && node.address.base == Address::BaseEnum::kRegister) {
+            const int base = node.address.reg;
+            if (base == kSp && fold_sp) {
+                node.sp_access = true;
+                node.address.base = Address::BaseEnum::kStack;
+                node.address.offset += sp_delta;
+                // nothing is stored below sp, where an interrupt handler
+                // would overwrite it: stay after the slot is allocated
+                for (auto it = adjusts.rbegin(); it != adjusts.rend(); ++it) {
+                    if (it->second > node.address.offset) {
+                        addEdge(it->first, n, m_core.alu_latency);
+                        break;
+                    }
+                }
+            } else {
+                node.address.version = last_def[base];
+            }
+        } else if (is_memory && node.address.base == Address::BaseEnum::kSymbol) {
+            // %lo(symbol) is only an address off the matching %hi(symbol)
+            const int base = node.address.reg;
+            const bool from_hi = last_def[base] >= 0 &&
+                                 p_lines[nodes[last_def[base]].line].op == "lui" &&
+                                 p_lines[nodes[last_def[base]].line].operands[1].compare(0, 4, "%hi(") == 0;
+            if (!from_hi) {
+                node.address.base = Address::BaseEnum::kUnknown;
+            }
+        }
+
+        for (const int use : node.uses) {
+            if (use == kSp && node.sp_access) {
+                continue;
+            }
+            addEdge(last_def[use], n, last_def[use] >= 0 ? latencyOf(nodes[last_def[use]]) : 0);
+            readers[use].push_back(n);
+        }
+        if (node.def >= 0) {
+            addEdge(last_def[node.def], n, 0);
+            for (const int reader : readers[node.def]) {
+                addEdge(reader, n, 0);
+            }
+            readers[node.def].clear();
+            last_def[node.def] = n;
+        }
+        if (node.sp_adjust && fold_sp) {
+            adjusts.emplace_back(n, sp_delta);
+            sp_delta += node.sp_imm;
+        }
+
+        if (node.unit == UnitEnum::kLoad) {
+            for (const int store : stores) {
+                if (mayAlias(nodes[store].address, node.address)) {
+                    addEdge(store, n, m_core.alu_latency);
+                }
+            }
+            loads.push_back(n);
+        } else if (node.unit == UnitEnum::kStore) {
+            for (const int other : loads) {
+                if (mayAlias(nodes[other].address, node.address)) {
+                    addEdge(other, n, 0);
+                }
+            }
+            for (const int other : stores) {
+                if (mayAlias(nodes[other].address, node.address)) {
+                    addEdge(other, n, 0);
+                }
+            }
+            stores.push_back(n);
+        }
+        if (node.terminator) {
+            for (int other = 0; other < n; ++other) {
+                addEdge(other, n, 0);
+            }
+        }
+    }
+
+    // ... and before it is released
+    for (int n = 0; n < static_cast<int>(nodes.size()); ++n) {
+        if (!nodes[n].sp_access) {
+            continue;
+        }
+        for (const auto &adjust : adjusts) {
+            if (adjust.first > n &&
+                adjust.second + nodes[adjust.first].sp_imm > nodes[n].address.offset) {
+                addEdge(n, adjust.first, 0);
+                break;
+            }
+        }
+    }
+
+    // longest latency-weighted path to the end of the block
+    for (int n = static_cast<int>(nodes.size()) - 1; n >= 0; --n) {
+        Node &node = nodes[n];
+        node.height = latencyOf(node);
+        for (const auto &successor : node.successors) {
+            node.height = std::max<uint64_t>(node.height,
+                                             successor.second + nodes[successor.first].height);
+        }
+    }
+
+    // cycle-driven list scheduling for a single-issue core
+    std::vector<int> ready;
+    for (int n = 0; n < static_cast<int>(nodes.size()); ++n) {
+        if (nodes[n].predecessors == 0) {
+            ready.push_back(n);
+        }
+    }
+    std::vector<int> order;
+    uint64_t cycle = 0;
+    while (!ready.empty()) {
+        auto best = ready.begin();
+        for (auto it = ready.begin(); it != ready.end(); ++it) {
+            const Node &candidate = nodes[*it];
+            const Node &current = nodes[*best];
+            const uint64_t candidate_issue = std::max(cycle, candidate.earliest);
+            const uint64_t current_issue = std::max(cycle, current.earliest);
+            if (candidate_issue != current_issue) {
+                if (candidate_issue < current_issue) {
+                    best = it;
+                }
+            } else if (candidate.height != current.height) {
+                if (candidate.height > current.height) {
+                    best = it;
+                }
+            } else if (*it < *best) {
+                best = it;
+            }
+        }
+        const int n = *best;
+        ready.erase(best);
+        order.push_back(n);
+
+        const uint64_t issue = std::max(cycle, nodes[n].earliest);
+        cycle = issue + occupancyOf(nodes[n]);
+        for (const auto &successor : nodes[n].successors) {
+            Node &next = nodes[successor.first];
+            next.earliest = std::max(next.earliest, issue + successor.second);
+            if (--next.predecessors == 0) {
+                ready.push_back(successor.first);
+            }
+        }
+    }
+
+    // lay the block out again; trailing comments stay at the end
+    AssemblyBuffer::Lines scheduled;
+    sp_delta = 0;
+    for (const int n : order) {
+        const Node &node = nodes[n];
+        for (const std::size_t line : node.trivia) {
+            scheduled.push_back(p_lines[line]);
+        }
+        AsmLine line = p_lines[node.line];
+        if (node.sp_access) {
+            const int64_t offset = node.address.offset - sp_delta;
+            std::string old_offset, base;
+            parseMemoryOperand(line.operands[1], old_offset, base);
+            if (old_offset != std::to_string(offset)) {
+                auto operands = line.operands;
+                operands[1] = std::to_string(offset) + "(" + base + ")";
+                line.setInstruction(line.op, operands);
+            }
+        }
+        if (node.sp_adjust && fold_sp) {
+            sp_delta += node.sp_imm;
+        }
+        scheduled.push_back(std::move(line));
+    }
+    const std::size_t last = nodes.back().line + 1;
+    for (std::size_t i = last; i < p_end; ++i) {
+        scheduled.push_back(p_lines[i]);
+    }
+    std::copy(scheduled.begin(), scheduled.end(), p_lines.begin() + nodes.front().line -
+                                                      nodes.front().trivia.size());
+}
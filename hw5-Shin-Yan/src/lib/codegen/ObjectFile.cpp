@@ -0,0 +1,296 @@
+#include "codegen/ObjectFile.hpp"
+
+namespace {
+
+constexpr uint16_t kElfTypeRelocatable = 1;
+constexpr uint16_t kElfMachineRiscv = 243;
+constexpr uint32_t kElfFlagRvc = 0x1;
+constexpr uint32_t kElfFlagFloatAbiDouble = 0x4;
+
+constexpr uint32_t kSectionProgbits = 1;
+constexpr uint32_t kSectionSymtab = 2;
+constexpr uint32_t kSectionStrtab = 3;
+constexpr uint32_t kSectionRela = 4;
+constexpr uint32_t kSectionNobits = 8;
+
+constexpr uint32_t kSectionWrite = 0x1;
+constexpr uint32_t kSectionAlloc = 0x2;
+constexpr uint32_t kSectionExec = 0x4;
+constexpr uint32_t kSectionInfoLink = 0x40;
+
+constexpr uint16_t kSectionIndexAbs = 0xfff1;
+
+constexpr uint32_t kElfHeaderSize = 52;
+constexpr uint32_t kSectionHeaderSize = 40;
+constexpr uint32_t kSymbolSize = 16;
+constexpr uint32_t kRelaSize = 12;
+
+class ByteWriter {
+  private:
+    std::vector<uint8_t> m_bytes;
+
+  public:
+    void put8(const uint8_t p_value) { m_bytes.push_back(p_value); }
+    void put16(const uint16_t p_value) {
+        put8(static_cast<uint8_t>(p_value));
+        put8(static_cast<uint8_t>(p_value >> 8));
+    }
+    void put32(const uint32_t p_value) {
+        put16(static_cast<uint16_t>(p_value));
+        put16(static_cast<uint16_t>(p_value >> 16));
+    }
+    void putBytes(const std::vector<uint8_t> &p_bytes) {
+        m_bytes.insert(m_bytes.end(), p_bytes.begin(), p_bytes.end());
+    }
+    void alignTo(const uint32_t p_align) {
+        while (m_bytes.size() % p_align != 0) {
+            put8(0);
+        }
+    }
+    uint32_t size() const { return static_cast<uint32_t>(m_bytes.size()); }
+    const std::vector<uint8_t> &bytes() const { return m_bytes; }
+};
+
+class StringTable {
+  private:
+    std::vector<uint8_t> m_bytes{0};
+
+  public:
+    uint32_t add(const std::string &p_str) {
+        if (p_str.empty()) {
+            return 0;
+        }
+        const auto offset = static_cast<uint32_t>(m_bytes.size());
+        m_bytes.insert(m_bytes.end(), p_str.begin(), p_str.end());
+        m_bytes.push_back(0);
+        return offset;
+    }
+    const std::vector<uint8_t> &bytes() const { return m_bytes; }
+};
+
+struct SectionHeader {
+    uint32_t name = 0;
+    uint32_t type = 0;
+    uint32_t flags = 0;
+    uint32_t offset = 0;
+    uint32_t size = 0;
+    uint32_t link = 0;
+    uint32_t info = 0;
+    uint32_t align = 0;
+    uint32_t entry_size = 0;
+};
+
+} // namespace
+
+int ObjectFile::findSection(const std::string &p_name) const {
+    for (std::size_t i = 0; i < sections.size(); ++i) {
+        if (sections[i].name == p_name) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+int ObjectFile::findSymbol(const std::string &p_name) const {
+    for (std::size_t i = 1; i < symbols.size(); ++i) {
+        if (symbols[i].name == p_name &&
+            symbols[i].type != Symbol::TypeEnum::kFile) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+void ObjectFile::writeElf(FILE *p_out_file) const {
+    // ELF wants the local symbols first
+    std::vector<uint32_t> order;
+    for (uint32_t i = 1; i < symbols.size(); ++i) {
+        if (!symbols[i].global) {
+            order.push_back(i);
+        }
+    }
+    const auto first_global = static_cast<uint32_t>(order.size() + 1);
+    for (uint32_t i = 1; i < symbols.size(); ++i) {
+        if (symbols[i].global) {
+            order.push_back(i);
+        }
+    }
+    std::vector<uint32_t> symbol_index(symbols.size(), 0);
+    for (uint32_t i = 0; i < order.size(); ++i) {
+        symbol_index[order[i]] = i + 1;
+    }
+
+    // section header indices: null, contents, relocations, symtab, strtab,
+    // shstrtab
+    const auto content_count = static_cast<uint32_t>(sections.size());
+    uint32_t rela_count = 0;
+    for (const auto &section : sections) {
+        rela_count += section.relocations.empty() ? 0 : 1;
+    }
+    const uint32_t symtab_index = 1 + content_count + rela_count;
+    const uint32_t strtab_index = symtab_index + 1;
+    const uint32_t shstrtab_index = strtab_index + 1;
+
+    ByteWriter file;
+    StringTable section_names;
+    StringTable names;
+    std::vector<SectionHeader> headers(1);
+
+    // reserve the ELF header, it is filled in once the layout is known
+    for (uint32_t i = 0; i < kElfHeaderSize; ++i) {
+        file.put8(0);
+    }
+
+    for (const auto &section : sections) {
+        SectionHeader header;
+        header.name = section_names.add(section.name);
+        header.align = section.align;
+        header.size = section.size;
+        switch (section.kind) {
+        case SectionKind::kText:
+            header.type = kSectionProgbits;
+            header.flags = kSectionAlloc | kSectionExec;
+            break;
+        case SectionKind::kData:
+            header.type = kSectionProgbits;
+            header.flags = kSectionAlloc | kSectionWrite;
+            break;
+        case SectionKind::kReadOnly:
+            header.type = kSectionProgbits;
+            header.flags = kSectionAlloc;
+            break;
+        case SectionKind::kBss:
+            header.type = kSectionNobits;
+            header.flags = kSectionAlloc | kSectionWrite;
+            break;
+        }
+        file.alignTo(section.align);
+        header.offset = file.size();
+        if (section.kind != SectionKind::kBss) {
+            file.putBytes(section.data);
+        }
+        headers.push_back(header);
+    }
+
+    for (uint32_t i = 0; i < content_count; ++i) {
+        const auto &section = sections[i];
+        if (section.relocations.empty()) {
+            continue;
+        }
+        SectionHeader header;
+        header.name = section_names.add(".rela" + section.name);
+        header.type = kSectionRela;
+        header.flags = kSectionInfoLink;
+        header.link = symtab_index;
+        header.info = i + 1;
+        header.align = 4;
+        header.entry_size = kRelaSize;
+        file.alignTo(4);
+        header.offset = file.size();
+        for (const auto &relocation : section.relocations) {
+            file.put32(relocation.offset);
+            file.put32(symbol_index[relocation.symbol] << 8 | relocation.type);
+            file.put32(static_cast<uint32_t>(relocation.addend));
+        }
+        header.size = file.size() - header.offset;
+        headers.push_back(header);
+    }
+
+    SectionHeader symtab;
+    symtab.name = section_names.add(".symtab");
+    symtab.type = kSectionSymtab;
+    symtab.link = strtab_index;
+    symtab.info = first_global;
+    symtab.align = 4;
+    symtab.entry_size = kSymbolSize;
+    file.alignTo(4);
+    symtab.offset = file.size();
+    for (uint32_t i = 0; i < kSymbolSize; ++i) {
+        file.put8(0);
+    }
+    for (const uint32_t index : order) {
+        const auto &symbol = symbols[index];
+        uint8_t type = 0;
+        switch (symbol.type) {
+        case Symbol::TypeEnum::kObject: type = 1; break;
+        case Symbol::TypeEnum::kFunction: type = 2; break;
+        case Symbol::TypeEnum::kFile: type = 4; break;
+        case Symbol::TypeEnum::kNoType: break;
+        }
+        uint16_t section_index = 0;
+        if (symbol.type == Symbol::TypeEnum::kFile) {
+            section_index = kSectionIndexAbs;
+        } else if (symbol.section >= 0) {
+            section_index = static_cast<uint16_t>(symbol.section + 1);
+        }
+        file.put32(names.add(symbol.name));
+        file.put32(symbol.value);
+        file.put32(symbol.size);
+        file.put8(static_cast<uint8_t>((symbol.global ? 1 : 0) << 4 | type));
+        file.put8(0);
+        file.put16(section_index);
+    }
+    symtab.size = file.size() - symtab.offset;
+    headers.push_back(symtab);
+
+    SectionHeader strtab;
+    strtab.name = section_names.add(".strtab");
+    strtab.type = kSectionStrtab;
+    strtab.align = 1;
+    strtab.offset = file.size();
+    file.putBytes(names.bytes());
+    strtab.size = file.size() - strtab.offset;
+    headers.push_back(strtab);
+
+    SectionHeader shstrtab;
+    shstrtab.name = section_names.add(".shstrtab");
+    shstrtab.type = kSectionStrtab;
+    shstrtab.align = 1;
+    shstrtab.offset = file.size();
+    file.putBytes(section_names.bytes());
+    shstrtab.size = file.size() - shstrtab.offset;
+    headers.push_back(shstrtab);
+
+    file.alignTo(4);
+    const uint32_t header_table_offset = file.size();
+    for (const auto &header : headers) {
+        file.put32(header.name);
+        file.put32(header.type);
+        file.put32(header.flags);
+        file.put32(0); // sh_addr
+        file.put32(header.offset);
+        file.put32(header.size);
+        file.put32(header.link);
+        file.put32(header.info);
+        file.put32(header.align);
+        file.put32(header.entry_size);
+    }
+
+    ByteWriter elf_header;
+    const uint8_t ident[] = {0x7f, 'E', 'L', 'F', 1 /* ELFCLASS32 */,
+                             1 /* little endian */, 1 /* EV_CURRENT */};
+    for (const uint8_t byte : ident) {
+        elf_header.put8(byte);
+    }
+    while (elf_header.size() < 16) {
+        elf_header.put8(0);
+    }
+    elf_header.put16(kElfTypeRelocatable);
+    elf_header.put16(kElfMachineRiscv);
+    elf_header.put32(1); // e_version
+    elf_header.put32(0); // e_entry
+    elf_header.put32(0); // e_phoff
+    elf_header.put32(header_table_offset);
+    elf_header.put32((rvc ? kElfFlagRvc : 0) |
+                     (double_float_abi ? kElfFlagFloatAbiDouble : 0));
+    elf_header.put16(kElfHeaderSize);
+    elf_header.put16(0); // e_phentsize
+    elf_header.put16(0); // e_phnum
+    elf_header.put16(kSectionHeaderSize);
+    elf_header.put16(static_cast<uint16_t>(headers.size()));
+    elf_header.put16(static_cast<uint16_t>(shstrtab_index));
+
+    std::fwrite(elf_header.bytes().data(), 1, elf_header.size(), p_out_file);
+    std::fwrite(file.bytes().data() + kElfHeaderSize, 1,
+                file.size() - kElfHeaderSize, p_out_file);
+}
@@ -0,0 +1,14 @@
+#include "codegen/OutputPath.hpp"
+
+std::string getOutputFilePath(const std::string &p_source_file,
+                              const std::string &p_save_path,
+                              const std::string &p_extension) {
+    const auto slash_pos = p_source_file.rfind('/');
+    std::string stem = p_source_file.substr(slash_pos == std::string::npos ? 0 : slash_pos + 1);
+    // a leading dot names a hidden file rather than starting an extension
+    const auto dot_pos = stem.rfind('.');
+    if (dot_pos != std::string::npos && dot_pos != 0) {
+        stem.erase(dot_pos);
+    }
+    return (p_save_path.empty() ? std::string{"."} : p_save_path) + "/" + stem + p_extension;
+}
@@ -0,0 +1,213 @@
+#include "codegen/PassManager.hpp"
+#include "codegen/CodeGenOptions.hpp"
+#include "codegen/InstructionScheduler.hpp"
+#include "driver/TimeTrace.hpp"
+
+#include <cassert>
+#include <cstring>
+
+namespace {
+
+constexpr uint8_t level(const OptLevel p_level) {
+    return static_cast<uint8_t>(1u << static_cast<unsigned>(p_level));
+}
+
+constexpr uint8_t kOnDemand = 0;
+constexpr uint8_t kAllLevels = level(OptLevel::kO0) | level(OptLevel::kO1) |
+                               level(OptLevel::kO2) | level(OptLevel::kOs);
+constexpr uint8_t kOptimizing = level(OptLevel::kO1) | level(OptLevel::kO2) |
+                                level(OptLevel::kOs);
+// -Os leaves out what copies code
+constexpr uint8_t kSpeed = level(OptLevel::kO2);
+
+const PassInfo kPasses[] = {
+    {PassId::kRanges, "ranges", true, kOnDemand, {}, {},
+     "integer ranges of expressions"},
+    {PassId::kPurity, "purity", true, kOnDemand, {}, {},
+     "functions without side effects"},
+    {PassId::kProfile, "profile", true, kOnDemand, {}, {},
+     "counts of a --profile-use file"},
+    {PassId::kCodeSize, "code-size", true, kAllLevels, {}, {},
+     "rv32im and rv32imac size of each function"},
+
+    {PassId::kFold, "fold", false, kOptimizing, {PassId::kRanges}, {},
+     "constant expressions and conditions"},
+    {PassId::kConstantImmediates, "const-imm", false, kOptimizing, {}, {},
+     "named constants as immediates"},
+    {PassId::kCheckElimination, "check-elim", false, kOptimizing, {PassId::kRanges}, {},
+     "bounds checks of indices in range"},
+    {PassId::kLayout, "layout", false, kOptimizing, {PassId::kProfile}, {},
+     "likely if arms and cold functions"},
+    {PassId::kScalarReplacement, "scalar-replace", false, kSpeed, {PassId::kRanges}, {},
+     "elements at known indices, short loops unrolled"},
+    {PassId::kSpecialize, "specialize", false, kSpeed, {PassId::kRanges}, {},
+     "clones for constant arguments"},
+    {PassId::kInline, "inline", false, kSpeed, {PassId::kProfile}, {},
+     "hot leaf functions"},
+    {PassId::kUnroll, "unroll", false, kSpeed, {PassId::kProfile}, {},
+     "hot for loops"},
+    {PassId::kMemoize, "memoize", false, kOnDemand, {PassId::kPurity}, {},
+     "result tables of pure functions"},
+    {PassId::kPadArrays, "pad-arrays", false, kOnDemand, {}, {},
+     "power-of-two inner dimensions"},
+
+    {PassId::kSchedule, "schedule", false, level(OptLevel::kO2) | level(OptLevel::kOs),
+     {}, {PassId::kCodeSize}, "basic blocks for the -mtune core"},
+    {PassId::kCompress, "compress", false, kAllLevels, {}, {PassId::kCodeSize},
+     "RV32C forms for -march=rv32imac"},
+};
+
+const char *getLevelName(const OptLevel p_level) {
+    switch (p_level) {
+    case OptLevel::kO0:
+        return "-O0";
+    case OptLevel::kO1:
+        return "-O1";
+    case OptLevel::kO2:
+        return "-O2";
+    case OptLevel::kOs:
+        return "-Os";
+    }
+    return "";
+}
+
+} // namespace
+
+const PassInfo &PassManager::getInfo(const PassId p_pass) {
+    const PassInfo &info = kPasses[static_cast<std::size_t>(p_pass)];
+    assert(info.id == p_pass && "kPasses is not in PassId order");
+    return info;
+}
+
+bool PassManager::parseLevel(const char *p_text, OptLevel &p_level) {
+    if (std::strcmp(p_text, "0") == 0) {
+        p_level = OptLevel::kO0;
+    } else if (std::strcmp(p_text, "1") == 0) {
+        p_level = OptLevel::kO1;
+    } else if (std::strcmp(p_text, "2") == 0) {
+        p_level = OptLevel::kO2;
+    } else if (std::strcmp(p_text, "s") == 0) {
+        p_level = OptLevel::kOs;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void PassManager::setLevel(const OptLevel p_level) {
+    m_level = p_level;
+    resolve();
+}
+
+bool PassManager::findPass(const std::string &p_name, PassId &p_pass) {
+    for (const auto &info : kPasses) {
+        if (p_name == info.name) {
+            p_pass = info.id;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PassManager::setEnabled(const std::string &p_name, const bool p_enabled) {
+    PassId pass;
+    if (!findPass(p_name, pass)) {
+        return false;
+    }
+    const auto index = static_cast<std::size_t>(pass);
+    m_forced_on[index] = p_enabled;
+    m_forced_off[index] = !p_enabled;
+    resolve();
+    return true;
+}
+
+void PassManager::resolve() {
+    m_enabled.reset();
+    for (const auto &info : kPasses) {
+        const auto index = static_cast<std::size_t>(info.id);
+        bool enabled = (info.levels & level(m_level)) != 0;
+        if (m_forced_on[index]) {
+            enabled = true;
+        }
+        if (m_forced_off[index]) {
+            enabled = false;
+        }
+        for (const PassId analysis : info.required) {
+            if (m_forced_off[static_cast<std::size_t>(analysis)]) {
+                enabled = false;
+            }
+        }
+        if (!enabled) {
+            continue;
+        }
+        m_enabled.set(index);
+        for (const PassId analysis : info.required) {
+            m_enabled.set(static_cast<std::size_t>(analysis));
+        }
+    }
+}
+
+void PassManager::markValid(const PassId p_analysis) {
+    assert(getInfo(p_analysis).is_analysis);
+    m_valid.set(static_cast<std::size_t>(p_analysis));
+}
+
+void PassManager::invalidate(const PassId p_transform) {
+    for (const PassId analysis : getInfo(p_transform).invalidated) {
+        m_valid.reset(static_cast<std::size_t>(analysis));
+    }
+}
+
+const RvcCompressor &PassManager::getCodeSize(const AssemblyBuffer &p_asm) {
+    if (!isValid(PassId::kCodeSize)) {
+        TimeScope scope("code-size");
+        AssemblyBuffer compressed_asm = p_asm;
+        m_code_size = RvcCompressor();
+        m_code_size.run(compressed_asm);
+        markValid(PassId::kCodeSize);
+    }
+    return m_code_size;
+}
+
+void PassManager::runAssemblyPasses(AssemblyBuffer &p_asm, const CodeGenOptions &p_options,
+                                    const std::string &p_source) {
+    const bool compress = p_options.compressed && isEnabled(PassId::kCompress);
+    if (isEnabled(PassId::kSchedule) && p_options.schedule) {
+        // t0-t3 share registers with the arguments once compressed
+        if (compress) {
+            RvcCompressor::remapRegisters(p_asm);
+        }
+        TimeScope scope("schedule");
+        InstructionScheduler scheduler(p_options.tune);
+        scheduler.run(p_asm);
+        invalidate(PassId::kSchedule);
+    }
+    // what rv32imac saves, whether or not the output is compressed
+    if (p_options.size_report) {
+        getCodeSize(p_asm).dumpSizeReport(stdout, p_source);
+    }
+    if (compress) {
+        TimeScope scope("compress");
+        RvcCompressor compressor;
+        compressor.run(p_asm);
+        invalidate(PassId::kCompress);
+    }
+}
+
+void PassManager::dumpPasses(FILE *p_out_file) const {
+    std::fprintf(p_out_file, "passes at %s:\n", getLevelName(m_level));
+    for (const auto &info : kPasses) {
+        std::string required;
+        for (const PassId analysis : info.required) {
+            required += required.empty() ? " (needs " : ", ";
+            required += getInfo(analysis).name;
+        }
+        if (!required.empty()) {
+            required += ")";
+        }
+        std::fprintf(p_out_file, "  %-16s %-9s %-3s %s%s\n", info.name,
+                     info.is_analysis ? "analysis" : "transform",
+                     isEnabled(info.id) ? "on" : "off", info.description,
+                     required.c_str());
+    }
+}
@@ -0,0 +1,103 @@
+#include "codegen/Profile.hpp"
+#include "visitor/AstNodeInclude.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <memory>
+
+uint32_t ProfileCounterMap::getCounter(const AstNode *p_node) const {
+    auto it = m_counters.find(p_node);
+    return it == m_counters.end() ? kNone : it->second;
+}
+
+void ProfileCounterMap::allocate(const AstNode *p_node, const uint32_t p_count) {
+    m_counters[p_node] = m_count;
+    m_count += p_count;
+}
+
+void ProfileCounterMap::visit(ProgramNode &p_program) {
+    allocate(&p_program, 1);
+    for (const auto &func : p_program.getFuncNodes()) {
+        func->accept(*this);
+    }
+    const_cast<CompoundStatementNode &>(p_program.getBody()).accept(*this);
+}
+
+void ProfileCounterMap::visit(FunctionNode &p_function) {
+    allocate(&p_function, 1);
+    if (p_function.getBody() != nullptr) {
+        p_function.getBody()->accept(*this);
+    }
+}
+
+void ProfileCounterMap::visit(CompoundStatementNode &p_compound_statement) {
+    p_compound_statement.visitChildNodes(*this);
+}
+
+void ProfileCounterMap::visit(IfNode &p_if) {
+    allocate(&p_if, 2);
+    p_if.getBody().accept(*this);
+    if (p_if.getElseBody() != nullptr) {
+        p_if.getElseBody()->accept(*this);
+    }
+}
+
+void ProfileCounterMap::visit(WhileNode &p_while) {
+    allocate(&p_while, 1);
+    p_while.getBody().accept(*this);
+}
+
+void ProfileCounterMap::visit(ForNode &p_for) {
+    allocate(&p_for, 1);
+    p_for.getBody().accept(*this);
+}
+
+bool ProfileData::load(const std::string &p_path, const uint32_t p_expected_count,
+                       std::string &p_error) {
+    m_counts.clear();
+    m_max = 0;
+
+    std::unique_ptr<FILE, decltype(&fclose)> file(fopen(p_path.c_str(), "r"), &fclose);
+    if (!file) {
+        p_error = "cannot open " + p_path;
+        return false;
+    }
+
+    unsigned count = 0;
+    if (fscanf(file.get(), "p-profile %u", &count) != 1) {
+        p_error = p_path + " is not a profile";
+        return false;
+    }
+    if (count != p_expected_count) {
+        p_error = p_path + " has " + std::to_string(count) + " counters, expected " +
+                  std::to_string(p_expected_count) + "; was it made from another source?";
+        return false;
+    }
+
+    std::vector<uint64_t> counts(count);
+    for (auto &value : counts) {
+        if (fscanf(file.get(), "%" SCNu64, &value) != 1) {
+            p_error = p_path + " is truncated";
+            return false;
+        }
+    }
+    m_counts.swap(counts);
+    for (const uint64_t value : m_counts) {
+        m_max = std::max(m_max, value);
+    }
+    return true;
+}
+
+uint64_t ProfileData::getCount(const uint32_t p_counter) const {
+    return p_counter < m_counts.size() ? m_counts[p_counter] : 0;
+}
+
+bool ProfileData::isHot(const uint32_t p_counter) const {
+    const uint64_t count = getCount(p_counter);
+    return count != 0 && count * 100 >= m_max;
+}
+
+bool ProfileData::isCold(const uint32_t p_counter) const {
+    return !empty() && p_counter < m_counts.size() && m_counts[p_counter] == 0;
+}
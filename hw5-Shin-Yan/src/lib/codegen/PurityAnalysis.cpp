@@ -0,0 +1,105 @@
+#include "codegen/PurityAnalysis.hpp"
+#include "sema/SymbolTable.hpp"
+#include "visitor/AstNodeInclude.hpp"
+
+void PurityAnalysis::visit(ProgramNode &p_program) {
+    m_symbol_manager_ptr->reconstructHashTableFromSymbolTable(p_program.getSymbolTable());
+    for (const auto &func : p_program.getFuncNodes()) {
+        func->accept(*this);
+    }
+    m_symbol_manager_ptr->removeSymbolsFromHashTable(p_program.getSymbolTable());
+
+    for (const auto &function : m_functions) {
+        if (!function.second.has_side_effects) {
+            m_pure_functions.insert(function.first);
+        }
+    }
+    // drop the callers of impure functions until nothing changes
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto it = m_pure_functions.begin(); it != m_pure_functions.end();) {
+            bool pure = true;
+            for (const auto &callee : m_functions[*it].callees) {
+                pure = pure && m_pure_functions.count(callee) != 0;
+            }
+            if (pure) {
+                ++it;
+            } else {
+                it = m_pure_functions.erase(it);
+                changed = true;
+            }
+        }
+    }
+}
+
+void PurityAnalysis::visit(FunctionNode &p_function) {
+    m_current = &m_functions[p_function.getName()];
+    // a declaration without a body is defined elsewhere
+    m_current->has_side_effects = p_function.getBody() == nullptr;
+    m_symbol_manager_ptr->reconstructHashTableFromSymbolTable(p_function.getSymbolTable());
+    if (p_function.getBody() != nullptr) {
+        p_function.getBody()->accept(*this);
+    }
+    m_symbol_manager_ptr->removeSymbolsFromHashTable(p_function.getSymbolTable());
+    m_current = nullptr;
+}
+
+void PurityAnalysis::visit(CompoundStatementNode &p_compound_statement) {
+    m_symbol_manager_ptr->reconstructHashTableFromSymbolTable(
+        p_compound_statement.getSymbolTable());
+    p_compound_statement.visitChildNodes(*this);
+    m_symbol_manager_ptr->removeSymbolsFromHashTable(p_compound_statement.getSymbolTable());
+}
+
+void PurityAnalysis::visit(PrintNode &p_print) {
+    m_current->has_side_effects = true;
+}
+
+void PurityAnalysis::visit(BinaryOperatorNode &p_bin_op) {
+    p_bin_op.visitChildNodes(*this);
+}
+
+void PurityAnalysis::visit(UnaryOperatorNode &p_un_op) {
+    p_un_op.visitChildNodes(*this);
+}
+
+void PurityAnalysis::visit(FunctionInvocationNode &p_func_invocation) {
+    m_current->callees.insert(p_func_invocation.getName());
+    p_func_invocation.visitChildNodes(*this);
+}
+
+void PurityAnalysis::visit(VariableReferenceNode &p_variable_ref) {
+    const SymbolEntry *entry = m_symbol_manager_ptr->lookup(p_variable_ref.getName());
+    if (entry == nullptr || (entry->getLevel() == 0 &&
+                             entry->getKind() == SymbolEntry::KindEnum::kVariableKind)) {
+        m_current->has_side_effects = true;
+    }
+    p_variable_ref.visitChildNodes(*this);
+}
+
+void PurityAnalysis::visit(AssignmentNode &p_assignment) {
+    p_assignment.visitChildNodes(*this);
+}
+
+void PurityAnalysis::visit(ReadNode &p_read) {
+    m_current->has_side_effects = true;
+}
+
+void PurityAnalysis::visit(IfNode &p_if) {
+    p_if.visitChildNodes(*this);
+}
+
+void PurityAnalysis::visit(WhileNode &p_while) {
+    p_while.visitChildNodes(*this);
+}
+
+void PurityAnalysis::visit(ForNode &p_for) {
+    m_symbol_manager_ptr->reconstructHashTableFromSymbolTable(p_for.getSymbolTable());
+    p_for.visitChildNodes(*this);
+    m_symbol_manager_ptr->removeSymbolsFromHashTable(p_for.getSymbolTable());
+}
+
+void PurityAnalysis::visit(ReturnNode &p_return) {
+    p_return.visitChildNodes(*this);
+}
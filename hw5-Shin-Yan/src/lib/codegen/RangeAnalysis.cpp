@@ -0,0 +1,180 @@
+#include "codegen/RangeAnalysis.hpp"
+#include "sema/SymbolTable.hpp"
+#include "visitor/AstNodeInclude.hpp"
+
+#include <algorithm>
+
+static constexpr ValueRange kBoolRange{0, 1};
+
+// values of P's 32-bit integers; a range beyond them may have wrapped
+static bool isBounded(const ValueRange &p_range) {
+    return p_range.within(INT32_MIN, INT32_MAX);
+}
+
+static bool getConstantRange(const Constant &p_constant, ValueRange &p_range) {
+    if (p_constant.getTypePtr()->isInteger()) {
+        p_range.min = p_range.max = p_constant.integer();
+        return isBounded(p_range);
+    }
+    if (p_constant.getTypePtr()->isBool()) {
+        p_range.min = p_range.max = p_constant.boolean() ? 1 : 0;
+        return true;
+    }
+    return false;
+}
+
+// the range of a relation given those of its operands
+static ValueRange compare(const Operator p_op, const ValueRange &p_left,
+                          const ValueRange &p_right) {
+    bool always = false;
+    bool never = false;
+    switch (p_op) {
+    case Operator::kLessOp:
+        always = p_left.max < p_right.min;
+        never = p_left.min >= p_right.max;
+        break;
+    case Operator::kLessOrEqualOp:
+        always = p_left.max <= p_right.min;
+        never = p_left.min > p_right.max;
+        break;
+    case Operator::kGreaterOp:
+        always = p_left.min > p_right.max;
+        never = p_left.max <= p_right.min;
+        break;
+    case Operator::kGreaterOrEqualOp:
+        always = p_left.min >= p_right.max;
+        never = p_left.max < p_right.min;
+        break;
+    case Operator::kEqualOp:
+    case Operator::kNotEqualOp:
+        always = p_left.min == p_left.max && p_right.min == p_right.max &&
+                 p_left.min == p_right.min;
+        never = p_left.max < p_right.min || p_right.max < p_left.min;
+        if (p_op == Operator::kNotEqualOp) {
+            std::swap(always, never);
+        }
+        break;
+    default:
+        break;
+    }
+    return always ? ValueRange{1, 1} : never ? ValueRange{0, 0} : kBoolRange;
+}
+
+void RangeAnalysis::enterLoop(const SymbolEntry *p_var, const int64_t p_lower,
+                              const int64_t p_upper) {
+    if (p_lower < p_upper) {
+        m_variable_ranges[p_var] = ValueRange{p_lower, p_upper - 1};
+    }
+}
+
+void RangeAnalysis::leaveLoop(const SymbolEntry *p_var) {
+    m_variable_ranges.erase(p_var);
+}
+
+void RangeAnalysis::bindParameter(const SymbolEntry *p_var, const int64_t p_value) {
+    m_variable_ranges[p_var] = ValueRange{p_value, p_value};
+}
+
+void RangeAnalysis::unbindParameter(const SymbolEntry *p_var) {
+    m_variable_ranges.erase(p_var);
+}
+
+bool RangeAnalysis::getValue(const ExpressionNode &p_expr, int64_t &p_value) const {
+    ValueRange range;
+    if (!getRange(p_expr, range) || range.min != range.max) {
+        return false;
+    }
+    p_value = range.min;
+    return true;
+}
+
+bool RangeAnalysis::getRange(const ExpressionNode &p_expr, ValueRange &p_range) const {
+    if (const auto *constant = dynamic_cast<const ConstantValueNode *>(&p_expr)) {
+        return getConstantRange(*constant->getConstantPtr(), p_range);
+    }
+
+    if (const auto *reference = dynamic_cast<const VariableReferenceNode *>(&p_expr)) {
+        if (!reference->getIndices().empty()) {
+            return false;
+        }
+        const SymbolEntry *entry = m_symbol_manager_ptr->lookup(reference->getName());
+        if (entry == nullptr) {
+            return false;
+        }
+        if (entry->getKind() == SymbolEntry::KindEnum::kConstantKind &&
+            entry->getAttribute().constant() != nullptr) {
+            return getConstantRange(*entry->getAttribute().constant(), p_range);
+        }
+        const auto variable = m_variable_ranges.find(entry);
+        if (variable == m_variable_ranges.end()) {
+            return false;
+        }
+        p_range = variable->second;
+        return true;
+    }
+
+    if (const auto *un_op = dynamic_cast<const UnaryOperatorNode *>(&p_expr)) {
+        ValueRange operand;
+        if (!getRange(un_op->getOperand(), operand)) {
+            return false;
+        }
+        if (un_op->getOp() == Operator::kNotOp) {
+            p_range.min = 1 - operand.max;
+            p_range.max = 1 - operand.min;
+            return true;
+        }
+        if (un_op->getOp() != Operator::kNegOp) {
+            return false;
+        }
+        p_range.min = -operand.max;
+        p_range.max = -operand.min;
+        return isBounded(p_range);
+    }
+
+    const auto *bin_op = dynamic_cast<const BinaryOperatorNode *>(&p_expr);
+    ValueRange left, right;
+    if (bin_op == nullptr || !getRange(bin_op->getLeftOperand(), left) ||
+        !getRange(bin_op->getRightOperand(), right)) {
+        return false;
+    }
+    switch (bin_op->getOp()) {
+    case Operator::kPlusOp:
+        p_range.min = left.min + right.min;
+        p_range.max = left.max + right.max;
+        break;
+    case Operator::kMinusOp:
+        p_range.min = left.min - right.max;
+        p_range.max = left.max - right.min;
+        break;
+    case Operator::kMultiplyOp: {
+        const int64_t products[] = {left.min * right.min, left.min * right.max,
+                                    left.max * right.min, left.max * right.max};
+        p_range.min = *std::min_element(std::begin(products), std::end(products));
+        p_range.max = *std::max_element(std::begin(products), std::end(products));
+        break;
+    }
+    case Operator::kModOp:
+        // rem keeps the sign of the dividend, so only a non-negative one is
+        // bounded by the divisor
+        if (left.min < 0 || right.min != right.max || right.min <= 0) {
+            return false;
+        }
+        p_range.min = 0;
+        p_range.max = std::min(left.max, right.min - 1);
+        break;
+    case Operator::kAndOp:
+        p_range.min = std::min(left.min, right.min);
+        p_range.max = std::min(left.max, right.max);
+        break;
+    case Operator::kOrOp:
+        p_range.min = std::max(left.min, right.min);
+        p_range.max = std::max(left.max, right.max);
+        break;
+    case Operator::kDivideOp:
+        return false;
+    default:
+        p_range = compare(bin_op->getOp(), left, right);
+        return true;
+    }
+    return isBounded(p_range);
+}
@@ -0,0 +1,161 @@
+#include "codegen/Remarks.hpp"
+
+#include <cstdio>
+#include <memory>
+
+namespace {
+
+// 'text' with the quotes doubled, a YAML single-quoted scalar
+std::string quoteYaml(const std::string &p_text) {
+    std::string quoted = "'";
+    for (const char c : p_text) {
+        quoted += c;
+        if (c == '\'') {
+            quoted += c;
+        }
+    }
+    return quoted + "'";
+}
+
+std::string quoteJson(const std::string &p_text) {
+    std::string quoted = "\"";
+    for (const char c : p_text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escape[8];
+            std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+            quoted += escape;
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+bool endsWith(const std::string &p_text, const std::string &p_suffix) {
+    return p_text.size() >= p_suffix.size() &&
+           p_text.compare(p_text.size() - p_suffix.size(), p_suffix.size(), p_suffix) == 0;
+}
+
+} // namespace
+
+bool RemarkOptions::parsePasses(const std::string &p_list, RemarkPasses &p_passes) {
+    if (p_list == "all") {
+        p_passes.set();
+        return true;
+    }
+    std::string::size_type begin = 0;
+    while (begin <= p_list.size()) {
+        auto comma = p_list.find(',', begin);
+        if (comma == std::string::npos) {
+            comma = p_list.size();
+        }
+        PassId pass;
+        if (!PassManager::findPass(p_list.substr(begin, comma - begin), pass)) {
+            return false;
+        }
+        p_passes.set(static_cast<std::size_t>(pass));
+        begin = comma + 1;
+    }
+    return true;
+}
+
+bool RemarkEmitter::isEnabled(const PassId p_pass) const {
+    const auto index = static_cast<std::size_t>(p_pass);
+    return !m_options.output_path.empty() || m_options.passed[index] ||
+           m_options.missed[index];
+}
+
+void RemarkEmitter::passed(const PassId p_pass, const char *p_name,
+                           const Location &p_location, const char *p_format, ...) {
+    va_list args;
+    va_start(args, p_format);
+    emit(KindEnum::kPassed, p_pass, p_name, p_location, p_format, args);
+    va_end(args);
+}
+
+void RemarkEmitter::missed(const PassId p_pass, const char *p_name,
+                           const Location &p_location, const char *p_format, ...) {
+    va_list args;
+    va_start(args, p_format);
+    emit(KindEnum::kMissed, p_pass, p_name, p_location, p_format, args);
+    va_end(args);
+}
+
+void RemarkEmitter::emit(const KindEnum p_kind, const PassId p_pass, const char *p_name,
+                         const Location &p_location, const char *p_format,
+                         va_list p_args) {
+    const auto index = static_cast<std::size_t>(p_pass);
+    const bool print = p_kind == KindEnum::kPassed ? m_options.passed[index]
+                                                   : m_options.missed[index];
+    if (!print && m_options.output_path.empty()) {
+        return;
+    }
+
+    va_list args_copy;
+    va_copy(args_copy, p_args);
+    const int length = std::vsnprintf(nullptr, 0, p_format, p_args);
+    std::string message(length, '\0');
+    std::vsnprintf(&message[0], length + 1, p_format, args_copy);
+    va_end(args_copy);
+
+    const char *pass_name = PassManager::getInfo(p_pass).name;
+    if (print) {
+        std::fprintf(stderr, "%s:%u:%u: remark: %s [-Rpass%s=%s]\n", m_source.c_str(),
+                     p_location.line, p_location.col, message.c_str(),
+                     p_kind == KindEnum::kPassed ? "" : "-missed", pass_name);
+    }
+    if (!m_options.output_path.empty()) {
+        m_remarks.push_back({p_kind, p_pass, p_name, p_location, m_function, message});
+    }
+}
+
+bool RemarkEmitter::write(std::string &p_error) const {
+    if (m_options.output_path.empty()) {
+        return true;
+    }
+    std::unique_ptr<FILE, decltype(&fclose)> file(
+        std::fopen(m_options.output_path.c_str(), "w"), &fclose);
+    if (!file) {
+        p_error = "cannot write " + m_options.output_path;
+        return false;
+    }
+
+    // the layout of LLVM's optimization records, one document per remark
+    if (!endsWith(m_options.output_path, ".json")) {
+        for (const auto &remark : m_remarks) {
+            std::fprintf(file.get(),
+                         "--- !%s\n"
+                         "Pass:            %s\n"
+                         "Name:            %s\n"
+                         "DebugLoc:        { File: %s, Line: %u, Column: %u }\n"
+                         "Function:        %s\n"
+                         "Message:         %s\n"
+                         "...\n",
+                         remark.kind == KindEnum::kPassed ? "Passed" : "Missed",
+                         PassManager::getInfo(remark.pass).name, remark.name.c_str(),
+                         quoteYaml(m_source).c_str(), remark.location.line,
+                         remark.location.col, quoteYaml(remark.function).c_str(),
+                         quoteYaml(remark.message).c_str());
+        }
+        return true;
+    }
+
+    std::fprintf(file.get(), "[");
+    for (std::size_t i = 0; i < m_remarks.size(); ++i) {
+        const auto &remark = m_remarks[i];
+        std::fprintf(file.get(),
+                     "%s\n  {\"kind\": \"%s\", \"pass\": \"%s\", \"name\": \"%s\", "
+                     "\"file\": %s, \"line\": %u, \"column\": %u, \"function\": %s, "
+                     "\"message\": %s}",
+                     i == 0 ? "" : ",",
+                     remark.kind == KindEnum::kPassed ? "passed" : "missed",
+                     PassManager::getInfo(remark.pass).name, remark.name.c_str(),
+                     quoteJson(m_source).c_str(), remark.location.line, remark.location.col,
+                     quoteJson(remark.function).c_str(), quoteJson(remark.message).c_str());
+    }
+    std::fprintf(file.get(), "\n]\n");
+    return true;
+}
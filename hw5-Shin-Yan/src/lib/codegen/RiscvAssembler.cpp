@@ -0,0 +1,1119 @@
+#include "codegen/RiscvAssembler.hpp"
+#include "codegen/RiscvIsa.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+struct RiscvAssembler::Operand {
+    // the number, or the addend when there is a symbol
+    int64_t value = 0;
+    // "hi", "lo", "pcrel_hi" or "pcrel_lo" for %modifier(symbol)
+    std::string modifier;
+    std::string symbol;
+};
+
+namespace {
+
+struct Opcode {
+    const char *name;
+    uint32_t funct3;
+    uint32_t funct7;
+};
+
+const Opcode kRegisterOps[] = {
+    {"add", 0, 0x00},  {"sub", 0, 0x20},    {"sll", 1, 0x00},
+    {"slt", 2, 0x00},  {"sltu", 3, 0x00},   {"xor", 4, 0x00},
+    {"srl", 5, 0x00},  {"sra", 5, 0x20},    {"or", 6, 0x00},
+    {"and", 7, 0x00},  {"mul", 0, 0x01},    {"mulh", 1, 0x01},
+    {"mulhsu", 2, 0x01}, {"mulhu", 3, 0x01}, {"div", 4, 0x01},
+    {"divu", 5, 0x01}, {"rem", 6, 0x01},    {"remu", 7, 0x01}};
+const Opcode kImmediateOps[] = {{"addi", 0, 0}, {"slti", 2, 0},
+                                {"sltiu", 3, 0}, {"xori", 4, 0},
+                                {"ori", 6, 0},  {"andi", 7, 0}};
+const Opcode kShiftOps[] = {
+    {"slli", 1, 0x00}, {"srli", 5, 0x00}, {"srai", 5, 0x20}};
+const Opcode kLoadOps[] = {
+    {"lb", 0, 0}, {"lh", 1, 0}, {"lw", 2, 0}, {"lbu", 4, 0}, {"lhu", 5, 0}};
+const Opcode kStoreOps[] = {{"sb", 0, 0}, {"sh", 1, 0}, {"sw", 2, 0}};
+const Opcode kBranchOps[] = {{"beq", 0, 0}, {"bne", 1, 0}, {"blt", 4, 0},
+                             {"bge", 5, 0}, {"bltu", 6, 0}, {"bgeu", 7, 0}};
+
+// c.sub, c.xor, c.or and c.and: funct2 in bits 6:5
+const Opcode kCompressedArithOps[] = {
+    {"c.sub", 0, 0}, {"c.xor", 1, 0}, {"c.or", 2, 0}, {"c.and", 3, 0}};
+
+constexpr uint32_t kOpLoad = 0x03;
+constexpr uint32_t kOpImm = 0x13;
+constexpr uint32_t kOpAuipc = 0x17;
+constexpr uint32_t kOpStore = 0x23;
+constexpr uint32_t kOpReg = 0x33;
+constexpr uint32_t kOpLui = 0x37;
+constexpr uint32_t kOpBranch = 0x63;
+constexpr uint32_t kOpJalr = 0x67;
+constexpr uint32_t kOpJal = 0x6f;
+constexpr uint32_t kOpSystem = 0x73;
+
+constexpr uint32_t kNop = 0x00000013;
+constexpr uint16_t kCompressedNop = 0x0001;
+
+template <std::size_t N>
+const Opcode *findOpcode(const Opcode (&p_table)[N], const std::string &p_name) {
+    for (const auto &opcode : p_table) {
+        if (p_name == opcode.name) {
+            return &opcode;
+        }
+    }
+    return nullptr;
+}
+
+uint32_t bits(const int64_t p_value, const unsigned p_high, const unsigned p_low) {
+    return (static_cast<uint32_t>(p_value) >> p_low) &
+           ((1u << (p_high - p_low + 1)) - 1);
+}
+
+uint32_t encodeR(const uint32_t p_op, const uint32_t p_rd, const uint32_t p_f3,
+                 const uint32_t p_rs1, const uint32_t p_rs2, const uint32_t p_f7) {
+    return p_f7 << 25 | p_rs2 << 20 | p_rs1 << 15 | p_f3 << 12 | p_rd << 7 | p_op;
+}
+
+uint32_t encodeI(const uint32_t p_op, const uint32_t p_rd, const uint32_t p_f3,
+                 const uint32_t p_rs1, const int64_t p_imm) {
+    return scatterIImmediate(p_imm) | p_rs1 << 15 | p_f3 << 12 | p_rd << 7 | p_op;
+}
+
+uint32_t encodeS(const uint32_t p_f3, const uint32_t p_rs1, const uint32_t p_rs2,
+                 const int64_t p_imm) {
+    return scatterSImmediate(p_imm) | p_rs2 << 20 | p_rs1 << 15 | p_f3 << 12 |
+           kOpStore;
+}
+
+uint32_t encodeB(const uint32_t p_f3, const uint32_t p_rs1, const uint32_t p_rs2,
+                 const int64_t p_imm) {
+    return scatterBImmediate(p_imm) | p_rs2 << 20 | p_rs1 << 15 | p_f3 << 12 |
+           kOpBranch;
+}
+
+uint32_t encodeU(const uint32_t p_op, const uint32_t p_rd, const int64_t p_imm20) {
+    return scatterUImmediate(p_imm20) | p_rd << 7 | p_op;
+}
+
+uint32_t encodeJ(const uint32_t p_rd, const int64_t p_imm) {
+    return scatterJImmediate(p_imm) | p_rd << 7 | kOpJal;
+}
+
+uint16_t encodeCJ(const uint32_t p_f3, const int64_t p_imm) {
+    return static_cast<uint16_t>(p_f3 << 13 | scatterCJImmediate(p_imm) | 0x1);
+}
+
+uint16_t encodeCB(const uint32_t p_f3, const uint32_t p_rs1, const int64_t p_imm) {
+    return static_cast<uint16_t>(p_f3 << 13 | scatterCBImmediate(p_imm) |
+                                 p_rs1 << 7 | 0x1);
+}
+
+std::string trim(const std::string &p_str) {
+    const auto begin = p_str.find_first_not_of(" \t");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    const auto end = p_str.find_last_not_of(" \t");
+    return p_str.substr(begin, end - begin + 1);
+}
+
+std::vector<std::string> splitArguments(const std::string &p_args) {
+    std::vector<std::string> args;
+    std::string current;
+    bool in_string = false;
+    for (std::string::size_type i = 0; i < p_args.size(); ++i) {
+        const char c = p_args[i];
+        if (c == '"' && (i == 0 || p_args[i - 1] != '\\')) {
+            in_string = !in_string;
+        }
+        if (c == ',' && !in_string) {
+            args.emplace_back(trim(current));
+            current.clear();
+        } else {
+            current += c;
+        }
+    }
+    if (!trim(current).empty() || !args.empty()) {
+        args.emplace_back(trim(current));
+    }
+    return args;
+}
+
+bool parseStringLiteral(const std::string &p_text, std::string &p_value) {
+    if (p_text.size() < 2 || p_text.front() != '"' || p_text.back() != '"') {
+        return false;
+    }
+    p_value.clear();
+    for (std::string::size_type i = 1; i + 1 < p_text.size(); ++i) {
+        char c = p_text[i];
+        if (c == '\\' && i + 2 < p_text.size()) {
+            c = p_text[++i];
+            switch (c) {
+            case 'n': c = '\n'; break;
+            case 't': c = '\t'; break;
+            case 'r': c = '\r'; break;
+            case 'b': c = '\b'; break;
+            case 'f': c = '\f'; break;
+            case '0': case '1': case '2': case '3':
+            case '4': case '5': case '6': case '7': {
+                int value = 0;
+                for (int digits = 0; digits < 3 && i + 1 < p_text.size() &&
+                                     p_text[i] >= '0' && p_text[i] <= '7';
+                     ++digits, ++i) {
+                    value = value * 8 + (p_text[i] - '0');
+                }
+                --i;
+                c = static_cast<char>(value);
+                break;
+            }
+            default:
+                break;
+            }
+        }
+        p_value += c;
+    }
+    return true;
+}
+
+// 32-bit values may be written unsigned, e.g. li t0, 0xffffffff
+int64_t toSigned32(const int64_t p_value) {
+    if (p_value >= (int64_t{1} << 31) && p_value < (int64_t{1} << 32)) {
+        return p_value - (int64_t{1} << 32);
+    }
+    return p_value;
+}
+
+} // namespace
+
+bool RiscvAssembler::assemble(const AssemblyBuffer &p_asm, ObjectFile &p_object) {
+    m_object = &p_object;
+    m_error.clear();
+    for (m_pass = 1; m_pass <= 2; ++m_pass) {
+        if (!runPass(p_asm)) {
+            return false;
+        }
+    }
+
+    for (std::size_t i = 0; i < m_object->sections.size(); ++i) {
+        m_object->sections[i].size = m_offsets[i];
+    }
+    // whatever is still undefined comes from the runtime or libc
+    for (auto &symbol : m_object->symbols) {
+        if (symbol.section < 0 && symbol.type != ObjectFile::Symbol::TypeEnum::kFile &&
+            !symbol.name.empty()) {
+            symbol.global = true;
+        }
+    }
+    return true;
+}
+
+bool RiscvAssembler::runPass(const AssemblyBuffer &p_asm) {
+    m_section = -1;
+    m_section_stack.clear();
+    m_offsets.assign(m_object->sections.size(), 0);
+    for (auto &section : m_object->sections) {
+        section.data.clear();
+        section.relocations.clear();
+    }
+    m_state = OptionState{false, true};
+    m_state_stack.clear();
+    m_pcrel_id = 0;
+    m_pending_location = ObjectFile::LineEntry();
+    if (m_pass == 2) {
+        m_object->lines.clear();
+    }
+
+    m_line_number = 0;
+    for (const auto &line : p_asm.getLines()) {
+        ++m_line_number;
+        bool ok = true;
+        if (line.isLabel()) {
+            ok = defineLabel(line.label);
+        } else if (line.isDirective()) {
+            ok = directive(line);
+        } else if (line.isInstruction()) {
+            if (m_section < 0) {
+                ok = switchSection(".text", "", "");
+            }
+            // like GNU as, a .loc applies to the next instruction
+            if (ok && m_pass == 2 && m_pending_location.line != 0) {
+                m_pending_location.section = m_section;
+                m_pending_location.offset = currentOffset();
+                m_object->lines.push_back(m_pending_location);
+                m_pending_location = ObjectFile::LineEntry();
+            }
+            if (ok) {
+                ok = (line.op.compare(0, 2, "c.") == 0)
+                         ? compressedInstruction(line)
+                         : instruction(line);
+            }
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RiscvAssembler::error(const std::string &p_message) {
+    if (m_error.empty()) {
+        m_error = "line " + std::to_string(m_line_number) + ": " + p_message;
+    }
+    return false;
+}
+
+bool RiscvAssembler::defineLabel(const std::string &p_name) {
+    if (m_section < 0 && !switchSection(".text", "", "")) {
+        return false;
+    }
+    const uint32_t index = getSymbol(p_name);
+    auto &symbol = m_object->symbols[index];
+    if (m_pass == 1) {
+        if (symbol.section >= 0) {
+            return error("symbol `" + p_name + "' is already defined");
+        }
+        symbol.section = m_section;
+        symbol.value = currentOffset();
+    }
+    return true;
+}
+
+uint32_t RiscvAssembler::getSymbol(const std::string &p_name) {
+    const int index = m_object->findSymbol(p_name);
+    if (index >= 0) {
+        return static_cast<uint32_t>(index);
+    }
+    ObjectFile::Symbol symbol;
+    symbol.name = p_name;
+    m_object->symbols.emplace_back(symbol);
+    return static_cast<uint32_t>(m_object->symbols.size() - 1);
+}
+
+bool RiscvAssembler::switchSection(const std::string &p_name,
+                                   const std::string &p_flags,
+                                   const std::string &p_type) {
+    int index = m_object->findSection(p_name);
+    if (index < 0) {
+        if (m_pass != 1) {
+            return error("section " + p_name + " appeared in the second pass");
+        }
+        ObjectFile::Section section;
+        section.name = p_name;
+
+        using Kind = ObjectFile::SectionKind;
+        const auto has_prefix = [&p_name](const char *p_prefix) {
+            const std::string prefix(p_prefix);
+            return p_name.compare(0, prefix.size(), prefix) == 0;
+        };
+        if (!p_flags.empty()) {
+            if (p_flags.find('x') != std::string::npos) {
+                section.kind = Kind::kText;
+            } else if (p_flags.find('w') != std::string::npos) {
+                section.kind = (p_type == "@nobits") ? Kind::kBss : Kind::kData;
+            } else {
+                section.kind = Kind::kReadOnly;
+            }
+        } else if (has_prefix(".text")) {
+            section.kind = Kind::kText;
+        } else if (has_prefix(".bss") || has_prefix(".sbss")) {
+            section.kind = Kind::kBss;
+        } else if (has_prefix(".rodata") || has_prefix(".srodata")) {
+            section.kind = Kind::kReadOnly;
+        } else {
+            section.kind = Kind::kData;
+        }
+        m_object->sections.emplace_back(section);
+        m_offsets.push_back(0);
+        index = static_cast<int>(m_object->sections.size() - 1);
+    }
+    m_section = index;
+    return true;
+}
+
+ObjectFile::Section &RiscvAssembler::currentSection() {
+    return m_object->sections[m_section];
+}
+
+bool RiscvAssembler::directive(const AsmLine &p_line) {
+    const std::string &name = p_line.op;
+    const std::string args = p_line.operands.empty() ? "" : p_line.operands[0];
+    const auto arg_list = splitArguments(args);
+
+    if (name == ".text" || name == ".data" || name == ".bss" ||
+        name == ".rodata") {
+        return switchSection(name, "", "");
+    }
+    if (name == ".section" || name == ".pushsection") {
+        if (arg_list.empty()) {
+            return error(name + " needs a name");
+        }
+        std::string flags;
+        if (arg_list.size() > 1 && !parseStringLiteral(arg_list[1], flags)) {
+            return error("bad section flags " + arg_list[1]);
+        }
+        if (name == ".pushsection") {
+            m_section_stack.push_back(m_section);
+        }
+        return switchSection(arg_list[0], flags,
+                             arg_list.size() > 2 ? arg_list[2] : "");
+    }
+    if (name == ".popsection") {
+        if (m_section_stack.empty()) {
+            return error(".popsection without .pushsection");
+        }
+        m_section = m_section_stack.back();
+        m_section_stack.pop_back();
+        return true;
+    }
+    if (name == ".option") {
+        if (args == "rvc") {
+            m_state.rvc = true;
+            m_object->rvc = true;
+        } else if (args == "norvc") {
+            m_state.rvc = false;
+        } else if (args == "relax") {
+            m_state.relax = true;
+        } else if (args == "norelax") {
+            m_state.relax = false;
+        } else if (args == "push") {
+            m_state_stack.push_back(m_state);
+        } else if (args == "pop") {
+            if (m_state_stack.empty()) {
+                return error(".option pop without push");
+            }
+            m_state = m_state_stack.back();
+            m_state_stack.pop_back();
+        } else if (args != "pic" && args != "nopic") {
+            return error("unknown option " + args);
+        }
+        return true;
+    }
+    if (name == ".loc") {
+        unsigned file = 0;
+        unsigned line = 0;
+        unsigned column = 0;
+        if (std::sscanf(args.c_str(), "%u %u %u", &file, &line, &column) < 2) {
+            return error("bad location " + args);
+        }
+        m_pending_location.line = line;
+        m_pending_location.column = column;
+        return true;
+    }
+    // ".file 1 name" numbers a file for .loc, which only uses the source
+    if (name == ".file" && !args.empty() && std::isdigit(static_cast<unsigned char>(args[0]))) {
+        return true;
+    }
+    if (name == ".file") {
+        std::string file_name;
+        if (!parseStringLiteral(args, file_name)) {
+            return error("bad file name " + args);
+        }
+        if (m_pass == 1) {
+            ObjectFile::Symbol symbol;
+            symbol.name = file_name;
+            symbol.type = ObjectFile::Symbol::TypeEnum::kFile;
+            m_object->symbols.emplace_back(symbol);
+        }
+        return true;
+    }
+    if (name == ".globl" || name == ".global" || name == ".local") {
+        for (const auto &arg : arg_list) {
+            m_object->symbols[getSymbol(arg)].global = (name != ".local");
+        }
+        return true;
+    }
+    if (name == ".type") {
+        if (arg_list.size() != 2) {
+            return error(".type needs a symbol and a type");
+        }
+        auto &symbol = m_object->symbols[getSymbol(arg_list[0])];
+        if (arg_list[1] == "@function" || arg_list[1] == "%function") {
+            symbol.type = ObjectFile::Symbol::TypeEnum::kFunction;
+        } else if (arg_list[1] == "@object" || arg_list[1] == "%object") {
+            symbol.type = ObjectFile::Symbol::TypeEnum::kObject;
+        } else {
+            return error("unknown symbol type " + arg_list[1]);
+        }
+        return true;
+    }
+
+    // everything below places bytes in the current section
+    if (m_section < 0 && !switchSection(".text", "", "")) {
+        return false;
+    }
+    if (name == ".size") {
+        if (arg_list.size() != 2) {
+            return error(".size needs a symbol and a size");
+        }
+        const uint32_t index = getSymbol(arg_list[0]);
+        if (m_pass == 2) {
+            auto &symbol = m_object->symbols[index];
+            int64_t size;
+            if (arg_list[1].compare(0, 2, ".-") == 0) {
+                if (symbol.section != m_section ||
+                    trim(arg_list[1].substr(2)) != arg_list[0]) {
+                    return error("unsupported size expression " + arg_list[1]);
+                }
+                size = currentOffset() - symbol.value;
+            } else if (!parseImmediate(arg_list[1], size)) {
+                return error("bad size " + arg_list[1]);
+            }
+            symbol.size = static_cast<uint32_t>(size);
+        }
+        return true;
+    }
+    if (name == ".align" || name == ".p2align" || name == ".balign") {
+        int64_t value;
+        if (arg_list.empty() || !parseImmediate(arg_list[0], value)) {
+            return error("bad alignment " + args);
+        }
+        if (name != ".balign") {
+            value = (value >= 0 && value <= 12) ? int64_t{1} << value : 0;
+        }
+        if (value <= 0 || value > 4096 || (value & (value - 1)) != 0) {
+            return error("bad alignment " + args);
+        }
+        return align(static_cast<uint32_t>(value));
+    }
+    if (name == ".zero" || name == ".space" || name == ".skip") {
+        int64_t value;
+        if (!parseImmediate(args, value) || value < 0) {
+            return error("bad size " + args);
+        }
+        for (int64_t i = 0; i < value; ++i) {
+            emit8(0);
+        }
+        return true;
+    }
+    if (currentSection().kind == ObjectFile::SectionKind::kBss) {
+        return error(name + " in a section without contents");
+    }
+    if (name == ".word" || name == ".4byte" || name == ".half" ||
+        name == ".2byte" || name == ".byte") {
+        for (const auto &arg : arg_list) {
+            int64_t value;
+            if (name == ".word" || name == ".4byte") {
+                if (!parseImmediate(arg, value)) {
+                    Operand operand;
+                    if (!parseOperand(arg, operand) || !operand.modifier.empty() ||
+                        !(std::isalpha(static_cast<unsigned char>(arg[0])) ||
+                          arg[0] == '_' || arg[0] == '.')) {
+                        return m_error.empty() && error("bad value " + arg);
+                    }
+                    addRelocation(kReloc32, getSymbol(operand.symbol),
+                                  static_cast<int32_t>(operand.value), false);
+                    value = 0;
+                }
+                emit32(static_cast<uint32_t>(value));
+            } else if (!parseImmediate(arg, value)) {
+                return error("bad value " + arg);
+            } else if (name == ".byte") {
+                emit8(static_cast<uint8_t>(value));
+            } else {
+                emit16(static_cast<uint16_t>(value));
+            }
+        }
+        return true;
+    }
+    if (name == ".string" || name == ".asciz" || name == ".ascii") {
+        for (const auto &arg : arg_list) {
+            std::string value;
+            if (!parseStringLiteral(arg, value)) {
+                return error("bad string " + arg);
+            }
+            for (const char c : value) {
+                emit8(static_cast<uint8_t>(c));
+            }
+            if (name != ".ascii") {
+                emit8(0);
+            }
+        }
+        return true;
+    }
+    return error("unsupported directive " + name);
+}
+
+bool RiscvAssembler::align(const uint32_t p_bytes) {
+    if (p_bytes <= 1) {
+        return true;
+    }
+    auto &section = currentSection();
+    section.align = std::max(section.align, p_bytes);
+
+    if (section.kind != ObjectFile::SectionKind::kText) {
+        while (currentOffset() % p_bytes != 0) {
+            emit8(0);
+        }
+        return true;
+    }
+
+    // Like GNU as: with relaxation the linker may delete code in front of
+    // the alignment, so reserve the worst-case padding and let it decide.
+    const uint32_t min_instruction = m_state.rvc ? 2 : 4;
+    uint32_t padding;
+    if (m_state.relax && p_bytes > min_instruction) {
+        padding = p_bytes - min_instruction;
+        addRelocation(kRelocAlign, 0, static_cast<int32_t>(padding), false);
+    } else {
+        padding = (p_bytes - currentOffset() % p_bytes) % p_bytes;
+    }
+    if (padding % 2 != 0) {
+        return error("cannot align code to an odd boundary");
+    }
+    if (padding % 4 != 0) {
+        emit16(kCompressedNop);
+        padding -= 2;
+    }
+    for (; padding != 0; padding -= 4) {
+        emit32(kNop);
+    }
+    return true;
+}
+
+bool RiscvAssembler::parseOperand(const std::string &p_text, Operand &p_operand) {
+    p_operand = Operand();
+    std::string text = p_text;
+    if (!text.empty() && text[0] == '%') {
+        const auto open = text.find('(');
+        if (open == std::string::npos || text.back() != ')') {
+            return error("bad operand " + p_text);
+        }
+        p_operand.modifier = text.substr(1, open - 1);
+        text = trim(text.substr(open + 1, text.size() - open - 2));
+    }
+    if (parseImmediate(text, p_operand.value)) {
+        if (!p_operand.modifier.empty()) {
+            return error("relocation modifier on a number: " + p_text);
+        }
+        return true;
+    }
+
+    // symbol, optionally followed by +addend or -addend
+    const auto sign = text.find_first_of("+-", 1);
+    p_operand.symbol = trim(text.substr(0, sign));
+    if (sign != std::string::npos &&
+        !parseImmediate(trim(text.substr(sign)), p_operand.value)) {
+        return error("bad operand " + p_text);
+    }
+    if (p_operand.symbol.empty() || getRegisterNumber(p_operand.symbol) >= 0) {
+        return error("bad operand " + p_text);
+    }
+    return true;
+}
+
+bool RiscvAssembler::parseRegister(const std::string &p_text, uint32_t &p_reg) {
+    const int reg = getRegisterNumber(p_text);
+    if (reg < 0) {
+        return error("expected a register but found `" + p_text + "'");
+    }
+    p_reg = static_cast<uint32_t>(reg);
+    return true;
+}
+
+bool RiscvAssembler::parseCompressedRegister(const std::string &p_text,
+                                             uint32_t &p_reg) {
+    if (!parseRegister(p_text, p_reg)) {
+        return false;
+    }
+    if (!isCompressedRegister(static_cast<int>(p_reg))) {
+        return error("register " + p_text + " is not one of x8-x15");
+    }
+    p_reg -= 8;
+    return true;
+}
+
+bool RiscvAssembler::parseMemory(const std::string &p_text, Operand &p_offset,
+                                 uint32_t &p_base) {
+    std::string offset, base;
+    if (!parseMemoryOperand(p_text, offset, base)) {
+        return error("expected offset(base) but found `" + p_text + "'");
+    }
+    return parseOperand(trim(offset), p_offset) && parseRegister(trim(base), p_base);
+}
+
+bool RiscvAssembler::resolveOffset(const Operand &p_target, int64_t &p_offset) {
+    if (p_target.symbol.empty() || !p_target.modifier.empty()) {
+        return error("expected a label as the target");
+    }
+    p_offset = 0;
+    if (m_pass == 1) {
+        return true;
+    }
+    const auto &symbol = m_object->symbols[getSymbol(p_target.symbol)];
+    if (symbol.section == m_section) {
+        p_offset = static_cast<int64_t>(symbol.value) + p_target.value -
+                   static_cast<int64_t>(currentOffset());
+    }
+    return true;
+}
+
+bool RiscvAssembler::immediate(const Operand &p_operand, const unsigned p_bits,
+                               const uint32_t p_reloc, int64_t &p_value) {
+    p_value = 0;
+    if (p_operand.symbol.empty()) {
+        if (!fitsSigned(p_operand.value, p_bits)) {
+            return error("immediate " + std::to_string(p_operand.value) +
+                         " out of range");
+        }
+        p_value = p_operand.value;
+        return true;
+    }
+
+    uint32_t type = kRelocNone;
+    if (p_operand.modifier == "lo") {
+        type = p_reloc;
+    } else if (p_operand.modifier == "pcrel_lo") {
+        type = (p_reloc == kRelocLo12S) ? kRelocPcrelLo12S : kRelocPcrelLo12I;
+    }
+    if (type == kRelocNone || p_reloc == kRelocNone) {
+        return error("unexpected symbol " + p_operand.symbol);
+    }
+    addRelocation(type, getSymbol(p_operand.symbol),
+                  static_cast<int32_t>(p_operand.value), true);
+    return true;
+}
+
+bool RiscvAssembler::instruction(const AsmLine &p_line) {
+    std::string op = p_line.op;
+    std::vector<std::string> args = p_line.operands;
+    const auto expect = [&](const std::size_t p_count) {
+        return args.size() == p_count ||
+               error(p_line.op + " expects " + std::to_string(p_count) +
+                     " operands");
+    };
+
+    // rewrite pseudo-instructions into their base instruction
+    if (op == "nop") {
+        op = "addi", args = {"zero", "zero", "0"};
+    } else if (op == "mv" && expect(2)) {
+        op = "addi", args.emplace_back("0");
+    } else if (op == "not" && expect(2)) {
+        op = "xori", args.emplace_back("-1");
+    } else if (op == "neg" && expect(2)) {
+        op = "sub", args = {args[0], "zero", args[1]};
+    } else if (op == "seqz" && expect(2)) {
+        op = "sltiu", args.emplace_back("1");
+    } else if (op == "snez" && expect(2)) {
+        op = "sltu", args = {args[0], "zero", args[1]};
+    } else if (op == "sltz" && expect(2)) {
+        op = "slt", args.emplace_back("zero");
+    } else if (op == "sgtz" && expect(2)) {
+        op = "slt", args = {args[0], "zero", args[1]};
+    } else if ((op == "beqz" || op == "bnez" || op == "bltz" || op == "bgez") &&
+               expect(2)) {
+        op = op.substr(0, 3), args = {args[0], "zero", args[1]};
+    } else if (op == "blez" && expect(2)) {
+        op = "bge", args = {"zero", args[0], args[1]};
+    } else if (op == "bgtz" && expect(2)) {
+        op = "blt", args = {"zero", args[0], args[1]};
+    } else if ((op == "bgt" || op == "ble" || op == "bgtu" || op == "bleu") &&
+               expect(3)) {
+        static const char *const swapped[][2] = {
+            {"bgt", "blt"}, {"ble", "bge"}, {"bgtu", "bltu"}, {"bleu", "bgeu"}};
+        for (const auto &pair : swapped) {
+            if (op == pair[0]) {
+                op = pair[1];
+                break;
+            }
+        }
+        std::swap(args[0], args[1]);
+    } else if (op == "j" && expect(1)) {
+        op = "jal", args = {"zero", args[0]};
+    } else if (op == "jal" && args.size() == 1) {
+        args = {"ra", args[0]};
+    } else if (op == "jr" && expect(1)) {
+        op = "jalr", args = {"zero", "0(" + args[0] + ")"};
+    } else if (op == "ret" && expect(0)) {
+        op = "jalr", args = {"zero", "0(ra)"};
+    } else if (op == "jalr" && args.size() == 1) {
+        args = {"ra", "0(" + args[0] + ")"};
+    } else if (op == "jalr" && args.size() == 3) {
+        args = {args[0], args[2] + "(" + args[1] + ")"};
+    }
+    if (!m_error.empty()) {
+        return false;
+    }
+
+    uint32_t rd, rs1, rs2;
+    int64_t imm;
+    Operand operand;
+    if (const Opcode *opcode = findOpcode(kRegisterOps, op)) {
+        if (!expect(3) || !parseRegister(args[0], rd) ||
+            !parseRegister(args[1], rs1) || !parseRegister(args[2], rs2)) {
+            return false;
+        }
+        emit32(encodeR(kOpReg, rd, opcode->funct3, rs1, rs2, opcode->funct7));
+    } else if (const Opcode *opcode = findOpcode(kImmediateOps, op)) {
+        if (!expect(3) || !parseRegister(args[0], rd) ||
+            !parseRegister(args[1], rs1) || !parseOperand(args[2], operand) ||
+            !immediate(operand, 12, kRelocLo12I, imm)) {
+            return false;
+        }
+        emit32(encodeI(kOpImm, rd, opcode->funct3, rs1, imm));
+    } else if (const Opcode *opcode = findOpcode(kShiftOps, op)) {
+        if (!expect(3) || !parseRegister(args[0], rd) ||
+            !parseRegister(args[1], rs1) || !parseOperand(args[2], operand)) {
+            return false;
+        }
+        if (!operand.symbol.empty() || operand.value < 0 || operand.value > 31) {
+            return error("bad shift amount " + args[2]);
+        }
+        emit32(encodeI(kOpImm, rd, opcode->funct3, rs1,
+                       operand.value | opcode->funct7 << 5));
+    } else if (const Opcode *opcode = findOpcode(kLoadOps, op)) {
+        if (!expect(2) || !parseRegister(args[0], rd) ||
+            !parseMemory(args[1], operand, rs1) ||
+            !immediate(operand, 12, kRelocLo12I, imm)) {
+            return false;
+        }
+        emit32(encodeI(kOpLoad, rd, opcode->funct3, rs1, imm));
+    } else if (const Opcode *opcode = findOpcode(kStoreOps, op)) {
+        if (!expect(2) || !parseRegister(args[0], rs2) ||
+            !parseMemory(args[1], operand, rs1) ||
+            !immediate(operand, 12, kRelocLo12S, imm)) {
+            return false;
+        }
+        emit32(encodeS(opcode->funct3, rs1, rs2, imm));
+    } else if (const Opcode *opcode = findOpcode(kBranchOps, op)) {
+        if (!expect(3) || !parseRegister(args[0], rs1) ||
+            !parseRegister(args[1], rs2) || !parseOperand(args[2], operand) ||
+            !resolveOffset(operand, imm)) {
+            return false;
+        }
+        if (!fitsSigned(imm, 13)) {
+            return error("branch to " + operand.symbol + " out of range");
+        }
+        addRelocation(kRelocBranch, getSymbol(operand.symbol),
+                      static_cast<int32_t>(operand.value), false);
+        emit32(encodeB(opcode->funct3, rs1, rs2, imm));
+    } else if (op == "jal") {
+        if (!expect(2) || !parseRegister(args[0], rd) ||
+            !parseOperand(args[1], operand) || !resolveOffset(operand, imm)) {
+            return false;
+        }
+        if (!fitsSigned(imm, 21)) {
+            return error("jump to " + operand.symbol + " out of range");
+        }
+        addRelocation(kRelocJal, getSymbol(operand.symbol),
+                      static_cast<int32_t>(operand.value), false);
+        emit32(encodeJ(rd, imm));
+    } else if (op == "jalr") {
+        if (!expect(2) || !parseRegister(args[0], rd) ||
+            !parseMemory(args[1], operand, rs1) ||
+            !immediate(operand, 12, kRelocNone, imm)) {
+            return false;
+        }
+        emit32(encodeI(kOpJalr, rd, 0, rs1, imm));
+    } else if (op == "lui" || op == "auipc") {
+        if (!expect(2) || !parseRegister(args[0], rd) ||
+            !parseOperand(args[1], operand)) {
+            return false;
+        }
+        imm = operand.value;
+        if (operand.symbol.empty()) {
+            if (imm < 0 || imm > 0xfffff) {
+                return error("immediate " + args[1] + " out of range");
+            }
+        } else {
+            const bool is_lui = (op == "lui");
+            if (operand.modifier != (is_lui ? "hi" : "pcrel_hi")) {
+                return error("unexpected symbol " + operand.symbol);
+            }
+            addRelocation(is_lui ? kRelocHi20 : kRelocPcrelHi20,
+                          getSymbol(operand.symbol),
+                          static_cast<int32_t>(operand.value), true);
+            imm = 0;
+        }
+        emit32(encodeU(op == "lui" ? kOpLui : kOpAuipc, rd, imm));
+    } else if (op == "li") {
+        if (!expect(2) || !parseRegister(args[0], rd) ||
+            !parseOperand(args[1], operand)) {
+            return false;
+        }
+        const int64_t value = toSigned32(operand.value);
+        if (!operand.symbol.empty() || !fitsSigned(value, 32)) {
+            return error("bad immediate " + args[1]);
+        }
+        if (fitsSigned(value, 12)) {
+            emit32(encodeI(kOpImm, rd, 0, 0, value));
+        } else {
+            const int64_t lo = ((value & 0xfff) ^ 0x800) - 0x800;
+            const int64_t hi = ((value - lo) >> 12) & 0xfffff;
+            emit32(encodeU(kOpLui, rd, hi));
+            if (lo != 0) {
+                emit32(encodeI(kOpImm, rd, 0, rd, lo));
+            }
+        }
+    } else if (op == "la" || op == "lla") {
+        if (!expect(2) || !parseRegister(args[0], rd) ||
+            !parseOperand(args[1], operand)) {
+            return false;
+        }
+        if (operand.symbol.empty() || !operand.modifier.empty()) {
+            return error("la expects a symbol");
+        }
+        // the %pcrel_lo half refers to the auipc through a local label
+        const std::string anchor = ".Lpcrel_hi" + std::to_string(m_pcrel_id++);
+        if (!defineLabel(anchor)) {
+            return false;
+        }
+        addRelocation(kRelocPcrelHi20, getSymbol(operand.symbol),
+                      static_cast<int32_t>(operand.value), true);
+        emit32(encodeU(kOpAuipc, rd, 0));
+        addRelocation(kRelocPcrelLo12I, getSymbol(anchor), 0, true);
+        emit32(encodeI(kOpImm, rd, 0, rd, 0));
+    } else if (op == "call" || op == "tail") {
+        if (!expect(1) || !parseOperand(args[0], operand)) {
+            return false;
+        }
+        if (operand.symbol.empty() || !operand.modifier.empty()) {
+            return error(op + " expects a symbol");
+        }
+        const uint32_t link = (op == "call") ? 1 : 6; // ra or t1
+        addRelocation(kRelocCall, getSymbol(operand.symbol),
+                      static_cast<int32_t>(operand.value), true);
+        emit32(encodeU(kOpAuipc, link, 0));
+        emit32(encodeI(kOpJalr, op == "call" ? 1 : 0, 0, link, 0));
+    } else if (op == "ecall" && expect(0)) {
+        emit32(kOpSystem);
+    } else if (op == "ebreak" && expect(0)) {
+        emit32(0x00100000 | kOpSystem);
+    } else {
+        return m_error.empty() && error("unsupported instruction " + op);
+    }
+    return true;
+}
+
+bool RiscvAssembler::compressedInstruction(const AsmLine &p_line) {
+    const std::string &op = p_line.op;
+    const auto &args = p_line.operands;
+    const auto expect = [&](const std::size_t p_count) {
+        return args.size() == p_count ||
+               error(op + " expects " + std::to_string(p_count) + " operands");
+    };
+    const auto simm = [&](const std::string &p_text, const unsigned p_bits,
+                          int64_t &p_value) {
+        Operand operand;
+        return parseOperand(p_text, operand) &&
+               immediate(operand, p_bits, kRelocNone, p_value);
+    };
+    const auto scaled = [&](const Operand &p_operand, const int64_t p_limit,
+                            const int64_t p_scale, int64_t &p_value) {
+        if (!p_operand.symbol.empty() || p_operand.value < 0 ||
+            p_operand.value >= p_limit || p_operand.value % p_scale != 0) {
+            return error("bad offset for " + op);
+        }
+        p_value = p_operand.value;
+        return true;
+    };
+
+    m_object->rvc = true;
+    uint32_t rd, rs;
+    int64_t imm;
+    Operand operand;
+    uint16_t half;
+
+    if (op == "c.nop" && expect(0)) {
+        half = kCompressedNop;
+    } else if (op == "c.ebreak" && expect(0)) {
+        half = 0x9002;
+    } else if (op == "c.addi" || op == "c.li" || op == "c.andi") {
+        const bool is_andi = (op == "c.andi");
+        if (!expect(2) ||
+            !(is_andi ? parseCompressedRegister(args[0], rd)
+                      : parseRegister(args[0], rd)) ||
+            !simm(args[1], 6, imm)) {
+            return false;
+        }
+        if (is_andi) {
+            half = static_cast<uint16_t>(0x8801 | bits(imm, 5, 5) << 12 |
+                                         rd << 7 | bits(imm, 4, 0) << 2);
+        } else {
+            half = static_cast<uint16_t>((op == "c.li" ? 0x4001 : 0x0001) |
+                                         bits(imm, 5, 5) << 12 | rd << 7 |
+                                         bits(imm, 4, 0) << 2);
+        }
+    } else if (op == "c.addi16sp") {
+        if (!expect(2) || !simm(args[1], 10, imm)) {
+            return false;
+        }
+        if (imm == 0 || imm % 16 != 0) {
+            return error("c.addi16sp needs a non-zero multiple of 16");
+        }
+        half = static_cast<uint16_t>(
+            0x6101 | bits(imm, 9, 9) << 12 | bits(imm, 4, 4) << 6 |
+            bits(imm, 6, 6) << 5 | bits(imm, 8, 7) << 3 | bits(imm, 5, 5) << 2);
+    } else if (op == "c.addi4spn") {
+        if (!expect(3) || !parseCompressedRegister(args[0], rd) ||
+            !parseOperand(args[2], operand) ||
+            !scaled(operand, 1024, 4, imm)) {
+            return false;
+        }
+        if (imm == 0) {
+            return error("c.addi4spn needs a non-zero immediate");
+        }
+        half = static_cast<uint16_t>(bits(imm, 5, 4) << 11 | bits(imm, 9, 6) << 7 |
+                                     bits(imm, 2, 2) << 6 | bits(imm, 3, 3) << 5 |
+                                     rd << 2);
+    } else if (op == "c.lui") {
+        if (!expect(2) || !parseRegister(args[0], rd) ||
+            !parseOperand(args[1], operand) || !operand.symbol.empty()) {
+            return m_error.empty() && error("bad operand for c.lui");
+        }
+        // accepted as the 20-bit upper value, like lui
+        imm = operand.value >= 0xfffe0 ? operand.value - 0x100000 : operand.value;
+        if (imm == 0 || !fitsSigned(imm, 6) || rd == 0 || rd == 2) {
+            return error("bad operand for c.lui");
+        }
+        half = static_cast<uint16_t>(0x6001 | bits(imm, 5, 5) << 12 | rd << 7 |
+                                     bits(imm, 4, 0) << 2);
+    } else if (op == "c.srli" || op == "c.srai" || op == "c.slli") {
+        const bool is_slli = (op == "c.slli");
+        if (!expect(2) ||
+            !(is_slli ? parseRegister(args[0], rd)
+                      : parseCompressedRegister(args[0], rd)) ||
+            !parseOperand(args[1], operand)) {
+            return false;
+        }
+        if (!operand.symbol.empty() || operand.value <= 0 || operand.value > 31) {
+            return error("bad shift amount " + args[1]);
+        }
+        if (is_slli) {
+            half = static_cast<uint16_t>(0x0002 | rd << 7 | operand.value << 2);
+        } else {
+            half = static_cast<uint16_t>((op == "c.srli" ? 0x8001 : 0x8401) |
+                                         rd << 7 | operand.value << 2);
+        }
+    } else if (const Opcode *opcode = findOpcode(kCompressedArithOps, op)) {
+        if (!expect(2) || !parseCompressedRegister(args[0], rd) ||
+            !parseCompressedRegister(args[1], rs)) {
+            return false;
+        }
+        half = static_cast<uint16_t>(0x8c01 | rd << 7 | opcode->funct3 << 5 |
+                                     rs << 2);
+    } else if (op == "c.mv" || op == "c.add") {
+        if (!expect(2) || !parseRegister(args[0], rd) ||
+            !parseRegister(args[1], rs)) {
+            return false;
+        }
+        if (rd == 0 || rs == 0) {
+            return error(op + " cannot use x0");
+        }
+        half = static_cast<uint16_t>((op == "c.mv" ? 0x8002 : 0x9002) | rd << 7 |
+                                     rs << 2);
+    } else if (op == "c.jr" || op == "c.jalr") {
+        if (!expect(1) || !parseRegister(args[0], rs)) {
+            return false;
+        }
+        if (rs == 0) {
+            return error(op + " cannot use x0");
+        }
+        half = static_cast<uint16_t>((op == "c.jr" ? 0x8002 : 0x9002) | rs << 7);
+    } else if (op == "c.lwsp" || op == "c.swsp") {
+        uint32_t base;
+        if (!expect(2) || !parseRegister(args[0], rd) ||
+            !parseMemory(args[1], operand, base) ||
+            !scaled(operand, 256, 4, imm)) {
+            return false;
+        }
+        if (base != 2) {
+            return error(op + " must address through sp");
+        }
+        if (op == "c.lwsp") {
+            if (rd == 0) {
+                return error("c.lwsp cannot load x0");
+            }
+            half = static_cast<uint16_t>(0x4002 | bits(imm, 5, 5) << 12 |
+                                         rd << 7 | bits(imm, 4, 2) << 4 |
+                                         bits(imm, 7, 6) << 2);
+        } else {
+            half = static_cast<uint16_t>(0xc002 | bits(imm, 5, 2) << 9 |
+                                         bits(imm, 7, 6) << 7 | rd << 2);
+        }
+    } else if (op == "c.lw" || op == "c.sw") {
+        uint32_t base;
+        std::string offset, base_name;
+        if (!expect(2) || !parseCompressedRegister(args[0], rd) ||
+            !parseMemoryOperand(args[1], offset, base_name)) {
+            return m_error.empty() && error("bad operand for " + op);
+        }
+        if (!parseCompressedRegister(trim(base_name), base) ||
+            !parseOperand(trim(offset), operand) ||
+            !scaled(operand, 128, 4, imm)) {
+            return false;
+        }
+        half = static_cast<uint16_t>((op == "c.lw" ? 0x4000 : 0xc000) |
+                                     bits(imm, 5, 3) << 10 | base << 7 |
+                                     bits(imm, 2, 2) << 6 | bits(imm, 6, 6) << 5 |
+                                     rd << 2);
+    } else if (op == "c.j" || op == "c.jal") {
+        if (!expect(1) || !parseOperand(args[0], operand) ||
+            !resolveOffset(operand, imm)) {
+            return false;
+        }
+        if (!fitsSigned(imm, 12)) {
+            return error("jump to " + operand.symbol + " out of range");
+        }
+        addRelocation(kRelocRvcJump, getSymbol(operand.symbol),
+                      static_cast<int32_t>(operand.value), false);
+        half = encodeCJ(op == "c.j" ? 5 : 1, imm);
+    } else if (op == "c.beqz" || op == "c.bnez") {
+        if (!expect(2) || !parseCompressedRegister(args[0], rs) ||
+            !parseOperand(args[1], operand) || !resolveOffset(operand, imm)) {
+            return false;
+        }
+        if (!fitsSigned(imm, 9)) {
+            return error("branch to " + operand.symbol + " out of range");
+        }
+        addRelocation(kRelocRvcBranch, getSymbol(operand.symbol),
+                      static_cast<int32_t>(operand.value), false);
+        half = encodeCB(op == "c.beqz" ? 6 : 7, rs, imm);
+    } else {
+        return m_error.empty() && error("unsupported instruction " + op);
+    }
+    emit16(half);
+    return true;
+}
+
+void RiscvAssembler::emit8(const uint8_t p_byte) {
+    auto &section = currentSection();
+    if (m_pass == 2 && section.kind != ObjectFile::SectionKind::kBss) {
+        section.data.push_back(p_byte);
+    }
+    ++m_offsets[m_section];
+}
+
+void RiscvAssembler::emit16(const uint16_t p_half) {
+    emit8(static_cast<uint8_t>(p_half));
+    emit8(static_cast<uint8_t>(p_half >> 8));
+}
+
+void RiscvAssembler::emit32(const uint32_t p_word) {
+    emit16(static_cast<uint16_t>(p_word));
+    emit16(static_cast<uint16_t>(p_word >> 16));
+}
+
+void RiscvAssembler::addRelocation(const uint32_t p_type, const uint32_t p_symbol,
+                                   const int32_t p_addend, const bool p_relax) {
+    if (m_pass != 2) {
+        return;
+    }
+    // Branches resolved inside the section only need a relocation when
+    // the linker may move code around them.
+    const bool pc_relative =
+        p_type == kRelocBranch || p_type == kRelocJal ||
+        p_type == kRelocRvcBranch || p_type == kRelocRvcJump;
+    if (pc_relative && !m_state.relax &&
+        m_object->symbols[p_symbol].section == m_section) {
+        return;
+    }
+
+    auto &relocations = currentSection().relocations;
+    relocations.push_back({currentOffset(), p_type, p_symbol, p_addend});
+    if (p_relax && m_state.relax) {
+        relocations.push_back({currentOffset(), kRelocRelax, 0, 0});
+    }
+}
@@ -0,0 +1,142 @@
+#include "codegen/RiscvIsa.hpp"
+#include "codegen/AssemblyBuffer.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+static const char *kAbiRegisterNames[] = {
+    "zero", "ra", "sp", "gp", "tp",  "t0",  "t1", "t2", "s0", "s1", "a0",
+    "a1",   "a2", "a3", "a4", "a5",  "a6",  "a7", "s2", "s3", "s4", "s5",
+    "s6",   "s7", "s8", "s9", "s10", "s11", "t3", "t4", "t5", "t6"};
+
+int getRegisterNumber(const std::string &p_name) {
+    if (p_name == "fp") {
+        return 8;
+    }
+    for (int i = 0; i < 32; ++i) {
+        if (p_name == kAbiRegisterNames[i]) {
+            return i;
+        }
+    }
+    if (p_name.size() >= 2 && p_name.size() <= 3 && p_name[0] == 'x') {
+        char *end = nullptr;
+        const long reg = std::strtol(p_name.c_str() + 1, &end, 10);
+        if (*end == '\0' && reg >= 0 && reg < 32) {
+            return static_cast<int>(reg);
+        }
+    }
+    return -1;
+}
+
+bool parseImmediate(const std::string &p_str, int64_t &p_value) {
+    if (p_str.empty()) {
+        return false;
+    }
+    char *end = nullptr;
+    p_value = std::strtoll(p_str.c_str(), &end, 0);
+    return *end == '\0';
+}
+
+bool parseMemoryOperand(const std::string &p_operand, std::string &p_offset,
+                        std::string &p_base) {
+    const auto open = p_operand.rfind('(');
+    if (open == std::string::npos || p_operand.back() != ')') {
+        return false;
+    }
+    p_offset = p_operand.substr(0, open);
+    if (p_offset.empty()) {
+        p_offset = "0";
+    }
+    p_base = p_operand.substr(open + 1, p_operand.size() - open - 2);
+    return true;
+}
+
+static uint32_t bits(const int64_t p_value, const unsigned p_high,
+                     const unsigned p_low) {
+    return (static_cast<uint32_t>(p_value) >> p_low) &
+           ((1u << (p_high - p_low + 1)) - 1);
+}
+
+uint32_t scatterIImmediate(const int64_t p_imm) {
+    return bits(p_imm, 11, 0) << 20;
+}
+
+uint32_t scatterSImmediate(const int64_t p_imm) {
+    return bits(p_imm, 11, 5) << 25 | bits(p_imm, 4, 0) << 7;
+}
+
+uint32_t scatterBImmediate(const int64_t p_imm) {
+    return bits(p_imm, 12, 12) << 31 | bits(p_imm, 10, 5) << 25 |
+           bits(p_imm, 4, 1) << 8 | bits(p_imm, 11, 11) << 7;
+}
+
+uint32_t scatterUImmediate(const int64_t p_imm20) {
+    return bits(p_imm20, 19, 0) << 12;
+}
+
+uint32_t scatterJImmediate(const int64_t p_imm) {
+    return bits(p_imm, 20, 20) << 31 | bits(p_imm, 10, 1) << 21 |
+           bits(p_imm, 11, 11) << 20 | bits(p_imm, 19, 12) << 12;
+}
+
+uint16_t scatterCJImmediate(const int64_t p_imm) {
+    return static_cast<uint16_t>(
+        bits(p_imm, 11, 11) << 12 | bits(p_imm, 4, 4) << 11 |
+        bits(p_imm, 9, 8) << 9 | bits(p_imm, 10, 10) << 8 |
+        bits(p_imm, 6, 6) << 7 | bits(p_imm, 7, 7) << 6 |
+        bits(p_imm, 3, 1) << 3 | bits(p_imm, 5, 5) << 2);
+}
+
+uint16_t scatterCBImmediate(const int64_t p_imm) {
+    return static_cast<uint16_t>(
+        bits(p_imm, 8, 8) << 12 | bits(p_imm, 4, 3) << 10 |
+        bits(p_imm, 7, 6) << 5 | bits(p_imm, 2, 1) << 3 |
+        bits(p_imm, 5, 5) << 2);
+}
+
+uint32_t getInstructionSize(const AsmLine &p_line) {
+    if (!p_line.isInstruction()) {
+        return 0;
+    }
+
+    const std::string &op = p_line.op;
+    if (op.compare(0, 2, "c.") == 0) {
+        return 2;
+    }
+    if (op == "la" || op == "lla" || op == "call" || op == "tail") {
+        return 8;
+    }
+    if (op == "li") {
+        int64_t value;
+        if (p_line.operands.size() == 2 &&
+            parseImmediate(p_line.operands[1], value) &&
+            (fitsSigned(value, 12) || fitsSigned(value - (int64_t{1} << 32), 12) ||
+             (value & 0xfff) == 0)) {
+            return 4;
+        }
+        return 8;
+    }
+    return 4;
+}
+
+void followSection(const AsmLine &p_line, std::vector<bool> &p_in_text) {
+    if (!p_line.isDirective()) {
+        return;
+    }
+    if (p_line.op == ".text") {
+        p_in_text.back() = true;
+    } else if (p_line.op == ".data" || p_line.op == ".bss" ||
+               p_line.op == ".rodata") {
+        p_in_text.back() = false;
+    } else if (p_line.op == ".section" || p_line.op == ".pushsection") {
+        const bool is_text = !p_line.operands.empty() &&
+                             p_line.operands[0].compare(0, 5, ".text") == 0;
+        if (p_line.op == ".pushsection") {
+            p_in_text.push_back(is_text);
+        } else {
+            p_in_text.back() = is_text;
+        }
+    } else if (p_line.op == ".popsection" && p_in_text.size() > 1) {
+        p_in_text.pop_back();
+    }
+}
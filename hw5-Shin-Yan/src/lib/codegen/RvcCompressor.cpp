@@ -0,0 +1,327 @@
+#include "codegen/RvcCompressor.hpp"
+#include "codegen/RiscvIsa.hpp"
+
+#include <cctype>
+#include <cstdlib>
+#include <map>
+#include <set>
+
+namespace {
+
+// register-allocation hint: the code generator's scratch registers are
+// remapped into x8-x15, which the 3-bit RV32C register fields can address
+const std::map<std::string, std::string> kScratchRegisterHint = {
+    {"t0", "a5"}, {"t1", "a4"}, {"t2", "a3"}, {"t3", "a2"}};
+
+// branch ranges of c.j/c.jal and c.beqz/c.bnez, minus a margin for the
+// padding that .align may insert once code shrinks
+constexpr int64_t kJumpRange = 2000;
+constexpr int64_t kBranchRange = 240;
+
+std::string renameRegister(const std::string &p_operand) {
+    const auto hint = kScratchRegisterHint.find(p_operand);
+    if (hint != kScratchRegisterHint.end()) {
+        return hint->second;
+    }
+
+    std::string offset, base;
+    if (parseMemoryOperand(p_operand, offset, base)) {
+        const auto base_hint = kScratchRegisterHint.find(base);
+        if (base_hint != kScratchRegisterHint.end()) {
+            return offset + "(" + base_hint->second + ")";
+        }
+    }
+    return p_operand;
+}
+
+void applyRegisterHint(AsmLine &p_line) {
+    auto operands = p_line.operands;
+    bool changed = false;
+    for (auto &operand : operands) {
+        const auto renamed = renameRegister(operand);
+        changed |= (renamed != operand);
+        operand = renamed;
+    }
+    if (!changed) {
+        return;
+    }
+    p_line.setInstruction(p_line.op, operands);
+
+    // keep comments such as "load value to register 't0'" truthful
+    auto &comment = p_line.comment;
+    for (const auto &hint : kScratchRegisterHint) {
+        std::string::size_type pos = comment.find(hint.first);
+        while (pos != std::string::npos) {
+            const auto end = pos + hint.first.size();
+            if ((pos == 0 || !std::isalnum(static_cast<unsigned char>(comment[pos - 1]))) &&
+                (end == comment.size() || !std::isalnum(static_cast<unsigned char>(comment[end])))) {
+                comment.replace(pos, hint.first.size(), hint.second);
+            }
+            pos = comment.find(hint.first, pos + 1);
+        }
+    }
+}
+
+// RV32C forms that do not depend on the code layout
+bool compressSimple(AsmLine &p_line) {
+    const auto &op = p_line.op;
+    const auto &ops = p_line.operands;
+    int64_t imm;
+
+    auto reg = [&](const std::size_t i) { return getRegisterNumber(ops[i]); };
+    auto set = [&](const char *c_op, const std::vector<std::string> &c_ops) {
+        p_line.setInstruction(c_op, c_ops);
+        return true;
+    };
+
+    if (op == "addi" && ops.size() == 3 && parseImmediate(ops[2], imm)) {
+        const int rd = reg(0), rs = reg(1);
+        if (rd == 2 && rs == 2 && imm != 0 && imm % 16 == 0 &&
+            imm >= -512 && imm <= 496) {
+            return set("c.addi16sp", {"sp", ops[2]});
+        }
+        if (rd == rs && rd > 0 && imm != 0 && fitsSigned(imm, 6)) {
+            return set("c.addi", {ops[0], ops[2]});
+        }
+        if (rs == 2 && isCompressedRegister(rd) && imm > 0 && imm % 4 == 0 &&
+            imm <= 1020) {
+            return set("c.addi4spn", {ops[0], "sp", ops[2]});
+        }
+        if (rs == 0 && rd > 0 && fitsSigned(imm, 6)) {
+            return set("c.li", {ops[0], ops[2]});
+        }
+        if (imm == 0 && rd > 0 && rs > 0) {
+            return set("c.mv", {ops[0], ops[1]});
+        }
+        return false;
+    }
+    if (op == "li" && ops.size() == 2 && parseImmediate(ops[1], imm) &&
+        reg(0) > 0 && fitsSigned(imm, 6)) {
+        return set("c.li", {ops[0], ops[1]});
+    }
+    if (op == "mv" && ops.size() == 2 && reg(0) > 0 && reg(1) > 0) {
+        return set("c.mv", {ops[0], ops[1]});
+    }
+    if (op == "add" && ops.size() == 3 && reg(0) > 0) {
+        if (reg(0) == reg(1) && reg(2) > 0) {
+            return set("c.add", {ops[0], ops[2]});
+        }
+        if (reg(0) == reg(2) && reg(1) > 0) {
+            return set("c.add", {ops[0], ops[1]});
+        }
+        return false;
+    }
+    if ((op == "sub" || op == "xor" || op == "or" || op == "and") &&
+        ops.size() == 3 && isCompressedRegister(reg(0))) {
+        const std::string c_op = "c." + op;
+        if (reg(0) == reg(1) && isCompressedRegister(reg(2))) {
+            return set(c_op.c_str(), {ops[0], ops[2]});
+        }
+        // the bitwise operations commute
+        if (op != "sub" && reg(0) == reg(2) && isCompressedRegister(reg(1))) {
+            return set(c_op.c_str(), {ops[0], ops[1]});
+        }
+        return false;
+    }
+    if (op == "andi" && ops.size() == 3 && parseImmediate(ops[2], imm) &&
+        reg(0) == reg(1) && isCompressedRegister(reg(0)) &&
+        fitsSigned(imm, 6)) {
+        return set("c.andi", {ops[0], ops[2]});
+    }
+    if ((op == "slli" || op == "srli" || op == "srai") && ops.size() == 3 &&
+        parseImmediate(ops[2], imm) && reg(0) == reg(1) && imm > 0 && imm < 32) {
+        if (op == "slli" ? reg(0) > 0 : isCompressedRegister(reg(0))) {
+            return set(("c." + op).c_str(), {ops[0], ops[2]});
+        }
+        return false;
+    }
+    if ((op == "lw" || op == "sw") && ops.size() == 2) {
+        std::string offset, base;
+        if (!parseMemoryOperand(ops[1], offset, base) ||
+            !parseImmediate(offset, imm) || imm < 0 || imm % 4 != 0) {
+            return false;
+        }
+        const int data = reg(0), base_reg = getRegisterNumber(base);
+        if (base_reg == 2 && imm <= 252 && (op == "sw" || data > 0)) {
+            return set(op == "lw" ? "c.lwsp" : "c.swsp", ops);
+        }
+        if (isCompressedRegister(data) && isCompressedRegister(base_reg) &&
+            imm <= 124) {
+            return set(op == "lw" ? "c.lw" : "c.sw", ops);
+        }
+        return false;
+    }
+    if (op == "jr" && ops.size() == 1 && reg(0) > 0) {
+        return set("c.jr", ops);
+    }
+    if (op == "ret" && ops.empty()) {
+        return set("c.jr", {"ra"});
+    }
+    if (op == "jalr" && ops.size() == 1 && reg(0) > 0) {
+        return set("c.jalr", ops);
+    }
+    if (op == "nop" && ops.empty()) {
+        return set("c.nop", {});
+    }
+    if (op == "ebreak" && ops.empty()) {
+        return set("c.ebreak", {});
+    }
+    return false;
+}
+
+} // namespace
+
+void RvcCompressor::measure(const AssemblyBuffer &p_asm,
+                            const bool p_compressed) {
+    std::set<std::string> functions;
+    FunctionSize *current = nullptr;
+
+    for (const auto &line : p_asm.getLines()) {
+        if (line.isDirective() && line.op == ".type" &&
+            !line.operands.empty() &&
+            line.operands[0].find("@function") != std::string::npos) {
+            functions.insert(
+                line.operands[0].substr(0, line.operands[0].find(',')));
+        } else if (line.isDirective() && line.op == ".size") {
+            current = nullptr;
+        } else if (line.isLabel() && functions.count(line.label)) {
+            current = nullptr;
+            for (auto &size : m_sizes) {
+                if (size.name == line.label) {
+                    current = &size;
+                }
+            }
+            if (current == nullptr) {
+                m_sizes.emplace_back();
+                m_sizes.back().name = line.label;
+                current = &m_sizes.back();
+            }
+        } else if (line.isInstruction() && current != nullptr) {
+            const auto size = getInstructionSize(line);
+            if (p_compressed) {
+                current->compressed_bytes += size;
+            } else {
+                current->instructions += 1;
+                current->uncompressed_bytes += size;
+            }
+        }
+    }
+}
+
+void RvcCompressor::remapRegisters(AssemblyBuffer &p_asm) {
+    for (auto &line : p_asm.getLines()) {
+        if (line.isInstruction()) {
+            applyRegisterHint(line);
+        }
+    }
+}
+
+void RvcCompressor::run(AssemblyBuffer &p_asm) {
+    m_sizes.clear();
+    measure(p_asm, false);
+
+    auto &lines = p_asm.getLines();
+    for (auto &line : lines) {
+        if (line.isInstruction()) {
+            applyRegisterHint(line);
+            compressSimple(line);
+        }
+    }
+
+    // lay out .text with every remaining instruction at full size to decide
+    // which jumps and branches reach their targets in compressed form
+    std::map<std::string, int64_t> label_offsets;
+    std::vector<int64_t> offsets(lines.size(), -1);
+    int64_t pc = 0;
+    std::vector<bool> in_text{true};
+    for (std::size_t i = 0; i < lines.size(); ++i) {
+        followSection(lines[i], in_text);
+        if (!in_text.back()) {
+            continue;
+        }
+        if (lines[i].isLabel()) {
+            label_offsets[lines[i].label] = pc;
+        } else if (lines[i].isInstruction()) {
+            offsets[i] = pc;
+            pc += getInstructionSize(lines[i]);
+        }
+    }
+
+    auto distance = [&](const std::size_t i, const std::string &p_label,
+                        int64_t &p_distance) {
+        const auto target = label_offsets.find(p_label);
+        if (offsets[i] < 0 || target == label_offsets.end()) {
+            return false;
+        }
+        p_distance = target->second - offsets[i];
+        return true;
+    };
+
+    for (std::size_t i = 0; i < lines.size(); ++i) {
+        auto &line = lines[i];
+        if (!line.isInstruction()) {
+            continue;
+        }
+        const auto &ops = line.operands;
+        int64_t d;
+
+        if (line.op == "j" && ops.size() == 1 && distance(i, ops[0], d) &&
+            std::llabs(d) <= kJumpRange) {
+            line.setInstruction("c.j", ops);
+        } else if (line.op == "jal" && ops.size() == 2 && ops[0] == "ra" &&
+                   distance(i, ops[1], d) && std::llabs(d) <= kJumpRange) {
+            line.setInstruction("c.jal", {ops[1]});
+        } else if ((line.op == "beqz" || line.op == "bnez") &&
+                   ops.size() == 2 &&
+                   isCompressedRegister(getRegisterNumber(ops[0])) &&
+                   distance(i, ops[1], d) && std::llabs(d) <= kBranchRange) {
+            line.setInstruction("c." + line.op, ops);
+        } else if ((line.op == "beq" || line.op == "bne") && ops.size() == 3 &&
+                   distance(i, ops[2], d) && std::llabs(d) <= kBranchRange) {
+            const bool rs_zero = getRegisterNumber(ops[1]) == 0;
+            const bool ls_zero = getRegisterNumber(ops[0]) == 0;
+            const std::string &rs = rs_zero ? ops[0] : ops[1];
+            if ((rs_zero || ls_zero) &&
+                isCompressedRegister(getRegisterNumber(rs))) {
+                line.setInstruction(line.op == "beq" ? "c.beqz" : "c.bnez",
+                                    {rs, ops[2]});
+            }
+        }
+    }
+
+    measure(p_asm, true);
+}
+
+void RvcCompressor::dumpSizeReport(FILE *p_out_file,
+                                   const std::string &p_source) const {
+    std::fprintf(p_out_file,
+                 "\n"
+                 "|---------------------------------------------------|\n"
+                 "|  Code size: rv32im vs rv32imac                    |\n"
+                 "|---------------------------------------------------|\n"
+                 "  %s\n"
+                 "  %-20s %8s %10s %10s %8s\n",
+                 p_source.c_str(), "function", "instrs", "rv32im", "rv32imac",
+                 "saved");
+
+    FunctionSize total;
+    total.name = "total";
+    auto dump_row = [&](const FunctionSize &p_size) {
+        const double saved =
+            (p_size.uncompressed_bytes == 0)
+                ? 0.0
+                : 100.0 * (p_size.uncompressed_bytes - p_size.compressed_bytes) /
+                      p_size.uncompressed_bytes;
+        std::fprintf(p_out_file, "  %-20s %8u %10u %10u %7.1f%%\n",
+                     p_size.name.c_str(), p_size.instructions,
+                     p_size.uncompressed_bytes, p_size.compressed_bytes, saved);
+    };
+
+    for (const auto &size : m_sizes) {
+        dump_row(size);
+        total.instructions += size.instructions;
+        total.uncompressed_bytes += size.uncompressed_bytes;
+        total.compressed_bytes += size.compressed_bytes;
+    }
+    dump_row(total);
+}
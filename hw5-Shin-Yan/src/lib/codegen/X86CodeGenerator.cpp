@@ -0,0 +1,705 @@
+#include "codegen/X86CodeGenerator.hpp"
+#include "codegen/OutputPath.hpp"
+#include "visitor/AstNodeInclude.hpp"
+
+#include <cassert>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+static const char *const kIntRegisters64[] = {"rdi", "rsi", "rdx",
+                                              "rcx", "r8",  "r9"};
+static const char *const kIntRegisters32[] = {"edi", "esi", "edx",
+                                              "ecx", "r8d", "r9d"};
+static constexpr int kIntRegisterCount = 6;
+static constexpr int kSseRegisterCount = 8;
+
+static void dumpInstructions(AssemblyBuffer &p_asm, const char *format, ...) {
+    va_list args;
+    va_list args_copy;
+    va_start(args, format);
+    va_copy(args_copy, args);
+    const int length = vsnprintf(nullptr, 0, format, args);
+    va_end(args);
+
+    std::string text(length, '\0');
+    vsnprintf(&text[0], length + 1, format, args_copy);
+    va_end(args_copy);
+    p_asm.append(text);
+}
+
+static int getElementCount(const PType &p_type) {
+    int count = 1;
+    for (auto dimension : p_type.getDimensions()) {
+        count *= static_cast<int>(dimension);
+    }
+    return count;
+}
+
+// bytes taken by a variable; strings are pointers
+static int getStorageSize(const PType &p_type) {
+    if (p_type.isString()) {
+        return 8;
+    }
+    return 4 * getElementCount(p_type);
+}
+
+X86CodeGenerator::X86CodeGenerator(const std::string &p_source_file_name,
+                                   const std::string &p_save_path,
+                                   const SymbolManager *const p_symbol_manager)
+    : m_symbol_manager_ptr(p_symbol_manager),
+      m_source_file_path(p_source_file_name) {
+    m_output_file.reset(
+        fopen(getOutputFilePath(p_source_file_name, p_save_path, ".s").c_str(), "w"));
+    assert(m_output_file.get() && "Failed to open output file");
+}
+
+std::vector<X86CodeGenerator::ArgumentLocation>
+X86CodeGenerator::classifyArguments(const std::vector<const PType *> &p_types,
+                                    int &p_stack_size) {
+    std::vector<ArgumentLocation> locations;
+    int int_count = 0;
+    int sse_count = 0;
+    p_stack_size = 0;
+    for (const PType *type : p_types) {
+        // arrays are passed as a pointer to the caller's copy
+        const bool sse = type->isReal();
+        int &count = sse ? sse_count : int_count;
+        if (count < (sse ? kSseRegisterCount : kIntRegisterCount)) {
+            locations.push_back({sse, count++, 0});
+        } else {
+            locations.push_back({sse, -1, p_stack_size});
+            p_stack_size += 8;
+        }
+    }
+    return locations;
+}
+
+int X86CodeGenerator::allocateLocal(const std::string &p_name,
+                                    const PType &p_type) {
+    const int size = getStorageSize(p_type);
+    const int align = p_type.isString() ? 8 : 4;
+    m_frame_size = (m_frame_size + size + align - 1) / align * align;
+    m_local_offsets[p_name].push(m_frame_size);
+    return m_frame_size;
+}
+
+void X86CodeGenerator::popScope(const SymbolTable *p_table) {
+    if (p_table == nullptr) {
+        return;
+    }
+    for (const auto &entry : p_table->getEntries()) {
+        auto it = m_local_offsets.find(entry->getName());
+        if (it == m_local_offsets.end()) {
+            continue;
+        }
+        it->second.pop();
+        if (it->second.empty()) {
+            m_local_offsets.erase(it);
+        }
+    }
+}
+
+int X86CodeGenerator::getStringLabel(const std::string &p_string) {
+    auto it = m_string_labels.find(p_string);
+    if (it == m_string_labels.end()) {
+        const int id = static_cast<int>(m_string_labels.size());
+        it = m_string_labels.emplace(p_string, id).first;
+    }
+    return it->second;
+}
+
+void X86CodeGenerator::pushConstant(const Constant &p_constant) {
+    const PType *type = p_constant.getTypePtr();
+    if (type->isString()) {
+        constexpr const char *const x86_string_expr =
+            "    leaq .LC%d(%%rip), %%rax\n"
+            "    pushq %%rax\n";
+        dumpInstructions(m_asm, x86_string_expr,
+                         getStringLabel(p_constant.getConstantValueCString()));
+        return;
+    }
+
+    int32_t value;
+    if (type->isReal()) {
+        const float real = static_cast<float>(p_constant.real());
+        std::memcpy(&value, &real, sizeof(value));
+    } else if (type->isBool()) {
+        value = (std::strcmp(p_constant.getConstantValueCString(), "true") == 0);
+    } else {
+        value = static_cast<int32_t>(p_constant.integer());
+    }
+    constexpr const char *const x86_const_expr =
+        "    movl $%d, %%eax       # %s\n"
+        "    pushq %%rax\n";
+    dumpInstructions(m_asm, x86_const_expr, value,
+                     p_constant.getConstantValueCString());
+}
+
+void X86CodeGenerator::evaluate(const ExpressionNode &p_expr,
+                                const bool p_as_real) {
+    ++m_expression_depth;
+    const_cast<ExpressionNode &>(p_expr).accept(*this);
+    --m_expression_depth;
+
+    if (p_as_real && p_expr.getInferredType()->isInteger()) {
+        constexpr const char *const x86_int_to_real =
+            "    popq %%rax\n"
+            "    cvtsi2ssl %%eax, %%xmm0\n"
+            "    movd %%xmm0, %%eax\n"
+            "    pushq %%rax\n";
+        dumpInstructions(m_asm, x86_int_to_real);
+    }
+}
+
+void X86CodeGenerator::evaluateAddress(const VariableReferenceNode &p_variable_ref) {
+    const SymbolEntry *entry = m_symbol_manager_ptr->lookup(p_variable_ref.getName());
+    if (entry == nullptr) {
+        return;
+    }
+
+    const auto &indices = p_variable_ref.getIndices();
+    if (!indices.empty()) {
+        for (const auto &index : indices) {
+            evaluate(*index);
+        }
+
+        // row-major, with indices from 1 as in CodeGenerator
+        const auto &dimensions = entry->getTypePtr()->getDimensions();
+        dumpInstructions(m_asm, "    xorl %%ecx, %%ecx\n");
+        int stride = 1;
+        for (std::size_t i = dimensions.size(); i-- > 0;) {
+            if (i < indices.size()) {
+                constexpr const char *const x86_index_expr =
+                    "    popq %%rax\n"
+                    "    movslq %%eax, %%rax\n"
+                    "    decq %%rax\n"
+                    "    imulq $%d, %%rax, %%rax\n"
+                    "    addq %%rax, %%rcx\n";
+                dumpInstructions(m_asm, x86_index_expr, stride);
+            }
+            stride *= static_cast<int>(dimensions[i]);
+        }
+    }
+
+    if (entry->getLevel() == 0) {
+        dumpInstructions(m_asm, "    leaq %s(%%rip), %%rax\n",
+                         entry->getNameCString());
+    } else {
+        dumpInstructions(m_asm, "    leaq -%d(%%rbp), %%rax\n",
+                         m_local_offsets[entry->getName()].top());
+    }
+    if (!indices.empty()) {
+        dumpInstructions(m_asm, "    leaq (%%rax,%%rcx,4), %%rax\n");
+    }
+    dumpInstructions(m_asm, "    pushq %%rax          # push the address of %s\n",
+                     entry->getNameCString());
+}
+
+// the expression stack leaves %rsp unaligned, %rbx remembers it
+void X86CodeGenerator::emitCall(const char *p_name) {
+    constexpr const char *const x86_call_expr =
+        "    movq %%rsp, %%rbx\n"
+        "    andq $-16, %%rsp\n"
+        "    call %s@PLT\n"
+        "    movq %%rbx, %%rsp\n";
+    dumpInstructions(m_asm, x86_call_expr, p_name);
+}
+
+void X86CodeGenerator::emitFunctionPrologue(const char *p_name) {
+    ++m_function_id;
+    m_frame_size = 8;
+    m_return_label = m_label++;
+    constexpr const char *const x86_function_prologue =
+        "    .text\n"
+        "    .globl %s\n"
+        "    .type %s, @function\n"
+        "%s:\n"
+        "    pushq %%rbp\n"
+        "    movq %%rsp, %%rbp\n"
+        "    pushq %%rbx\n"
+        "    subq $.Lframe%d, %%rsp\n";
+    dumpInstructions(m_asm, x86_function_prologue, p_name, p_name, p_name,
+                     m_function_id);
+}
+
+void X86CodeGenerator::emitFunctionEpilogue(const char *p_name) {
+    // keep %rsp 16-byte aligned inside the function
+    const int frame = (m_frame_size + 15) / 16 * 16 - 8;
+    constexpr const char *const x86_function_epilogue =
+        ".L%d:\n"
+        "    movq -8(%%rbp), %%rbx\n"
+        "    leave\n"
+        "    ret\n"
+        "    .size %s, .-%s\n"
+        "    .set .Lframe%d, %d\n\n";
+    dumpInstructions(m_asm, x86_function_epilogue, m_return_label, p_name,
+                     p_name, m_function_id, frame);
+}
+
+void X86CodeGenerator::visit(ProgramNode &p_program) {
+    dumpInstructions(m_asm, "    .file \"%s\"\n\n", m_source_file_path.c_str());
+
+    m_symbol_manager_ptr->reconstructHashTableFromSymbolTable(
+        p_program.getSymbolTable());
+
+    for (const auto &decl : p_program.getDeclNodes()) {
+        decl->accept(*this);
+    }
+    for (const auto &func : p_program.getFuncNodes()) {
+        func->accept(*this);
+    }
+
+    m_return_type_ptr = nullptr;
+    emitFunctionPrologue("main");
+    const_cast<CompoundStatementNode &>(p_program.getBody()).accept(*this);
+    dumpInstructions(m_asm, "    xorl %%eax, %%eax\n");
+    emitFunctionEpilogue("main");
+
+    m_symbol_manager_ptr->removeSymbolsFromHashTable(p_program.getSymbolTable());
+
+    if (!m_string_labels.empty()) {
+        dumpInstructions(m_asm, "    .section .rodata\n");
+        for (const auto &string : m_string_labels) {
+            dumpInstructions(m_asm, ".LC%d:\n    .string \"%s\"\n",
+                             string.second, string.first.c_str());
+        }
+    }
+    dumpInstructions(m_asm, "    .section .note.GNU-stack,\"\",@progbits\n");
+
+    m_asm.write(m_output_file.get());
+}
+
+void X86CodeGenerator::visit(DeclNode &p_decl) {
+    p_decl.visitChildNodes(*this);
+}
+
+void X86CodeGenerator::visit(VariableNode &p_variable) {
+    const SymbolEntry *entry = m_symbol_manager_ptr->lookup(p_variable.getName());
+    if (entry == nullptr) {
+        return;
+    }
+
+    // constants are folded into their references
+    if (entry->getKind() == SymbolEntry::KindEnum::kConstantKind) {
+        return;
+    }
+
+    const PType &type = *p_variable.getTypePtr();
+    const char *name = p_variable.getNameCString();
+    if (entry->getLevel() == 0) {
+        const int size = getStorageSize(type);
+        constexpr const char *const x86_global_variable_expr =
+            "# global variable declaration: %s\n"
+            "    .bss\n"
+            "    .align %d\n"
+            "    .globl %s\n"
+            "    .type %s, @object\n"
+            "    .size %s, %d\n"
+            "%s:\n"
+            "    .zero %d\n\n";
+        dumpInstructions(m_asm, x86_global_variable_expr, name,
+                         type.isString() ? 8 : 4, name, name, name, size,
+                         name, size);
+        return;
+    }
+
+    const int offset = allocateLocal(p_variable.getName(), type);
+    if (entry->getKind() != SymbolEntry::KindEnum::kParameterKind) {
+        return;
+    }
+
+    assert(m_parameter_index < m_parameter_locations.size());
+    const ArgumentLocation &location = m_parameter_locations[m_parameter_index++];
+    const bool wide = !type.isScalar() || type.isString();
+    std::string source;
+    if (location.reg < 0) {
+        source = std::to_string(16 + location.stack_offset) + "(%rbp)";
+    } else if (location.sse) {
+        source = "%xmm" + std::to_string(location.reg);
+    } else {
+        source = std::string("%") + (wide ? kIntRegisters64 : kIntRegisters32)[location.reg];
+    }
+
+    if (type.isScalar()) {
+        const char *op = location.sse && location.reg >= 0 ? "movss" : wide ? "movq" : "movl";
+        if (location.reg < 0) {
+            constexpr const char *const x86_stack_parameter_expr =
+                "    %s %s, %%%s\n"
+                "    %s %%%s, -%d(%%rbp)    # save parameter %s in the local stack\n";
+            const char *scratch = wide ? "rax" : "eax";
+            dumpInstructions(m_asm, x86_stack_parameter_expr, op, source.c_str(),
+                             scratch, op, scratch, offset, name);
+        } else {
+            dumpInstructions(m_asm,
+                             "    %s %s, -%d(%%rbp)    # save parameter %s in the local stack\n",
+                             op, source.c_str(), offset, name);
+        }
+        return;
+    }
+
+    // arrays are passed by value: copy the caller's array into the frame,
+    // using only registers that cannot hold another argument
+    const int label = m_label++;
+    constexpr const char *const x86_array_parameter_expr =
+        "    movq %s, %%rax        # copy parameter %s into the local stack\n"
+        "    xorl %%r10d, %%r10d\n"
+        ".L%d:\n"
+        "    movl (%%rax,%%r10,4), %%r11d\n"
+        "    movl %%r11d, -%d(%%rbp,%%r10,4)\n"
+        "    addq $1, %%r10\n"
+        "    cmpq $%d, %%r10\n"
+        "    jb .L%d\n";
+    dumpInstructions(m_asm, x86_array_parameter_expr, source.c_str(), name, label,
+                     offset, getElementCount(type), label);
+}
+
+void X86CodeGenerator::visit(ConstantValueNode &p_constant_value) {
+    pushConstant(*p_constant_value.getConstantPtr());
+}
+
+void X86CodeGenerator::visit(FunctionNode &p_function) {
+    m_symbol_manager_ptr->reconstructHashTableFromSymbolTable(
+        p_function.getSymbolTable());
+
+    std::vector<const PType *> parameter_types;
+    for (const auto &decl : p_function.getParameters()) {
+        for (const auto &var : decl->getVariables()) {
+            parameter_types.push_back(var->getTypePtr());
+        }
+    }
+    int stack_size;
+    m_parameter_locations = classifyArguments(parameter_types, stack_size);
+    m_parameter_index = 0;
+    m_return_type_ptr = p_function.getTypePtr();
+
+    emitFunctionPrologue(p_function.getNameCString());
+    p_function.visitChildNodes(*this);
+    emitFunctionEpilogue(p_function.getNameCString());
+
+    m_return_type_ptr = nullptr;
+    popScope(p_function.getSymbolTable());
+    m_symbol_manager_ptr->removeSymbolsFromHashTable(p_function.getSymbolTable());
+}
+
+void X86CodeGenerator::visit(CompoundStatementNode &p_compound_statement) {
+    m_symbol_manager_ptr->reconstructHashTableFromSymbolTable(
+        p_compound_statement.getSymbolTable());
+
+    p_compound_statement.visitChildNodes(*this);
+
+    popScope(p_compound_statement.getSymbolTable());
+    m_symbol_manager_ptr->removeSymbolsFromHashTable(
+        p_compound_statement.getSymbolTable());
+}
+
+void X86CodeGenerator::visit(PrintNode &p_print) {
+    dumpInstructions(m_asm, "\n# print\n");
+    evaluate(p_print.getTarget());
+
+    const PType *type = p_print.getTarget().getInferredType();
+    if (type->isString()) {
+        dumpInstructions(m_asm, "    popq %%rdi\n");
+        emitCall("printString");
+    } else if (type->isReal()) {
+        dumpInstructions(m_asm, "    popq %%rax\n    movd %%eax, %%xmm0\n");
+        emitCall("printReal");
+    } else {
+        dumpInstructions(m_asm, "    popq %%rdi\n");
+        emitCall("printInt");
+    }
+}
+
+void X86CodeGenerator::visit(BinaryOperatorNode &p_bin_op) {
+    dumpInstructions(m_asm, "\n# binary operator: %s\n", p_bin_op.getOpCString());
+
+    const bool real_operands =
+        p_bin_op.getLeftOperand().getInferredType()->isReal() ||
+        p_bin_op.getRightOperand().getInferredType()->isReal();
+    evaluate(p_bin_op.getLeftOperand(), real_operands);
+    evaluate(p_bin_op.getRightOperand(), real_operands);
+    dumpInstructions(m_asm, "    popq %%rcx\n    popq %%rax\n");
+    if (real_operands) {
+        dumpInstructions(m_asm, "    movd %%eax, %%xmm0\n    movd %%ecx, %%xmm1\n");
+    }
+
+    const char *setcc = nullptr;
+    switch (p_bin_op.getOp()) {
+    case Operator::kPlusOp:
+    case Operator::kMinusOp:
+    case Operator::kMultiplyOp:
+    case Operator::kDivideOp:
+        if (real_operands) {
+            static const char *const kRealOps[] = {"mulss", "divss", "", "addss", "subss"};
+            dumpInstructions(
+                m_asm, "    %s %%xmm1, %%xmm0\n    movd %%xmm0, %%eax\n",
+                kRealOps[static_cast<int>(p_bin_op.getOp()) -
+                         static_cast<int>(Operator::kMultiplyOp)]);
+        } else if (p_bin_op.getOp() == Operator::kPlusOp) {
+            dumpInstructions(m_asm, "    addl %%ecx, %%eax\n");
+        } else if (p_bin_op.getOp() == Operator::kMinusOp) {
+            dumpInstructions(m_asm, "    subl %%ecx, %%eax\n");
+        } else if (p_bin_op.getOp() == Operator::kMultiplyOp) {
+            dumpInstructions(m_asm, "    imull %%ecx, %%eax\n");
+        } else {
+            dumpInstructions(m_asm, "    cltd\n    idivl %%ecx\n");
+        }
+        break;
+    case Operator::kModOp:
+        dumpInstructions(m_asm, "    cltd\n    idivl %%ecx\n    movl %%edx, %%eax\n");
+        break;
+    case Operator::kAndOp:
+        dumpInstructions(m_asm, "    andl %%ecx, %%eax\n");
+        break;
+    case Operator::kOrOp:
+        dumpInstructions(m_asm, "    orl %%ecx, %%eax\n");
+        break;
+    // ucomiss sets the flags like an unsigned comparison
+    case Operator::kLessOp:
+        setcc = real_operands ? "setb" : "setl";
+        break;
+    case Operator::kLessOrEqualOp:
+        setcc = real_operands ? "setbe" : "setle";
+        break;
+    case Operator::kGreaterOp:
+        setcc = real_operands ? "seta" : "setg";
+        break;
+    case Operator::kGreaterOrEqualOp:
+        setcc = real_operands ? "setae" : "setge";
+        break;
+    case Operator::kEqualOp:
+        setcc = "sete";
+        break;
+    case Operator::kNotEqualOp:
+        setcc = "setne";
+        break;
+    default:
+        assert(false && "unexpected binary operator");
+    }
+
+    if (setcc != nullptr) {
+        constexpr const char *const x86_compare_expr =
+            "    %s\n"
+            "    %s %%al\n"
+            "    movzbl %%al, %%eax\n";
+        dumpInstructions(m_asm, x86_compare_expr,
+                         real_operands ? "ucomiss %xmm1, %xmm0" : "cmpl %ecx, %eax",
+                         setcc);
+    }
+    dumpInstructions(m_asm, "    pushq %%rax\n");
+}
+
+void X86CodeGenerator::visit(UnaryOperatorNode &p_un_op) {
+    dumpInstructions(m_asm, "\n# unary operator: %s\n", p_un_op.getOpCString());
+    evaluate(p_un_op.getOperand());
+    dumpInstructions(m_asm, "    popq %%rax\n");
+    if (p_un_op.getOp() == Operator::kNotOp) {
+        dumpInstructions(m_asm, "    testl %%eax, %%eax\n    sete %%al\n    movzbl %%al, %%eax\n");
+    } else if (p_un_op.getInferredType()->isReal()) {
+        dumpInstructions(m_asm, "    xorl $0x80000000, %%eax    # flip the sign bit\n");
+    } else {
+        dumpInstructions(m_asm, "    negl %%eax\n");
+    }
+    dumpInstructions(m_asm, "    pushq %%rax\n");
+}
+
+void X86CodeGenerator::visit(FunctionInvocationNode &p_func_invocation) {
+    const bool discard_result = (m_expression_depth == 0);
+    dumpInstructions(m_asm, "\n# function invocation: %s\n",
+                     p_func_invocation.getNameCString());
+
+    std::vector<const PType *> parameter_types;
+    const SymbolEntry *entry = m_symbol_manager_ptr->lookup(p_func_invocation.getName());
+    if (entry != nullptr && entry->getKind() == SymbolEntry::KindEnum::kFunctionKind) {
+        for (const auto &decl : *entry->getAttribute().parameters()) {
+            for (const auto &var : decl->getVariables()) {
+                parameter_types.push_back(var->getTypePtr());
+            }
+        }
+    }
+    const auto &arguments = p_func_invocation.getArguments();
+    if (parameter_types.size() != arguments.size()) {
+        parameter_types.clear();
+        for (const auto &argument : arguments) {
+            parameter_types.push_back(argument->getInferredType());
+        }
+    }
+
+    for (std::size_t i = 0; i < arguments.size(); ++i) {
+        evaluate(*arguments[i], parameter_types[i]->isReal());
+    }
+
+    // argument i is at (n - 1 - i) * 8(%rbx)
+    int stack_size;
+    const auto locations = classifyArguments(parameter_types, stack_size);
+    const int count = static_cast<int>(arguments.size());
+    dumpInstructions(m_asm, "    movq %%rsp, %%rbx\n    andq $-16, %%rsp\n");
+    if (stack_size % 16 != 0) {
+        dumpInstructions(m_asm, "    subq $8, %%rsp\n");
+    }
+    for (int i = count - 1; i >= 0; --i) {
+        if (locations[i].reg < 0) {
+            dumpInstructions(m_asm, "    pushq %d(%%rbx)\n", (count - 1 - i) * 8);
+        }
+    }
+    for (int i = 0; i < count; ++i) {
+        if (locations[i].reg < 0) {
+            continue;
+        }
+        if (locations[i].sse) {
+            dumpInstructions(m_asm, "    movss %d(%%rbx), %%xmm%d\n",
+                             (count - 1 - i) * 8, locations[i].reg);
+        } else {
+            dumpInstructions(m_asm, "    movq %d(%%rbx), %%%s\n",
+                             (count - 1 - i) * 8, kIntRegisters64[locations[i].reg]);
+        }
+    }
+
+    constexpr const char *const x86_function_call =
+        "    call %s\n"
+        "    leaq %d(%%rbx), %%rsp    # drop the arguments\n";
+    dumpInstructions(m_asm, x86_function_call, p_func_invocation.getNameCString(),
+                     count * 8);
+    if (discard_result) {
+        return;
+    }
+    if (p_func_invocation.getInferredType()->isReal()) {
+        dumpInstructions(m_asm, "    movd %%xmm0, %%eax\n");
+    }
+    dumpInstructions(m_asm, "    pushq %%rax\n");
+}
+
+void X86CodeGenerator::visit(VariableReferenceNode &p_variable_ref) {
+    const SymbolEntry *entry = m_symbol_manager_ptr->lookup(p_variable_ref.getName());
+    if (entry == nullptr) {
+        return;
+    }
+
+    if (entry->getKind() == SymbolEntry::KindEnum::kConstantKind) {
+        pushConstant(*entry->getAttribute().constant());
+        return;
+    }
+
+    // a whole (sub)array is an argument, its address is passed
+    const PType *type = p_variable_ref.getInferredType();
+    if (!type->isScalar()) {
+        evaluateAddress(p_variable_ref);
+        return;
+    }
+
+    const char *load = type->isString() ? "movq" : "movl";
+    const char *reg = type->isString() ? "rax" : "eax";
+    if (p_variable_ref.getIndices().empty()) {
+        if (entry->getLevel() == 0) {
+            dumpInstructions(m_asm, "    %s %s(%%rip), %%%s\n", load,
+                             entry->getNameCString(), reg);
+        } else {
+            dumpInstructions(m_asm, "    %s -%d(%%rbp), %%%s    # load the value of %s\n",
+                             load, m_local_offsets[entry->getName()].top(), reg,
+                             entry->getNameCString());
+        }
+    } else {
+        evaluateAddress(p_variable_ref);
+        dumpInstructions(m_asm, "    popq %%rax\n    %s (%%rax), %%%s\n", load, reg);
+    }
+    dumpInstructions(m_asm, "    pushq %%rax\n");
+}
+
+void X86CodeGenerator::visit(AssignmentNode &p_assignment) {
+    const VariableReferenceNode &lvalue = p_assignment.getLvalue();
+    dumpInstructions(m_asm, "\n# variable assignment: %s\n", lvalue.getNameCString());
+
+    evaluateAddress(lvalue);
+    evaluate(p_assignment.getExpr(), lvalue.getInferredType()->isReal());
+    constexpr const char *const x86_assign_expr =
+        "    popq %%rax\n"
+        "    popq %%rcx\n"
+        "    %s %%%s, (%%rcx)     # save the value to %s\n";
+    const bool wide = lvalue.getInferredType()->isString();
+    dumpInstructions(m_asm, x86_assign_expr, wide ? "movq" : "movl",
+                     wide ? "rax" : "eax", lvalue.getNameCString());
+}
+
+void X86CodeGenerator::visit(ReadNode &p_read) {
+    dumpInstructions(m_asm, "\n# read\n");
+    evaluateAddress(p_read.getTarget());
+    if (p_read.getTarget().getInferredType()->isReal()) {
+        emitCall("readReal");
+        dumpInstructions(m_asm, "    movd %%xmm0, %%eax\n");
+    } else {
+        emitCall("readInt");
+    }
+    dumpInstructions(m_asm, "    popq %%rcx\n    movl %%eax, (%%rcx)     # save the value to %s\n",
+                     p_read.getTarget().getNameCString());
+}
+
+void X86CodeGenerator::visit(IfNode &p_if) {
+    const int else_label = m_label++;
+    const int end_label = m_label++;
+
+    dumpInstructions(m_asm, "\n# if\n");
+    evaluate(p_if.getCondition());
+    dumpInstructions(m_asm, "    popq %%rax\n    testl %%eax, %%eax\n    je .L%d\n",
+                     else_label);
+    p_if.getBody().accept(*this);
+    dumpInstructions(m_asm, "    jmp .L%d\n.L%d:\n", end_label, else_label);
+    if (p_if.getElseBody() != nullptr) {
+        p_if.getElseBody()->accept(*this);
+    }
+    dumpInstructions(m_asm, ".L%d:\n", end_label);
+}
+
+void X86CodeGenerator::visit(WhileNode &p_while) {
+    const int condition_label = m_label++;
+    const int end_label = m_label++;
+
+    dumpInstructions(m_asm, "\n# while\n.L%d:\n", condition_label);
+    evaluate(p_while.getCondition());
+    dumpInstructions(m_asm, "    popq %%rax\n    testl %%eax, %%eax\n    je .L%d\n",
+                     end_label);
+    p_while.getBody().accept(*this);
+    dumpInstructions(m_asm, "    jmp .L%d\n.L%d:\n", condition_label, end_label);
+}
+
+void X86CodeGenerator::visit(ForNode &p_for) {
+    m_symbol_manager_ptr->reconstructHashTableFromSymbolTable(
+        p_for.getSymbolTable());
+
+    const int condition_label = m_label++;
+    const int end_label = m_label++;
+
+    p_for.getLoopVarDecl().accept(*this);
+    const_cast<AssignmentNode *>(p_for.getInitialStatement())->accept(*this);
+
+    // the upper bound is exclusive, as in CodeGenerator
+    const auto &loop_var = p_for.getInitialStatement()->getLvalue();
+    const int offset = m_local_offsets[loop_var.getName()].top();
+    constexpr const char *const x86_for_condition =
+        ".L%d:\n"
+        "    cmpl $%d, -%d(%%rbp)\n"
+        "    jge .L%d\n";
+    dumpInstructions(m_asm, x86_for_condition, condition_label,
+                     static_cast<int32_t>(p_for.getUpperBound().getConstantPtr()->integer()),
+                     offset, end_label);
+    p_for.getBody().accept(*this);
+    constexpr const char *const x86_for_step =
+        "    addl $1, -%d(%%rbp)     # increment %s\n"
+        "    jmp .L%d\n"
+        ".L%d:\n";
+    dumpInstructions(m_asm, x86_for_step, offset, loop_var.getNameCString(),
+                     condition_label, end_label);
+
+    popScope(p_for.getSymbolTable());
+    m_symbol_manager_ptr->removeSymbolsFromHashTable(p_for.getSymbolTable());
+}
+
+void X86CodeGenerator::visit(ReturnNode &p_return) {
+    dumpInstructions(m_asm, "\n# return\n");
+    const bool real = m_return_type_ptr != nullptr && m_return_type_ptr->isReal();
+    evaluate(p_return.getReturnValue(), real);
+    dumpInstructions(m_asm, "    popq %%rax\n");
+    if (real) {
+        dumpInstructions(m_asm, "    movd %%eax, %%xmm0\n");
+    }
+    dumpInstructions(m_asm, "    jmp .L%d\n", m_return_label);
+}
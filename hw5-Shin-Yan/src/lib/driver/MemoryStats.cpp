@@ -0,0 +1,90 @@
+#include "driver/MemoryStats.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace {
+
+// zero-initialized before any dynamic initialization allocates
+MemorySnapshot g_heap;
+MemoryCounters g_counters[static_cast<std::size_t>(MemoryCategory::kNumCategories)];
+
+uint64_t getResidentKilobytes() {
+    FILE *statm = std::fopen("/proc/self/statm", "r");
+    if (statm == nullptr) {
+        return 0;
+    }
+    unsigned long size = 0;
+    unsigned long resident = 0;
+    const int fields = std::fscanf(statm, "%lu %lu", &size, &resident);
+    std::fclose(statm);
+    return fields == 2 ? resident * (sysconf(_SC_PAGESIZE) / 1024) : 0;
+}
+
+} // namespace
+
+void *operator new(std::size_t p_size) {
+    ++g_heap.allocations;
+    g_heap.allocated_bytes += p_size;
+    if (void *ptr = std::malloc(p_size == 0 ? 1 : p_size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p_ptr) noexcept {
+    if (p_ptr != nullptr) {
+        ++g_heap.frees;
+    }
+    std::free(p_ptr);
+}
+
+void operator delete(void *p_ptr, std::size_t) noexcept { operator delete(p_ptr); }
+
+void MemoryStats::add(const MemoryCategory p_category, const std::size_t p_bytes) {
+    MemoryCounters &counters = g_counters[static_cast<std::size_t>(p_category)];
+    ++counters.created;
+    ++counters.live;
+    counters.peak_live = std::max(counters.peak_live, counters.live);
+    counters.bytes += p_bytes;
+    counters.live_bytes += p_bytes;
+}
+
+void MemoryStats::remove(const MemoryCategory p_category, const std::size_t p_bytes) {
+    MemoryCounters &counters = g_counters[static_cast<std::size_t>(p_category)];
+    --counters.live;
+    counters.live_bytes -= p_bytes;
+}
+
+const MemoryCounters &MemoryStats::getCounters(const MemoryCategory p_category) {
+    return g_counters[static_cast<std::size_t>(p_category)];
+}
+
+const char *MemoryStats::getCategoryName(const MemoryCategory p_category) {
+    switch (p_category) {
+    case MemoryCategory::kAstNode:
+        return "AST nodes";
+    case MemoryCategory::kPType:
+        return "PType";
+    case MemoryCategory::kSymbol:
+        return "symbol entries/tables";
+    case MemoryCategory::kNumCategories:
+        break;
+    }
+    return "";
+}
+
+MemorySnapshot MemoryStats::snapshot() {
+    MemorySnapshot snapshot = g_heap;
+    snapshot.rss_kb = getResidentKilobytes();
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        // kilobytes on Linux
+        snapshot.peak_rss_kb = static_cast<uint64_t>(usage.ru_maxrss);
+    }
+    return snapshot;
+}
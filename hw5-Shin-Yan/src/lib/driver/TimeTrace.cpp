@@ -0,0 +1,186 @@
+#include "driver/TimeTrace.hpp"
+
+#include <cassert>
+#include <cinttypes>
+#include <memory>
+
+namespace {
+
+std::string escapeJson(const std::string &p_text) {
+    std::string escaped;
+    for (const char c : p_text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buffer[8];
+            std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+            escaped += buffer;
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+std::string getLabel(const TimeTracer::Span &p_span) {
+    return p_span.detail.empty() ? p_span.name : p_span.name + " " + p_span.detail;
+}
+
+double toMilliseconds(const uint64_t p_microseconds) {
+    return p_microseconds / 1000.0;
+}
+
+} // namespace
+
+TimeTracer &TimeTracer::get() {
+    static TimeTracer tracer;
+    return tracer;
+}
+
+void TimeTracer::enable() {
+    if (!m_enabled) {
+        m_enabled = true;
+        m_origin = std::chrono::steady_clock::now();
+    }
+}
+
+void TimeTracer::enableMemory() {
+    enable();
+    m_memory = true;
+}
+
+uint64_t TimeTracer::now() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - m_origin)
+        .count();
+}
+
+void TimeTracer::begin(const char *p_name, const std::string &p_detail) {
+    Span span;
+    span.name = p_name;
+    span.detail = p_detail;
+    span.depth = m_open.size();
+    span.start = now();
+    m_open.push_back(m_spans.size());
+    m_open_cpu.push_back(std::clock());
+    if (m_memory) {
+        m_open_memory.push_back(MemoryStats::snapshot());
+    }
+    m_spans.push_back(std::move(span));
+}
+
+void TimeTracer::end() {
+    assert(!m_open.empty() && "end() without begin()");
+    Span &span = m_spans[m_open.back()];
+    span.wall = now() - span.start;
+    span.cpu = static_cast<uint64_t>(std::clock() - m_open_cpu.back()) * 1000000 /
+               CLOCKS_PER_SEC;
+    if (m_memory) {
+        const MemorySnapshot memory = MemoryStats::snapshot();
+        span.allocations = memory.allocations - m_open_memory.back().allocations;
+        span.allocated_bytes = memory.allocated_bytes - m_open_memory.back().allocated_bytes;
+        span.rss_kb = memory.rss_kb;
+        span.peak_rss_kb = memory.peak_rss_kb;
+        m_open_memory.pop_back();
+    }
+    m_open.pop_back();
+    m_open_cpu.pop_back();
+}
+
+void TimeTracer::dumpReport(FILE *p_out_file, const std::string &p_source) const {
+    std::fprintf(p_out_file,
+                 "\n"
+                 "|---------------------------------------------------|\n"
+                 "|  Time report                                      |\n"
+                 "|---------------------------------------------------|\n"
+                 "  %s\n"
+                 "  %-36s %10s %10s %7s\n",
+                 p_source.c_str(), "phase", "wall ms", "cpu ms", "wall");
+
+    uint64_t total_wall = 0;
+    uint64_t total_cpu = 0;
+    for (const auto &span : m_spans) {
+        if (span.depth == 0) {
+            total_wall += span.wall;
+            total_cpu += span.cpu;
+        }
+    }
+    for (const auto &span : m_spans) {
+        const std::string label = std::string(span.depth * 2, ' ') + getLabel(span);
+        const double share = total_wall == 0 ? 0.0 : 100.0 * span.wall / total_wall;
+        std::fprintf(p_out_file, "  %-36s %10.3f %10.3f %6.1f%%\n", label.c_str(),
+                     toMilliseconds(span.wall), toMilliseconds(span.cpu), share);
+    }
+    std::fprintf(p_out_file, "  %-36s %10.3f %10.3f\n", "total", toMilliseconds(total_wall),
+                 toMilliseconds(total_cpu));
+}
+
+void TimeTracer::dumpMemoryReport(FILE *p_out_file, const std::string &p_source) const {
+    std::fprintf(p_out_file,
+                 "\n"
+                 "|---------------------------------------------------|\n"
+                 "|  Memory report                                    |\n"
+                 "|---------------------------------------------------|\n"
+                 "  %s\n"
+                 "  %-36s %10s %10s %9s %9s\n",
+                 p_source.c_str(), "phase", "allocs", "KiB", "RSS MiB", "peak MiB");
+    for (const auto &span : m_spans) {
+        const std::string label = std::string(span.depth * 2, ' ') + getLabel(span);
+        std::fprintf(p_out_file, "  %-36s %10" PRIu64 " %10.1f %9.1f %9.1f\n", label.c_str(),
+                     span.allocations, span.allocated_bytes / 1024.0, span.rss_kb / 1024.0,
+                     span.peak_rss_kb / 1024.0);
+    }
+
+    const MemorySnapshot heap = MemoryStats::snapshot();
+    std::fprintf(p_out_file,
+                 "  heap: %" PRIu64 " allocations, %.1f KiB, %" PRIu64 " frees\n"
+                 "  %-24s %10s %10s %10s %10s %10s\n",
+                 heap.allocations, heap.allocated_bytes / 1024.0, heap.frees, "objects",
+                 "created", "KiB", "live", "live KiB", "peak live");
+    uint64_t objects = 0;
+    uint64_t object_bytes = 0;
+    for (std::size_t i = 0; i < static_cast<std::size_t>(MemoryCategory::kNumCategories); ++i) {
+        const auto category = static_cast<MemoryCategory>(i);
+        const MemoryCounters &counters = MemoryStats::getCounters(category);
+        std::fprintf(p_out_file,
+                     "  %-24s %10" PRIu64 " %10.1f %10" PRIu64 " %10.1f %10" PRIu64 "\n",
+                     MemoryStats::getCategoryName(category), counters.created,
+                     counters.bytes / 1024.0, counters.live, counters.live_bytes / 1024.0,
+                     counters.peak_live);
+        objects += counters.created;
+        object_bytes += counters.bytes;
+    }
+    // PTypes and symbols made on the stack are counted as objects too
+    std::fprintf(p_out_file, "  %-24s %10" PRIu64 " %10.1f\n", "strings, vectors, other",
+                 heap.allocations > objects ? heap.allocations - objects : 0,
+                 heap.allocated_bytes > object_bytes
+                     ? (heap.allocated_bytes - object_bytes) / 1024.0
+                     : 0.0);
+}
+
+bool TimeTracer::writeChromeTrace(const std::string &p_path, std::string &p_error) const {
+    std::unique_ptr<FILE, decltype(&fclose)> file(fopen(p_path.c_str(), "w"), &fclose);
+    if (!file) {
+        p_error = "cannot open " + p_path;
+        return false;
+    }
+
+    std::fprintf(file.get(), "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    std::fprintf(file.get(), "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,"
+                             "\"args\":{\"name\":\"compiler\"}}");
+    for (const auto &span : m_spans) {
+        std::fprintf(file.get(),
+                     ",\n{\"name\":\"%s\",\"cat\":\"compiler\",\"ph\":\"X\",\"pid\":1,"
+                     "\"tid\":1,\"ts\":%" PRIu64 ",\"dur\":%" PRIu64
+                     ",\"args\":{\"detail\":\"%s\",\"cpu_us\":%" PRIu64 "}}",
+                     escapeJson(getLabel(span)).c_str(), span.start, span.wall,
+                     escapeJson(span.detail).c_str(), span.cpu);
+    }
+    std::fprintf(file.get(), "\n]}\n");
+    if (std::ferror(file.get())) {
+        p_error = "cannot write " + p_path;
+        return false;
+    }
+    return true;
+}
@@ -1,5 +1,6 @@
 #include "sema/SemanticAnalyzer.hpp"
 #include "sema/error.hpp"
+#include "driver/TimeTrace.hpp"
 #include "visitor/AstNodeInclude.hpp"
 
 #include <algorithm>
@@ -103,6 +104,7 @@ void SemanticAnalyzer::visit(ConstantValueNode &p_constant_value) {
 }
 
 void SemanticAnalyzer::visit(FunctionNode &p_function) {
+    TimeScope scope("function", p_function.getName());
     auto success = m_symbol_manager.addSymbol(
         p_function.getName(), SymbolEntry::KindEnum::kFunctionKind,
         p_function.getTypePtr(), &p_function.getParameters());
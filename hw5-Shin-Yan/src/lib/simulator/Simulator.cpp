@@ -0,0 +1,1121 @@
+#include "simulator/Simulator.hpp"
+#include "codegen/RiscvIsa.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+namespace {
+
+enum Op : uint8_t {
+    kLui, kAuipc, kJal, kJalr,
+    kBeq, kBne, kBlt, kBge, kBltu, kBgeu,
+    kLb, kLh, kLw, kLbu, kLhu, kSb, kSh, kSw,
+    kAddi, kSlti, kSltiu, kXori, kOri, kAndi, kSlli, kSrli, kSrai,
+    kAdd, kSub, kSll, kSlt, kSltu, kXor, kSrl, kSra, kOr, kAnd,
+    kMul, kMulh, kMulhsu, kMulhu, kDiv, kDivu, kRem, kRemu,
+    kEcall, kEbreak, kRuntimeCall, kIllegal, kFloat,
+    kOpCount
+};
+
+enum class RuntimeId : uint8_t {
+    kExit,
+    kPrintInt, kReadInt, kPrintReal, kReadReal, kPrintString,
+    kPrintFixed, kReadFixed, kProfileInit, kBoundsCheckFailed,
+    kFloatSiSf, kAddSf3, kSubSf3, kMulSf3, kDivSf3,
+    kLtSf2, kLeSf2, kGtSf2, kGeSf2, kEqSf2, kNeSf2
+};
+
+// writes to x0 are redirected here so that x0 stays zero without a check
+constexpr uint8_t kSinkRegister = 32;
+constexpr uint32_t kCustom0 = 0x0b;
+constexpr uint32_t kNullGuard = 0x1000;
+constexpr uint32_t kStackSize = 1024 * 1024;
+constexpr uint32_t kArgumentArea = 4096;
+
+int32_t signExtend(const uint32_t p_value, const unsigned p_bits) {
+    const uint32_t shift = 32 - p_bits;
+    return static_cast<int32_t>(p_value << shift) >> shift;
+}
+
+float asFloat(const uint32_t p_bits) {
+    float value;
+    std::memcpy(&value, &p_bits, sizeof(value));
+    return value;
+}
+
+uint32_t asBits(const float p_value) {
+    uint32_t bits;
+    std::memcpy(&bits, &p_value, sizeof(bits));
+    return bits;
+}
+
+} // namespace
+
+struct Simulator::RuntimeFunction {
+    const char *name;
+    RuntimeId id;
+};
+
+struct Simulator::Instruction {
+    // label of the handler in run(), which decodes the slot on first use
+    const void *handler = nullptr;
+    uint8_t op = kIllegal;
+    uint8_t rd = kSinkRegister;
+    uint8_t rs1 = 0;
+    uint8_t rs2 = 0;
+    uint8_t size = 4;
+    ClassEnum klass = ClassEnum::kAlu;
+    uint8_t latency = 1;
+    uint8_t occupancy = 1;
+    int32_t imm = 0;
+};
+
+const Simulator::RuntimeFunction *
+Simulator::findRuntimeFunction(const std::string &p_name) {
+    static const RuntimeFunction kRuntimeFunctions[] = {
+        {"exit", RuntimeId::kExit},
+        {"printInt", RuntimeId::kPrintInt},
+        {"readInt", RuntimeId::kReadInt},
+        {"printReal", RuntimeId::kPrintReal},
+        {"readReal", RuntimeId::kReadReal},
+        {"printString", RuntimeId::kPrintString},
+        {"printFixed", RuntimeId::kPrintFixed},
+        {"readFixed", RuntimeId::kReadFixed},
+        {"profileInit", RuntimeId::kProfileInit},
+        {"boundsCheckFailed", RuntimeId::kBoundsCheckFailed},
+        {"__floatsisf", RuntimeId::kFloatSiSf},
+        {"__addsf3", RuntimeId::kAddSf3},
+        {"__subsf3", RuntimeId::kSubSf3},
+        {"__mulsf3", RuntimeId::kMulSf3},
+        {"__divsf3", RuntimeId::kDivSf3},
+        {"__ltsf2", RuntimeId::kLtSf2},
+        {"__lesf2", RuntimeId::kLeSf2},
+        {"__gtsf2", RuntimeId::kGtSf2},
+        {"__gesf2", RuntimeId::kGeSf2},
+        {"__eqsf2", RuntimeId::kEqSf2},
+        {"__nesf2", RuntimeId::kNeSf2}};
+
+    for (const auto &function : kRuntimeFunctions) {
+        if (p_name == function.name) {
+            return &function;
+        }
+    }
+    return nullptr;
+}
+
+uint64_t Simulator::Statistics::getInstructions() const {
+    uint64_t total = 0;
+    for (int i = 0; i < static_cast<int>(ClassEnum::kCount); ++i) {
+        if (i != static_cast<int>(ClassEnum::kRuntime)) {
+            total += counts[i];
+        }
+    }
+    return total;
+}
+
+Simulator::~Simulator() = default;
+
+Simulator::Simulator(const CoreModel &p_core) : m_core(p_core) {}
+
+bool Simulator::error(const std::string &p_message) {
+    if (m_error.empty()) {
+        m_error = p_message;
+    }
+    return false;
+}
+
+bool Simulator::load(const ObjectFile &p_object, const std::string &p_entry) {
+    m_memory.assign(kMemorySize, 0);
+    m_stubs.assign(1, findRuntimeFunction("exit"));
+    m_error.clear();
+
+    // every undefined symbol must be part of the built-in runtime
+    std::map<std::string, uint32_t> stub_index;
+    for (const auto &symbol : p_object.symbols) {
+        if (symbol.section >= 0 || symbol.name.empty() ||
+            symbol.type == ObjectFile::Symbol::TypeEnum::kFile ||
+            stub_index.count(symbol.name) != 0) {
+            continue;
+        }
+        const RuntimeFunction *function = findRuntimeFunction(symbol.name);
+        if (function == nullptr) {
+            return error("undefined reference to `" + symbol.name + "'");
+        }
+        stub_index[symbol.name] = static_cast<uint32_t>(m_stubs.size());
+        m_stubs.push_back(function);
+    }
+
+    // code first, followed by one stub instruction per runtime function,
+    // then the data sections
+    std::vector<uint32_t> section_addresses(p_object.sections.size(), 0);
+    uint32_t address = kTextBase;
+    const auto place = [&](const bool p_text) {
+        for (std::size_t i = 0; i < p_object.sections.size(); ++i) {
+            const auto &section = p_object.sections[i];
+            if ((section.kind == ObjectFile::SectionKind::kText) != p_text) {
+                continue;
+            }
+            const uint32_t align = std::max<uint32_t>(section.align, 1);
+            address = (address + align - 1) / align * align;
+            section_addresses[i] = address;
+            address += section.size;
+        }
+    };
+    place(true);
+    address = (address + 3) & ~3u;
+    m_exit_stub = address;
+    address += 4 * static_cast<uint32_t>(m_stubs.size());
+    m_text_end = address;
+    place(false);
+    if (address > kMemorySize - kStackSize) {
+        return error("program does not fit in the simulated memory");
+    }
+
+    for (std::size_t i = 0; i < p_object.sections.size(); ++i) {
+        const auto &section = p_object.sections[i];
+        if (!section.data.empty()) {
+            std::memcpy(&m_memory[section_addresses[i]], section.data.data(),
+                        section.data.size());
+        }
+    }
+    for (uint32_t i = 0; i < m_stubs.size(); ++i) {
+        const uint32_t stub = i << 20 | kCustom0;
+        std::memcpy(&m_memory[m_exit_stub + 4 * i], &stub, sizeof(stub));
+    }
+
+    std::vector<uint32_t> symbol_addresses(p_object.symbols.size(), 0);
+    m_entry = 0;
+    for (std::size_t i = 1; i < p_object.symbols.size(); ++i) {
+        const auto &symbol = p_object.symbols[i];
+        if (symbol.section >= 0) {
+            symbol_addresses[i] = section_addresses[symbol.section] + symbol.value;
+            if (symbol.name == p_entry && symbol.global) {
+                m_entry = symbol_addresses[i];
+            }
+        } else if (stub_index.count(symbol.name) != 0) {
+            symbol_addresses[i] = m_exit_stub + 4 * stub_index[symbol.name];
+        }
+    }
+    if (m_entry == 0) {
+        return error("no entry point `" + p_entry + "'");
+    }
+
+    if (!relocate(p_object, section_addresses, symbol_addresses)) {
+        return false;
+    }
+    m_code.assign((m_text_end - kTextBase) / 2, Instruction());
+
+    m_functions.clear();
+    for (std::size_t i = 1; i < p_object.symbols.size(); ++i) {
+        if (p_object.symbols[i].type == ObjectFile::Symbol::TypeEnum::kFunction &&
+            p_object.symbols[i].section >= 0) {
+            m_functions.emplace_back(symbol_addresses[i], p_object.symbols[i].name);
+        }
+    }
+    std::sort(m_functions.begin(), m_functions.end());
+    m_line_table.clear();
+    for (const auto &entry : p_object.lines) {
+        m_line_table.emplace_back(section_addresses[entry.section] + entry.offset, entry.line);
+    }
+    std::sort(m_line_table.begin(), m_line_table.end());
+    return true;
+}
+
+bool Simulator::relocate(const ObjectFile &p_object,
+                         const std::vector<uint32_t> &p_section_addresses,
+                         const std::vector<uint32_t> &p_symbol_addresses) {
+    const auto read32 = [this](const uint32_t p_addr) {
+        uint32_t value;
+        std::memcpy(&value, &m_memory[p_addr], sizeof(value));
+        return value;
+    };
+    const auto write32 = [this](const uint32_t p_addr, const uint32_t p_value) {
+        std::memcpy(&m_memory[p_addr], &p_value, sizeof(p_value));
+    };
+    const auto read16 = [this](const uint32_t p_addr) {
+        uint16_t value;
+        std::memcpy(&value, &m_memory[p_addr], sizeof(value));
+        return value;
+    };
+    const auto write16 = [this](const uint32_t p_addr, const uint16_t p_value) {
+        std::memcpy(&m_memory[p_addr], &p_value, sizeof(p_value));
+    };
+    const auto hi20 = [](const uint32_t p_value) {
+        return ((p_value + 0x800) >> 12) & 0xfffff;
+    };
+
+    for (std::size_t i = 0; i < p_object.sections.size(); ++i) {
+        const auto &section = p_object.sections[i];
+        const uint32_t base = p_section_addresses[i];
+
+        // %pcrel_lo refers to the address of its auipc, whose
+        // R_RISCV_PCREL_HI20 holds the actual offset
+        std::map<uint32_t, uint32_t> pcrel_offsets;
+        for (const auto &relocation : section.relocations) {
+            if (relocation.type == kRelocPcrelHi20) {
+                const uint32_t place = base + relocation.offset;
+                pcrel_offsets[place] = p_symbol_addresses[relocation.symbol] +
+                                       relocation.addend - place;
+            }
+        }
+
+        for (const auto &relocation : section.relocations) {
+            const uint32_t place = base + relocation.offset;
+            const uint32_t value =
+                p_symbol_addresses[relocation.symbol] + relocation.addend;
+            const auto offset = static_cast<int32_t>(value - place);
+            const std::string &name = p_object.symbols[relocation.symbol].name;
+            switch (relocation.type) {
+            case kReloc32:
+                write32(place, value);
+                break;
+            case kRelocHi20:
+                write32(place, (read32(place) & 0xfff) | hi20(value) << 12);
+                break;
+            case kRelocLo12I:
+                write32(place, (read32(place) & 0x000fffff) |
+                                   scatterIImmediate(value));
+                break;
+            case kRelocLo12S:
+                write32(place, (read32(place) & 0x01fff07f) |
+                                   scatterSImmediate(value));
+                break;
+            case kRelocPcrelHi20:
+                write32(place, (read32(place) & 0xfff) |
+                                   hi20(static_cast<uint32_t>(offset)) << 12);
+                break;
+            case kRelocPcrelLo12I:
+            case kRelocPcrelLo12S: {
+                const auto hi = pcrel_offsets.find(value);
+                if (hi == pcrel_offsets.end()) {
+                    return error("%pcrel_lo without a matching %pcrel_hi");
+                }
+                write32(place, (read32(place) & (relocation.type == kRelocPcrelLo12I
+                                                     ? 0x000fffff
+                                                     : 0x01fff07f)) |
+                                   (relocation.type == kRelocPcrelLo12I
+                                        ? scatterIImmediate(hi->second)
+                                        : scatterSImmediate(hi->second)));
+                break;
+            }
+            case kRelocCall:
+                write32(place, (read32(place) & 0xfff) |
+                                   hi20(static_cast<uint32_t>(offset)) << 12);
+                write32(place + 4, (read32(place + 4) & 0x000fffff) |
+                                       scatterIImmediate(offset));
+                break;
+            case kRelocBranch:
+                if (!fitsSigned(offset, 13)) {
+                    return error("branch to `" + name + "' out of range");
+                }
+                write32(place, (read32(place) & 0x01fff07f) |
+                                   scatterBImmediate(offset));
+                break;
+            case kRelocJal:
+                if (!fitsSigned(offset, 21)) {
+                    return error("jump to `" + name + "' out of range");
+                }
+                write32(place, (read32(place) & 0xfff) | scatterJImmediate(offset));
+                break;
+            case kRelocRvcBranch:
+                if (!fitsSigned(offset, 9)) {
+                    return error("branch to `" + name + "' out of range");
+                }
+                write16(place, static_cast<uint16_t>((read16(place) & 0xe383) |
+                                                     scatterCBImmediate(offset)));
+                break;
+            case kRelocRvcJump:
+                if (!fitsSigned(offset, 12)) {
+                    return error("jump to `" + name + "' out of range");
+                }
+                write16(place, static_cast<uint16_t>((read16(place) & 0xe003) |
+                                                     scatterCJImmediate(offset)));
+                break;
+            case kRelocRelax:
+            case kRelocAlign:
+                // nothing is relaxed, the padding stays in place as nops
+                break;
+            default:
+                return error("unsupported relocation type " +
+                             std::to_string(relocation.type));
+            }
+        }
+    }
+    return true;
+}
+
+bool Simulator::decode(const uint32_t p_pc, Instruction &p_inst) const {
+    p_inst = Instruction();
+    uint16_t half;
+    std::memcpy(&half, &m_memory[p_pc], sizeof(half));
+
+    uint8_t op = kIllegal;
+    uint32_t rd = 0, rs1 = 0, rs2 = 0;
+    int32_t imm = 0;
+
+    if ((half & 3) != 3) {
+        // RV32C, expanded to the equivalent base instruction
+        const uint32_t h = half;
+        const uint32_t funct3 = h >> 13;
+        const uint32_t rd_full = (h >> 7) & 31;
+        const uint32_t rs2_full = (h >> 2) & 31;
+        const uint32_t rd_prime = 8 + ((h >> 2) & 7);
+        const uint32_t rs1_prime = 8 + ((h >> 7) & 7);
+        const int32_t imm6 = signExtend(((h >> 7) & 0x20) | ((h >> 2) & 0x1f), 6);
+        p_inst.size = 2;
+
+        switch ((h & 3) << 3 | funct3) {
+        case 0x00: // c.addi4spn
+            imm = static_cast<int32_t>(((h >> 7) & 0x30) | ((h >> 1) & 0x3c0) |
+                                       ((h >> 4) & 0x4) | ((h >> 2) & 0x8));
+            if (imm != 0) {
+                op = kAddi, rd = rd_prime, rs1 = 2;
+            }
+            break;
+        case 0x02: // c.lw
+        case 0x06: // c.sw
+            imm = static_cast<int32_t>(((h >> 7) & 0x38) | ((h >> 4) & 0x4) |
+                                       ((h << 1) & 0x40));
+            rs1 = rs1_prime;
+            if (funct3 == 2) {
+                op = kLw, rd = rd_prime;
+            } else {
+                op = kSw, rs2 = rd_prime;
+            }
+            break;
+        case 0x08: // c.addi, c.nop
+            op = kAddi, rd = rd_full, rs1 = rd_full, imm = imm6;
+            break;
+        case 0x09: // c.jal
+        case 0x0d: // c.j
+            op = kJal, rd = (funct3 == 1) ? 1 : 0;
+            imm = signExtend(((h >> 1) & 0x800) | ((h >> 7) & 0x10) |
+                                 ((h >> 1) & 0x300) | ((h << 2) & 0x400) |
+                                 ((h >> 1) & 0x40) | ((h << 1) & 0x80) |
+                                 ((h >> 2) & 0xe) | ((h << 3) & 0x20),
+                             12);
+            break;
+        case 0x0a: // c.li
+            op = kAddi, rd = rd_full, rs1 = 0, imm = imm6;
+            break;
+        case 0x0b:
+            if (rd_full == 2) { // c.addi16sp
+                imm = signExtend(((h >> 3) & 0x200) | ((h >> 2) & 0x10) |
+                                     ((h << 1) & 0x40) | ((h << 4) & 0x180) |
+                                     ((h << 3) & 0x20),
+                                 10);
+                if (imm != 0) {
+                    op = kAddi, rd = 2, rs1 = 2;
+                }
+            } else if (imm6 != 0) { // c.lui
+                op = kLui, rd = rd_full;
+                imm = static_cast<int32_t>(static_cast<uint32_t>(imm6) << 12);
+            }
+            break;
+        case 0x0c:
+            rd = rs1 = rs1_prime;
+            switch ((h >> 10) & 3) {
+            case 0:
+                op = kSrli, imm = imm6 & 0x1f;
+                break;
+            case 1:
+                op = kSrai, imm = imm6 & 0x1f;
+                break;
+            case 2:
+                op = kAndi, imm = imm6;
+                break;
+            default: {
+                static const uint8_t kArith[] = {kSub, kXor, kOr, kAnd};
+                if ((h & 0x1000) == 0) {
+                    op = kArith[(h >> 5) & 3], rs2 = rd_prime;
+                }
+                break;
+            }
+            }
+            break;
+        case 0x0e: // c.beqz
+        case 0x0f: // c.bnez
+            op = (funct3 == 6) ? kBeq : kBne, rs1 = rs1_prime, rs2 = 0;
+            imm = signExtend(((h >> 4) & 0x100) | ((h >> 7) & 0x18) |
+                                 ((h << 1) & 0xc0) | ((h >> 2) & 0x6) |
+                                 ((h << 3) & 0x20),
+                             9);
+            break;
+        case 0x10: // c.slli
+            op = kSlli, rd = rs1 = rd_full, imm = imm6 & 0x1f;
+            break;
+        case 0x12: // c.lwsp
+            if (rd_full != 0) {
+                op = kLw, rd = rd_full, rs1 = 2;
+                imm = static_cast<int32_t>(((h >> 7) & 0x20) | ((h >> 2) & 0x1c) |
+                                           ((h << 4) & 0xc0));
+            }
+            break;
+        case 0x14:
+            if ((h & 0x1000) == 0) {
+                if (rs2_full == 0 && rd_full != 0) { // c.jr
+                    op = kJalr, rd = 0, rs1 = rd_full;
+                } else if (rs2_full != 0) { // c.mv
+                    op = kAdd, rd = rd_full, rs1 = 0, rs2 = rs2_full;
+                }
+            } else if (rs2_full == 0) {
+                if (rd_full == 0) { // c.ebreak
+                    op = kEbreak;
+                } else { // c.jalr
+                    op = kJalr, rd = 1, rs1 = rd_full;
+                }
+            } else { // c.add
+                op = kAdd, rd = rs1 = rd_full, rs2 = rs2_full;
+            }
+            break;
+        case 0x16: // c.swsp
+            op = kSw, rs1 = 2, rs2 = rs2_full;
+            imm = static_cast<int32_t>(((h >> 7) & 0x3c) | ((h >> 1) & 0xc0));
+            break;
+        case 0x01: // c.fld
+        case 0x03: // c.flw
+        case 0x05: // c.fsd
+        case 0x07: // c.fsw
+        case 0x11: // c.fldsp
+        case 0x13: // c.flwsp
+        case 0x15: // c.fsdsp
+        case 0x17: // c.fswsp
+            op = kFloat;
+            break;
+        default:
+            break;
+        }
+    } else {
+        uint32_t insn;
+        std::memcpy(&insn, &m_memory[p_pc], sizeof(insn));
+        const uint32_t funct3 = (insn >> 12) & 7;
+        const uint32_t funct7 = insn >> 25;
+        rd = (insn >> 7) & 31;
+        rs1 = (insn >> 15) & 31;
+        rs2 = (insn >> 20) & 31;
+        const int32_t imm_i = static_cast<int32_t>(insn) >> 20;
+
+        switch (insn & 0x7f) {
+        case 0x37:
+        case 0x17:
+            op = ((insn & 0x7f) == 0x37) ? kLui : kAuipc;
+            imm = static_cast<int32_t>(insn & 0xfffff000);
+            rs1 = rs2 = 0;
+            break;
+        case 0x6f:
+            op = kJal, rs1 = rs2 = 0;
+            imm = (static_cast<int32_t>(insn & 0x80000000) >> 11) |
+                  static_cast<int32_t>((insn & 0xff000) | ((insn >> 9) & 0x800) |
+                                       ((insn >> 20) & 0x7fe));
+            break;
+        case 0x67:
+            if (funct3 == 0) {
+                op = kJalr, rs2 = 0, imm = imm_i;
+            }
+            break;
+        case 0x63: {
+            static const uint8_t kBranches[] = {kBeq, kBne, kIllegal, kIllegal,
+                                                kBlt, kBge, kBltu, kBgeu};
+            op = kBranches[funct3], rd = 0;
+            imm = (static_cast<int32_t>(insn & 0x80000000) >> 19) |
+                  static_cast<int32_t>(((insn & 0x80) << 4) |
+                                       ((insn >> 20) & 0x7e0) |
+                                       ((insn >> 7) & 0x1e));
+            break;
+        }
+        case 0x03: {
+            static const uint8_t kLoads[] = {kLb, kLh, kLw, kIllegal,
+                                             kLbu, kLhu, kIllegal, kIllegal};
+            op = kLoads[funct3], rs2 = 0, imm = imm_i;
+            break;
+        }
+        case 0x23: {
+            static const uint8_t kStores[] = {kSb, kSh, kSw, kIllegal,
+                                              kIllegal, kIllegal, kIllegal, kIllegal};
+            op = kStores[funct3], rd = 0;
+            imm = (imm_i & ~0x1f) | static_cast<int32_t>((insn >> 7) & 0x1f);
+            break;
+        }
+        case 0x13: {
+            static const uint8_t kImmediates[] = {kAddi, kSlli, kSlti, kSltiu,
+                                                  kXori, kSrli, kOri, kAndi};
+            op = kImmediates[funct3], rs2 = 0, imm = imm_i;
+            if (funct3 == 1 || funct3 == 5) {
+                imm = static_cast<int32_t>((insn >> 20) & 31);
+                if (funct3 == 5 && funct7 == 0x20) {
+                    op = kSrai;
+                } else if (funct7 != 0) {
+                    op = kIllegal;
+                }
+            }
+            break;
+        }
+        case 0x33: {
+            static const uint8_t kBase[] = {kAdd, kSll, kSlt, kSltu,
+                                            kXor, kSrl, kOr, kAnd};
+            static const uint8_t kMulDiv[] = {kMul, kMulh, kMulhsu, kMulhu,
+                                              kDiv, kDivu, kRem, kRemu};
+            if (funct7 == 0) {
+                op = kBase[funct3];
+            } else if (funct7 == 1) {
+                op = kMulDiv[funct3];
+            } else if (funct7 == 0x20 && (funct3 == 0 || funct3 == 5)) {
+                op = (funct3 == 0) ? kSub : kSra;
+            }
+            break;
+        }
+        case 0x0f: // fence: nothing to order in a single hart
+            op = kAddi, rd = rs1 = rs2 = 0, imm = 0;
+            break;
+        case 0x73:
+            if (insn == 0x00000073) {
+                op = kEcall;
+            } else if (insn == 0x00100073) {
+                op = kEbreak;
+            }
+            rd = rs1 = rs2 = 0;
+            break;
+        case 0x07: // flw, fld
+        case 0x27: // fsw, fsd
+        case 0x43: // fmadd
+        case 0x47: // fmsub
+        case 0x4b: // fnmsub
+        case 0x4f: // fnmadd
+        case 0x53: // the other F and D operations
+            op = kFloat, rd = rs1 = rs2 = 0;
+            break;
+        case kCustom0:
+            if (p_pc >= m_exit_stub) {
+                op = kRuntimeCall, rd = rs1 = rs2 = 0;
+                imm = static_cast<int32_t>(insn >> 20);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    p_inst.op = op;
+    p_inst.rd = (rd == 0) ? kSinkRegister : static_cast<uint8_t>(rd);
+    p_inst.rs1 = static_cast<uint8_t>(rs1);
+    p_inst.rs2 = static_cast<uint8_t>(rs2);
+    p_inst.imm = imm;
+
+    switch (op) {
+    case kMul: case kMulh: case kMulhsu: case kMulhu:
+        p_inst.klass = ClassEnum::kMul;
+        p_inst.latency = static_cast<uint8_t>(m_core.mul_latency);
+        p_inst.occupancy = m_core.muldiv_blocking ? p_inst.latency : 1;
+        break;
+    case kDiv: case kDivu: case kRem: case kRemu:
+        p_inst.klass = ClassEnum::kDiv;
+        p_inst.latency = static_cast<uint8_t>(m_core.div_latency);
+        p_inst.occupancy = m_core.muldiv_blocking ? p_inst.latency : 1;
+        break;
+    case kLb: case kLh: case kLw: case kLbu: case kLhu:
+        p_inst.klass = ClassEnum::kLoad;
+        p_inst.latency = static_cast<uint8_t>(m_core.load_latency);
+        break;
+    case kSb: case kSh: case kSw:
+        p_inst.klass = ClassEnum::kStore;
+        break;
+    case kBeq: case kBne: case kBlt: case kBge: case kBltu: case kBgeu:
+        p_inst.klass = ClassEnum::kBranch;
+        break;
+    case kJal: case kJalr:
+        p_inst.klass = ClassEnum::kJump;
+        break;
+    case kEcall: case kEbreak: case kIllegal: case kFloat:
+        p_inst.klass = ClassEnum::kSystem;
+        break;
+    case kRuntimeCall:
+        p_inst.klass = ClassEnum::kRuntime;
+        p_inst.latency = 0;
+        p_inst.occupancy = 0;
+        break;
+    default:
+        p_inst.latency = static_cast<uint8_t>(m_core.alu_latency);
+        break;
+    }
+    return op != kIllegal;
+}
+
+bool Simulator::readString(const uint32_t p_addr, std::string &p_str) const {
+    p_str.clear();
+    for (uint32_t addr = p_addr; addr >= kNullGuard && addr < kMemorySize; ++addr) {
+        if (m_memory[addr] == '\0') {
+            return true;
+        }
+        p_str.push_back(static_cast<char>(m_memory[addr]));
+    }
+    return false;
+}
+
+// the soft-float comparison helpers return a value whose relation to zero
+// is the result; unordered operands make the comparison fail
+static uint32_t compareFloat(const uint32_t p_lhs, const uint32_t p_rhs,
+                             const int32_t p_unordered) {
+    const float lhs = asFloat(p_lhs);
+    const float rhs = asFloat(p_rhs);
+    if (lhs != lhs || rhs != rhs) {
+        return static_cast<uint32_t>(p_unordered);
+    }
+    return static_cast<uint32_t>((lhs < rhs) ? -1 : (lhs > rhs) ? 1 : 0);
+}
+
+bool Simulator::callRuntime(const RuntimeFunction &p_function, uint32_t *p_regs) {
+    uint32_t &a0 = p_regs[10];
+    const uint32_t a1 = p_regs[11];
+
+    switch (p_function.id) {
+    case RuntimeId::kPrintInt:
+        printf("%d\n", static_cast<int32_t>(a0));
+        break;
+    case RuntimeId::kReadInt: {
+        int value = 0;
+        if (scanf("%d", &value) != 1) {
+            value = 0;
+        }
+        a0 = static_cast<uint32_t>(value);
+        break;
+    }
+    case RuntimeId::kPrintReal:
+        printf("%f\n", asFloat(a0));
+        break;
+    case RuntimeId::kReadReal:
+    case RuntimeId::kReadFixed: {
+        float value = 0.0f;
+        if (scanf("%f", &value) != 1) {
+            value = 0.0f;
+        }
+        a0 = (p_function.id == RuntimeId::kReadReal)
+                 ? asBits(value)
+                 : static_cast<uint32_t>(static_cast<int32_t>(value * 65536.0f));
+        break;
+    }
+    case RuntimeId::kPrintString: {
+        std::string str;
+        if (!readString(a0, str)) {
+            return error("printString: bad string address " + std::to_string(a0));
+        }
+        printf("%s\n", str.c_str());
+        break;
+    }
+    case RuntimeId::kPrintFixed:
+        printf("%f\n", static_cast<int32_t>(a0) / 65536.0);
+        break;
+    case RuntimeId::kProfileInit:
+        m_profile_counters = a0;
+        m_profile_count = a1;
+        if (!readString(p_regs[12], m_profile_path)) {
+            return error("profileInit: bad path address " + std::to_string(p_regs[12]));
+        }
+        break;
+    case RuntimeId::kBoundsCheckFailed:
+        return error("line " + std::to_string(static_cast<int32_t>(a0)) + ": index " +
+                     std::to_string(static_cast<int32_t>(a1)) + " out of bounds [1, " +
+                     std::to_string(static_cast<int32_t>(p_regs[12])) + "]");
+    case RuntimeId::kFloatSiSf:
+        a0 = asBits(static_cast<float>(static_cast<int32_t>(a0)));
+        break;
+    case RuntimeId::kAddSf3:
+        a0 = asBits(asFloat(a0) + asFloat(a1));
+        break;
+    case RuntimeId::kSubSf3:
+        a0 = asBits(asFloat(a0) - asFloat(a1));
+        break;
+    case RuntimeId::kMulSf3:
+        a0 = asBits(asFloat(a0) * asFloat(a1));
+        break;
+    case RuntimeId::kDivSf3:
+        a0 = asBits(asFloat(a0) / asFloat(a1));
+        break;
+    case RuntimeId::kLtSf2:
+    case RuntimeId::kLeSf2:
+    case RuntimeId::kEqSf2:
+    case RuntimeId::kNeSf2:
+        a0 = compareFloat(a0, a1, 1);
+        break;
+    case RuntimeId::kGtSf2:
+    case RuntimeId::kGeSf2:
+        a0 = compareFloat(a0, a1, -1);
+        break;
+    case RuntimeId::kExit:
+        break;
+    }
+    return true;
+}
+
+bool Simulator::writeProfile() {
+    if (m_profile_path.empty()) {
+        return true;
+    }
+    if (m_profile_counters < kNullGuard ||
+        m_profile_counters + 4ull * m_profile_count > kMemorySize) {
+        return error("profileInit: bad counter address " + std::to_string(m_profile_counters));
+    }
+    FILE *file = fopen(m_profile_path.c_str(), "w");
+    if (file == nullptr) {
+        return error("cannot write the profile to " + m_profile_path);
+    }
+    fprintf(file, "p-profile %u\n", m_profile_count);
+    for (uint32_t i = 0; i < m_profile_count; ++i) {
+        uint32_t count;
+        std::memcpy(&count, &m_memory[m_profile_counters + 4 * i], sizeof(count));
+        fprintf(file, "%u\n", count);
+    }
+    fclose(file);
+    return true;
+}
+
+bool Simulator::run() {
+    // indexed by Op, the last entry decodes the slot on first execution
+    static const void *const kHandlers[kOpCount + 1] = {
+        &&lui, &&auipc, &&jal, &&jalr,
+        &&beq, &&bne, &&blt, &&bge, &&bltu, &&bgeu,
+        &&lb, &&lh, &&lw, &&lbu, &&lhu, &&sb, &&sh, &&sw,
+        &&addi, &&slti, &&sltiu, &&xori, &&ori, &&andi, &&slli, &&srli, &&srai,
+        &&add, &&sub, &&sll, &&slt, &&sltu, &&xor_, &&srl, &&sra, &&or_, &&and_,
+        &&mul, &&mulh, &&mulhsu, &&mulhu, &&div, &&divu, &&rem, &&remu,
+        &&ecall, &&ebreak, &&runtime_call, &&illegal, &&float_,
+        &&undecoded};
+
+    if (m_code.empty()) {
+        return error("no program loaded");
+    }
+    for (auto &inst : m_code) {
+        inst.handler = kHandlers[kOpCount];
+    }
+
+    m_stats = Statistics();
+    m_pc_counts.assign(m_count_pcs ? m_code.size() : 0, 0);
+    uint64_t *const pc_counts = m_count_pcs ? m_pc_counts.data() : nullptr;
+    uint32_t regs[kSinkRegister + 1] = {};
+    uint64_t ready[kSinkRegister + 1] = {};
+    uint64_t cycle = 0;
+    uint32_t pc = m_entry;
+    uint32_t addr = 0;
+    Instruction *inst = nullptr;
+    regs[1] = m_exit_stub;
+    // pk starts main below argc/argv, some programs write above their frame
+    regs[2] = kMemorySize - kArgumentArea;
+
+    const auto fault = [&](const char *p_what) {
+        char message[96];
+        snprintf(message, sizeof(message), "%s at pc 0x%08x (address 0x%08x)",
+                 p_what, pc, addr);
+        m_stats.cycles = cycle;
+        return error(message);
+    };
+
+    // every handler ends with its own copy of the dispatch sequence, so the
+    // host branch predictor sees one indirect jump per guest instruction
+#define DISPATCH(next_pc)                                                     \
+    do {                                                                      \
+        pc = (next_pc);                                                       \
+        if (pc < kTextBase || pc >= m_text_end) {                             \
+            addr = pc;                                                        \
+            return fault("instruction fetch outside the text");               \
+        }                                                                     \
+        inst = &m_code[(pc - kTextBase) >> 1];                                \
+        if (pc_counts != nullptr) {                                           \
+            ++pc_counts[(pc - kTextBase) >> 1];                               \
+        }                                                                     \
+        const uint64_t issue =                                                \
+            std::max(cycle, std::max(ready[inst->rs1], ready[inst->rs2]));    \
+        ready[inst->rd] = issue + inst->latency;                              \
+        cycle = issue + inst->occupancy;                                      \
+        ++m_stats.counts[static_cast<int>(inst->klass)];                      \
+        goto *inst->handler;                                                  \
+    } while (0)
+#define NEXT() DISPATCH(pc + inst->size)
+#define RD regs[inst->rd]
+#define RS1 regs[inst->rs1]
+#define RS2 regs[inst->rs2]
+#define SRS1 static_cast<int32_t>(regs[inst->rs1])
+#define SRS2 static_cast<int32_t>(regs[inst->rs2])
+#define IMM static_cast<uint32_t>(inst->imm)
+#define BRANCH(cond)                                                          \
+    do {                                                                      \
+        if (cond) {                                                           \
+            ++m_stats.branches_taken;                                         \
+            cycle += m_core.branch_taken_penalty;                             \
+            DISPATCH(pc + IMM);                                               \
+        }                                                                     \
+        NEXT();                                                               \
+    } while (0)
+#define LOAD(type)                                                            \
+    do {                                                                      \
+        addr = RS1 + IMM;                                                     \
+        if (addr < kNullGuard || addr > kMemorySize - sizeof(type)) {         \
+            return fault("load fault");                                       \
+        }                                                                     \
+        type value;                                                           \
+        std::memcpy(&value, &m_memory[addr], sizeof(value));                  \
+        RD = static_cast<uint32_t>(value);                                    \
+        NEXT();                                                               \
+    } while (0)
+#define STORE(type)                                                           \
+    do {                                                                      \
+        addr = RS1 + IMM;                                                     \
+        if (addr < m_text_end || addr > kMemorySize - sizeof(type)) {         \
+            return fault("store fault");                                      \
+        }                                                                     \
+        const auto value = static_cast<type>(RS2);                            \
+        std::memcpy(&m_memory[addr], &value, sizeof(value));                  \
+        NEXT();                                                               \
+    } while (0)
+
+    DISPATCH(m_entry);
+
+undecoded:
+    // undo the accounting done for the placeholder
+    --m_stats.counts[static_cast<int>(inst->klass)];
+    cycle -= inst->occupancy;
+    if (pc_counts != nullptr) {
+        --pc_counts[(pc - kTextBase) >> 1];
+    }
+    decode(pc, *inst);
+    inst->handler = kHandlers[inst->op];
+    DISPATCH(pc);
+
+lui:
+    RD = IMM;
+    NEXT();
+auipc:
+    RD = pc + IMM;
+    NEXT();
+jal:
+    RD = pc + inst->size;
+    cycle += m_core.jump_penalty;
+    DISPATCH(pc + IMM);
+jalr: {
+    const uint32_t target = (RS1 + IMM) & ~1u;
+    RD = pc + inst->size;
+    cycle += m_core.jump_penalty;
+    DISPATCH(target);
+}
+
+beq:
+    BRANCH(RS1 == RS2);
+bne:
+    BRANCH(RS1 != RS2);
+blt:
+    BRANCH(SRS1 < SRS2);
+bge:
+    BRANCH(SRS1 >= SRS2);
+bltu:
+    BRANCH(RS1 < RS2);
+bgeu:
+    BRANCH(RS1 >= RS2);
+
+lb:
+    LOAD(int8_t);
+lh:
+    LOAD(int16_t);
+lw:
+    LOAD(uint32_t);
+lbu:
+    LOAD(uint8_t);
+lhu:
+    LOAD(uint16_t);
+sb:
+    STORE(uint8_t);
+sh:
+    STORE(uint16_t);
+sw:
+    STORE(uint32_t);
+
+addi:
+    RD = RS1 + IMM;
+    NEXT();
+slti:
+    RD = SRS1 < inst->imm;
+    NEXT();
+sltiu:
+    RD = RS1 < IMM;
+    NEXT();
+xori:
+    RD = RS1 ^ IMM;
+    NEXT();
+ori:
+    RD = RS1 | IMM;
+    NEXT();
+andi:
+    RD = RS1 & IMM;
+    NEXT();
+slli:
+    RD = RS1 << inst->imm;
+    NEXT();
+srli:
+    RD = RS1 >> inst->imm;
+    NEXT();
+srai:
+    RD = static_cast<uint32_t>(SRS1 >> inst->imm);
+    NEXT();
+
+add:
+    RD = RS1 + RS2;
+    NEXT();
+sub:
+    RD = RS1 - RS2;
+    NEXT();
+sll:
+    RD = RS1 << (RS2 & 31);
+    NEXT();
+slt:
+    RD = SRS1 < SRS2;
+    NEXT();
+sltu:
+    RD = RS1 < RS2;
+    NEXT();
+xor_:
+    RD = RS1 ^ RS2;
+    NEXT();
+srl:
+    RD = RS1 >> (RS2 & 31);
+    NEXT();
+sra:
+    RD = static_cast<uint32_t>(SRS1 >> (RS2 & 31));
+    NEXT();
+or_:
+    RD = RS1 | RS2;
+    NEXT();
+and_:
+    RD = RS1 & RS2;
+    NEXT();
+
+mul:
+    RD = RS1 * RS2;
+    NEXT();
+mulh:
+    RD = static_cast<uint32_t>(
+        (static_cast<int64_t>(SRS1) * static_cast<int64_t>(SRS2)) >> 32);
+    NEXT();
+mulhsu:
+    RD = static_cast<uint32_t>(
+        (static_cast<int64_t>(SRS1) * static_cast<int64_t>(RS2)) >> 32);
+    NEXT();
+mulhu:
+    RD = static_cast<uint32_t>(
+        (static_cast<uint64_t>(RS1) * static_cast<uint64_t>(RS2)) >> 32);
+    NEXT();
+div:
+    if (RS2 == 0) {
+        RD = ~0u;
+    } else if (SRS1 == INT32_MIN && SRS2 == -1) {
+        RD = RS1;
+    } else {
+        RD = static_cast<uint32_t>(SRS1 / SRS2);
+    }
+    NEXT();
+divu:
+    RD = (RS2 == 0) ? ~0u : RS1 / RS2;
+    NEXT();
+rem:
+    if (RS2 == 0) {
+        RD = RS1;
+    } else if (SRS1 == INT32_MIN && SRS2 == -1) {
+        RD = 0;
+    } else {
+        RD = static_cast<uint32_t>(SRS1 % SRS2);
+    }
+    NEXT();
+remu:
+    RD = (RS2 == 0) ? RS1 : RS1 % RS2;
+    NEXT();
+
+ecall:
+    // only the exit system call exists without an operating system
+    if (regs[17] == 93) {
+        m_stats.cycles = cycle;
+        return writeProfile();
+    }
+    addr = regs[17];
+    return fault("unsupported system call");
+ebreak:
+    return fault("breakpoint");
+illegal:
+    addr = pc;
+    return fault("illegal instruction");
+float_:
+    // real code runs when lowered with --real=soft-float or fixed-point
+    addr = pc;
+    return fault("unsupported instruction (F extension)");
+
+runtime_call: {
+    const RuntimeFunction &function = *m_stubs[inst->imm];
+    if (function.id == RuntimeId::kExit) {
+        m_stats.cycles = cycle;
+        fflush(stdout);
+        return writeProfile();
+    }
+    if (!callRuntime(function, regs)) {
+        m_stats.cycles = cycle;
+        return false;
+    }
+    ready[10] = ready[11] = cycle;
+    DISPATCH(regs[1]);
+}
+
+#undef STORE
+#undef LOAD
+#undef BRANCH
+#undef IMM
+#undef SRS2
+#undef SRS1
+#undef RS2
+#undef RS1
+#undef RD
+#undef NEXT
+#undef DISPATCH
+}
+
+bool Simulator::writePcProfile(const std::string &p_path, const std::string &p_source) const {
+    FILE *file = fopen(p_path.c_str(), "w");
+    if (file == nullptr) {
+        return false;
+    }
+    fprintf(file, "p-pc-profile %s\n", p_source.c_str());
+    for (const auto &function : m_functions) {
+        fprintf(file, "func 0x%08x %s\n", function.first, function.second.c_str());
+    }
+    for (const auto &entry : m_line_table) {
+        fprintf(file, "line 0x%08x %u\n", entry.first, entry.second);
+    }
+    // the runtime stubs from m_exit_stub on are not instructions
+    for (std::size_t i = 0; i < m_pc_counts.size() && kTextBase + 2 * i < m_exit_stub; ++i) {
+        if (m_pc_counts[i] != 0) {
+            fprintf(file, "pc 0x%08x %llu\n", static_cast<uint32_t>(kTextBase + 2 * i),
+                    static_cast<unsigned long long>(m_pc_counts[i]));
+        }
+    }
+    const bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+void Simulator::dumpStatistics(FILE *p_out_file, const std::string &p_source) const {
+    static const char *const kClassNames[] = {"alu", "mul", "div", "load", "store",
+                                              "branch", "jump", "system"};
+    const uint64_t instructions = m_stats.getInstructions();
+
+    fprintf(p_out_file, "==== simulation of %s on core '%s' ====\n",
+            p_source.c_str(), m_core.name.c_str());
+    fprintf(p_out_file, "%-16s %12llu\n", "instructions",
+            static_cast<unsigned long long>(instructions));
+    for (int i = 0; i < static_cast<int>(ClassEnum::kRuntime); ++i) {
+        fprintf(p_out_file, "  %-14s %12llu\n", kClassNames[i],
+                static_cast<unsigned long long>(m_stats.counts[i]));
+    }
+    fprintf(p_out_file, "%-16s %12llu\n", "branches taken",
+            static_cast<unsigned long long>(m_stats.branches_taken));
+    fprintf(p_out_file, "%-16s %12llu\n", "runtime calls",
+            static_cast<unsigned long long>(
+                m_stats.counts[static_cast<int>(ClassEnum::kRuntime)]));
+    fprintf(p_out_file, "%-16s %12llu\n", "cycles",
+            static_cast<unsigned long long>(m_stats.cycles));
+    fprintf(p_out_file, "%-16s %12.3f\n", "CPI",
+            instructions ? static_cast<double>(m_stats.cycles) / instructions : 0.0);
+}
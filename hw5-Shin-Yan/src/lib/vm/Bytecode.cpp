@@ -0,0 +1,25 @@
+#include "vm/Bytecode.hpp"
+
+const char *BytecodeProgram::getMnemonic(const Opcode p_op) {
+    static const char *const kMnemonics[] = {
+#define BYTECODE_MNEMONIC(name, mnemonic) mnemonic,
+        BYTECODE_OPCODES(BYTECODE_MNEMONIC)
+#undef BYTECODE_MNEMONIC
+    };
+    return kMnemonics[static_cast<int>(p_op)];
+}
+
+void BytecodeProgram::dump(FILE *p_out_file) const {
+    for (std::size_t f = 0; f < functions.size(); ++f) {
+        const BytecodeFunction &function = functions[f];
+        const uint32_t end = (f + 1 < functions.size()) ? functions[f + 1].entry
+                                                        : code.size();
+        fprintf(p_out_file, "%s: # frame %u\n", function.name.c_str(),
+                function.frame_size);
+        for (uint32_t pc = function.entry; pc < end; ++pc) {
+            const BytecodeInstruction &inst = code[pc];
+            fprintf(p_out_file, "%6u  %-8s %d, %d, %d\n", pc,
+                    getMnemonic(inst.op), inst.a, inst.b, inst.c);
+        }
+    }
+}
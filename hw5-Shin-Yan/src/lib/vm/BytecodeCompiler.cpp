@@ -0,0 +1,672 @@
+#include "vm/BytecodeCompiler.hpp"
+#include "visitor/AstNodeInclude.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+static uint32_t getElementCount(const PType &p_type) {
+    uint32_t count = 1;
+    for (auto dimension : p_type.getDimensions()) {
+        count *= static_cast<uint32_t>(dimension);
+    }
+    return count;
+}
+
+// whether p_op writes its result to r[a]
+static bool writesRegisterA(const Opcode p_op) {
+    switch (p_op) {
+    case Opcode::kGstore:
+    case Opcode::kGstoreIdx:
+    case Opcode::kStoreIdx:
+    case Opcode::kCopy:
+    case Opcode::kGcopy:
+    case Opcode::kJump:
+    case Opcode::kJumpIfZero:
+    case Opcode::kJumpIfNotZero:
+    case Opcode::kGaddStore:
+    case Opcode::kBlt:
+    case Opcode::kBle:
+    case Opcode::kBgt:
+    case Opcode::kBge:
+    case Opcode::kBeq:
+    case Opcode::kBne:
+    case Opcode::kBgeImm:
+    case Opcode::kForLoop:
+    case Opcode::kCall:
+    case Opcode::kReturn:
+    case Opcode::kReturnVoid:
+    case Opcode::kPrintInt:
+    case Opcode::kPrintReal:
+    case Opcode::kPrintString:
+    case Opcode::kHalt:
+    case Opcode::kCount:
+        return false;
+    default:
+        return true;
+    }
+}
+
+static bool isComparison(const Operator p_op) {
+    switch (p_op) {
+    case Operator::kLessOp:
+    case Operator::kLessOrEqualOp:
+    case Operator::kGreaterOp:
+    case Operator::kGreaterOrEqualOp:
+    case Operator::kEqualOp:
+    case Operator::kNotEqualOp:
+        return true;
+    default:
+        return false;
+    }
+}
+
+BytecodeCompiler::BytecodeCompiler(const SymbolManager *const p_symbol_manager,
+                                   BytecodeProgram &p_program)
+    : m_symbol_manager_ptr(p_symbol_manager), m_program(p_program) {}
+
+void BytecodeCompiler::reportError(const std::string &p_message) {
+    if (m_error.empty()) {
+        m_error = p_message;
+    }
+}
+
+uint32_t BytecodeCompiler::emit(const Opcode p_op, const int32_t p_a,
+                                const int32_t p_b, const int32_t p_c) {
+    BytecodeInstruction inst;
+    inst.op = p_op;
+    inst.a = p_a;
+    inst.b = p_b;
+    inst.c = p_c;
+    m_program.code.push_back(inst);
+    return static_cast<uint32_t>(m_program.code.size() - 1);
+}
+
+void BytecodeCompiler::patch(const uint32_t p_index, const uint32_t p_target) {
+    BytecodeInstruction &inst = m_program.code[p_index];
+    switch (inst.op) {
+    case Opcode::kJump:
+        inst.a = static_cast<int32_t>(p_target);
+        break;
+    case Opcode::kJumpIfZero:
+    case Opcode::kJumpIfNotZero:
+        inst.b = static_cast<int32_t>(p_target);
+        break;
+    default:
+        inst.c = static_cast<int32_t>(p_target);
+        break;
+    }
+}
+
+bool BytecodeCompiler::retarget(const int32_t p_temporary,
+                                const int32_t p_register) {
+    if (m_program.code.empty()) {
+        return false;
+    }
+    BytecodeInstruction &last = m_program.code.back();
+    if (!writesRegisterA(last.op) || last.a != p_temporary) {
+        return false;
+    }
+    last.a = p_register;
+    return true;
+}
+
+int32_t BytecodeCompiler::allocateRegisters(const uint32_t p_count) {
+    const uint32_t first = m_next_register;
+    m_next_register += p_count;
+    m_frame_size = std::max(m_frame_size, m_next_register);
+    return static_cast<int32_t>(first);
+}
+
+void BytecodeCompiler::popScope(const SymbolTable *p_table) {
+    if (p_table == nullptr) {
+        return;
+    }
+    for (const auto &entry : p_table->getEntries()) {
+        auto it = m_locations.find(entry->getName());
+        if (it == m_locations.end()) {
+            continue;
+        }
+        it->second.pop();
+        if (it->second.empty()) {
+            m_locations.erase(it);
+        }
+    }
+}
+
+const BytecodeCompiler::Location *
+BytecodeCompiler::findLocation(const std::string &p_name) const {
+    auto it = m_locations.find(p_name);
+    return it == m_locations.end() ? nullptr : &it->second.top();
+}
+
+void BytecodeCompiler::loadConstant(const int32_t p_register,
+                                    const Constant &p_constant) {
+    const PType *type = p_constant.getTypePtr();
+    if (type->isString()) {
+        const std::string string = p_constant.getConstantValueCString();
+        auto it = m_string_ids.find(string);
+        if (it == m_string_ids.end()) {
+            const int32_t id = static_cast<int32_t>(m_program.strings.size());
+            m_program.strings.emplace_back(new std::string(string));
+            it = m_string_ids.emplace(string, id).first;
+        }
+        emit(Opcode::kLoadString, p_register, it->second);
+        return;
+    }
+
+    int32_t value;
+    if (type->isReal()) {
+        const float real = static_cast<float>(p_constant.real());
+        std::memcpy(&value, &real, sizeof(value));
+    } else if (type->isBool()) {
+        value = (std::strcmp(p_constant.getConstantValueCString(), "true") == 0);
+    } else {
+        value = static_cast<int32_t>(p_constant.integer());
+    }
+    emit(Opcode::kLoadImm, p_register, value);
+}
+
+int32_t BytecodeCompiler::compile(const ExpressionNode &p_expr,
+                                  const bool p_as_real) {
+    ++m_expression_depth;
+    const_cast<ExpressionNode &>(p_expr).accept(*this);
+    --m_expression_depth;
+
+    int32_t result = m_result;
+    if (p_as_real && p_expr.getInferredType()->isInteger()) {
+        const int32_t real = allocateRegisters();
+        emit(Opcode::kIntToReal, real, result);
+        result = real;
+    }
+    return result;
+}
+
+int32_t BytecodeCompiler::compileIndex(const VariableReferenceNode &p_variable_ref) {
+    const SymbolEntry *entry = m_symbol_manager_ptr->lookup(p_variable_ref.getName());
+    const auto &dimensions = entry->getTypePtr()->getDimensions();
+    const auto &indices = p_variable_ref.getIndices();
+
+    // row-major; the indices start from 1, so the element of all ones,
+    // which is at 'origin' before it is subtracted, is element 0
+    int32_t linear = compile(*indices[0]);
+    int32_t origin = 1;
+    for (std::size_t i = 1; i < indices.size(); ++i) {
+        const int32_t scaled = allocateRegisters();
+        emit(Opcode::kMulImm, scaled, linear, static_cast<int32_t>(dimensions[i]));
+        emit(Opcode::kAdd, scaled, scaled, compile(*indices[i]));
+        linear = scaled;
+        origin = origin * static_cast<int32_t>(dimensions[i]) + 1;
+    }
+    const int32_t based = allocateRegisters();
+    emit(Opcode::kAddImm, based, linear, -origin);
+    linear = based;
+    int32_t stride = 1;
+    for (std::size_t i = indices.size(); i < dimensions.size(); ++i) {
+        stride *= static_cast<int32_t>(dimensions[i]);
+    }
+    if (stride != 1) {
+        const int32_t scaled = allocateRegisters();
+        emit(Opcode::kMulImm, scaled, linear, stride);
+        linear = scaled;
+    }
+    return linear;
+}
+
+uint32_t BytecodeCompiler::compileBranch(const ExpressionNode &p_condition,
+                                         const bool p_when) {
+    // a comparison of integers fuses with the branch
+    const auto *comparison = dynamic_cast<const BinaryOperatorNode *>(&p_condition);
+    if (comparison != nullptr && isComparison(comparison->getOp()) &&
+        !comparison->getLeftOperand().getInferredType()->isReal() &&
+        !comparison->getRightOperand().getInferredType()->isReal()) {
+        const int32_t left = compile(comparison->getLeftOperand());
+        const int32_t right = compile(comparison->getRightOperand());
+
+        Opcode op;
+        switch (comparison->getOp()) {
+        case Operator::kLessOp:
+            op = p_when ? Opcode::kBlt : Opcode::kBge;
+            break;
+        case Operator::kLessOrEqualOp:
+            op = p_when ? Opcode::kBle : Opcode::kBgt;
+            break;
+        case Operator::kGreaterOp:
+            op = p_when ? Opcode::kBgt : Opcode::kBle;
+            break;
+        case Operator::kGreaterOrEqualOp:
+            op = p_when ? Opcode::kBge : Opcode::kBlt;
+            break;
+        case Operator::kEqualOp:
+            op = p_when ? Opcode::kBeq : Opcode::kBne;
+            break;
+        default:
+            op = p_when ? Opcode::kBne : Opcode::kBeq;
+            break;
+        }
+        return emit(op, left, right);
+    }
+
+    const int32_t value = compile(p_condition);
+    return emit(p_when ? Opcode::kJumpIfNotZero : Opcode::kJumpIfZero, value);
+}
+
+void BytecodeCompiler::store(const VariableReferenceNode &p_lvalue,
+                             const int32_t p_value) {
+    const Location *location = findLocation(p_lvalue.getName());
+    if (location == nullptr) {
+        reportError("cannot assign to '" + p_lvalue.getName() + "'");
+        return;
+    }
+
+    if (p_lvalue.getIndices().empty()) {
+        if (location->global) {
+            emit(Opcode::kGstore, location->index, p_value);
+        } else if (p_value != location->index) {
+            emit(Opcode::kMov, location->index, p_value);
+        }
+        return;
+    }
+
+    const int32_t index = compileIndex(p_lvalue);
+    emit(location->global ? Opcode::kGstoreIdx : Opcode::kStoreIdx,
+         location->index, index, p_value);
+}
+
+void BytecodeCompiler::visit(ProgramNode &p_program) {
+    m_symbol_manager_ptr->reconstructHashTableFromSymbolTable(
+        p_program.getSymbolTable());
+
+    for (const auto &decl : p_program.getDeclNodes()) {
+        decl->accept(*this);
+    }
+    for (const auto &func : p_program.getFuncNodes()) {
+        func->accept(*this);
+    }
+
+    m_program.main_function = static_cast<uint32_t>(m_program.functions.size());
+    m_program.functions.push_back({"main", static_cast<uint32_t>(m_program.code.size()), 0});
+    m_return_type_ptr = nullptr;
+    m_next_register = 0;
+    m_frame_size = 0;
+    const_cast<CompoundStatementNode &>(p_program.getBody()).accept(*this);
+    emit(Opcode::kHalt);
+    m_program.functions.back().frame_size = m_frame_size;
+
+    m_symbol_manager_ptr->removeSymbolsFromHashTable(p_program.getSymbolTable());
+}
+
+void BytecodeCompiler::visit(DeclNode &p_decl) {
+    p_decl.visitChildNodes(*this);
+}
+
+void BytecodeCompiler::visit(VariableNode &p_variable) {
+    const SymbolEntry *entry = m_symbol_manager_ptr->lookup(p_variable.getName());
+    if (entry == nullptr) {
+        return;
+    }
+
+    // constants are folded into their references
+    if (entry->getKind() == SymbolEntry::KindEnum::kConstantKind) {
+        return;
+    }
+
+    const uint32_t count = getElementCount(*p_variable.getTypePtr());
+    if (entry->getLevel() == 0) {
+        m_locations[p_variable.getName()].push(
+            {true, static_cast<int32_t>(m_program.global_size)});
+        m_program.global_size += count;
+        return;
+    }
+
+    // parameters are declared first, so they take the registers the caller
+    // filled with the arguments
+    m_locations[p_variable.getName()].push({false, allocateRegisters(count)});
+}
+
+void BytecodeCompiler::visit(ConstantValueNode &p_constant_value) {
+    m_result = allocateRegisters();
+    loadConstant(m_result, *p_constant_value.getConstantPtr());
+}
+
+void BytecodeCompiler::visit(FunctionNode &p_function) {
+    m_symbol_manager_ptr->reconstructHashTableFromSymbolTable(
+        p_function.getSymbolTable());
+
+    const uint32_t id = static_cast<uint32_t>(m_program.functions.size());
+    m_function_ids[p_function.getName()] = id;
+    m_program.functions.push_back(
+        {p_function.getName(), static_cast<uint32_t>(m_program.code.size()), 0});
+    m_return_type_ptr = p_function.getTypePtr();
+    m_next_register = 0;
+    m_frame_size = 0;
+
+    p_function.visitChildNodes(*this);
+    emit(Opcode::kReturnVoid);
+    m_program.functions[id].frame_size = m_frame_size;
+
+    m_return_type_ptr = nullptr;
+    popScope(p_function.getSymbolTable());
+    m_symbol_manager_ptr->removeSymbolsFromHashTable(p_function.getSymbolTable());
+}
+
+void BytecodeCompiler::visit(CompoundStatementNode &p_compound_statement) {
+    m_symbol_manager_ptr->reconstructHashTableFromSymbolTable(
+        p_compound_statement.getSymbolTable());
+
+    // locals of the block are dead once it ends
+    const uint32_t mark = m_next_register;
+    p_compound_statement.visitChildNodes(*this);
+    m_next_register = mark;
+
+    popScope(p_compound_statement.getSymbolTable());
+    m_symbol_manager_ptr->removeSymbolsFromHashTable(
+        p_compound_statement.getSymbolTable());
+}
+
+void BytecodeCompiler::visit(PrintNode &p_print) {
+    const uint32_t mark = m_next_register;
+    const int32_t value = compile(p_print.getTarget());
+
+    const PType *type = p_print.getTarget().getInferredType();
+    if (type->isString()) {
+        emit(Opcode::kPrintString, value);
+    } else if (type->isReal()) {
+        emit(Opcode::kPrintReal, value);
+    } else {
+        emit(Opcode::kPrintInt, value);
+    }
+    m_next_register = mark;
+}
+
+void BytecodeCompiler::visit(BinaryOperatorNode &p_bin_op) {
+    const ExpressionNode &left_operand = p_bin_op.getLeftOperand();
+    const ExpressionNode &right_operand = p_bin_op.getRightOperand();
+    const bool real = left_operand.getInferredType()->isReal() ||
+                      right_operand.getInferredType()->isReal();
+    const Operator op = p_bin_op.getOp();
+
+    // x + c, x - c and x * c take an immediate
+    const auto *constant = dynamic_cast<const ConstantValueNode *>(&right_operand);
+    if (!real && constant != nullptr &&
+        constant->getInferredType()->isInteger() &&
+        (op == Operator::kPlusOp || op == Operator::kMinusOp ||
+         op == Operator::kMultiplyOp)) {
+        const int32_t value = static_cast<int32_t>(constant->getConstantPtr()->integer());
+        const int32_t left = compile(left_operand);
+        m_result = allocateRegisters();
+        if (op == Operator::kMultiplyOp) {
+            emit(Opcode::kMulImm, m_result, left, value);
+        } else {
+            emit(Opcode::kAddImm, m_result, left,
+                 op == Operator::kPlusOp ? value : -value);
+        }
+        return;
+    }
+
+    const int32_t left = compile(left_operand, real);
+    const int32_t right = compile(right_operand, real);
+
+    Opcode opcode;
+    switch (op) {
+    case Operator::kMultiplyOp:
+        opcode = real ? Opcode::kFmul : Opcode::kMul;
+        break;
+    case Operator::kDivideOp:
+        opcode = real ? Opcode::kFdiv : Opcode::kDiv;
+        break;
+    case Operator::kModOp:
+        opcode = Opcode::kMod;
+        break;
+    case Operator::kPlusOp:
+        opcode = real ? Opcode::kFadd : Opcode::kAdd;
+        break;
+    case Operator::kMinusOp:
+        opcode = real ? Opcode::kFsub : Opcode::kSub;
+        break;
+    case Operator::kLessOp:
+        opcode = real ? Opcode::kFlt : Opcode::kLt;
+        break;
+    case Operator::kLessOrEqualOp:
+        opcode = real ? Opcode::kFle : Opcode::kLe;
+        break;
+    case Operator::kGreaterOp:
+        opcode = real ? Opcode::kFgt : Opcode::kGt;
+        break;
+    case Operator::kGreaterOrEqualOp:
+        opcode = real ? Opcode::kFge : Opcode::kGe;
+        break;
+    case Operator::kEqualOp:
+        opcode = real ? Opcode::kFeq : Opcode::kEq;
+        break;
+    case Operator::kNotEqualOp:
+        opcode = real ? Opcode::kFne : Opcode::kNe;
+        break;
+    case Operator::kAndOp:
+        opcode = Opcode::kAnd;
+        break;
+    case Operator::kOrOp:
+        opcode = Opcode::kOr;
+        break;
+    default:
+        reportError(std::string("unsupported operator '") +
+                    p_bin_op.getOpCString() + "'");
+        opcode = Opcode::kAdd;
+        break;
+    }
+    m_result = allocateRegisters();
+    emit(opcode, m_result, left, right);
+}
+
+void BytecodeCompiler::visit(UnaryOperatorNode &p_un_op) {
+    const int32_t operand = compile(p_un_op.getOperand());
+    m_result = allocateRegisters();
+    if (p_un_op.getOp() == Operator::kNotOp) {
+        emit(Opcode::kNot, m_result, operand);
+    } else if (p_un_op.getInferredType()->isReal()) {
+        emit(Opcode::kFneg, m_result, operand);
+    } else {
+        emit(Opcode::kNeg, m_result, operand);
+    }
+}
+
+void BytecodeCompiler::visit(FunctionInvocationNode &p_func_invocation) {
+    const bool discard_result = (m_expression_depth == 0);
+    const uint32_t mark = m_next_register;
+
+    auto id = m_function_ids.find(p_func_invocation.getName());
+    const SymbolEntry *entry = m_symbol_manager_ptr->lookup(p_func_invocation.getName());
+    if (id == m_function_ids.end() || entry == nullptr ||
+        entry->getKind() != SymbolEntry::KindEnum::kFunctionKind) {
+        reportError("call to unknown function '" + p_func_invocation.getName() + "'");
+        m_result = allocateRegisters();
+        return;
+    }
+
+    std::vector<const PType *> parameter_types;
+    uint32_t argument_size = 0;
+    for (const auto &decl : *entry->getAttribute().parameters()) {
+        for (const auto &var : decl->getVariables()) {
+            parameter_types.push_back(var->getTypePtr());
+            argument_size += getElementCount(*var->getTypePtr());
+        }
+    }
+
+    const auto &arguments = p_func_invocation.getArguments();
+    const int32_t base = allocateRegisters(std::max<uint32_t>(argument_size, 1));
+    const uint32_t first_temporary = m_next_register;
+    int32_t offset = base;
+    for (std::size_t i = 0; i < arguments.size() && i < parameter_types.size(); ++i) {
+        const PType &type = *parameter_types[i];
+        if (type.isScalar()) {
+            const int32_t value = compile(*arguments[i], type.isReal());
+            if (value != offset &&
+                !(value >= static_cast<int32_t>(first_temporary) && retarget(value, offset))) {
+                emit(Opcode::kMov, offset, value);
+            }
+            ++offset;
+            m_next_register = first_temporary;
+            continue;
+        }
+
+        // arrays are passed by value, one register per element
+        const uint32_t count = getElementCount(type);
+        const auto *array = dynamic_cast<const VariableReferenceNode *>(arguments[i].get());
+        const Location *location =
+            array == nullptr ? nullptr : findLocation(array->getName());
+        if (location == nullptr || !array->getIndices().empty()) {
+            reportError("only whole arrays can be passed to '" +
+                        p_func_invocation.getName() + "'");
+        } else {
+            emit(location->global ? Opcode::kGcopy : Opcode::kCopy, offset,
+                 location->index, static_cast<int32_t>(count));
+        }
+        offset += static_cast<int32_t>(count);
+    }
+
+    emit(Opcode::kCall, static_cast<int32_t>(id->second), base);
+    m_result = base;
+    m_next_register = discard_result ? mark : static_cast<uint32_t>(base) + 1;
+}
+
+void BytecodeCompiler::visit(VariableReferenceNode &p_variable_ref) {
+    const SymbolEntry *entry = m_symbol_manager_ptr->lookup(p_variable_ref.getName());
+    if (entry == nullptr) {
+        m_result = allocateRegisters();
+        return;
+    }
+
+    if (entry->getKind() == SymbolEntry::KindEnum::kConstantKind) {
+        m_result = allocateRegisters();
+        loadConstant(m_result, *entry->getAttribute().constant());
+        return;
+    }
+
+    const Location *location = findLocation(p_variable_ref.getName());
+    if (location == nullptr || !p_variable_ref.getInferredType()->isScalar()) {
+        reportError("arrays can only be used as arguments ('" +
+                    p_variable_ref.getName() + "')");
+        m_result = allocateRegisters();
+        return;
+    }
+
+    if (p_variable_ref.getIndices().empty()) {
+        if (location->global) {
+            m_result = allocateRegisters();
+            emit(Opcode::kGload, m_result, location->index);
+        } else {
+            m_result = location->index;
+        }
+        return;
+    }
+
+    const int32_t index = compileIndex(p_variable_ref);
+    m_result = allocateRegisters();
+    emit(location->global ? Opcode::kGloadIdx : Opcode::kLoadIdx, m_result,
+         location->index, index);
+}
+
+void BytecodeCompiler::visit(AssignmentNode &p_assignment) {
+    const uint32_t mark = m_next_register;
+    const VariableReferenceNode &lvalue = p_assignment.getLvalue();
+    const Location *location = findLocation(lvalue.getName());
+    const bool scalar = lvalue.getIndices().empty();
+
+    // g := g + e on a global integer is a single load-add-store
+    const auto *sum = dynamic_cast<const BinaryOperatorNode *>(&p_assignment.getExpr());
+    const auto *addend = sum == nullptr ? nullptr
+        : dynamic_cast<const VariableReferenceNode *>(&sum->getLeftOperand());
+    if (location != nullptr && location->global && scalar && addend != nullptr &&
+        sum->getOp() == Operator::kPlusOp && addend->getName() == lvalue.getName() &&
+        addend->getIndices().empty() && lvalue.getInferredType()->isInteger() &&
+        sum->getRightOperand().getInferredType()->isInteger()) {
+        emit(Opcode::kGaddStore, location->index, compile(sum->getRightOperand()));
+        m_next_register = mark;
+        return;
+    }
+
+    const int32_t value = compile(p_assignment.getExpr(),
+                                  lvalue.getInferredType()->isReal());
+    // write a local scalar directly instead of through a temporary
+    if (location == nullptr || location->global || !scalar ||
+        value < static_cast<int32_t>(mark) || !retarget(value, location->index)) {
+        store(lvalue, value);
+    }
+    m_next_register = mark;
+}
+
+void BytecodeCompiler::visit(ReadNode &p_read) {
+    const uint32_t mark = m_next_register;
+    const VariableReferenceNode &target = p_read.getTarget();
+    const Location *location = findLocation(target.getName());
+    const Opcode op = target.getInferredType()->isReal() ? Opcode::kReadReal
+                                                         : Opcode::kReadInt;
+
+    if (location != nullptr && !location->global && target.getIndices().empty()) {
+        emit(op, location->index);
+    } else {
+        const int32_t value = allocateRegisters();
+        emit(op, value);
+        store(target, value);
+    }
+    m_next_register = mark;
+}
+
+void BytecodeCompiler::visit(IfNode &p_if) {
+    const uint32_t mark = m_next_register;
+    const uint32_t to_else = compileBranch(p_if.getCondition(), false);
+    m_next_register = mark;
+
+    p_if.getBody().accept(*this);
+    if (p_if.getElseBody() == nullptr) {
+        patch(to_else, static_cast<uint32_t>(m_program.code.size()));
+        return;
+    }
+
+    const uint32_t to_end = emit(Opcode::kJump);
+    patch(to_else, static_cast<uint32_t>(m_program.code.size()));
+    p_if.getElseBody()->accept(*this);
+    patch(to_end, static_cast<uint32_t>(m_program.code.size()));
+}
+
+void BytecodeCompiler::visit(WhileNode &p_while) {
+    // test at the bottom, so that an iteration takes one branch
+    const uint32_t to_condition = emit(Opcode::kJump);
+    const uint32_t body = static_cast<uint32_t>(m_program.code.size());
+    p_while.getBody().accept(*this);
+    patch(to_condition, static_cast<uint32_t>(m_program.code.size()));
+
+    const uint32_t mark = m_next_register;
+    patch(compileBranch(p_while.getCondition(), true), body);
+    m_next_register = mark;
+}
+
+void BytecodeCompiler::visit(ForNode &p_for) {
+    m_symbol_manager_ptr->reconstructHashTableFromSymbolTable(
+        p_for.getSymbolTable());
+    const uint32_t mark = m_next_register;
+
+    p_for.getLoopVarDecl().accept(*this);
+    const_cast<AssignmentNode *>(p_for.getInitialStatement())->accept(*this);
+
+    // the upper bound is exclusive, as in CodeGenerator
+    const auto &loop_var = p_for.getInitialStatement()->getLvalue();
+    const int32_t counter = findLocation(loop_var.getName())->index;
+    const int32_t upper_bound =
+        static_cast<int32_t>(p_for.getUpperBound().getConstantPtr()->integer());
+    const uint32_t to_end = emit(Opcode::kBgeImm, counter, upper_bound);
+    const uint32_t body = static_cast<uint32_t>(m_program.code.size());
+    p_for.getBody().accept(*this);
+    emit(Opcode::kForLoop, counter, upper_bound, static_cast<int32_t>(body));
+    patch(to_end, static_cast<uint32_t>(m_program.code.size()));
+
+    m_next_register = mark;
+    popScope(p_for.getSymbolTable());
+    m_symbol_manager_ptr->removeSymbolsFromHashTable(p_for.getSymbolTable());
+}
+
+void BytecodeCompiler::visit(ReturnNode &p_return) {
+    const uint32_t mark = m_next_register;
+    const bool real = m_return_type_ptr != nullptr && m_return_type_ptr->isReal();
+    emit(Opcode::kReturn, compile(p_return.getReturnValue(), real));
+    m_next_register = mark;
+}
@@ -0,0 +1,295 @@
+#include "vm/VirtualMachine.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+struct ThreadedInstruction {
+    const void *handler;
+    int32_t a;
+    int32_t b;
+    int32_t c;
+};
+
+struct Frame {
+    const ThreadedInstruction *return_pc;
+    Value *fp;
+};
+
+// P integers wrap around like the RV32 instructions they compile to
+inline int32_t wrap(const uint32_t p_value) {
+    return static_cast<int32_t>(p_value);
+}
+
+} // namespace
+
+VirtualMachine::VirtualMachine(const BytecodeProgram &p_program)
+    : m_program(p_program), m_registers(kRegisterFileSize),
+      m_globals(std::max<uint32_t>(p_program.global_size, 1)) {}
+
+bool VirtualMachine::run() {
+    static const void *const kHandlers[] = {
+#define BYTECODE_HANDLER(name, mnemonic) &&op_##name,
+        BYTECODE_OPCODES(BYTECODE_HANDLER)
+#undef BYTECODE_HANDLER
+    };
+
+    std::vector<ThreadedInstruction> threaded;
+    threaded.reserve(m_program.code.size());
+    for (const BytecodeInstruction &inst : m_program.code) {
+        threaded.push_back({kHandlers[static_cast<int>(inst.op)], inst.a, inst.b, inst.c});
+    }
+
+    const BytecodeFunction &main_function = m_program.functions[m_program.main_function];
+    if (main_function.frame_size > kRegisterFileSize) {
+        m_error = "stack overflow";
+        return false;
+    }
+
+    std::vector<Frame> frames;
+    frames.reserve(64);
+    const ThreadedInstruction *const code = threaded.data();
+    const ThreadedInstruction *pc = code + main_function.entry;
+    Value *fp = m_registers.data();
+    Value *const registers_end = m_registers.data() + m_registers.size();
+    Value *const g = m_globals.data();
+    uint64_t executed = 0;
+
+#define DISPATCH()                                                             \
+    do {                                                                       \
+        ++executed;                                                            \
+        goto *pc->handler;                                                     \
+    } while (0)
+#define NEXT()                                                                 \
+    do {                                                                       \
+        ++pc;                                                                  \
+        DISPATCH();                                                            \
+    } while (0)
+#define BRANCH(condition)                                                      \
+    do {                                                                       \
+        pc = (condition) ? code + pc->c : pc + 1;                              \
+        DISPATCH();                                                            \
+    } while (0)
+
+    DISPATCH();
+
+op_kMov:
+    fp[pc->a] = fp[pc->b];
+    NEXT();
+op_kLoadImm:
+    fp[pc->a].i = pc->b;
+    NEXT();
+op_kLoadString:
+    fp[pc->a].s = m_program.strings[pc->b]->c_str();
+    NEXT();
+op_kGload:
+    fp[pc->a] = g[pc->b];
+    NEXT();
+op_kGstore:
+    g[pc->a] = fp[pc->b];
+    NEXT();
+op_kGloadIdx:
+    fp[pc->a] = g[pc->b + fp[pc->c].i];
+    NEXT();
+op_kGstoreIdx:
+    g[pc->a + fp[pc->b].i] = fp[pc->c];
+    NEXT();
+op_kLoadIdx:
+    fp[pc->a] = fp[pc->b + fp[pc->c].i];
+    NEXT();
+op_kStoreIdx:
+    fp[pc->a + fp[pc->b].i] = fp[pc->c];
+    NEXT();
+op_kCopy:
+    std::copy(fp + pc->b, fp + pc->b + pc->c, fp + pc->a);
+    NEXT();
+op_kGcopy:
+    std::copy(g + pc->b, g + pc->b + pc->c, fp + pc->a);
+    NEXT();
+op_kAdd:
+    fp[pc->a].i = wrap(static_cast<uint32_t>(fp[pc->b].i) + static_cast<uint32_t>(fp[pc->c].i));
+    NEXT();
+op_kSub:
+    fp[pc->a].i = wrap(static_cast<uint32_t>(fp[pc->b].i) - static_cast<uint32_t>(fp[pc->c].i));
+    NEXT();
+op_kMul:
+    fp[pc->a].i = wrap(static_cast<uint32_t>(fp[pc->b].i) * static_cast<uint32_t>(fp[pc->c].i));
+    NEXT();
+op_kDiv:
+    if (fp[pc->c].i == 0) {
+        m_error = "division by zero";
+        goto fail;
+    }
+    // INT_MIN / -1 overflows to INT_MIN, as div does
+    fp[pc->a].i = (fp[pc->c].i == -1) ? wrap(0u - static_cast<uint32_t>(fp[pc->b].i))
+                                      : fp[pc->b].i / fp[pc->c].i;
+    NEXT();
+op_kMod:
+    if (fp[pc->c].i == 0) {
+        m_error = "division by zero";
+        goto fail;
+    }
+    fp[pc->a].i = (fp[pc->c].i == -1) ? 0 : fp[pc->b].i % fp[pc->c].i;
+    NEXT();
+op_kAnd:
+    fp[pc->a].i = fp[pc->b].i & fp[pc->c].i;
+    NEXT();
+op_kOr:
+    fp[pc->a].i = fp[pc->b].i | fp[pc->c].i;
+    NEXT();
+op_kAddImm:
+    fp[pc->a].i = wrap(static_cast<uint32_t>(fp[pc->b].i) + static_cast<uint32_t>(pc->c));
+    NEXT();
+op_kMulImm:
+    fp[pc->a].i = wrap(static_cast<uint32_t>(fp[pc->b].i) * static_cast<uint32_t>(pc->c));
+    NEXT();
+op_kNeg:
+    fp[pc->a].i = wrap(0u - static_cast<uint32_t>(fp[pc->b].i));
+    NEXT();
+op_kNot:
+    fp[pc->a].i = !fp[pc->b].i;
+    NEXT();
+op_kLt:
+    fp[pc->a].i = fp[pc->b].i < fp[pc->c].i;
+    NEXT();
+op_kLe:
+    fp[pc->a].i = fp[pc->b].i <= fp[pc->c].i;
+    NEXT();
+op_kGt:
+    fp[pc->a].i = fp[pc->b].i > fp[pc->c].i;
+    NEXT();
+op_kGe:
+    fp[pc->a].i = fp[pc->b].i >= fp[pc->c].i;
+    NEXT();
+op_kEq:
+    fp[pc->a].i = fp[pc->b].i == fp[pc->c].i;
+    NEXT();
+op_kNe:
+    fp[pc->a].i = fp[pc->b].i != fp[pc->c].i;
+    NEXT();
+op_kFadd:
+    fp[pc->a].f = fp[pc->b].f + fp[pc->c].f;
+    NEXT();
+op_kFsub:
+    fp[pc->a].f = fp[pc->b].f - fp[pc->c].f;
+    NEXT();
+op_kFmul:
+    fp[pc->a].f = fp[pc->b].f * fp[pc->c].f;
+    NEXT();
+op_kFdiv:
+    fp[pc->a].f = fp[pc->b].f / fp[pc->c].f;
+    NEXT();
+op_kFneg:
+    fp[pc->a].f = -fp[pc->b].f;
+    NEXT();
+op_kFlt:
+    fp[pc->a].i = fp[pc->b].f < fp[pc->c].f;
+    NEXT();
+op_kFle:
+    fp[pc->a].i = fp[pc->b].f <= fp[pc->c].f;
+    NEXT();
+op_kFgt:
+    fp[pc->a].i = fp[pc->b].f > fp[pc->c].f;
+    NEXT();
+op_kFge:
+    fp[pc->a].i = fp[pc->b].f >= fp[pc->c].f;
+    NEXT();
+op_kFeq:
+    fp[pc->a].i = fp[pc->b].f == fp[pc->c].f;
+    NEXT();
+op_kFne:
+    fp[pc->a].i = fp[pc->b].f != fp[pc->c].f;
+    NEXT();
+op_kIntToReal:
+    fp[pc->a].f = static_cast<float>(fp[pc->b].i);
+    NEXT();
+op_kJump:
+    pc = code + pc->a;
+    DISPATCH();
+op_kJumpIfZero:
+    pc = (fp[pc->a].i == 0) ? code + pc->b : pc + 1;
+    DISPATCH();
+op_kJumpIfNotZero:
+    pc = (fp[pc->a].i != 0) ? code + pc->b : pc + 1;
+    DISPATCH();
+op_kGaddStore:
+    g[pc->a].i = wrap(static_cast<uint32_t>(g[pc->a].i) + static_cast<uint32_t>(fp[pc->b].i));
+    NEXT();
+op_kBlt:
+    BRANCH(fp[pc->a].i < fp[pc->b].i);
+op_kBle:
+    BRANCH(fp[pc->a].i <= fp[pc->b].i);
+op_kBgt:
+    BRANCH(fp[pc->a].i > fp[pc->b].i);
+op_kBge:
+    BRANCH(fp[pc->a].i >= fp[pc->b].i);
+op_kBeq:
+    BRANCH(fp[pc->a].i == fp[pc->b].i);
+op_kBne:
+    BRANCH(fp[pc->a].i != fp[pc->b].i);
+op_kBgeImm:
+    BRANCH(fp[pc->a].i >= pc->b);
+op_kForLoop:
+    BRANCH(++fp[pc->a].i < pc->b);
+op_kCall: {
+    const BytecodeFunction &callee = m_program.functions[pc->a];
+    Value *const callee_fp = fp + pc->b;
+    if (frames.size() >= kMaxCallDepth ||
+        callee.frame_size > static_cast<std::size_t>(registers_end - callee_fp)) {
+        m_error = "stack overflow in call to '" + callee.name + "'";
+        goto fail;
+    }
+    frames.push_back({pc + 1, fp});
+    fp = callee_fp;
+    pc = code + callee.entry;
+    DISPATCH();
+}
+op_kReturn:
+    // the caller expects the result in its r[base], which is our r[0]
+    fp[0] = fp[pc->a];
+    // fall through
+op_kReturnVoid:
+    if (frames.empty()) {
+        goto done;
+    }
+    pc = frames.back().return_pc;
+    fp = frames.back().fp;
+    frames.pop_back();
+    DISPATCH();
+op_kPrintInt:
+    printf("%d\n", fp[pc->a].i);
+    NEXT();
+op_kPrintReal:
+    printf("%f\n", fp[pc->a].f);
+    NEXT();
+op_kPrintString:
+    printf("%s\n", fp[pc->a].s);
+    NEXT();
+op_kReadInt:
+    if (scanf("%d", &fp[pc->a].i) != 1) {
+        fp[pc->a].i = 0;
+    }
+    NEXT();
+op_kReadReal:
+    if (scanf("%f", &fp[pc->a].f) != 1) {
+        fp[pc->a].f = 0.0f;
+    }
+    NEXT();
+op_kHalt:
+    goto done;
+
+#undef BRANCH
+#undef NEXT
+#undef DISPATCH
+
+done:
+    m_executed = executed;
+    fflush(stdout);
+    return true;
+
+fail:
+    m_executed = executed;
+    fflush(stdout);
+    return false;
+}
@@ -21,6 +21,13 @@
 
 #include "sema/SemanticAnalyzer.hpp"
 #include "codegen/CodeGenerator.hpp"
+#include "codegen/RiscvAssembler.hpp"
+#include "codegen/X86CodeGenerator.hpp"
+#include "codegen/CCodeGenerator.hpp"
+#include "driver/TimeTrace.hpp"
+#include "simulator/Simulator.hpp"
+#include "vm/BytecodeCompiler.hpp"
+#include "vm/VirtualMachine.hpp"
 
 #include "AST/constant.hpp"
 #include "AST/operator.hpp"
@@ -752,40 +759,443 @@ void yyerror(const char *msg) {
     exit(-1);
 }
 
+static void usage() {
+    fprintf(stderr,
+            "Usage: ./compiler <filename> [options]\n"
+            "Options:\n"
+            "  --target=riscv32|x86_64|c   riscv32 writes a .S file, x86_64 a .s\n"
+            "                              file and c a C99 .c file, both to link\n"
+            "                              with a host build of io.c\n"
+            "  --dump-ast                  dump the AST\n"
+            "  --save-path <save path>     directory of the generated .S file\n"
+            "  --real=soft-float           lower real to libgcc soft-float calls\n"
+            "  --real=fixed-point          lower real to Q16.16 fixed-point\n"
+            "  -march=rv32im|rv32imac      target ISA, rv32imac emits RV32C\n"
+            "  --size-report               compare rv32im and rv32imac code size\n"
+            "  --cost-report[=<model>]     instruction mix, frame and a static\n"
+            "                              cycle estimate per basic block of each\n"
+            "                              function, on the -mtune core or inorder\n"
+            "  --emit=asm|obj|asm,obj      write a .S file and/or a relocatable .o\n"
+            "  -mabi=ilp32d|ilp32          float ABI recorded in the .o\n"
+            "  --simulate                  run the program on the built-in RV32IMC\n"
+            "                              simulator and report instruction and\n"
+            "                              cycle counts on stderr\n"
+            "  --core=<model>[:k=v,...]    core model for --simulate: ideal,\n"
+            "                              bumblebee or inorder; keys alu, load,\n"
+            "                              mul, div, muldiv-blocking, branch, jump\n"
+            "  -mtune=<model>[:k=v,...]    schedule basic blocks for a core model\n"
+            "                              given like --core (-O2 and -Os)\n"
+            "  --run                       compile to bytecode and execute it on\n"
+            "                              the built-in virtual machine\n"
+            "  --dump-bytecode             print the bytecode --run executes\n"
+            "  --profile-generate[=file]   count function entries, if arms and\n"
+            "                              loop iterations into file (default\n"
+            "                              <source>.prof) when the program exits\n"
+            "  --profile-use=file          lay out if arms, place cold functions,\n"
+            "                              unroll hot loops and inline hot leaf\n"
+            "                              functions by a --profile-generate run\n"
+            "  -g                          emit .loc directives mapping the code\n"
+            "                              of each statement to its source line\n"
+            "  --pc-profile=file           with --simulate: write the execution\n"
+            "                              count of each instruction, and the\n"
+            "                              functions and lines of the code, for\n"
+            "                              test/bench/lineprof.py; implies -g\n"
+            "  --bounds-check              trap on out-of-bounds array indices\n"
+            "                              unless proven in range at compile time\n"
+            "  -O0|-O1|-O2|-Os             riscv32 optimization level: none, the\n"
+            "                              passes that cost little compile time,\n"
+            "                              all (default), or all that do not copy\n"
+            "                              code\n"
+            "  -f<pass>, -fno-<pass>       enable or disable a pass of the level;\n"
+            "                              a pass runs with the analyses it needs\n"
+            "  --print-passes              list the passes and which of them run\n"
+            "  -Rpass=<passes>             report where the passes, given by name\n"
+            "                              or as all, transformed the code\n"
+            "  -Rpass-missed=<passes>      report where they did not, and why\n"
+            "  --remarks-output=file       record both kinds of remark as YAML, or\n"
+            "                              as JSON for a .json file\n"
+            "  --time-report               print wall and CPU time per phase,\n"
+            "                              pass and function on stderr\n"
+            "  --trace=file.json           write those spans as a Chrome trace\n"
+            "  --mem-report                print heap allocations and resident\n"
+            "                              set size per phase, and the AST nodes,\n"
+            "                              PTypes and symbols made, on stderr\n"
+            "  --no-scalar-replacement     -fno-scalar-replace: keep the address\n"
+            "                              computation of array elements at known\n"
+            "                              indices\n"
+            "  --no-specialize             -fno-specialize: do not clone functions\n"
+            "                              for constant arguments\n"
+            "  --memoize                   -fmemoize: cache the results of pure\n"
+            "                              integer functions of one integer argument\n"
+            "  --pad-arrays                -fpad-arrays: pad inner dimensions of\n"
+            "                              local arrays to powers of two and report\n"
+            "                              the overhead\n");
+}
+
+static bool simulate(const char *p_source, const AssemblyBuffer &p_asm,
+                     const CodeGenOptions &p_options, const CoreModel &p_core,
+                     const std::string &p_pc_profile_path) {
+    ObjectFile object;
+    object.double_float_abi = p_options.double_float_abi;
+    RiscvAssembler assembler;
+    if (!assembler.assemble(p_asm, object)) {
+        fprintf(stderr, "%s: assembler error: %s\n", p_source,
+                assembler.getError().c_str());
+        return false;
+    }
+
+    Simulator simulator(p_core);
+    if (!p_pc_profile_path.empty()) {
+        simulator.countPcs();
+    }
+    bool ok = simulator.load(object) && simulator.run();
+    fflush(stdout);
+    if (!ok) {
+        fprintf(stderr, "%s: simulation error: %s\n", p_source,
+                simulator.getError().c_str());
+    }
+    simulator.dumpStatistics(stderr, p_source);
+    if (!p_pc_profile_path.empty() &&
+        !simulator.writePcProfile(p_pc_profile_path, p_source)) {
+        fprintf(stderr, "%s: cannot write %s\n", p_source, p_pc_profile_path.c_str());
+        ok = false;
+    }
+    return ok;
+}
+
+static bool runBytecode(const char *p_source, AstNode &p_root,
+                        const SymbolManager *p_symbol_manager,
+                        const bool p_dump) {
+    BytecodeProgram program;
+    BytecodeCompiler compiler(p_symbol_manager, program);
+    {
+        TimeScope scope("bytecode");
+        p_root.accept(compiler);
+    }
+    if (compiler.hasError()) {
+        fprintf(stderr, "%s: bytecode error: %s\n", p_source,
+                compiler.getError().c_str());
+        return false;
+    }
+    if (p_dump) {
+        program.dump(stderr);
+    }
+
+    TimeScope scope("vm");
+    VirtualMachine vm(program);
+    if (!vm.run()) {
+        fprintf(stderr, "%s: runtime error: %s\n", p_source,
+                vm.getError().c_str());
+        return false;
+    }
+    if (p_dump) {
+        fprintf(stderr, "%s: executed %llu bytecode instructions\n", p_source,
+                static_cast<unsigned long long>(vm.getExecutedCount()));
+    }
+    return true;
+}
+
 int main(int argc, const char *argv[]) {
     if (argc < 2) {
-        fprintf(stderr, "Usage: ./compiler <filename> --save-path [save path]\n");
+        usage();
+        exit(-1);
+    }
+
+    bool opt_dump_ast = false;
+    bool opt_simulate = false;
+    enum class Target { kRiscv32, kX86_64, kC } target = Target::kRiscv32;
+    bool opt_run = false;
+    bool opt_dump_bytecode = false;
+    bool opt_print_passes = false;
+    bool opt_time_report = false;
+    bool opt_mem_report = false;
+    std::string trace_path;
+    std::string pc_profile_path;
+    CoreModel core_model;
+    bool cost_core_given = false;
+    const char *save_path = "";
+    CodeGenOptions codegen_options;
+    for (int i = 2; i < argc; ++i) {
+        if (strcmp(argv[i], "--dump-ast") == 0) {
+            opt_dump_ast = true;
+        } else if (strcmp(argv[i], "--save-path") == 0 && i + 1 < argc) {
+            save_path = argv[++i];
+        } else if (strcmp(argv[i], "--real=soft-float") == 0) {
+            codegen_options.real_lowering = RealLowering::kSoftFloat;
+        } else if (strcmp(argv[i], "--real=fixed-point") == 0) {
+            codegen_options.real_lowering = RealLowering::kFixedPoint;
+        } else if (strcmp(argv[i], "-march=rv32im") == 0) {
+            codegen_options.compressed = false;
+        } else if (strcmp(argv[i], "-march=rv32imac") == 0) {
+            codegen_options.compressed = true;
+        } else if (strcmp(argv[i], "--size-report") == 0) {
+            codegen_options.size_report = true;
+        } else if (strcmp(argv[i], "--cost-report") == 0) {
+            codegen_options.cost_report = true;
+        } else if (strncmp(argv[i], "--cost-report=", 14) == 0) {
+            if (!CoreModel::parse(argv[i] + 14, codegen_options.cost_core)) {
+                fprintf(stderr, "Bad core model: %s\n", argv[i] + 14);
+                usage();
+                exit(-1);
+            }
+            codegen_options.cost_report = true;
+            cost_core_given = true;
+        } else if (strcmp(argv[i], "--emit=asm") == 0) {
+            codegen_options.emit_assembly = true;
+            codegen_options.emit_object = false;
+        } else if (strcmp(argv[i], "--emit=obj") == 0) {
+            codegen_options.emit_assembly = false;
+            codegen_options.emit_object = true;
+        } else if (strcmp(argv[i], "--emit=asm,obj") == 0) {
+            codegen_options.emit_assembly = true;
+            codegen_options.emit_object = true;
+        } else if (strcmp(argv[i], "-mabi=ilp32d") == 0) {
+            codegen_options.double_float_abi = true;
+        } else if (strcmp(argv[i], "-mabi=ilp32") == 0) {
+            codegen_options.double_float_abi = false;
+        } else if (strcmp(argv[i], "--target=riscv32") == 0) {
+            target = Target::kRiscv32;
+        } else if (strcmp(argv[i], "--target=x86_64") == 0) {
+            target = Target::kX86_64;
+        } else if (strcmp(argv[i], "--target=c") == 0) {
+            target = Target::kC;
+        } else if (strcmp(argv[i], "--simulate") == 0) {
+            opt_simulate = true;
+        } else if (strcmp(argv[i], "--run") == 0) {
+            opt_run = true;
+        } else if (strcmp(argv[i], "--dump-bytecode") == 0) {
+            opt_dump_bytecode = true;
+        } else if (strcmp(argv[i], "--profile-generate") == 0) {
+            const std::string source(argv[1]);
+            codegen_options.profile_generate_path =
+                source.substr(0, source.rfind('.')) + ".prof";
+        } else if (strncmp(argv[i], "--profile-generate=", 19) == 0) {
+            codegen_options.profile_generate_path = argv[i] + 19;
+        } else if (strncmp(argv[i], "--profile-use=", 14) == 0) {
+            codegen_options.profile_use_path = argv[i] + 14;
+        } else if (strcmp(argv[i], "--pad-arrays") == 0) {
+            codegen_options.passes.setEnabled("pad-arrays", true);
+        } else if (strcmp(argv[i], "--memoize") == 0) {
+            codegen_options.passes.setEnabled("memoize", true);
+        } else if (strcmp(argv[i], "--no-specialize") == 0) {
+            codegen_options.passes.setEnabled("specialize", false);
+        } else if (strcmp(argv[i], "--no-scalar-replacement") == 0) {
+            codegen_options.passes.setEnabled("scalar-replace", false);
+        } else if (strncmp(argv[i], "-O", 2) == 0) {
+            OptLevel level;
+            if (!PassManager::parseLevel(argv[i] + 2, level)) {
+                fprintf(stderr, "Bad optimization level: %s\n", argv[i]);
+                usage();
+                exit(-1);
+            }
+            codegen_options.passes.setLevel(level);
+        } else if (strncmp(argv[i], "-fno-", 5) == 0 || strncmp(argv[i], "-f", 2) == 0) {
+            const bool enable = strncmp(argv[i], "-fno-", 5) != 0;
+            const char *name = argv[i] + (enable ? 2 : 5);
+            if (!codegen_options.passes.setEnabled(name, enable)) {
+                fprintf(stderr, "Unknown pass: %s\n", name);
+                usage();
+                exit(-1);
+            }
+        } else if (strncmp(argv[i], "-Rpass=", 7) == 0 ||
+                   strncmp(argv[i], "-Rpass-missed=", 14) == 0) {
+            const bool missed = strncmp(argv[i], "-Rpass-missed=", 14) == 0;
+            const char *passes = argv[i] + (missed ? 14 : 7);
+            if (!RemarkOptions::parsePasses(passes, missed ? codegen_options.remarks.missed
+                                                           : codegen_options.remarks.passed)) {
+                fprintf(stderr, "Unknown pass in: %s\n", passes);
+                usage();
+                exit(-1);
+            }
+        } else if (strncmp(argv[i], "--remarks-output=", 17) == 0 && argv[i][17] != '\0') {
+            codegen_options.remarks.output_path = argv[i] + 17;
+        } else if (strcmp(argv[i], "--print-passes") == 0) {
+            opt_print_passes = true;
+        } else if (strcmp(argv[i], "--time-report") == 0) {
+            opt_time_report = true;
+        } else if (strcmp(argv[i], "--mem-report") == 0) {
+            opt_mem_report = true;
+        } else if (strncmp(argv[i], "--trace=", 8) == 0 && argv[i][8] != '\0') {
+            trace_path = argv[i] + 8;
+        } else if (strcmp(argv[i], "-g") == 0) {
+            codegen_options.line_table = true;
+        } else if (strncmp(argv[i], "--pc-profile=", 13) == 0 && argv[i][13] != '\0') {
+            pc_profile_path = argv[i] + 13;
+            codegen_options.line_table = true;
+        } else if (strcmp(argv[i], "--bounds-check") == 0) {
+            codegen_options.bounds_check = true;
+        } else if (strncmp(argv[i], "-mtune=", 7) == 0) {
+            if (!CoreModel::parse(argv[i] + 7, codegen_options.tune)) {
+                fprintf(stderr, "Bad core model: %s\n", argv[i] + 7);
+                usage();
+                exit(-1);
+            }
+            codegen_options.schedule = true;
+        } else if (strncmp(argv[i], "--core=", 7) == 0) {
+            if (!CoreModel::parse(argv[i] + 7, core_model)) {
+                fprintf(stderr, "Bad core model: %s\n", argv[i] + 7);
+                usage();
+                exit(-1);
+            }
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            usage();
+            exit(-1);
+        }
+    }
+
+    if (opt_simulate && target != Target::kRiscv32) {
+        fprintf(stderr, "--simulate runs riscv32 code only\n");
+        usage();
+        exit(-1);
+    }
+    if (codegen_options.cost_report && (opt_run || target != Target::kRiscv32)) {
+        fprintf(stderr, "--cost-report is riscv32 only\n");
+        usage();
+        exit(-1);
+    }
+    if (codegen_options.cost_report && !cost_core_given) {
+        if (codegen_options.schedule) {
+            codegen_options.cost_core = codegen_options.tune;
+        } else {
+            CoreModel::parse("inorder", codegen_options.cost_core);
+        }
+    }
+    if (!pc_profile_path.empty() && !opt_simulate) {
+        fprintf(stderr, "--pc-profile needs --simulate\n");
+        usage();
+        exit(-1);
+    }
+    if (opt_run && (opt_simulate || target != Target::kRiscv32)) {
+        fprintf(stderr, "--run cannot be combined with --simulate or --target\n");
+        usage();
+        exit(-1);
+    }
+
+    const bool opt_profile = !codegen_options.profile_generate_path.empty() ||
+                             !codegen_options.profile_use_path.empty();
+    if (!codegen_options.profile_generate_path.empty() &&
+        !codegen_options.profile_use_path.empty()) {
+        fprintf(stderr, "--profile-generate and --profile-use are exclusive\n");
+        usage();
+        exit(-1);
+    }
+    if (opt_profile && (opt_run || target != Target::kRiscv32)) {
+        fprintf(stderr, "profile-guided builds are riscv32 only\n");
+        usage();
         exit(-1);
     }
+    if (codegen_options.bounds_check && (opt_run || target != Target::kRiscv32)) {
+        fprintf(stderr, "--bounds-check is riscv32 only\n");
+        usage();
+        exit(-1);
+    }
+    if ((codegen_options.passes.isEnabled(PassId::kMemoize) ||
+         codegen_options.passes.isEnabled(PassId::kPadArrays)) &&
+        (opt_run || target != Target::kRiscv32)) {
+        fprintf(stderr, "--memoize and --pad-arrays are riscv32 only\n");
+        usage();
+        exit(-1);
+    }
+
+    if (opt_print_passes) {
+        codegen_options.passes.dumpPasses(stderr);
+    }
+
+    if (opt_time_report || !trace_path.empty()) {
+        TimeTracer::get().enable();
+    }
+    if (opt_mem_report) {
+        TimeTracer::get().enableMemory();
+    }
 
     yyin = fopen(argv[1], "r");
     if (yyin == NULL) {
         perror("fopen() failed:");
     }
 
-    yyparse();
+    {
+        TimeScope scope("parse");
+        yyparse();
+    }
 
-    if (argc >= 3 && strcmp(argv[2], "--dump-ast") == 0) {
+    if (opt_dump_ast) {
+        TimeScope scope("dump-ast");
         AstDumper ast_dumper;
         root->accept(ast_dumper);
     }
 
     SemanticAnalyzer sema_analyzer(opt_dmp);
-    root->accept(sema_analyzer);
-
-    CodeGenerator code_generator(argv[1], (argc == 4) ? argv[3] : "",
-                                 sema_analyzer.getSymbolManager());
-    root->accept(code_generator);
-
-    if (!sema_analyzer.hasError()) {
+    {
+        TimeScope scope("semantic analysis");
+        root->accept(sema_analyzer);
+    }
+
+    bool failed = false;
+    if (opt_run) {
+        // the program's own output is all that goes to stdout
+        failed = sema_analyzer.hasError() ||
+                 !runBytecode(argv[1], *root, sema_analyzer.getSymbolManager(),
+                              opt_dump_bytecode);
+    } else if (target == Target::kX86_64) {
+        TimeScope scope("codegen", "x86_64");
+        X86CodeGenerator x86_code_generator(argv[1], save_path,
+                                            sema_analyzer.getSymbolManager());
+        root->accept(x86_code_generator);
+    } else if (target == Target::kC) {
+        TimeScope scope("codegen", "c");
+        CCodeGenerator c_code_generator(argv[1], save_path,
+                                        sema_analyzer.getSymbolManager());
+        root->accept(c_code_generator);
+    } else {
+        CodeGenerator code_generator(argv[1], save_path,
+                                     sema_analyzer.getSymbolManager(),
+                                     codegen_options);
+        {
+            TimeScope scope("codegen", "riscv32");
+            root->accept(code_generator);
+        }
+
+        failed = code_generator.hasError();
+        if (opt_simulate && code_generator.needsFloatExtension()) {
+            fprintf(stderr,
+                    "%s: simulation error: unsupported instruction (F extension); "
+                    "lower real with --real=soft-float or --real=fixed-point\n",
+                    argv[1]);
+            failed = true;
+        } else if (opt_simulate) {
+            TimeScope scope("simulate");
+            // the program's own output is all that goes to stdout
+            failed = sema_analyzer.hasError() ||
+                     !simulate(argv[1], code_generator.getAssembly(),
+                               codegen_options, core_model, pc_profile_path) ||
+                     failed;
+        }
+    }
+
+    if (!opt_simulate && !opt_run && !sema_analyzer.hasError()) {
         printf("\n"
                "|---------------------------------------------------|\n"
                "|  There is no syntactic error and semantic error!  |\n"
                "|---------------------------------------------------|\n");
     }
 
+    if (opt_time_report) {
+        TimeTracer::get().dumpReport(stderr, argv[1]);
+    }
+    if (opt_mem_report) {
+        TimeTracer::get().dumpMemoryReport(stderr, argv[1]);
+    }
+    if (!trace_path.empty()) {
+        std::string error;
+        if (!TimeTracer::get().writeChromeTrace(trace_path, error)) {
+            fprintf(stderr, "%s: %s\n", argv[1], error.c_str());
+            failed = true;
+        }
+    }
+
     delete root;
     fclose(yyin);
     yylex_destroy();
-    return 0;
+    return failed ? -1 : 0;
 }
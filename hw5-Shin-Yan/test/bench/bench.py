@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+
+# Times the kernels in this directory on the compiler's bytecode VM
+# (--run), as C built with the host compiler (--target=c) for a best-case
+# native reference and, when the RISC-V toolchain is installed, on
+# spike + pk.
+
+import glob
+import os
+import shutil
+import subprocess
+import time
+from argparse import ArgumentParser
+
+def best_time(cmd, repeat):
+    best = None
+    output = None
+    for _ in range(repeat):
+        start = time.perf_counter()
+        proc = subprocess.run(cmd, shell=True, stdout=subprocess.PIPE,
+                              stderr=subprocess.DEVNULL)
+        elapsed = time.perf_counter() - start
+        if proc.returncode != 0:
+            return None, None
+        best = elapsed if best is None else min(best, elapsed)
+        output = proc.stdout
+    return best, output
+
+def main():
+    bench_dir = os.path.dirname(os.path.abspath(__file__))
+    parser = ArgumentParser()
+    parser.add_argument("--compiler", help="Compiler to benchmark.",
+                        default=os.path.join(bench_dir, "../../src/compiler"))
+    parser.add_argument("--io-file", help="IO file for io function",
+                        default=os.path.join(bench_dir, "../io.c"))
+    parser.add_argument("--pk", help="Proxy kernel for spike.",
+                        default="/risc-v/riscv32-unknown-elf/bin/pk")
+    parser.add_argument("--repeat", type=int, default=3)
+    parser.add_argument("--work-dir", default="./bench_build")
+    args = parser.parse_args()
+
+    have_spike = (shutil.which("spike") is not None and
+                  shutil.which("riscv32-unknown-elf-gcc") is not None)
+    if not have_spike:
+        print("spike or riscv32-unknown-elf-gcc not found; skipping the spike column")
+    os.makedirs(args.work_dir, exist_ok=True)
+
+    print("%-16s %12s %12s %12s %10s" %
+          ("kernel", "host C (s)", "vm (s)", "spike (s)", "vm/spike"))
+    for kernel in sorted(glob.glob(os.path.join(bench_dir, "*.p"))):
+        name = os.path.splitext(os.path.basename(kernel))[0]
+        vm_time, vm_output = best_time(
+            "%s %s --run < /dev/null" % (args.compiler, kernel), args.repeat)
+
+        native_time = None
+        executable = os.path.join(args.work_dir, name + "-c")
+        if subprocess.run("%s %s --target=c --save-path %s > /dev/null && "
+                          "gcc -std=c99 -O2 -fwrapv %s/%s.c %s -o %s" %
+                          (args.compiler, kernel, args.work_dir, args.work_dir,
+                           name, args.io_file, executable), shell=True).returncode == 0:
+            native_time, native_output = best_time(
+                "%s < /dev/null" % executable, args.repeat)
+            if native_output is not None and native_output != vm_output:
+                print("%s: output differs between the VM and the C build" % name)
+
+        spike_time = None
+        if have_spike:
+            executable = os.path.join(args.work_dir, name)
+            subprocess.run("%s %s --save-path %s > /dev/null && "
+                           "riscv32-unknown-elf-gcc %s/%s.S %s -o %s" %
+                           (args.compiler, kernel, args.work_dir, args.work_dir,
+                            name, args.io_file, executable), shell=True)
+            spike_time, spike_output = best_time(
+                "spike --isa=RV32 %s %s < /dev/null" % (args.pk, executable),
+                args.repeat)
+            # pk prints its banner first
+            if (spike_output is not None and vm_output is not None and
+                    spike_output.split(b"\n", 1)[-1] != vm_output):
+                print("%s: output differs between the VM and spike" % name)
+
+        def show(value):
+            return "-" if value is None else "%.3f" % value
+        speedup = "-"
+        if vm_time and spike_time:
+            speedup = "%.1fx" % (spike_time / vm_time)
+        print("%-16s %12s %12s %12s %10s" % (name, show(native_time), show(vm_time),
+                                             show(spike_time), speedup))
+
+if __name__ == "__main__":
+    main()
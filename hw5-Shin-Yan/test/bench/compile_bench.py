@@ -0,0 +1,104 @@
+#!/usr/bin/env python3
+
+# Measures how the compiler scales with its input: generates programs of
+# several sizes with genprog.py, compiles each with --time-report and
+# --mem-report, and prints lines/second and the memory of each top-level
+# phase, so that a phase that grows faster than the input stands out.
+
+import os
+import re
+import subprocess
+import sys
+from argparse import ArgumentParser
+
+# functions, nesting depth, expression terms, declaration width, array size
+SIZES = {
+    "small": (10, 3, 4, 8, 1024),
+    "medium": (100, 4, 8, 16, 16384),
+    "large": (1000, 5, 12, 32, 262144),
+    "huge": (4000, 6, 16, 64, 1048576),
+}
+
+TIME_ROW = re.compile(r"^  (\S.*?)\s+([\d.]+)\s+([\d.]+)(?:\s+[\d.]+%)?$")
+MEMORY_ROW = re.compile(r"^  (\S.*?)\s+(\d+)\s+([\d.]+)\s+([\d.]+)\s+([\d.]+)$")
+
+# the top-level rows of both reports; nested spans are indented further
+def parse_reports(text):
+    phases = {}
+    section = None
+    for line in text.splitlines():
+        if "Time report" in line:
+            section = "time"
+        elif "Memory report" in line:
+            section = "memory"
+        elif line.startswith("  heap:"):
+            section = None
+        elif section == "time":
+            match = TIME_ROW.match(line)
+            if match:
+                phases.setdefault(match.group(1), {})["wall_ms"] = float(match.group(2))
+        elif section == "memory":
+            match = MEMORY_ROW.match(line)
+            if match:
+                phase = phases.setdefault(match.group(1), {})
+                phase["allocs"] = int(match.group(2))
+                phase["kib"] = float(match.group(3))
+                phase["peak_mib"] = float(match.group(5))
+    return phases
+
+def main():
+    bench_dir = os.path.dirname(os.path.abspath(__file__))
+    parser = ArgumentParser()
+    parser.add_argument("--compiler", help="Compiler to benchmark.",
+                        default=os.path.join(bench_dir, "../../src/compiler"))
+    # large takes about 40 s and 5 GiB at -O2
+    parser.add_argument("--sizes", default="small,medium",
+                        help="Comma-separated sizes among %s." % ", ".join(SIZES))
+    parser.add_argument("--compiler-flags", default="",
+                        help="Extra flags, e.g. -O0 or --target=c.")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--work-dir", default="./bench_build")
+    args = parser.parse_args()
+
+    os.makedirs(args.work_dir, exist_ok=True)
+    print("%-8s %8s  %-20s %10s %12s %10s %10s %9s" %
+          ("size", "lines", "phase", "wall ms", "lines/s", "allocs", "KiB", "peak MiB"))
+    for size in args.sizes.split(","):
+        if size not in SIZES:
+            sys.exit("unknown size '%s'" % size)
+        functions, depth, terms, width, array_size = SIZES[size]
+        name = "gen" + size
+        source = os.path.join(args.work_dir, name + ".p")
+        subprocess.run([sys.executable, os.path.join(bench_dir, "genprog.py"),
+                        "--functions", str(functions), "--depth", str(depth),
+                        "--expr-terms", str(terms), "--decl-width", str(width),
+                        "--array-size", str(array_size), "--seed", str(args.seed),
+                        "--name", name, "-o", source], check=True)
+        with open(source) as program:
+            lines = sum(1 for _ in program)
+
+        proc = subprocess.run("%s %s --save-path %s --time-report --mem-report %s" %
+                              (args.compiler, source, args.work_dir, args.compiler_flags),
+                              shell=True, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE,
+                              universal_newlines=True)
+        if proc.returncode != 0:
+            print("%-8s %8d  compiler failed:\n%s" % (size, lines, proc.stderr))
+            continue
+
+        phases = parse_reports(proc.stderr)
+        total_ms = 0.0
+        for phase, row in phases.items():
+            wall_ms = row.get("wall_ms", 0.0)
+            if phase == "total":
+                total_ms = wall_ms
+                continue
+            rate = lines / (wall_ms / 1000.0) if wall_ms > 0 else 0.0
+            print("%-8s %8d  %-20s %10.1f %12.0f %10d %10.1f %9.1f" %
+                  (size, lines, phase, wall_ms, rate, row.get("allocs", 0),
+                   row.get("kib", 0.0), row.get("peak_mib", 0.0)))
+        if total_ms > 0:
+            print("%-8s %8d  %-20s %10.1f %12.0f" %
+                  (size, lines, "total", total_ms, lines / (total_ms / 1000.0)))
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,24 @@
+//&S-
+//&T-
+//&D-
+
+fibonacci;
+
+fib(n: integer): integer
+begin
+    if n < 2 then
+    begin
+        return n;
+    end
+    else
+    begin
+        return fib(n - 1) + fib(n - 2);
+    end
+    end if
+end
+end
+
+begin
+    print fib(30);
+end
+end
@@ -0,0 +1,195 @@
+#!/usr/bin/env python3
+
+# Writes a valid P program of a chosen size for compile-throughput
+# measurements: many functions, nested blocks, long expressions, wide
+# declarations and large arrays. The same arguments and seed always give
+# the same program. Functions only call the few before them and loops have
+# constant trip counts, so a program terminates, but the calls in loops
+# make its run time exponential in the number of functions: it is meant
+# to be compiled, not run.
+
+import random
+import sys
+from argparse import ArgumentParser
+
+class Generator:
+    def __init__(self, args):
+        self.args = args
+        self.rng = random.Random(args.seed)
+        self.lines = []
+        self.indent = 0
+
+    def emit(self, text=""):
+        self.lines.append("    " * self.indent + text if text else "")
+
+    # scalar integer variables readable in the current function
+    def readable(self, scope):
+        return scope["vars"] + scope["loop_vars"] + ["gv%d" % i for i in range(self.args.decl_width)]
+
+    def term(self, scope, budget):
+        choice = self.rng.random()
+        if choice < 0.35:
+            return self.rng.choice(self.readable(scope))
+        if choice < 0.55:
+            return str(self.rng.randint(1, 100))
+        if choice < 0.65:
+            return "ga[%d]" % self.rng.randint(1, self.args.array_size)
+        if choice < 0.72 and scope["callees"] and budget[0] > 0:
+            budget[0] -= 1
+            callee = self.rng.choice(scope["callees"])
+            return "%s(%s, %s)" % (callee, self.expression(scope, 2, budget),
+                                   self.expression(scope, 2, budget))
+        if choice < 0.8:
+            return "gc"
+        return "(%s)" % self.expression(scope, 3, budget)
+
+    def expression(self, scope, terms, budget=None):
+        if budget is None:
+            budget = [2]
+        text = self.term(scope, budget)
+        for _ in range(terms - 1):
+            op = self.rng.choice(["+", "-", "*", "+", "-", "mod"])
+            if op == "mod":
+                text = "(%s) mod %d" % (text, self.rng.randint(2, 97))
+            else:
+                text = "%s %s %s" % (text, op, self.term(scope, budget))
+        return text
+
+    def condition(self, scope):
+        relation = "%s %s %s" % (self.expression(scope, 2),
+                                 self.rng.choice(["<", "<=", ">", ">=", "=", "<>"]),
+                                 self.expression(scope, 2))
+        choice = self.rng.random()
+        if choice < 0.2:
+            return "not (%s)" % relation
+        if choice < 0.4:
+            return "%s and %s" % (relation, self.condition_leaf(scope))
+        return relation
+
+    def condition_leaf(self, scope):
+        return "%s < %d" % (self.rng.choice(self.readable(scope)), self.rng.randint(1, 100))
+
+    def assignable(self, scope):
+        choice = self.rng.random()
+        if choice < 0.6 and scope["vars"]:
+            return self.rng.choice(scope["vars"])
+        if choice < 0.8:
+            return "gv%d" % self.rng.randrange(self.args.decl_width)
+        return "ga[%d]" % self.rng.randint(1, self.args.array_size)
+
+    def block(self, scope, depth, statements):
+        self.emit("begin")
+        self.indent += 1
+        for _ in range(statements):
+            self.statement(scope, depth)
+        self.indent -= 1
+        self.emit("end")
+
+    def statement(self, scope, depth):
+        choice = self.rng.random()
+        nested = depth < self.args.depth
+        body = max(1, self.args.statements // 4)
+        if nested and choice < 0.15:
+            self.emit("if %s then" % self.condition(scope))
+            self.block(scope, depth + 1, body)
+            self.emit("else")
+            self.block(scope, depth + 1, body)
+            self.emit("end if")
+        elif nested and choice < 0.25:
+            counter = "w%d" % depth
+            self.emit("%s := 0;" % counter)
+            self.emit("while %s < %d do" % (counter, self.rng.randint(1, 4)))
+            self.emit("begin")
+            self.indent += 1
+            for _ in range(body):
+                self.statement(scope, depth + 1)
+            self.emit("%s := %s + 1;" % (counter, counter))
+            self.indent -= 1
+            self.emit("end")
+            self.emit("end do")
+        elif nested and choice < 0.35:
+            loop_var = "i%d" % depth
+            lower = self.rng.randint(1, 5)
+            self.emit("for %s := %d to %d do" % (loop_var, lower, lower + self.rng.randint(1, 4)))
+            scope["loop_vars"].append(loop_var)
+            self.block(scope, depth + 1, body)
+            scope["loop_vars"].pop()
+            self.emit("end do")
+        elif choice < 0.45:
+            self.emit("print %s;" % self.expression(scope, self.args.expr_terms))
+        else:
+            self.emit("%s := %s;" % (self.assignable(scope),
+                                     self.expression(scope, self.args.expr_terms)))
+
+    def local_declarations(self, scope):
+        names = ["l%d" % i for i in range(self.args.decl_width)]
+        self.emit("var %s: integer;" % ", ".join(names))
+        self.emit("var %s: integer;" % ", ".join("w%d" % i for i in range(self.args.depth + 1)))
+        scope["vars"] += names + ["w%d" % i for i in range(self.args.depth + 1)]
+
+    def function(self, index):
+        name = "f%d" % index
+        self.emit("%s(a, b: integer): integer" % name)
+        self.emit("begin")
+        self.indent += 1
+        # a window of earlier functions keeps the call graph acyclic and bounded
+        scope = {"vars": ["a", "b"], "loop_vars": [],
+                 "callees": ["f%d" % i for i in range(max(0, index - 3), index)]}
+        self.local_declarations(scope)
+        for _ in range(self.args.statements):
+            self.statement(scope, 0)
+        self.emit("return %s;" % self.expression(scope, self.args.expr_terms))
+        self.indent -= 1
+        self.emit("end")
+        self.emit("end")
+        self.emit()
+
+    def program(self):
+        for pragma in ("S", "T", "D"):
+            self.emit("//&%s-" % pragma)
+        self.emit()
+        self.emit("%s;" % self.args.name)
+        self.emit()
+        self.emit("var %s: integer;" % ", ".join("gv%d" % i for i in range(self.args.decl_width)))
+        self.emit("var ga: array %d of integer;" % self.args.array_size)
+        self.emit("var gc: 7;")
+        self.emit()
+        for index in range(self.args.functions):
+            self.function(index)
+        self.emit("begin")
+        self.indent += 1
+        scope = {"vars": [], "loop_vars": [],
+                 "callees": ["f%d" % i for i in range(max(0, self.args.functions - 3),
+                                                       self.args.functions)]}
+        self.local_declarations(scope)
+        for _ in range(self.args.statements):
+            self.statement(scope, 0)
+        self.indent -= 1
+        self.emit("end")
+        self.emit("end")
+        return "\n".join(self.lines) + "\n"
+
+def main():
+    parser = ArgumentParser()
+    parser.add_argument("--functions", type=int, default=100)
+    parser.add_argument("--statements", type=int, default=8,
+                        help="Statements per function body; nested blocks get a quarter.")
+    parser.add_argument("--depth", type=int, default=3, help="Nesting depth of if/while/for.")
+    parser.add_argument("--expr-terms", type=int, default=6, help="Terms of each long expression.")
+    parser.add_argument("--decl-width", type=int, default=16,
+                        help="Variables in each global and local declaration.")
+    parser.add_argument("--array-size", type=int, default=4096)
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--name", default="generated", help="Program name; match the file name.")
+    parser.add_argument("-o", "--output", help="Output file (default: stdout).")
+    args = parser.parse_args()
+
+    text = Generator(args).program()
+    if args.output:
+        with open(args.output, "w") as output:
+            output.write(text)
+    else:
+        sys.stdout.write(text)
+
+if __name__ == "__main__":
+    main()
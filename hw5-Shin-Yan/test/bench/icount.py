@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+
+# Tracks the speed of the generated code: counts the dynamic instructions
+# and cycles of each kernel in this directory and compares them against
+# baseline.json, failing when a kernel got slower or its output changed.
+# The counts come from the compiler's simulator (--simulate), which is
+# exact and needs no toolchain, or with --spike from the spike commit log
+# of the same build test.py runs, which includes pk's own instructions.
+# Run with --update to accept the current counts as the new baseline.
+
+import glob
+import hashlib
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+from argparse import ArgumentParser
+
+def simulate(args, kernel):
+    proc = subprocess.run("%s %s --simulate --core=%s --save-path %s %s < /dev/null" %
+                          (args.compiler, kernel, args.core, args.work_dir, args.compiler_flags),
+                          shell=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                          universal_newlines=True)
+    instructions = re.search(r"^instructions\s+(\d+)$", proc.stderr, re.M)
+    cycles = re.search(r"^cycles\s+(\d+)$", proc.stderr, re.M)
+    if proc.returncode != 0 or instructions is None or cycles is None:
+        return None
+    return {"instructions": int(instructions.group(1)), "cycles": int(cycles.group(1)),
+            "output": hashlib.sha1(proc.stdout.encode()).hexdigest()}
+
+def spike(args, kernel):
+    name = os.path.splitext(os.path.basename(kernel))[0]
+    executable = os.path.join(args.work_dir, name)
+    if subprocess.run("%s %s --save-path %s %s > /dev/null && "
+                      "riscv32-unknown-elf-gcc %s/%s.S %s -o %s" %
+                      (args.compiler, kernel, args.work_dir, args.compiler_flags,
+                       args.work_dir, name, args.io_file, executable),
+                      shell=True).returncode != 0:
+        return None
+    # -l logs every retired instruction on stderr as "core   0: 0x... (0x...) ..."
+    proc = subprocess.Popen(["spike", "-l", "--isa=RV32", args.pk, executable],
+                            stdin=subprocess.DEVNULL, stdout=subprocess.PIPE,
+                            stderr=subprocess.PIPE)
+    output, log = proc.communicate()
+    if proc.returncode != 0:
+        return None
+    instructions = sum(1 for line in log.splitlines() if line.startswith(b"core"))
+    # pk prints its banner first
+    output = output.split(b"\n", 1)[-1]
+    return {"instructions": instructions, "output": hashlib.sha1(output).hexdigest()}
+
+def main():
+    bench_dir = os.path.dirname(os.path.abspath(__file__))
+    parser = ArgumentParser()
+    parser.add_argument("--compiler", help="Compiler to benchmark.",
+                        default=os.path.join(bench_dir, "../../src/compiler"))
+    parser.add_argument("--io-file", help="IO file for io function",
+                        default=os.path.join(bench_dir, "../io.c"))
+    parser.add_argument("--pk", help="Proxy kernel for spike.",
+                        default="/risc-v/riscv32-unknown-elf/bin/pk")
+    parser.add_argument("--spike", action="store_true",
+                        help="Count with spike's commit log instead of the simulator.")
+    parser.add_argument("--core", default="inorder", help="Core model the cycles are counted on.")
+    parser.add_argument("--compiler-flags", default="")
+    parser.add_argument("--baseline", default=os.path.join(bench_dir, "baseline.json"))
+    parser.add_argument("--update", action="store_true", help="Write the counts as the baseline.")
+    parser.add_argument("--tolerance", type=float, default=0.0,
+                        help="Percentage a count may grow by before it is a regression.")
+    parser.add_argument("--work-dir", default="./bench_build")
+    args = parser.parse_args()
+
+    mode = "spike" if args.spike else "simulate"
+    if args.spike and (shutil.which("spike") is None or
+                       shutil.which("riscv32-unknown-elf-gcc") is None):
+        sys.exit("spike or riscv32-unknown-elf-gcc not found")
+    os.makedirs(args.work_dir, exist_ok=True)
+
+    baseline = {}
+    if os.path.exists(args.baseline):
+        with open(args.baseline) as baseline_file:
+            baseline = json.load(baseline_file)
+    # a baseline is per counting mode and per set of flags
+    key = "%s %s core=%s" % (mode, args.compiler_flags.strip() or "-O2",
+                             "spike" if args.spike else args.core)
+    expected = baseline.get(key, {})
+
+    failures = 0
+    current = {}
+    print("%-12s %-13s %14s %14s %9s" % ("kernel", "count", "baseline", "current", "change"))
+    for kernel in sorted(glob.glob(os.path.join(bench_dir, "*.p"))):
+        name = os.path.splitext(os.path.basename(kernel))[0]
+        counts = spike(args, kernel) if args.spike else simulate(args, kernel)
+        if counts is None:
+            print("%-12s failed to compile or run" % name)
+            failures += 1
+            continue
+        current[name] = counts
+        old = expected.get(name)
+        for count in ("instructions", "cycles"):
+            if count not in counts:
+                continue
+            before = old.get(count) if old else None
+            change = "new"
+            if before:
+                growth = 100.0 * (counts[count] - before) / before
+                change = "%+.2f%%" % growth
+                if growth > args.tolerance:
+                    change += " slower"
+                    failures += 1
+            print("%-12s %-13s %14s %14d %9s" % (name, count, "-" if before is None else before,
+                                                 counts[count], change))
+        if old and old.get("output") != counts["output"] and not args.update:
+            print("%-12s output differs from the baseline run" % name)
+            failures += 1
+
+    if args.update:
+        baseline[key] = current
+        with open(args.baseline, "w") as baseline_file:
+            json.dump(baseline, baseline_file, indent=2, sort_keys=True)
+            baseline_file.write("\n")
+        print("wrote %s [%s]" % (args.baseline, key))
+    elif failures:
+        print("%d regression(s) against %s [%s]" % (failures, args.baseline, key))
+        sys.exit(1)
+
+if __name__ == "__main__":
+    main()
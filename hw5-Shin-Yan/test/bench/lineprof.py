@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+
+# Folds the instructions a P program executed into counts per function and
+# per source line, and prints the source annotated with them. It reads
+# either the profile the simulator writes:
+#
+#   ../../src/compiler sort.p --simulate --pc-profile=sort.pcprof
+#   python3 lineprof.py sort.pcprof
+#
+# or, for a program built from a -g .S file with the RISC-V toolchain, the
+# spike -l log (or a trace with one hex pc per line) and the executable,
+# whose line table riscv32-unknown-elf-addr2line reads:
+#
+#   spike -l --isa=RV32 pk sort 2> sort.log
+#   python3 lineprof.py --spike-log sort.log --elf sort --source sort.p
+
+import bisect
+import collections
+import re
+import subprocess
+import sys
+from argparse import ArgumentParser
+
+PC = re.compile(r"(0x[0-9a-fA-F]+)")
+
+def read_simulator_profile(path):
+    source = None
+    functions = []
+    lines = []
+    counts = collections.Counter()
+    with open(path) as profile:
+        for text in profile:
+            fields = text.split()
+            if not fields:
+                continue
+            if fields[0] == "p-pc-profile":
+                source = text.split(None, 1)[1].strip()
+            elif fields[0] == "func":
+                functions.append((int(fields[1], 16), fields[2]))
+            elif fields[0] == "line":
+                lines.append((int(fields[1], 16), int(fields[2])))
+            elif fields[0] == "pc":
+                counts[int(fields[1], 16)] += int(fields[2])
+    functions.sort()
+    lines.sort()
+
+    function_starts = [address for address, _ in functions]
+    line_starts = [address for address, _ in lines]
+    attributed = {}
+    for pc in counts:
+        function = bisect.bisect_right(function_starts, pc) - 1
+        line = bisect.bisect_right(line_starts, pc) - 1
+        name = functions[function][1] if function >= 0 else "?"
+        # a line entry of an earlier function does not describe this pc
+        if line < 0 or (function >= 0 and lines[line][0] < functions[function][0]):
+            attributed[pc] = (name, None)
+        else:
+            attributed[pc] = (name, lines[line][1])
+    return source, counts, attributed
+
+def read_trace(path):
+    counts = collections.Counter()
+    with open(path, errors="replace") as trace:
+        for text in trace:
+            # "core   0: 0x00010074 (0x00000513) li a0, 0" or a bare pc
+            if text.startswith("core") and ">>>>" not in text:
+                match = PC.search(text.split(":", 1)[1])
+            else:
+                match = PC.match(text.strip())
+            if match:
+                counts[int(match.group(1), 16)] += 1
+    return counts
+
+def addr2line(addr2line_tool, elf, pcs):
+    proc = subprocess.run([addr2line_tool, "-f", "-e", elf],
+                          input="".join("0x%x\n" % pc for pc in pcs),
+                          stdout=subprocess.PIPE, universal_newlines=True, check=True)
+    output = proc.stdout.splitlines()
+    attributed = {}
+    for i, pc in enumerate(pcs):
+        name = output[2 * i]
+        location = output[2 * i + 1].rsplit(":", 1)
+        line = location[1].split()[0] if len(location) == 2 else "?"
+        attributed[pc] = (name, int(line) if line.isdigit() and line != "0" else None)
+    return attributed
+
+def main():
+    parser = ArgumentParser()
+    parser.add_argument("profile", nargs="?", help="Profile from --simulate --pc-profile.")
+    parser.add_argument("--spike-log", help="spike -l log or pc trace to fold instead.")
+    parser.add_argument("--elf", help="Executable the spike log ran, built from -g code.")
+    parser.add_argument("--addr2line", default="riscv32-unknown-elf-addr2line")
+    parser.add_argument("--source", help="P source (default: the one in the profile).")
+    args = parser.parse_args()
+
+    if args.spike_log:
+        if not args.elf or not args.source:
+            sys.exit("--spike-log needs --elf and --source")
+        counts = read_trace(args.spike_log)
+        attributed = addr2line(args.addr2line, args.elf, sorted(counts))
+        # pk and libc have no line of the source
+        counts = collections.Counter({pc: count for pc, count in counts.items()
+                                      if attributed[pc][1] is not None})
+        source = args.source
+    elif args.profile:
+        source, counts, attributed = read_simulator_profile(args.profile)
+        source = args.source or source
+    else:
+        sys.exit("give a profile, or --spike-log with --elf and --source")
+
+    total = sum(counts.values())
+    if total == 0:
+        sys.exit("no instructions executed")
+    per_function = collections.Counter()
+    per_line = collections.Counter()
+    unattributed = 0
+    for pc, count in counts.items():
+        name, line = attributed[pc]
+        per_function[name] += count
+        if line is None:
+            unattributed += count
+        else:
+            per_line[line] += count
+
+    print("%-24s %14s %7s" % ("function", "instructions", "share"))
+    for name, count in per_function.most_common():
+        print("%-24s %14d %6.2f%%" % (name, count, 100.0 * count / total))
+    print("%-24s %14d" % ("total", total))
+    if unattributed:
+        print("%d instructions have no source line (build with -g)" % unattributed)
+    print()
+
+    with open(source) as source_file:
+        source_lines = source_file.read().splitlines()
+    print("%14s %7s %5s  %s" % ("instructions", "share", "line", source))
+    for number, text in enumerate(source_lines, 1):
+        count = per_line.get(number, 0)
+        if count:
+            print("%14d %6.2f%% %5d  %s" % (count, 100.0 * count / total, number, text))
+        else:
+            print("%14s %7s %5d  %s" % ("", "", number, text))
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,50 @@
+//&S-
+//&T-
+//&D-
+
+matmul;
+
+var a: array 40 of array 40 of integer;
+var b: array 40 of array 40 of integer;
+var c: array 40 of array 40 of integer;
+
+begin
+    var sum, trace: integer;
+    for i := 1 to 41 do
+    begin
+        for j := 1 to 41 do
+        begin
+            a[i][j] := i + j;
+            b[i][j] := (i * j) mod 7 - 3;
+        end
+        end do
+    end
+    end do
+    for r := 0 to 4 do
+    begin
+        for i := 1 to 41 do
+        begin
+            for j := 1 to 41 do
+            begin
+                sum := r;
+                for k := 1 to 41 do
+                begin
+                    sum := sum + a[i][k] * b[k][j];
+                end
+                end do
+                c[i][j] := sum;
+            end
+            end do
+        end
+        end do
+    end
+    end do
+    trace := 0;
+    for i := 1 to 41 do
+    begin
+        trace := trace + c[i][i];
+    end
+    end do
+    print trace;
+end
+end
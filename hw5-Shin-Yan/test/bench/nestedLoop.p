@@ -0,0 +1,22 @@
+//&S-
+//&T-
+//&D-
+
+nestedLoop;
+
+var sum: integer;
+
+begin
+    sum := 0;
+    for i := 0 to 3000 do
+    begin
+        for j := 0 to 1000 do
+        begin
+            sum := sum + i * j mod 7;
+        end
+        end do
+    end
+    end do
+    print sum;
+end
+end
@@ -0,0 +1,41 @@
+//&S-
+//&T-
+//&D-
+
+sieve;
+
+var composite: array 20000 of boolean;
+
+begin
+    var count: integer;
+    count := 0;
+    for r := 0 to 50 do
+    begin
+        for i := 1 to 20000 do
+        begin
+            composite[i] := false;
+        end
+        end do
+        count := 0;
+        for i := 2 to 20000 do
+        begin
+            if not composite[i] then
+            begin
+                var j: integer;
+                count := count + 1;
+                j := i * i;
+                while j < 20000 do
+                begin
+                    composite[j] := true;
+                    j := j + i;
+                end
+                end do
+            end
+            end if
+        end
+        end do
+    end
+    end do
+    print count;
+end
+end
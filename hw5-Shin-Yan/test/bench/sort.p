@@ -0,0 +1,70 @@
+//&S-
+//&T-
+//&D-
+
+sort;
+
+var data: array 800 of integer;
+
+begin
+    var seed, checksum, unsorted: integer;
+    seed := 42;
+    for i := 1 to 801 do
+    begin
+        seed := (seed * 1103 + 12345) mod 65536;
+        data[i] := seed;
+    end
+    end do
+    // insertion sort
+    for i := 2 to 801 do
+    begin
+        var key, j: integer;
+        var moving: boolean;
+        key := data[i];
+        j := i - 1;
+        moving := true;
+        while moving do
+        begin
+            if j < 1 then
+            begin
+                moving := false;
+            end
+            else
+            begin
+                if data[j] > key then
+                begin
+                    data[j + 1] := data[j];
+                    j := j - 1;
+                end
+                else
+                begin
+                    moving := false;
+                end
+                end if
+            end
+            end if
+        end
+        end do
+        data[j + 1] := key;
+    end
+    end do
+    checksum := 0;
+    unsorted := 0;
+    for i := 1 to 801 do
+    begin
+        checksum := (checksum * 31 + data[i]) mod 1000003;
+    end
+    end do
+    for i := 2 to 801 do
+    begin
+        if data[i - 1] > data[i] then
+        begin
+            unsorted := unsorted + 1;
+        end
+        end if
+    end
+    end do
+    print checksum;
+    print unsorted;
+end
+end
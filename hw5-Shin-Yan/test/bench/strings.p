@@ -0,0 +1,20 @@
+//&S-
+//&T-
+//&D-
+
+strings;
+
+begin
+    var greeting, separator: string;
+    greeting := "hello, world";
+    separator := "----";
+    for i := 0 to 3000 do
+    begin
+        print greeting;
+        print "line";
+        print i;
+        print separator;
+    end
+    end do
+end
+end
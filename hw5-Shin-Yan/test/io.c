@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdlib.h>
 
 void printInt(int value)
 {
@@ -27,3 +28,47 @@ void printString(char *value)
 {
     printf("%s\n", value);
 }
+
+void printFixed(int value)
+{
+    printf("%f\n", value / 65536.0);
+}
+
+int readFixed(){
+    float value;
+    scanf("%f", &value);
+    return (int)(value * 65536.0f);
+}
+
+static unsigned *profile_counters;
+static int profile_count;
+static const char *profile_path;
+
+static void writeProfile(void)
+{
+    FILE *file = fopen(profile_path, "w");
+    if (file == NULL) {
+        perror(profile_path);
+        return;
+    }
+    fprintf(file, "p-profile %d\n", profile_count);
+    for (int i = 0; i < profile_count; ++i)
+        fprintf(file, "%u\n", profile_counters[i]);
+    fclose(file);
+}
+
+// called on entry to main by a --profile-generate build
+void profileInit(unsigned *counters, int count, const char *path)
+{
+    profile_counters = counters;
+    profile_count = count;
+    profile_path = path;
+    atexit(writeProfile);
+}
+
+// called by a --bounds-check build when an array index is out of range
+void boundsCheckFailed(int line, int index, int size)
+{
+    fprintf(stderr, "line %d: index %d out of bounds [1, %d]\n", line, index, size);
+    exit(1);
+}
@@ -0,0 +1,26 @@
+//&S-
+//&T-
+//&D-
+
+boundsElided;
+
+var size: 20;
+
+begin
+    var a: array 20 of integer;
+    var sum: integer;
+    for i := 1 to 21 do
+    begin
+        a[i] := i * i;
+    end
+    end do
+    sum := 0;
+    for i := 0 to 100 do
+    begin
+        sum := sum + a[i mod size + 1];
+    end
+    end do
+    print sum;
+    print a[size - 1] - a[21 - size];
+end
+end
@@ -0,0 +1,21 @@
+//&S-
+//&T-
+//&D-
+
+boundsTrap;
+
+begin
+    var a: array 5 of integer;
+    var n: integer;
+    for i := 1 to 6 do
+    begin
+        a[i] := i * 2;
+    end
+    end do
+    n := 5;
+    print a[n];
+    n := n + 1;
+    print a[n];
+    print 0;
+end
+end
@@ -0,0 +1,13 @@
+//&S-
+//&T-
+//&D-
+
+boundsWrap;
+
+begin
+    var a: array 5 of integer;
+    // 2147483647 + 1 wraps to -2147483648, and the index to -2
+    a[(2147483647 + 1) mod 5 + 1] := 1;
+    print 0;
+end
+end
@@ -0,0 +1,42 @@
+//&S-
+//&T-
+//&D-
+
+globalArray;
+
+var m: array 3 of array 4 of integer;
+var flags: array 5 of boolean;
+
+begin
+    for i := 1 to 4 do
+    begin
+        for j := 1 to 5 do
+        begin
+            m[i][j] := i * 10 + j;
+        end
+        end do
+    end
+    end do
+    flags[2] := true;
+    print m[2][3];
+    print m[3][4] + m[1][1];
+    if flags[2] then
+    begin
+        print 1;
+    end
+    else
+    begin
+        print 0;
+    end
+    end if
+    if flags[3] then
+    begin
+        print 1;
+    end
+    else
+    begin
+        print 0;
+    end
+    end if
+end
+end
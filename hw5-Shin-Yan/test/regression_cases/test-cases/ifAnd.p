@@ -0,0 +1,42 @@
+//&S-
+//&T-
+//&D-
+
+ifAnd;
+
+begin
+    var a, b: boolean;
+    var x: integer;
+    x := 3;
+    a := x > 0;
+    b := x > 5;
+    if a and b then
+    begin
+        print 1;
+    end
+    else
+    begin
+        print 0;
+    end
+    end if
+    b := not b;
+    if a and b then
+    begin
+        print 1;
+    end
+    else
+    begin
+        print 0;
+    end
+    end if
+    if a or b then
+    begin
+        print 1;
+    end
+    else
+    begin
+        print 0;
+    end
+    end if
+end
+end
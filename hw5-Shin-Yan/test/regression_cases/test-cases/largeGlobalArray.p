@@ -0,0 +1,28 @@
+//&S-
+//&T-
+//&D-
+
+largeGlobalArray;
+
+// strides of 4000 and 4 bytes sum to more than an addi can add
+var m: array 10 of array 1000 of integer;
+
+begin
+    var s: integer;
+    for i := 1 to 11 do
+    begin
+        m[i][1] := i;
+        m[i][1000] := i * 1000;
+    end
+    end do
+    s := 0;
+    for i := 1 to 11 do
+    begin
+        s := s + m[i][1] + m[i][1000];
+    end
+    end do
+    print s;
+    print m[10][1000];
+    print m[1][1];
+end
+end
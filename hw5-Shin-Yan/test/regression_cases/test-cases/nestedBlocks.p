@@ -0,0 +1,32 @@
+//&S-
+//&T-
+//&D-
+
+nestedBlocks;
+
+begin
+    var count: integer;
+    count := 0;
+    for i := 1 to 6 do
+    begin
+        if i mod 2 = 0 then
+        begin
+            var j: integer;
+            j := i;
+            while j < 10 do
+            begin
+                count := count + 1;
+                j := j + i;
+            end
+            end do
+        end
+        else
+        begin
+            count := count + 100;
+        end
+        end if
+    end
+    end do
+    print count;
+end
+end
@@ -0,0 +1,54 @@
+//&S-
+//&T-
+//&D-
+
+signedCompare;
+
+begin
+    var b, c: integer;
+    var p: boolean;
+    b := 5;
+    c := -2147483647;
+    // an unsigned comparison would order c above b
+    p := c > b;
+    if p then
+    begin
+        print 1;
+    end
+    else
+    begin
+        print 0;
+    end
+    end if
+    p := c < b;
+    if p then
+    begin
+        print 1;
+    end
+    else
+    begin
+        print 0;
+    end
+    end if
+    p := b <= c;
+    if p then
+    begin
+        print 1;
+    end
+    else
+    begin
+        print 0;
+    end
+    end if
+    p := b >= c;
+    if p then
+    begin
+        print 1;
+    end
+    else
+    begin
+        print 0;
+    end
+    end if
+end
+end
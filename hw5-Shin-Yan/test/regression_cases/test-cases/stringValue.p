@@ -0,0 +1,19 @@
+//&S-
+//&T-
+//&D-
+
+stringValue;
+
+begin
+    var greeting: string;
+    greeting := "hello";
+    print greeting;
+    for i := 0 to 2 do
+    begin
+        print "line";
+        print i;
+    end
+    end do
+    print "done";
+end
+end
@@ -0,0 +1,20 @@
+//&S-
+//&T-
+//&D-
+
+whileBool;
+
+begin
+    var i: integer;
+    var p: boolean;
+    i := 0;
+    p := true;
+    while p do
+    begin
+        i := i + 1;
+        p := i < 3;
+        print i;
+    end
+    end do
+end
+end
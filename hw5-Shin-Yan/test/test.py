@@ -47,12 +47,52 @@ class Grader:
     bonus_case_scores = [0, 2, 2, 3, 3, 3, 3, 3]
     bonus_id_list = bonus_cases.keys()
 
+    # programs that once miscompiled
+    regression_case_dir = "./regression_cases"
+    regression_cases = {
+        1 : "nestedBlocks",
+        2 : "globalArray",
+        3 : "stringValue",
+        4 : "boundsTrap",
+        5 : "boundsElided",
+        6 : "boundsWrap",
+        7 : "signedCompare",
+        8 : "whileBool",
+        9 : "ifAnd",
+        10 : "largeGlobalArray"
+    }
+    regression_case_scores = [0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1]
+    regression_id_list = regression_cases.keys()
+    # riscv32 options a case is compiled with; the other targets skip it
+    regression_case_flags = {
+        "boundsTrap" : "--bounds-check",
+        "boundsElided" : "--bounds-check -fcheck-elim",
+        "boundsWrap" : "--bounds-check"
+    }
+    # code the generated assembly of a case must not contain
+    regression_case_absent = {
+        "boundsElided" : "boundsCheckFailed"
+    }
+
     diff_result = ""
 
     def __init__(self, compiler, save_path, 
-                executable_file_path, code_result_path, io_file):
+                executable_file_path, code_result_path, io_file, emit_obj=False,
+                simulate=False, native=False, run_vm=False, c_source=False,
+                compiler_flags=""):
         self.compiler = compiler
+        self.compiler_flags = compiler_flags
         self.io_file = io_file
+        self.emit_obj = emit_obj
+        self.output_ext = "o" if emit_obj else "S"
+        self.simulate = simulate
+        self.native = native or c_source
+        self.run_vm = run_vm
+        self.c_source = c_source
+        if native:
+            self.output_ext = "s"
+        if c_source:
+            self.output_ext = "c"
 
         self.save_path = save_path
         if not os.path.exists(self.save_path):
@@ -77,8 +117,20 @@ class Grader:
             test_case = "%s/%s/%s.p" % (self.advance_case_dir, "test-cases", self.advance_cases[case_id])
         elif case_type == "bonus":
             test_case = "%s/%s/%s.p" % (self.bonus_case_dir, "test-cases", self.bonus_cases[case_id])
+        elif case_type == "regression":
+            test_case = "%s/%s/%s.p" % (self.regression_case_dir, "test-cases", self.regression_cases[case_id])
       
         clist = [self.compiler, test_case, "--save-path", self.save_path]
+        if self.compiler_flags:
+            clist.append(self.compiler_flags)
+        if case_type == "regression":
+            clist.append(self.regression_case_flags.get(self.regression_cases[case_id], ""))
+        if self.emit_obj:
+            clist.append("--emit=obj")
+        if self.c_source:
+            clist.append("--target=c")
+        elif self.native:
+            clist.append("--target=x86_64")
         cmd = " ".join(clist)
         try:
             proc = subprocess.Popen(cmd, shell=True)
@@ -90,16 +142,25 @@ class Grader:
 
     def compile_riscv_code(self, case_type, case_id):
         if case_type == "basic":
-            test_case = "%s/%s.S" % (self.save_path, self.basic_cases[case_id])
+            test_case = "%s/%s.%s" % (self.save_path, self.basic_cases[case_id], self.output_ext)
             executable_file = "%s/%s" % (self.executable_file_path, self.basic_cases[case_id])
         elif case_type == "advance":
-            test_case = "%s/%s.S" % (self.save_path, self.advance_cases[case_id])
+            test_case = "%s/%s.%s" % (self.save_path, self.advance_cases[case_id], self.output_ext)
             executable_file = "%s/%s" % (self.executable_file_path, self.advance_cases[case_id])
         elif case_type == "bonus":
-            test_case = "%s/%s.S" % (self.save_path, self.bonus_cases[case_id])
+            test_case = "%s/%s.%s" % (self.save_path, self.bonus_cases[case_id], self.output_ext)
             executable_file = "%s/%s" % (self.executable_file_path, self.bonus_cases[case_id])
-
-        clist = ["riscv32-unknown-elf-gcc", test_case, self.io_file, "-o", executable_file]
+        elif case_type == "regression":
+            test_case = "%s/%s.%s" % (self.save_path, self.regression_cases[case_id], self.output_ext)
+            executable_file = "%s/%s" % (self.executable_file_path, self.regression_cases[case_id])
+
+        if self.c_source:
+            cc = "gcc -std=c99 -O2 -fwrapv"
+        elif self.native:
+            cc = "gcc"
+        else:
+            cc = "riscv32-unknown-elf-gcc"
+        clist = [cc, test_case, self.io_file, "-o", executable_file]
         cmd = " ".join(clist)
         try:
             proc = subprocess.Popen(cmd, shell=True)
@@ -119,8 +180,15 @@ class Grader:
         elif case_type == "bonus":
             output_file = "%s/%s" % (self.code_result_path, self.bonus_cases[case_id])
             executable_file = "%s/%s" % (self.executable_file_path, self.bonus_cases[case_id])
-
-        clist = ["echo", "123", "|", "spike", "--isa=RV32", "/risc-v/riscv32-unknown-elf/bin/pk", executable_file]
+        elif case_type == "regression":
+            output_file = "%s/%s" % (self.code_result_path, self.regression_cases[case_id])
+            executable_file = "%s/%s" % (self.executable_file_path, self.regression_cases[case_id])
+
+        if self.native:
+            # the sample solutions start with the banner printed by pk
+            clist = ["(", "echo", "bbl loader", ";", "echo", "123", "|", executable_file, ")"]
+        else:
+            clist = ["echo", "123", "|", "spike", "--isa=RV32", "/risc-v/riscv32-unknown-elf/bin/pk", executable_file]
         cmd = " ".join(clist)
         try:
             proc = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE, shell=True)
@@ -152,6 +220,48 @@ class Grader:
             out.write(stdout)
             out.write(stderr)
 
+    def simulate_riscv_code(self, case_type, case_id):
+        if case_type == "basic":
+            test_case = "%s/%s/%s.p" % (self.basic_case_dir, "test-cases", self.basic_cases[case_id])
+            output_file = "%s/%s" % (self.code_result_path, self.basic_cases[case_id])
+        elif case_type == "advance":
+            test_case = "%s/%s/%s.p" % (self.advance_case_dir, "test-cases", self.advance_cases[case_id])
+            output_file = "%s/%s" % (self.code_result_path, self.advance_cases[case_id])
+        elif case_type == "bonus":
+            test_case = "%s/%s/%s.p" % (self.bonus_case_dir, "test-cases", self.bonus_cases[case_id])
+            output_file = "%s/%s" % (self.code_result_path, self.bonus_cases[case_id])
+        elif case_type == "regression":
+            test_case = "%s/%s/%s.p" % (self.regression_case_dir, "test-cases", self.regression_cases[case_id])
+            output_file = "%s/%s" % (self.code_result_path, self.regression_cases[case_id])
+
+        mode = "--run" if self.run_vm else "--simulate"
+        clist = ["echo", "123", "|", self.compiler, test_case, "--save-path", self.save_path, mode]
+        if self.compiler_flags:
+            clist.append(self.compiler_flags)
+        if case_type == "regression":
+            clist.append(self.regression_case_flags.get(self.regression_cases[case_id], ""))
+        cmd = " ".join(clist)
+        try:
+            proc = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE, shell=True)
+        except Exception as e:
+            print(Colors.RED + "Call of '%s' failed: %s" % (" ".join(clist), e))
+            exit(1)
+
+        stdout, stderr = proc.communicate()
+        stdout = str(stdout, "utf-8", "replace")
+
+        # the sample solutions start with the banner printed by pk
+        with open(output_file, "w") as out:
+            out.write("bbl loader\n")
+            out.write(stdout)
+            # a trap ends the output with its message, as io.c's does on spike
+            for line in str(stderr, "utf-8", "replace").splitlines():
+                _, error, message = line.partition(": simulation error: ")
+                if error:
+                    out.write(message + "\n")
+                else:
+                    print(line, file=sys.stderr)
+
     def compare_file_content(self, case_type, case_id):
         if case_type == "basic":
             output_file = "%s/%s" % (self.code_result_path, self.basic_cases[case_id])
@@ -162,6 +272,9 @@ class Grader:
         elif case_type == "bonus":
             output_file = "%s/%s" % (self.code_result_path, self.bonus_cases[case_id])
             solution = "%s/%s/%s" % (self.bonus_case_dir, "sample-solutions", self.bonus_cases[case_id])
+        elif case_type == "regression":
+            output_file = "%s/%s" % (self.code_result_path, self.regression_cases[case_id])
+            solution = "%s/%s/%s" % (self.regression_case_dir, "sample-solutions", self.regression_cases[case_id])
 
         clist = ["diff", "-Z", "-u", output_file, solution, f'--label="your output:({output_file})"', f'--label="answer:({solution})"']
         cmd = " ".join(clist)
@@ -182,16 +295,32 @@ class Grader:
                 self.diff_result += "{}\n".format(self.advance_cases[case_id])
             elif case_type == "bonus":
                 self.diff_result += "{}\n".format(self.bonus_cases[case_id])
+            elif case_type == "regression":
+                self.diff_result += "{}\n".format(self.regression_cases[case_id])
             self.diff_result += "{}\n".format(output)
 
         return retcode == 0
     
+    def check_absent_code(self, case_type, case_id):
+        if case_type != "regression" or self.regression_cases[case_id] not in self.regression_case_absent:
+            return True
+        c_name = self.regression_cases[case_id]
+        with open("%s/%s.S" % (self.save_path, c_name)) as code:
+            if self.regression_case_absent[c_name] not in code.read():
+                return True
+        self.diff_result += "{}\nthe code contains {}\n".format(c_name, self.regression_case_absent[c_name])
+        return False
+
     def test_sample_case(self, case_type, case_id):
+        if self.simulate or self.run_vm:
+            self.simulate_riscv_code(case_type, case_id)
+            return self.compare_file_content(case_type, case_id) and self.check_absent_code(case_type, case_id)
+
         self.gen_riscv_code(case_type, case_id)
         self.compile_riscv_code(case_type, case_id)
         self.run_riscv_code(case_type, case_id)
 
-        return self.compare_file_content(case_type, case_id)
+        return self.compare_file_content(case_type, case_id) and self.check_absent_code(case_type, case_id)
 
     def run(self):
         print("---\tCase\t\tPoints")
@@ -229,6 +358,19 @@ class Grader:
             total_score += get_val
             max_score += max_val
 
+        for r_id in self.regression_id_list:
+            c_name = self.regression_cases[r_id]
+            if c_name in self.regression_case_flags and (self.native or self.run_vm):
+                print("---\t%s\tskipped, riscv32 only" % c_name)
+                continue
+            print("+++ TESTING regression case %s:" % c_name)
+            ok = self.test_sample_case("regression", r_id)
+            max_val = self.regression_case_scores[r_id]
+            get_val = max_val if ok else 0
+            print("---\t%s\t%d/%d" % (c_name, get_val, max_val))
+            total_score += get_val
+            max_score += max_val
+
         print("---\tTOTAL\t\t%d/%d" % (total_score, max_score))
 
         with open("{}/{}".format(self.output_dir, "score.txt"), "w") as result:
@@ -249,13 +391,31 @@ def main():
                                         default="./code_executed_result")
     parser.add_argument("--io-file", help="IO file for io function", 
                                     default="./io.c")
+    parser.add_argument("--emit-obj", help="Link the .o files written by the compiler instead of assembling its .S output.",
+                                    action="store_true")
+    parser.add_argument("--simulate", help="Run the programs on the compiler's built-in simulator instead of spike.",
+                                    action="store_true")
+    parser.add_argument("--native", help="Generate x86-64 code and run it on the host instead of spike.",
+                                    action="store_true")
+    parser.add_argument("--run", help="Run the programs on the compiler's bytecode virtual machine instead of spike.",
+                                    action="store_true")
+    parser.add_argument("--c", help="Translate the programs to C, build them with the host compiler and run them on the host instead of spike.",
+                                    action="store_true")
+    parser.add_argument("--compiler-flags", help="Extra options passed to the compiler, e.g. \"-mtune=inorder\".",
+                                    default="")
     args = parser.parse_args()
 
     g = Grader(compiler = args.compiler, 
                 save_path = args.save_path,
                 executable_file_path = args.executable_file_path,
                 code_result_path = args.code_result_path,
-                io_file = args.io_file)
+                io_file = args.io_file,
+                emit_obj = args.emit_obj,
+                simulate = args.simulate,
+                native = args.native,
+                run_vm = args.run,
+                c_source = args.c,
+                compiler_flags = args.compiler_flags)
     g.run()
 
 if __name__ == "__main__":